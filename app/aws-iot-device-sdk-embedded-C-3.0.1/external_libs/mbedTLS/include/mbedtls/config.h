@@ -97,9 +97,13 @@
 //#define MBEDTLS_PLATFORM_FPRINTF_ALT
 //#define MBEDTLS_PLATFORM_EXIT_ALT
 
-//#define MBEDTLS_SSL_IN_CONTENT_LEN	(8*1024)
-//#define MBEDTLS_SSL_OUT_CONTENT_LEN	    (2*1024)
-//#define MBEDTLS_SSL_MAX_FRAGMENT_LENGTH
+//Record buffers. Outgoing records are limited by us, so 2K is enough for
+//MQTT packets and the client certificate. Incoming buffer has to hold the
+//largest record server may send; reduce it only if server is known to
+//honour max_fragment_length (see IOT_TLS_MAX_FRAGMENT_LEN in aws_iot_config.h).
+//#define MBEDTLS_SSL_IN_CONTENT_LEN	(4*1024)
+#define MBEDTLS_SSL_OUT_CONTENT_LEN	    (2*1024)
+#define MBEDTLS_SSL_MAX_FRAGMENT_LENGTH
 
 //#define MBEDTLS_MPI_MAX_SIZE 512
 //#define MBEDTLS_MPI_WINDOW_SIZE 1 
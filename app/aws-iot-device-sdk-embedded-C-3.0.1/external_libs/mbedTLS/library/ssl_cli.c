@@ -1165,6 +1165,10 @@ static int ssl_parse_max_fragment_length_ext( mbedtls_ssl_context *ssl,
         return( MBEDTLS_ERR_SSL_BAD_HS_SERVER_HELLO );
     }
 
+    /* Record that the server echoed it, session mfl_code is otherwise
+     * left at MBEDTLS_SSL_MAX_FRAG_LEN_NONE on the client side */
+    ssl->session_negotiate->mfl_code = buf[0];
+
     return( 0 );
 }
 #endif /* MBEDTLS_SSL_MAX_FRAGMENT_LENGTH */
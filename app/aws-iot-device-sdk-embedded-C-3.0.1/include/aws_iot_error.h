@@ -156,7 +156,11 @@ typedef enum {
 	/** Some limit has been exceeded, e.g. the maximum number of subscriptions has been reached */
 			LIMIT_EXCEEDED_ERROR = -51,
 	/** Invalid input topic type */
-			INVALID_TOPIC_TYPE_ERROR = -52
+			INVALID_TOPIC_TYPE_ERROR = -52,
+	/** Broker refused one or more topic filters of a SUBSCRIBE */
+			MQTT_SUBSCRIBE_REJECTED_ERROR = -53,
+	/** Broker refused request with an MQTT 5 failure reason code */
+			MQTT_REQUEST_REJECTED_ERROR = -54
 } IoT_Error_t;
 
 #ifdef __cplusplus
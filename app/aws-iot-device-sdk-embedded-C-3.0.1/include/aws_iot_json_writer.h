@@ -0,0 +1,139 @@
+/*
+ * Copyright 2010-2015 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file aws_iot_json_writer.h
+ * @brief Cursor based JSON writer used to build Shadow and Jobs documents
+ *
+ * The writer keeps the length of the document it has produced so far, so every
+ * append writes at the cursor instead of rescanning the buffer with strlen.
+ * Appenders never fail individually; the first error is latched in the writer
+ * and all later appenders turn into no-ops (or, on truncation, only keep
+ * counting). Check rc once after the document is complete.
+ */
+
+#ifndef AWS_IOT_SDK_SRC_JSON_WRITER_H_
+#define AWS_IOT_SDK_SRC_JSON_WRITER_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "aws_iot_error.h"
+
+/**
+ * @brief State of a JSON document under construction
+ */
+typedef struct {
+	char *pBuffer; ///< Output buffer, always null terminated while rc is SUCCESS
+	size_t bufferSize; ///< Size of pBuffer in bytes
+	size_t length; ///< Length of the document, including anything that did not fit
+	bool needSeparator; ///< A comma must precede the next member of the current object
+	IoT_Error_t rc; ///< First error hit while writing
+} AwsIotJsonWriter;
+
+/**
+ * @brief Start a new document in the given buffer
+ *
+ * A NULL buffer with a size of 0 is allowed; the writer then only measures the
+ * document and rc ends up as SHADOW_JSON_BUFFER_TRUNCATED with length holding
+ * the size required.
+ *
+ * @param pWriter Writer to initialize
+ * @param pBuffer Output buffer
+ * @param bufferSize Size of pBuffer
+ */
+void aws_iot_json_writer_init(AwsIotJsonWriter *pWriter, char *pBuffer, size_t bufferSize);
+
+/**
+ * @brief Continue writing a document that already holds length bytes
+ *
+ * The next member is preceded by a comma unless the document ends with the
+ * opening brace of an object.
+ *
+ * @param pWriter Writer to initialize
+ * @param pBuffer Output buffer holding the document
+ * @param bufferSize Size of pBuffer
+ * @param length Number of bytes of pBuffer already in use
+ */
+void aws_iot_json_writer_resume(AwsIotJsonWriter *pWriter, char *pBuffer, size_t bufferSize, size_t length);
+
+/**
+ * @brief Open an object, as a member called pKey or as a bare value if pKey is NULL
+ */
+void aws_iot_json_writer_begin_object(AwsIotJsonWriter *pWriter, const char *pKey);
+
+/**
+ * @brief Close the innermost open object
+ */
+void aws_iot_json_writer_end_object(AwsIotJsonWriter *pWriter);
+
+/**
+ * @brief Write the name of the next member; the value must follow with pKey NULL
+ */
+void aws_iot_json_writer_key(AwsIotJsonWriter *pWriter, const char *pKey);
+
+/**
+ * @brief Append a signed integer member
+ */
+void aws_iot_json_writer_int32(AwsIotJsonWriter *pWriter, const char *pKey, int32_t value);
+
+/**
+ * @brief Append an unsigned integer member
+ */
+void aws_iot_json_writer_uint32(AwsIotJsonWriter *pWriter, const char *pKey, uint32_t value);
+
+/**
+ * @brief Append a 64 bit signed integer member
+ */
+void aws_iot_json_writer_int64(AwsIotJsonWriter *pWriter, const char *pKey, int64_t value);
+
+/**
+ * @brief Append a floating point member
+ */
+void aws_iot_json_writer_double(AwsIotJsonWriter *pWriter, const char *pKey, double value);
+
+/**
+ * @brief Append a true/false member
+ */
+void aws_iot_json_writer_bool(AwsIotJsonWriter *pWriter, const char *pKey, bool value);
+
+/**
+ * @brief Append a string member, escaped as needed; a NULL value is written as null
+ */
+void aws_iot_json_writer_string(AwsIotJsonWriter *pWriter, const char *pKey, const char *pValue);
+
+/**
+ * @brief Append a member whose value is already serialized JSON, copied verbatim
+ */
+void aws_iot_json_writer_object(AwsIotJsonWriter *pWriter, const char *pKey, const char *pJson);
+
+/**
+ * @brief Append printf formatted text verbatim at the cursor
+ *
+ * No separator is written, this is meant for building a value piecewise after
+ * aws_iot_json_writer_key().
+ */
+void aws_iot_json_writer_format(AwsIotJsonWriter *pWriter, const char *pFormat, ...);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AWS_IOT_SDK_SRC_JSON_WRITER_H_ */
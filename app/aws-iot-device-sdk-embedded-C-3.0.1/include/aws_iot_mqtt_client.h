@@ -95,11 +95,13 @@ typedef struct {
 /**
  * @brief MQTT Version Type
  *
- * Defining an MQTT version type. Only 3.1.1 is supported at this time
+ * Defining an MQTT version type. MQTT 5 support covers topic aliases, receive
+ * maximum and reason codes, other MQTT 5 features are not used
  *
  */
 typedef enum {
-	MQTT_3_1_1 = 4    ///< MQTT 3.1.1 (protocol message byte = 4)
+	MQTT_3_1_1 = 4,    ///< MQTT 3.1.1 (protocol message byte = 4)
+	MQTT_5 = 5         ///< MQTT 5 (protocol message byte = 5)
 } MQTT_Ver_t;
 
 /**
@@ -220,6 +222,40 @@ typedef enum _ClientState {
 typedef void (*pApplicationHandler_t)(AWS_IoT_Client *pClient, char *pTopicName, uint16_t topicNameLen,
 									  IoT_Publish_Message_Params *pParams, void *pClientData);
 
+/**
+ * @brief Streaming Message Handler Type
+ *
+ * Receives payload of a message in fragments as they are read from the network, so messages
+ * larger than the RX buffer can be processed. pParams->payloadLen is total payload length and
+ * stays same for all fragments of a message, offset is position of fragment in payload. Last
+ * fragment ends at pParams->payloadLen. Messages that fit RX buffer come as one fragment.
+ * If connection fails in the middle of a message, handler is called once more with pFragment
+ * NULL and fragmentLen 0, the partial message should be discarded.
+ *
+ * Topic and message header need to fit RX buffer, fragment size is what is left of it.
+ * @warning Handler must not call any blocking MQTT API (QoS1 publish, subscribe, yield) since
+ * rest of the message is still unread.
+ *
+ */
+typedef void (*pStreamHandler_t)(AWS_IoT_Client *pClient, char *pTopicName, uint16_t topicNameLen,
+								 IoT_Publish_Message_Params *pParams, size_t offset,
+								 const unsigned char *pFragment, size_t fragmentLen, void *pClientData);
+
+/**
+ * @brief Subscription Parameters Type
+ *
+ * One topic filter of aws_iot_mqtt_subscribe_batch. pTopicName and pApplicationHandlerData
+ * need to be static in memory, same as for aws_iot_mqtt_subscribe.
+ */
+typedef struct {
+	const char *pTopicName;			///< Topic filter to subscribe to
+	uint16_t topicNameLen;			///< Length of the topic filter
+	QoS qos;				///< Requested QoS
+	pApplicationHandler_t pApplicationHandler;	///< Handler for whole messages, may be NULL when pStreamHandler is set
+	pStreamHandler_t pStreamHandler;	///< Handler for fragmented delivery, used instead of pApplicationHandler when not NULL
+	void *pApplicationHandlerData;		///< Data passed to the handler
+} IoT_Subscribe_Params;
+
 /**
  * @brief MQTT Message Handler
  *
@@ -232,9 +268,66 @@ typedef struct _MessageHandlers {
 	uint16_t topicNameLen;
 	QoS qos;
 	pApplicationHandler_t pApplicationHandler;
+	pStreamHandler_t pStreamHandler;
 	void *pApplicationHandlerData;
+	int16_t nextHandler;	///< Next handler ending at the same topic filter node, or next unindexed one, -1 if none
 } MessageHandlers;   /* Message handlers are indexed by subscription topic */
 
+/* Topic filter index holds at most this many levels, root included */
+#define AWS_IOT_MQTT_TOPIC_NODES (AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS * AWS_IOT_MQTT_MAX_TOPIC_LEVELS + 1)
+
+/**
+ * @brief Node of the topic filter index
+ *
+ * Subscribed topic filters are kept as a tree of their '/' separated levels, so
+ * that an incoming topic is matched by walking its levels once instead of being
+ * compared with every handler. Children named by a level are found by hashing
+ * parent and level text into topicNodeSlots of ClientData, '+' and '#' children
+ * are held by their parent. Nodes are indexes into topicNodes, -1 is none.
+ */
+typedef struct {
+	const char *pLevel;		///< Level text, inside the topic filter of a subscribed handler
+	uint16_t levelLen;		///< Length of level text
+	int16_t parent;			///< Node of the previous level
+	int16_t plusChild;		///< Child for a '+' level
+	int16_t hashChild;		///< Child for a '#' level
+	int16_t firstHandler;	///< First handler with topic filter ending at this node
+} MQTTTopicNode;
+
+/**
+ * @brief Async Publish Completion Handler Type
+ *
+ * Called from yield (or any call reading the socket) when the PUBACK of an
+ * aws_iot_mqtt_publish_async QoS1 message arrives with rc SUCCESS, or with rc
+ * MQTT_REQUEST_TIMEOUT_ERROR when it was resent AWS_IOT_MQTT_INFLIGHT_MAX_RETRIES
+ * times without acknowledgement, or with MQTT_REQUEST_REJECTED_ERROR when MQTT 5
+ * broker refused it with a failure reason code. The in-flight slot is free when this is called.
+ *
+ */
+typedef void (*pPublishCompleteHandler_t)(AWS_IoT_Client *pClient, uint16_t packetId, IoT_Error_t rc,
+										  void *pCompleteHandlerData);
+
+/**
+ * @brief In-flight QoS1 Publish
+ *
+ * Async publish waiting for PUBACK. Topic and payload are referenced, not copied,
+ * and must stay valid until completion handler is called.
+ *
+ */
+typedef struct _InflightPublish {
+	bool isUsed;
+	uint16_t packetId;
+	uint8_t retries;
+	uint8_t isRetained;
+	const char *pTopicName;
+	uint16_t topicNameLen;
+	const void *pPayload;
+	size_t payloadLen;
+	Timer retryTimer;
+	pPublishCompleteHandler_t completeHandler;
+	void *pCompleteHandlerData;
+} InflightPublish;
+
 /**
  * @brief MQTT Client Status
  *
@@ -246,6 +339,7 @@ typedef struct _ClientStatus {
 	ClientState clientState;
 	bool isPingOutstanding;
 	bool isAutoReconnectEnabled;
+	bool isSessionPresent;
 } ClientStatus;
 
 /**
@@ -261,6 +355,8 @@ typedef struct _ClientData {
 	uint32_t packetTimeoutMs;
 	uint32_t commandTimeoutMs;
 	uint16_t keepAliveInterval;
+	uint16_t pingIntervalSec;
+	uint32_t pingResponseCount;
 	uint32_t currentReconnectWaitInterval;
 	uint32_t counterNetworkDisconnected;
 
@@ -283,6 +379,26 @@ typedef struct _ClientData {
 	IoT_Client_Connect_Params options;
 
 	MessageHandlers messageHandlers[AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS];
+
+	/* Topic filter index of message handlers, node 0 is the root. Slots are
+	 * twice the nodes, so open addressing always finds a free one */
+	MQTTTopicNode topicNodes[AWS_IOT_MQTT_TOPIC_NODES];
+	int16_t topicNodeSlots[2 * AWS_IOT_MQTT_TOPIC_NODES];
+	uint16_t topicNodeCount;
+	int16_t firstUnindexedHandler;	/* topic filter too deep for the index */
+
+	InflightPublish inflightPublish[AWS_IOT_MQTT_MAX_INFLIGHT_PUBLISH];
+	uint8_t inflightCount;
+
+	/* MQTT 5 limits announced by broker in CONNACK */
+	uint16_t serverReceiveMaximum;
+	uint16_t serverTopicAliasMaximum;
+
+	/* MQTT 5 topic aliases assigned on this connection, alias is index + 1 */
+	uint8_t topicAliasCount;
+	uint16_t topicAliasLen[AWS_IOT_MQTT_MAX_TOPIC_ALIASES];
+	char topicAlias[AWS_IOT_MQTT_MAX_TOPIC_ALIASES][AWS_IOT_MQTT_TOPIC_ALIAS_MAX_LEN];
+
 	iot_disconnect_handler disconnectHandler;
 
 	void *disconnectHandlerData;
@@ -341,6 +457,43 @@ IoT_Error_t aws_iot_mqtt_set_connect_params(AWS_IoT_Client *pClient, IoT_Client_
  */
 bool aws_iot_mqtt_is_client_connected(AWS_IoT_Client *pClient);
 
+/**
+ * @brief Set how long the link may stay idle before a PINGREQ is sent
+ *
+ * Any packet sent restarts this interval, so pings are only sent on an idle link.
+ * Intervals above the keepalive of the connection are capped to it.
+ *
+ * @param pClient Reference to the IoT Client
+ * @param pingIntervalSec Idle time in seconds, 0 = keepalive interval
+ *
+ * @return IoT_Error_t Type defining successful/failed API call
+ */
+IoT_Error_t aws_iot_mqtt_set_ping_interval(AWS_IoT_Client *pClient, uint16_t pingIntervalSec);
+
+/**
+ * @brief Number of PINGRESP received since client init
+ *
+ * Each one proves the link survived an idle period of the ping interval.
+ *
+ * @param pClient Reference to the IoT Client
+ *
+ * @return PINGRESP count
+ */
+uint32_t aws_iot_mqtt_get_ping_response_count(AWS_IoT_Client *pClient);
+
+/**
+ * @brief Did the broker resume a persistent session on last connect?
+ *
+ * Set from the session present flag of the last CONNACK when connecting with
+ * isCleanSession false. Broker then still has the subscriptions and QoS1 state,
+ * so reconnect skips resubscribe.
+ *
+ * @param pClient Reference to the IoT Client
+ *
+ * @return true = broker resumed the session, false = new session
+ */
+bool aws_iot_mqtt_is_session_present(AWS_IoT_Client *pClient);
+
 /**
  * @brief Get the current state of the client
  *
@@ -82,6 +82,31 @@ typedef union {
 	unsigned char byte;				/**< the whole byte */
 } MQTTHeader;
 
+/* MQTT 5 property identifiers used by the client, MQTT v5.0 Specification 2.2.2.2 */
+#define MQTT5_PROP_SESSION_EXPIRY_INTERVAL	0x11
+#define MQTT5_PROP_SERVER_KEEP_ALIVE		0x13
+#define MQTT5_PROP_REASON_STRING			0x1F
+#define MQTT5_PROP_RECEIVE_MAXIMUM			0x21
+#define MQTT5_PROP_TOPIC_ALIAS_MAXIMUM		0x22
+#define MQTT5_PROP_TOPIC_ALIAS				0x23
+
+/* MQTT 5 reason codes from this value up are failures */
+#define MQTT5_REASON_FAILURE				0x80
+
+#define AWS_IOT_MQTT_IS_V5(pClient)	(MQTT_5 == (pClient)->clientData.options.MQTTVersion)
+
+/**
+ * MQTT 5 properties the client acts on, others are skipped.
+ */
+typedef struct {
+	uint16_t receiveMaximum;
+	uint16_t topicAliasMaximum;
+	uint16_t serverKeepAlive;
+	bool hasServerKeepAlive;
+	const char *pReasonString;
+	uint16_t reasonStringLen;
+} MQTT5Properties;
+
 IoT_Error_t aws_iot_mqtt_internal_init_header(MQTTHeader *pHeader, MessageTypes message_type,
 											  QoS qos, uint8_t dup, uint8_t retained);
 
@@ -89,7 +114,7 @@ IoT_Error_t aws_iot_mqtt_internal_serialize_ack(unsigned char *pTxBuf, size_t tx
 												MessageTypes msgType, uint8_t dup, uint16_t packetId,
 												uint32_t *pSerializedLen);
 IoT_Error_t aws_iot_mqtt_internal_deserialize_ack(unsigned char *, unsigned char *,
-												  uint16_t *, unsigned char *, size_t);
+												  uint16_t *, unsigned char *, unsigned char *, size_t);
 
 uint32_t aws_iot_mqtt_internal_get_final_packet_length_from_remaining_length(uint32_t rem_len);
 
@@ -104,17 +129,32 @@ unsigned char aws_iot_mqtt_internal_read_char(unsigned char **pptr);
 void aws_iot_mqtt_internal_write_char(unsigned char **pptr, unsigned char c);
 void aws_iot_mqtt_internal_write_utf8_string(unsigned char **pptr, const char *string, uint16_t stringLen);
 
+IoT_Error_t aws_iot_mqtt_internal_read_properties(unsigned char **pptr, unsigned char *pEnd, MQTT5Properties *pProps);
+
+void aws_iot_mqtt_internal_index_topic_filters(AWS_IoT_Client *pClient);
+
+void aws_iot_mqtt_internal_restart_ping_timer(AWS_IoT_Client *pClient);
+
 IoT_Error_t aws_iot_mqtt_internal_flushBuffers( AWS_IoT_Client *pClient );
 IoT_Error_t aws_iot_mqtt_internal_send_packet(AWS_IoT_Client *pClient, size_t length, Timer *pTimer);
+
+IoT_Error_t aws_iot_mqtt_internal_send_segments(AWS_IoT_Client *pClient, const IoT_Net_Segment *pSegments,
+												size_t segmentCount, Timer *pTimer);
 IoT_Error_t aws_iot_mqtt_internal_cycle_read(AWS_IoT_Client *pClient, Timer *pTimer, uint8_t *pPacketType);
 IoT_Error_t aws_iot_mqtt_internal_wait_for_read(AWS_IoT_Client *pClient, uint8_t packetType, Timer *pTimer);
+IoT_Error_t aws_iot_mqtt_internal_deserialize_ack(unsigned char *pPacketType, unsigned char *dup,
+												  uint16_t *pPacketId, unsigned char *pReasonCode,
+												  unsigned char *pRxBuf, size_t rxBuflen);
+bool aws_iot_mqtt_internal_inflight_ack(AWS_IoT_Client *pClient, uint16_t packetId, IoT_Error_t rc);
+IoT_Error_t aws_iot_mqtt_internal_inflight_retry(AWS_IoT_Client *pClient);
+void aws_iot_mqtt_internal_inflight_resend_now(AWS_IoT_Client *pClient);
 IoT_Error_t aws_iot_mqtt_internal_serialize_zero(unsigned char *pTxBuf, size_t txBufLen,
 												 MessageTypes packetType, size_t *pSerializedLength);
 IoT_Error_t aws_iot_mqtt_internal_deserialize_publish(uint8_t *dup, QoS *qos,
 													  uint8_t *retained, uint16_t *pPacketId,
 													  char **pTopicName, uint16_t *topicNameLen,
 													  unsigned char **payload, size_t *payloadLen,
-													  unsigned char *pRxBuf, size_t rxBufLen);
+													  bool isMqtt5, unsigned char *pRxBuf, size_t rxBufLen);
 
 IoT_Error_t aws_iot_mqtt_set_client_state(AWS_IoT_Client *pClient, ClientState expectedCurrentState,
 										  ClientState newState);
@@ -111,6 +111,51 @@ IoT_Error_t aws_iot_mqtt_connect(AWS_IoT_Client *pClient, IoT_Client_Connect_Par
 IoT_Error_t aws_iot_mqtt_publish(AWS_IoT_Client *pClient, const char *pTopicName, uint16_t topicNameLen,
 								 IoT_Publish_Message_Params *pParams);
 
+/**
+ * @brief Publish an MQTT message on a topic without waiting for PUBACK
+ *
+ * Called to publish an MQTT message on a topic.
+ * @note Call returns after the message was passed to the TLS layer. A QoS1 message
+ * takes one of AWS_IOT_MQTT_MAX_INFLIGHT_PUBLISH in-flight slots until its PUBACK is
+ * read by yield. Unacknowledged messages are resent with DUP flag every
+ * AWS_IOT_MQTT_INFLIGHT_RETRY_MS. For QoS0 the completion handler is called before return.
+ * @warning pTopicName and pParams->payload are not copied and need to stay valid
+ * until the completion handler is called.
+ *
+ * @param pClient Reference to the IoT Client
+ * @param pTopicName Topic Name to publish to
+ * @param topicNameLen Length of the topic name
+ * @param pParams Pointer to Publish Message parameters, packet id is returned in pParams->id
+ * @param completeHandler Called when message is acknowledged or given up, can be NULL
+ * @param pCompleteHandlerData Passed to completion handler
+ *
+ * @return An IoT Error Type defining successful/failed publish,
+ *         LIMIT_EXCEEDED_ERROR if in-flight window is full, see aws_iot_mqtt_get_inflight_window
+ */
+IoT_Error_t aws_iot_mqtt_publish_async(AWS_IoT_Client *pClient, const char *pTopicName, uint16_t topicNameLen,
+									   IoT_Publish_Message_Params *pParams,
+									   pPublishCompleteHandler_t completeHandler, void *pCompleteHandlerData);
+
+/**
+ * @brief Number of async QoS1 publishes waiting for PUBACK
+ *
+ * @param pClient Reference to the IoT Client
+ *
+ * @return In-flight count, 0 to AWS_IOT_MQTT_MAX_INFLIGHT_PUBLISH
+ */
+uint8_t aws_iot_mqtt_get_inflight_count(AWS_IoT_Client *pClient);
+
+/**
+ * @brief Number of async QoS1 publishes allowed in flight at the same time
+ *
+ * AWS_IOT_MQTT_MAX_INFLIGHT_PUBLISH, or MQTT 5 receive maximum of broker when it is lower.
+ *
+ * @param pClient Reference to the IoT Client
+ *
+ * @return In-flight window
+ */
+uint8_t aws_iot_mqtt_get_inflight_window(AWS_IoT_Client *pClient);
+
 /**
  * @brief Subscribe to an MQTT topic.
  *
@@ -132,6 +177,45 @@ IoT_Error_t aws_iot_mqtt_publish(AWS_IoT_Client *pClient, const char *pTopicName
 IoT_Error_t aws_iot_mqtt_subscribe(AWS_IoT_Client *pClient, const char *pTopicName, uint16_t topicNameLen,
 								   QoS qos, pApplicationHandler_t pApplicationHandler, void *pApplicationHandlerData);
 
+/**
+ * @brief Subscribe to an MQTT topic with streaming delivery
+ *
+ * Same as aws_iot_mqtt_subscribe but payload is passed to pStreamHandler in fragments
+ * while it is read from network, see pStreamHandler_t. Messages larger than
+ * AWS_IOT_MQTT_RX_BUF_LEN are delivered instead of being dropped.
+ * @note Call is blocking.  The call returns after the receipt of the SUBACK control packet.
+ * @warning pTopicName and pStreamHandlerData need to be static in memory.
+ *
+ * @param pClient Reference to the IoT Client
+ * @param pTopicName Topic Name to subscribe to
+ * @param topicNameLen Length of the topic name
+ * @param qos Requested QoS
+ * @param pStreamHandler Reference to the handler function for this subscription
+ * @param pStreamHandlerData Point to data passed to the callback
+ *
+ * @return An IoT Error Type defining successful/failed subscription
+ */
+IoT_Error_t aws_iot_mqtt_subscribe_stream(AWS_IoT_Client *pClient, const char *pTopicName, uint16_t topicNameLen,
+										  QoS qos, pStreamHandler_t pStreamHandler, void *pStreamHandlerData);
+
+/**
+ * @brief Subscribe to several MQTT topics at once
+ *
+ * Sends one SUBSCRIBE packet with all topic filters and waits for its single SUBACK,
+ * saving a round trip per topic compared to repeated aws_iot_mqtt_subscribe calls.
+ * Handlers are registered only for filters granted by the broker.
+ * @note Call is blocking.  The call returns after the receipt of the SUBACK control packet.
+ *
+ * @param pClient Reference to the IoT Client
+ * @param pParams Array of subscriptions, see IoT_Subscribe_Params
+ * @param count Number of entries in pParams
+ *
+ * @return SUCCESS, MQTT_SUBSCRIBE_REJECTED_ERROR if broker refused some of the filters,
+ *         or an IoT Error Type defining failed subscription
+ */
+IoT_Error_t aws_iot_mqtt_subscribe_batch(AWS_IoT_Client *pClient, const IoT_Subscribe_Params *pParams,
+										 uint32_t count);
+
 /**
  * @brief Subscribe to an MQTT topic.
  *
@@ -191,6 +275,20 @@ IoT_Error_t aws_iot_mqtt_disconnect(AWS_IoT_Client *pClient);
  */
 IoT_Error_t aws_iot_mqtt_yield(AWS_IoT_Client *pClient, uint32_t timeout_ms);
 
+/**
+ * @brief Time until client next needs yield for its own housekeeping
+ *
+ * Earliest of keepalive ping, pending reconnect attempt and async publish resend.
+ * Lets caller sleep between yields instead of polling the network. Incoming data
+ * has to be detected by caller, e.g. from modem notifications.
+ *
+ * @param pClient Reference to the IoT Client
+ * @param max_ms Value returned when nothing is scheduled sooner
+ *
+ * @return Milliseconds until next deadline, 0 if it is already due
+ */
+uint32_t aws_iot_mqtt_get_next_deadline_ms(AWS_IoT_Client *pClient, uint32_t max_ms);
+
 /**
  * @brief MQTT Manual Re-Connection Function
  *
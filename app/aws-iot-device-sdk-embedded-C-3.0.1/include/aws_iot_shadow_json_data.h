@@ -27,6 +27,8 @@ extern "C" {
 
 #include <stddef.h>
 
+#include "aws_iot_json_writer.h"
+
 /**
  * @brief This is a static JSON object that could be used in code
  *
@@ -130,6 +132,51 @@ IoT_Error_t aws_iot_shadow_add_desired(char *pJsonDocument, size_t maxSizeOfJson
  */
 IoT_Error_t aws_iot_finalize_json_document(char *pJsonDocument, size_t maxSizeOfJsonDocument);
 
+/**
+ * @brief Start a Shadow document with a cursor based writer
+ *
+ * Writes {"state":{ into the buffer. Follow with aws_iot_shadow_writer_add_section for
+ * the reported and/or desired sections and finish with aws_iot_shadow_writer_finalize.
+ * The writer tracks the document length, so unlike the variadic API above no call
+ * rescans the buffer.
+ *
+ * @param pWriter Writer to initialize, owned by the caller for the whole call sequence
+ * @param pJsonDocument The JSON Document filled in this char buffer
+ * @param maxSizeOfJsonDocument maximum size of the pJsonDocument that can be used to fill the JSON document
+ * @return An IoT Error Type defining if the buffer was null or the entire string was not filled up
+ */
+IoT_Error_t aws_iot_shadow_writer_init(AwsIotJsonWriter *pWriter, char *pJsonDocument, size_t maxSizeOfJsonDocument);
+
+/**
+ * @brief Add a section such as "reported" holding the selected fields
+ *
+ * Only fields whose bit is set in fieldMask are written, bit i selecting ppFields[i]; fields
+ * past the 32nd are always written. This lets a caller report just the fields that changed.
+ * When no field is selected the section is left out entirely. A truncated document still
+ * measures every selected field, so pWriter->length ends up as the size needed.
+ *
+ * @param pWriter Writer set up with aws_iot_shadow_writer_init
+ * @param pSectionKey Name of the section, SHADOW_REPORTED_STRING or SHADOW_DESIRED_STRING
+ * @param ppFields Array of count fields
+ * @param count Number of entries in ppFields
+ * @param fieldMask Bitmask of the fields to write
+ * @return An IoT Error Type defining if a field was null or the entire string was not filled up
+ */
+IoT_Error_t aws_iot_shadow_writer_add_section(AwsIotJsonWriter *pWriter, const char *pSectionKey,
+											  jsonStruct_t *const *ppFields, uint8_t count, uint32_t fieldMask);
+
+/**
+ * @brief Close the state object and add the client token, incrementing its sequence number
+ *
+ * With a non zero version the document also carries "version", and the service rejects the
+ * update with a version conflict unless the Shadow is still at that version.
+ *
+ * @param pWriter Writer set up with aws_iot_shadow_writer_init
+ * @param version Expected Shadow version, 0 to update unconditionally
+ * @return An IoT Error Type defining if the entire string was not filled up
+ */
+IoT_Error_t aws_iot_shadow_writer_finalize(AwsIotJsonWriter *pWriter, uint32_t version);
+
 /**
  * @brief Fill the given buffer with client token for tracking the Repsonse.
  *
@@ -0,0 +1,103 @@
+/*
+ * Copyright 2010-2015 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file aws_iot_shadow_reported.h
+ * @brief Publish only the reported fields that changed since the last accepted update
+ *
+ * The tracker remembers, per field, the value the Shadow service last accepted and the
+ * Shadow version that update produced. An update then carries just the changed fields
+ * in state.reported together with that version, so the service rejects it if anyone
+ * else modified the Shadow in between. A version conflict or a timed out update makes
+ * the next one a full sync of every field without a version, as does an expired
+ * SHADOW_REPORTED_FULL_SYNC_INTERVAL_SEC.
+ */
+
+#ifndef SRC_SHADOW_AWS_IOT_SHADOW_REPORTED_H_
+#define SRC_SHADOW_AWS_IOT_SHADOW_REPORTED_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "aws_iot_shadow_interface.h"
+#include "timer_interface.h"
+
+/** Fields are selected with a 32 bit mask */
+#define SHADOW_REPORTED_MAX_FIELDS 32
+
+/**
+ * @brief Reported state of one Thing as last acknowledged by the Shadow service
+ */
+typedef struct {
+	jsonStruct_t *const *ppFields; ///< Fields making up state.reported
+	uint8_t count; ///< Number of entries in ppFields
+	uint32_t ackedFingerprint[SHADOW_REPORTED_MAX_FIELDS]; ///< Value of each field in the last accepted update
+	uint32_t pendingFingerprint[SHADOW_REPORTED_MAX_FIELDS]; ///< Value of each field in the update awaiting its ack
+	uint32_t ackedMask; ///< Fields whose accepted value is known
+	uint32_t pendingMask; ///< Fields carried by the update awaiting its ack
+	uint32_t version; ///< Shadow version after the last accepted update, 0 if unknown
+	bool isUpdatePending; ///< An update is waiting for its accepted/rejected response
+	Timer fullSyncTimer; ///< Time left until the next periodic full sync
+	uint32_t fullSyncs; ///< Updates sent with every field
+	uint32_t deltaUpdates; ///< Updates sent with only the changed fields
+	uint32_t resyncs; ///< Updates rejected for a version conflict or timed out, each forcing a full sync
+} ShadowReportedState_t;
+
+/**
+ * @brief Start tracking the reported state made of the given fields
+ *
+ * Nothing is known about the Shadow yet, so the first update is a full sync.
+ *
+ * @param pState Tracker to initialize
+ * @param ppFields Fields reported to the Shadow; must stay valid while the tracker is used
+ * @param count Number of fields, at most SHADOW_REPORTED_MAX_FIELDS
+ * @return SUCCESS, NULL_VALUE_ERROR or MAX_SIZE_ERROR
+ */
+IoT_Error_t aws_iot_shadow_reported_init(ShadowReportedState_t *pState, jsonStruct_t *const *ppFields, uint8_t count);
+
+/**
+ * @brief Publish the fields that changed since the last accepted update
+ *
+ * Returns SUCCESS without publishing anything when no field changed and no full sync is due.
+ *
+ * @param pClient MQTT Client used as the protocol layer
+ * @param pState Tracker set up with aws_iot_shadow_reported_init
+ * @param pThingName Thing Name of the shadow that needs to be Updated
+ * @param pJsonDocument Buffer used to build the update document
+ * @param maxSizeOfJsonDocument Size of pJsonDocument
+ * @param timeout_seconds Seconds to wait for the accepted/rejected response
+ * @return SHADOW_WAIT_FOR_PUBLISH while the previous update is unacknowledged, otherwise
+ * the result of building or publishing the document
+ */
+IoT_Error_t aws_iot_shadow_reported_update(AWS_IoT_Client *pClient, ShadowReportedState_t *pState,
+										   const char *pThingName, char *pJsonDocument,
+										   size_t maxSizeOfJsonDocument, uint8_t timeout_seconds);
+
+/**
+ * @brief Make the next update a full sync, e.g. after a reconnect
+ *
+ * @param pState Tracker set up with aws_iot_shadow_reported_init
+ */
+void aws_iot_shadow_reported_force_full_sync(ShadowReportedState_t *pState);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SRC_SHADOW_AWS_IOT_SHADOW_REPORTED_H_ */
@@ -57,6 +57,16 @@ typedef struct {
 	bool ServerVerificationFlag;        ///< Boolean.  True = perform server certificate hostname validation.  False = skip validation \b NOT recommended.
 } TLSConnectParams;
 
+/**
+ * @brief Network Write Segment
+ *
+ * One buffer of a gather write. Buffers are sent back to back as a single stream.
+ */
+typedef struct {
+	const unsigned char *pBuf;    ///< Data to send
+	size_t len;                   ///< Length of data in bytes
+} IoT_Net_Segment;
+
 /**
  * @brief Network Structure
  *
@@ -67,6 +77,7 @@ struct Network {
 
 	IoT_Error_t (*read)(Network *, unsigned char *, size_t, Timer *, size_t *);    ///< Function pointer pointing to the network function to read from the network
 	IoT_Error_t (*write)(Network *, unsigned char *, size_t, Timer *, size_t *);    ///< Function pointer pointing to the network function to write to the network
+	IoT_Error_t (*writeSegments)(Network *, const IoT_Net_Segment *, size_t, Timer *, size_t *);    ///< Optional gather write of several buffers without copying them together, NULL if not supported
 	IoT_Error_t (*disconnect)(Network *);    ///< Function pointer pointing to the network function to disconnect from the network
 	IoT_Error_t (*isConnected)(Network *);    ///< Function pointer pointing to the network function to check if TLS is connected
 	IoT_Error_t (*destroy)(Network *);        ///< Function pointer pointing to the network function to destroy the network object
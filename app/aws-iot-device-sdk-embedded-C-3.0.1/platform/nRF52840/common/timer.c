@@ -28,6 +28,9 @@ limitations under the License.
 
 #define MAX_MS_VALUE (0xffffffU + 1)
 
+// RTC compare closer than this to counter may not generate event.
+#define MIN_WAKE_MS 2
+
 static nrfx_rtc_t rtc = NRFX_RTC_INSTANCE(1);
 
 static uint32_t now(void);
@@ -70,3 +73,22 @@ void init_timer(Timer* timer)
     timer->diff = 0;
     timer->that_time = now();
 }
+
+void timer_wait_event(Timer* timer)
+{
+    uint32_t ms = left_ms(timer);
+
+    if (ms < MIN_WAKE_MS)
+        return;
+
+    // Compare interrupt only wakes the core, RTC1 irq handler disables it again.
+    nrf_rtc_event_clear(rtc.p_reg, NRF_RTC_EVENT_COMPARE_0);
+    nrf_rtc_cc_set(rtc.p_reg, 0, (now() + ms) % MAX_MS_VALUE);
+    nrf_rtc_int_enable(rtc.p_reg, NRF_RTC_INT_COMPARE0_MASK);
+
+    // Event register latches interrupts taken since caller checked its
+    // condition, so nothing is missed between check and sleep.
+    __WFE();
+
+    nrf_rtc_int_disable(rtc.p_reg, NRF_RTC_INT_COMPARE0_MASK);
+}
@@ -28,4 +28,8 @@ struct Timer {
     uint32_t that_time;
 };
 
+//Sleeps (WFE) until any interrupt or until timer expires, whichever is first.
+//Can return early, caller has to check its own wake up condition again.
+void timer_wait_event(struct Timer* timer);
+
 #endif /* TIMER_PLATFORM_H_ */
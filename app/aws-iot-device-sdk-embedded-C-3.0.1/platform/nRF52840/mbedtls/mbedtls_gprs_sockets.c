@@ -156,16 +156,17 @@ int mbedtls_net_recv_timeout(void* ctx, unsigned char* buf,
     size_t len, uint32_t timeout_ms)
 {
     int ret;
-    (void)timeout_ms;
     int fd = ((mbedtls_net_context*)ctx)->fd;
 
+    // Short timeouts are polls from iot_tls_read, answer them from link state
+    // cached by modem driver instead of blocking for minimum api timeout.
     if (timeout_ms < GPRS_MINIMUM_API_TIMEOUT_MS)
-        timeout_ms = GPRS_MINIMUM_API_TIMEOUT_MS;
-
-    ret = gprs_recv(fd, buf, len, (int)timeout_ms);
+        ret = gprs_recv_nonblock(fd, buf, len);
+    else
+        ret = gprs_recv(fd, buf, len, (int)timeout_ms);
 
     if (ret < 0) {
-        if (ret == GPRS_ERROR_TIMEOUT)
+        if ((ret == GPRS_ERROR_TIMEOUT) || (ret == GPRS_ERROR_WOULD_BLOCK))
             return MBEDTLS_ERR_SSL_WANT_READ;
 
         dbg_printf(DEBUG_LEVEL_ERROR, "gprs_recv failed: %d\r\n", ret);
@@ -43,18 +43,34 @@ limitations under the License.
 extern "C" {
 #endif
 
+#ifdef IOT_TLS_MULTI_TRANSPORT
+// Linked along with other transport, network_transport.c dispatches.
+#define iot_tls_init iot_mbedtls_init
+#define iot_tls_connect iot_mbedtls_connect
+#define iot_tls_write iot_mbedtls_write
+#define iot_tls_read iot_mbedtls_read
+#define iot_tls_disconnect iot_mbedtls_disconnect
+#define iot_tls_destroy iot_mbedtls_destroy
+#define iot_tls_is_connected iot_mbedtls_is_connected
+#define _iot_tls_set_connect_params _iot_mbedtls_set_connect_params
+#endif
+
 #include "network_interface.h"
 #include "timer_platform.h"
+#include <limits.h>
 #include <stdbool.h>
 #include <string.h>
 
+#include "aws_iot_config.h"
 #include "aws_iot_error.h"
 #include "aws_iot_log.h"
-#include "network_interface.h"
-#include "network_platform.h"
+
+#include "mbedtls/asn1.h"
+#include "mbedtls/sha256.h"
 
 #include "nrf_drv_rng.h"
 #include "rofs.h"
+#include "sim7600_gprs.h"
 
 #ifdef MBEDTLS_DEBUG_C
 #include "mbedtls/debug.h"
@@ -72,6 +88,60 @@ extern "C" {
 /* This is the value used for ssl read timeout */
 #define IOT_SSL_READ_TIMEOUT 10
 
+/* Map configured max fragment length (bytes) to RFC 6066 code */
+#ifndef IOT_TLS_MAX_FRAGMENT_LEN
+#define IOT_TLS_MAX_FRAGMENT_LEN 0
+#endif
+
+#if IOT_TLS_MAX_FRAGMENT_LEN == 0
+#define IOT_TLS_MFL_CODE MBEDTLS_SSL_MAX_FRAG_LEN_NONE
+#elif IOT_TLS_MAX_FRAGMENT_LEN == 512
+#define IOT_TLS_MFL_CODE MBEDTLS_SSL_MAX_FRAG_LEN_512
+#elif IOT_TLS_MAX_FRAGMENT_LEN == 1024
+#define IOT_TLS_MFL_CODE MBEDTLS_SSL_MAX_FRAG_LEN_1024
+#elif IOT_TLS_MAX_FRAGMENT_LEN == 2048
+#define IOT_TLS_MFL_CODE MBEDTLS_SSL_MAX_FRAG_LEN_2048
+#elif IOT_TLS_MAX_FRAGMENT_LEN == 4096
+#define IOT_TLS_MFL_CODE MBEDTLS_SSL_MAX_FRAG_LEN_4096
+#else
+#error "IOT_TLS_MAX_FRAGMENT_LEN must be 0, 512, 1024, 2048 or 4096"
+#endif
+
+#if (IOT_TLS_MAX_FRAGMENT_LEN != 0) && !defined(MBEDTLS_SSL_MAX_FRAGMENT_LENGTH)
+#error "IOT_TLS_MAX_FRAGMENT_LEN requires MBEDTLS_SSL_MAX_FRAGMENT_LENGTH in mbedtls config"
+#endif
+
+/* Server chain checks done after handshake instead of by mbedTLS,
+ * when a key is pinned or validated chains are cached. */
+#ifndef IOT_TLS_PINNED_SPKI_SHA256
+#define IOT_TLS_PINNED_SPKI_SHA256 ""
+#endif
+
+#ifndef IOT_TLS_VERIFIED_CHAIN_CACHE_SIZE
+#define IOT_TLS_VERIFIED_CHAIN_CACHE_SIZE 0
+#endif
+
+#define IOT_TLS_SHA256_LEN 32
+#define IOT_TLS_PIN_ENABLED (sizeof(IOT_TLS_PINNED_SPKI_SHA256) > 1)
+#define IOT_TLS_DEFER_VERIFY (IOT_TLS_PIN_ENABLED || (IOT_TLS_VERIFIED_CHAIN_CACHE_SIZE > 0))
+
+/* Filled in while mbedtls_x509_crt_verify walks the path it built. */
+typedef struct {
+    unsigned char pin[IOT_TLS_SHA256_LEN];
+    bool pinSeen;
+    unsigned long validTo; ///< Earliest expiry on the path, unix seconds
+} IotTlsVerifiedPath_t;
+
+#if IOT_TLS_VERIFIED_CHAIN_CACHE_SIZE > 0
+typedef struct {
+    unsigned char hash[IOT_TLS_SHA256_LEN]; ///< Of host name and chain DER
+    unsigned long validTo; ///< Earliest expiry on the verified path, 0 for a free entry
+} IotTlsVerifiedChain_t;
+
+static IotTlsVerifiedChain_t verified_chains[IOT_TLS_VERIFIED_CHAIN_CACHE_SIZE];
+static int verified_chains_next;
+#endif
+
 /* This defines the value of the debug buffer that gets allocated.
  * The value can be altered based on memory constraints
  */
@@ -125,6 +195,247 @@ static int _iot_tls_verify_cert(void* data, mbedtls_x509_crt* crt, int depth, ui
     return 0;
 }
 
+/*
+ * SHA-256 of DER SubjectPublicKeyInfo, which follows subject in TBS certificate.
+ */
+static int _iot_tls_spki_sha256(const mbedtls_x509_crt* crt, unsigned char* hash)
+{
+    unsigned char* p = crt->subject_raw.p + crt->subject_raw.len;
+    const unsigned char* end = crt->tbs.p + crt->tbs.len;
+    const unsigned char* spki = p;
+    size_t len;
+    int ret;
+
+    ret = mbedtls_asn1_get_tag(&p, end, &len, MBEDTLS_ASN1_CONSTRUCTED | MBEDTLS_ASN1_SEQUENCE);
+    if (ret != 0) {
+        return ret;
+    }
+
+    return mbedtls_sha256_ret(spki, (size_t)(p - spki) + len, hash, 0);
+}
+
+static int _iot_tls_hex_to_bin(const char* hex, unsigned char* bin, size_t bin_len)
+{
+    size_t i;
+    unsigned int byte;
+
+    if (strlen(hex) != bin_len * 2) {
+        return -1;
+    }
+
+    for (i = 0; i < bin_len; i++) {
+        if (sscanf(&hex[i * 2], "%2x", &byte) != 1) {
+            return -1;
+        }
+        bin[i] = (unsigned char)byte;
+    }
+
+    return 0;
+}
+
+static bool _iot_tls_is_pinned_key(const mbedtls_x509_crt* crt, const unsigned char* pin)
+{
+    unsigned char hash[IOT_TLS_SHA256_LEN];
+
+    return _iot_tls_spki_sha256(crt, hash) == 0 && memcmp(hash, pin, IOT_TLS_SHA256_LEN) == 0;
+}
+
+/*
+ * Unix seconds of an X.509 time, UTC.
+ */
+static unsigned long _iot_tls_x509_time_to_unix(const mbedtls_x509_time* t)
+{
+    // Days from civil, March based year puts leap day last.
+    long year = t->year - (t->mon <= 2);
+    long era = year / 400;
+    long yoe = year - era * 400;
+    long doy = (153 * (t->mon + (t->mon > 2 ? -3 : 9)) + 2) / 5 + t->day - 1;
+    long days = era * 146097 + yoe * 365 + yoe / 4 - yoe / 100 + doy - 719468;
+
+    return (unsigned long)(days * 86400L + t->hour * 3600L + t->min * 60L + t->sec);
+}
+
+/*
+ * Called by mbedtls_x509_crt_verify for each certificate of the path it built,
+ * so a pinned key in an extra certificate the server sent along is not counted.
+ */
+static int _iot_tls_verify_path_cert(void* data, mbedtls_x509_crt* crt, int depth, uint32_t* flags)
+{
+    IotTlsVerifiedPath_t* path = (IotTlsVerifiedPath_t*)data;
+    unsigned long validTo = _iot_tls_x509_time_to_unix(&crt->valid_to);
+
+    if (IOT_TLS_PIN_ENABLED && _iot_tls_is_pinned_key(crt, path->pin)) {
+        path->pinSeen = true;
+    }
+    if (validTo < path->validTo) {
+        path->validTo = validTo;
+    }
+
+    return _iot_tls_verify_cert(NULL, crt, depth, flags);
+}
+
+/*
+ * No root CA: pinned leaf key authenticates the server by itself. A pinned
+ * intermediate is made the trust anchor, leaf must then be signed by it and
+ * name the host.
+ */
+static IoT_Error_t _iot_tls_verify_pinned_only(Network* pNetwork, const mbedtls_x509_crt* chain,
+    const unsigned char* pin)
+{
+    TLSDataParams* tlsDataParams = &(pNetwork->tlsDataParams);
+    const mbedtls_x509_crt* crt;
+    mbedtls_x509_crt anchor;
+    char vrfy_buf[512];
+    int ret;
+
+    if (_iot_tls_is_pinned_key(chain, pin)) {
+        IOT_DEBUG(" ok (pinned leaf key)\n");
+        return SUCCESS;
+    }
+
+    for (crt = chain->next; crt != NULL && crt->raw.p != NULL; crt = crt->next) {
+        if (_iot_tls_is_pinned_key(crt, pin)) {
+            break;
+        }
+    }
+
+    if (crt == NULL || crt->raw.p == NULL) {
+        IOT_ERROR(" failed\n  ! server chain does not contain pinned key\n");
+        return SSL_CONNECTION_ERROR;
+    }
+
+    mbedtls_x509_crt_init(&anchor);
+    ret = mbedtls_x509_crt_parse_der(&anchor, crt->raw.p, crt->raw.len);
+    if (ret == 0) {
+        ret = mbedtls_x509_crt_verify((mbedtls_x509_crt*)chain, &anchor, NULL,
+            pNetwork->tlsConnectParams.pDestinationURL, &(tlsDataParams->flags), _iot_tls_verify_cert, NULL);
+    }
+    mbedtls_x509_crt_free(&anchor);
+
+    if (ret != 0) {
+        IOT_ERROR(" failed\n");
+        mbedtls_x509_crt_verify_info(vrfy_buf, sizeof(vrfy_buf), "  ! ", tlsDataParams->flags);
+        IOT_ERROR("%s\n", vrfy_buf);
+        return SSL_CONNECTION_ERROR;
+    }
+
+    IOT_DEBUG(" ok (signed by pinned key)\n");
+    return SUCCESS;
+}
+
+#if IOT_TLS_VERIFIED_CHAIN_CACHE_SIZE > 0
+/*
+ * Host name is hashed too, chain validated for one host is not valid for another.
+ */
+static int _iot_tls_chain_sha256(const char* host, const mbedtls_x509_crt* chain, unsigned char* hash)
+{
+    mbedtls_sha256_context ctx;
+    int ret;
+
+    mbedtls_sha256_init(&ctx);
+    ret = mbedtls_sha256_starts_ret(&ctx, 0);
+    if (ret == 0) {
+        ret = mbedtls_sha256_update_ret(&ctx, (const unsigned char*)host, strlen(host) + 1);
+    }
+    for (; ret == 0 && chain != NULL && chain->raw.p != NULL; chain = chain->next) {
+        ret = mbedtls_sha256_update_ret(&ctx, chain->raw.p, chain->raw.len);
+    }
+    if (ret == 0) {
+        ret = mbedtls_sha256_finish_ret(&ctx, hash);
+    }
+    mbedtls_sha256_free(&ctx);
+
+    return ret;
+}
+
+/*
+ * Cached chain is used until the first certificate on its path expires, by
+ * modem clock. Unknown time counts as expired. Full validation checks dates
+ * only with MBEDTLS_HAVE_TIME_DATE.
+ */
+static bool _iot_tls_cached_chain_expired(const IotTlsVerifiedChain_t* entry)
+{
+    unsigned long now;
+
+    return gsm_get_time(&now) != GPRS_OK || now >= entry->validTo;
+}
+#endif
+
+/*
+ * Full chain validation, with pinned key required on the verified path, only
+ * when the presented chain is not one validated before for this host.
+ */
+static IoT_Error_t _iot_tls_verify_server_chain(Network* pNetwork)
+{
+    TLSDataParams* tlsDataParams = &(pNetwork->tlsDataParams);
+    const mbedtls_x509_crt* chain = mbedtls_ssl_get_peer_cert(&(tlsDataParams->ssl));
+    IotTlsVerifiedPath_t path;
+    char vrfy_buf[512];
+    int ret;
+#if IOT_TLS_VERIFIED_CHAIN_CACHE_SIZE > 0
+    unsigned char chain_hash[IOT_TLS_SHA256_LEN];
+    bool chain_hashed;
+    int i;
+#endif
+
+    if (chain == NULL) {
+        IOT_ERROR(" failed\n  ! no server certificate\n");
+        return SSL_CONNECTION_ERROR;
+    }
+
+    memset(&path, 0, sizeof(path));
+    path.validTo = ULONG_MAX;
+    if (IOT_TLS_PIN_ENABLED
+        && _iot_tls_hex_to_bin(IOT_TLS_PINNED_SPKI_SHA256, path.pin, sizeof(path.pin)) != 0) {
+        IOT_ERROR(" failed\n  ! IOT_TLS_PINNED_SPKI_SHA256 is not a SHA-256 hex string\n");
+        return SSL_CONNECTION_ERROR;
+    }
+
+    // Without root CA verification is only enabled with a pinned key, see iot_tls_connect.
+    if (NULL == pNetwork->tlsConnectParams.pRootCALocation) {
+        return _iot_tls_verify_pinned_only(pNetwork, chain, path.pin);
+    }
+
+#if IOT_TLS_VERIFIED_CHAIN_CACHE_SIZE > 0
+    chain_hashed = (_iot_tls_chain_sha256(pNetwork->tlsConnectParams.pDestinationURL, chain, chain_hash) == 0);
+    for (i = 0; chain_hashed && i < IOT_TLS_VERIFIED_CHAIN_CACHE_SIZE; i++) {
+        if (verified_chains[i].validTo == 0 || memcmp(verified_chains[i].hash, chain_hash, sizeof(chain_hash)) != 0) {
+            continue;
+        }
+        if (!_iot_tls_cached_chain_expired(&verified_chains[i])) {
+            IOT_DEBUG(" ok (chain validated earlier)\n");
+            return SUCCESS;
+        }
+        memset(&verified_chains[i], 0, sizeof(verified_chains[i]));
+    }
+#endif
+
+    ret = mbedtls_x509_crt_verify((mbedtls_x509_crt*)chain, &(tlsDataParams->cacert), NULL,
+        pNetwork->tlsConnectParams.pDestinationURL, &(tlsDataParams->flags), _iot_tls_verify_path_cert, &path);
+    if (ret != 0) {
+        IOT_ERROR(" failed\n");
+        mbedtls_x509_crt_verify_info(vrfy_buf, sizeof(vrfy_buf), "  ! ", tlsDataParams->flags);
+        IOT_ERROR("%s\n", vrfy_buf);
+        return SSL_CONNECTION_ERROR;
+    }
+
+    if (IOT_TLS_PIN_ENABLED && !path.pinSeen) {
+        IOT_ERROR(" failed\n  ! pinned key is not on verified path\n");
+        return SSL_CONNECTION_ERROR;
+    }
+
+#if IOT_TLS_VERIFIED_CHAIN_CACHE_SIZE > 0
+    if (chain_hashed) {
+        memcpy(verified_chains[verified_chains_next].hash, chain_hash, sizeof(chain_hash));
+        verified_chains[verified_chains_next].validTo = path.validTo;
+        verified_chains_next = (verified_chains_next + 1) % IOT_TLS_VERIFIED_CHAIN_CACHE_SIZE;
+    }
+#endif
+
+    IOT_DEBUG(" ok\n");
+    return SUCCESS;
+}
+
 void _iot_tls_set_connect_params(Network* pNetwork, const char* pRootCALocation, const char* pDeviceCertLocation,
     const char* pDevicePrivateKeyLocation, const char* pDestinationURL,
     uint16_t destinationPort, uint32_t timeout_ms, bool ServerVerificationFlag)
@@ -148,6 +459,8 @@ IoT_Error_t iot_tls_init(Network* pNetwork, const char* pRootCALocation, const c
 
     pNetwork->connect = iot_tls_connect;
     pNetwork->read = iot_tls_read;
+    // Records are per write, packet is better copied together by MQTT layer.
+    pNetwork->writeSegments = NULL;
     pNetwork->write = iot_tls_write;
     pNetwork->disconnect = iot_tls_disconnect;
     pNetwork->isConnected = iot_tls_is_connected;
@@ -239,7 +552,7 @@ IoT_Error_t iot_tls_connect(Network* pNetwork, TLSConnectParams* params)
         }
 
         IOT_DEBUG(" ok (%d skipped)\n", ret);
-    } else {
+    } else if (!IOT_TLS_PIN_ENABLED) {
         pNetwork->tlsConnectParams.ServerVerificationFlag = false;
     }
 
@@ -302,7 +615,10 @@ IoT_Error_t iot_tls_connect(Network* pNetwork, TLSConnectParams* params)
     }
 
     mbedtls_ssl_conf_verify(&(tlsDataParams->conf), _iot_tls_verify_cert, NULL);
-    if (pNetwork->tlsConnectParams.ServerVerificationFlag == true) {
+    if (pNetwork->tlsConnectParams.ServerVerificationFlag == true && IOT_TLS_DEFER_VERIFY) {
+        // Chain is still parsed during handshake but checked afterwards, see _iot_tls_verify_server_chain.
+        mbedtls_ssl_conf_authmode(&(tlsDataParams->conf), MBEDTLS_SSL_VERIFY_NONE);
+    } else if (pNetwork->tlsConnectParams.ServerVerificationFlag == true) {
         mbedtls_ssl_conf_authmode(&(tlsDataParams->conf), MBEDTLS_SSL_VERIFY_REQUIRED);
     } else {
         mbedtls_ssl_conf_authmode(&(tlsDataParams->conf), MBEDTLS_SSL_VERIFY_OPTIONAL);
@@ -322,6 +638,15 @@ IoT_Error_t iot_tls_connect(Network* pNetwork, TLSConnectParams* params)
 
     mbedtls_ssl_conf_read_timeout(&(tlsDataParams->conf), pNetwork->tlsConnectParams.timeout_ms);
 
+#if IOT_TLS_MAX_FRAGMENT_LEN != 0
+    // Records sent are limited either way. Server may ignore the extension and
+    // still send full size records, so the receive buffer is not reduced.
+    if ((ret = mbedtls_ssl_conf_max_frag_len(&(tlsDataParams->conf), IOT_TLS_MFL_CODE)) != 0) {
+        IOT_ERROR(" failed\n  ! mbedtls_ssl_conf_max_frag_len returned -0x%x\n\n", -ret);
+        return SSL_CONNECTION_ERROR;
+    }
+#endif
+
 /* Use the AWS IoT ALPN extension for MQTT if port 443 is requested. */
 #if 0
 	//Enable ALPN Protocols in mbedTLS config.
@@ -370,10 +695,20 @@ IoT_Error_t iot_tls_connect(Network* pNetwork, TLSConnectParams* params)
     } else {
         IOT_DEBUG("    [ Record expansion is unknown (compression) ]\n");
     }
+#if IOT_TLS_MAX_FRAGMENT_LEN != 0
+    // Session mfl_code is set on client side only when server echoed the extension, see ssl_cli.c.
+    if (tlsDataParams->ssl.session->mfl_code != MBEDTLS_SSL_MAX_FRAG_LEN_NONE) {
+        IOT_DEBUG("    [ Max fragment length %u accepted by server ]\n", (unsigned int)IOT_TLS_MAX_FRAGMENT_LEN);
+    } else {
+        IOT_DEBUG("    [ Max fragment length not accepted, server may send full size records ]\n");
+    }
+#endif
 
     IOT_DEBUG("  . Verifying peer X.509 certificate...");
 
-    if (pNetwork->tlsConnectParams.ServerVerificationFlag == true) {
+    if (pNetwork->tlsConnectParams.ServerVerificationFlag == true && IOT_TLS_DEFER_VERIFY) {
+        ret = _iot_tls_verify_server_chain(pNetwork);
+    } else if (pNetwork->tlsConnectParams.ServerVerificationFlag == true) {
         if ((tlsDataParams->flags = mbedtls_ssl_get_verify_result(&(tlsDataParams->ssl))) != 0) {
             IOT_ERROR(" failed\n");
             mbedtls_x509_crt_verify_info(vrfy_buf, sizeof(vrfy_buf), "  ! ", tlsDataParams->flags);
@@ -443,7 +778,7 @@ IoT_Error_t iot_tls_read(Network* pNetwork, unsigned char* pMsg, size_t len, Tim
     int ret;
 
     while (len > 0) {
-        // This read will timeout after IOT_SSL_READ_TIMEOUT if there's no data to be read
+        // Returns WANT_READ at once when modem has reported no data for the link
         ret = mbedtls_ssl_read(ssl, pMsg, len);
         if (ret > 0) {
             rxLen += ret;
@@ -0,0 +1,54 @@
+/*
+
+Copyright 2019-2020 Ravikiran Bukkasagara <contact@ravikiranb.com>
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+    
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#ifndef AWS_IOT_DEVICE_SDK_EMBEDDED_C_3_0_1_PLATFORM_NRF52840_MULTI_TLS_PLATFORM_H_
+#define AWS_IOT_DEVICE_SDK_EMBEDDED_C_3_0_1_PLATFORM_NRF52840_MULTI_TLS_PLATFORM_H_
+
+#include "mbedtls/config.h"
+
+#include "mbedtls/certs.h"
+#include "mbedtls/ctr_drbg.h"
+#include "mbedtls/debug.h"
+#include "mbedtls/entropy.h"
+#include "mbedtls/error.h"
+#include "mbedtls/memory_buffer_alloc.h"
+#include "mbedtls/net.h"
+#include "mbedtls/platform.h"
+#include "mbedtls/ssl.h"
+#include "mbedtls/timing.h"
+#include "mbedtls/x509.h"
+
+// Both sim7600e and mbedtls transports are linked, see network_transport.h.
+// Fields of both transports, names don't clash so wrappers use them as is.
+typedef struct _TLSDataParams {
+    // sim7600e
+    int session_id;
+
+    // mbedtls
+    mbedtls_entropy_context entropy;
+    mbedtls_ctr_drbg_context ctr_drbg;
+    mbedtls_ssl_context ssl;
+    mbedtls_ssl_config conf;
+    uint32_t flags;
+    mbedtls_x509_crt cacert;
+    mbedtls_x509_crt clicert;
+    mbedtls_pk_context pkey;
+    mbedtls_net_context server_fd;
+} TLSDataParams;
+
+#endif //AWS_IOT_DEVICE_SDK_EMBEDDED_C_3_0_1_PLATFORM_NRF52840_MULTI_TLS_PLATFORM_H_
@@ -0,0 +1,102 @@
+/*
+
+Copyright 2019-2020 Ravikiran Bukkasagara <contact@ravikiranb.com>
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+    
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+/*
+	Selects TLS transport per connection when both sim7600e (modem SSL) and
+	mbedtls (MCU TLS over modem TCP) wrappers are linked in one image.
+*/
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "aws_iot_config.h"
+#include "aws_iot_error.h"
+#include "aws_iot_log.h"
+#include "network_transport.h"
+
+#ifndef IOT_TLS_DEFAULT_TRANSPORT
+#define IOT_TLS_DEFAULT_TRANSPORT IOT_TLS_TRANSPORT_MBEDTLS
+#endif
+
+static const char* transport_names[IOT_TLS_TRANSPORT_COUNT] = {
+    "modem-ssl",
+    "mbedtls",
+};
+
+IoT_Error_t iot_tls_init(Network* pNetwork, const char* pRootCALocation, const char* pDeviceCertLocation,
+    const char* pDevicePrivateKeyLocation, const char* pDestinationURL,
+    uint16_t destinationPort, uint32_t timeout_ms, bool ServerVerificationFlag)
+{
+    if (NULL == pNetwork) {
+        return NULL_VALUE_ERROR;
+    }
+
+    pNetwork->tlsConnectParams.pRootCALocation = pRootCALocation;
+    pNetwork->tlsConnectParams.pDeviceCertLocation = pDeviceCertLocation;
+    pNetwork->tlsConnectParams.pDevicePrivateKeyLocation = pDevicePrivateKeyLocation;
+    pNetwork->tlsConnectParams.pDestinationURL = pDestinationURL;
+    pNetwork->tlsConnectParams.DestinationPort = destinationPort;
+    pNetwork->tlsConnectParams.timeout_ms = timeout_ms;
+    pNetwork->tlsConnectParams.ServerVerificationFlag = ServerVerificationFlag;
+
+    return iot_tls_set_transport(pNetwork, IOT_TLS_DEFAULT_TRANSPORT);
+}
+
+IoT_Error_t iot_tls_set_transport(Network* pNetwork, iot_tls_transport_t transport)
+{
+    TLSConnectParams* params;
+
+    if (NULL == pNetwork) {
+        return NULL_VALUE_ERROR;
+    }
+
+    params = &(pNetwork->tlsConnectParams);
+
+    IOT_DEBUG("TLS transport: %s\r\n", iot_tls_transport_name(transport));
+
+    switch (transport) {
+    case IOT_TLS_TRANSPORT_MODEM:
+        return iot_modem_tls_init(pNetwork, params->pRootCALocation, params->pDeviceCertLocation,
+            params->pDevicePrivateKeyLocation, params->pDestinationURL, params->DestinationPort,
+            params->timeout_ms, params->ServerVerificationFlag);
+    case IOT_TLS_TRANSPORT_MBEDTLS:
+        return iot_mbedtls_init(pNetwork, params->pRootCALocation, params->pDeviceCertLocation,
+            params->pDevicePrivateKeyLocation, params->pDestinationURL, params->DestinationPort,
+            params->timeout_ms, params->ServerVerificationFlag);
+    default:
+        return FAILURE;
+    }
+}
+
+iot_tls_transport_t iot_tls_get_transport(const Network* pNetwork)
+{
+    if (pNetwork->connect == iot_modem_tls_connect) {
+        return IOT_TLS_TRANSPORT_MODEM;
+    }
+
+    return IOT_TLS_TRANSPORT_MBEDTLS;
+}
+
+const char* iot_tls_transport_name(iot_tls_transport_t transport)
+{
+    if ((unsigned int)transport >= IOT_TLS_TRANSPORT_COUNT) {
+        return "unknown";
+    }
+
+    return transport_names[transport];
+}
@@ -0,0 +1,48 @@
+/*
+
+Copyright 2019-2020 Ravikiran Bukkasagara <contact@ravikiranb.com>
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+    
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#ifndef AWS_IOT_DEVICE_SDK_EMBEDDED_C_3_0_1_PLATFORM_NRF52840_MULTI_TLS_NETWORK_TRANSPORT_H_
+#define AWS_IOT_DEVICE_SDK_EMBEDDED_C_3_0_1_PLATFORM_NRF52840_MULTI_TLS_NETWORK_TRANSPORT_H_
+
+#include "network_interface.h"
+
+typedef enum {
+    IOT_TLS_TRANSPORT_MODEM = 0, // SIM7600 SSL offload
+    IOT_TLS_TRANSPORT_MBEDTLS, // mbedTLS on MCU over modem TCP
+    IOT_TLS_TRANSPORT_COUNT
+} iot_tls_transport_t;
+
+// iot_tls_init() picks IOT_TLS_DEFAULT_TRANSPORT (aws_iot_config.h).
+// Switch transport of a network only while it is disconnected, connect
+// parameters are kept.
+IoT_Error_t iot_tls_set_transport(Network* pNetwork, iot_tls_transport_t transport);
+iot_tls_transport_t iot_tls_get_transport(const Network* pNetwork);
+const char* iot_tls_transport_name(iot_tls_transport_t transport);
+
+// Transport wrappers, renamed when IOT_TLS_MULTI_TRANSPORT is defined.
+IoT_Error_t iot_modem_tls_init(Network* pNetwork, const char* pRootCALocation, const char* pDeviceCertLocation,
+    const char* pDevicePrivateKeyLocation, const char* pDestinationURL,
+    uint16_t DestinationPort, uint32_t timeout_ms, bool ServerVerificationFlag);
+IoT_Error_t iot_modem_tls_connect(Network* pNetwork, TLSConnectParams* TLSParams);
+
+IoT_Error_t iot_mbedtls_init(Network* pNetwork, const char* pRootCALocation, const char* pDeviceCertLocation,
+    const char* pDevicePrivateKeyLocation, const char* pDestinationURL,
+    uint16_t DestinationPort, uint32_t timeout_ms, bool ServerVerificationFlag);
+IoT_Error_t iot_mbedtls_connect(Network* pNetwork, TLSConnectParams* TLSParams);
+
+#endif //AWS_IOT_DEVICE_SDK_EMBEDDED_C_3_0_1_PLATFORM_NRF52840_MULTI_TLS_NETWORK_TRANSPORT_H_
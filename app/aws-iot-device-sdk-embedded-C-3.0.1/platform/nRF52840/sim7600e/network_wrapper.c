@@ -20,14 +20,24 @@ limitations under the License.
 #include <string.h>
 #include <stdio.h>
 
+#ifdef IOT_TLS_MULTI_TRANSPORT
+// Linked along with other transport, network_transport.c dispatches.
+#define iot_tls_init iot_modem_tls_init
+#define iot_tls_connect iot_modem_tls_connect
+#define iot_tls_write iot_modem_tls_write
+#define iot_tls_read iot_modem_tls_read
+#define iot_tls_disconnect iot_modem_tls_disconnect
+#define iot_tls_destroy iot_modem_tls_destroy
+#define iot_tls_is_connected iot_modem_tls_is_connected
+#define _iot_tls_set_connect_params _iot_modem_tls_set_connect_params
+#endif
+
 #include "network_interface.h"
 #include "timer_platform.h"
 
 
 #include "aws_iot_error.h"
 #include "aws_iot_log.h"
-#include "network_interface.h"
-#include "network_platform.h"
 
 #include "sim7600_gprs.h"
 #include "uart_print.h"
@@ -35,6 +45,11 @@ limitations under the License.
 /* This is the value used for ssl read timeout */
 #define IOT_SSL_READ_TIMEOUT 10
 #define AWS_IOT_SSL_CONTEXT_ID 0
+// MQTT publish uses at most header, topic, packet id and payload.
+#define IOT_TLS_MAX_WRITE_SEGMENTS 4
+
+static IoT_Error_t _iot_tls_write_segments(Network* pNetwork, const IoT_Net_Segment* pSegments, size_t count,
+    Timer* timer, size_t* written_len);
 
 void _iot_tls_set_connect_params(Network* pNetwork, const char* pRootCALocation, const char* pDeviceCertLocation,
     const char* pDevicePrivateKeyLocation, const char* pDestinationURL,
@@ -65,6 +80,7 @@ IoT_Error_t iot_tls_init(Network* pNetwork, const char* pRootCALocation, const c
     pNetwork->connect = iot_tls_connect;
     pNetwork->read = iot_tls_read;
     pNetwork->write = iot_tls_write;
+    pNetwork->writeSegments = _iot_tls_write_segments;
     pNetwork->disconnect = iot_tls_disconnect;
     pNetwork->isConnected = iot_tls_is_connected;
     pNetwork->destroy = iot_tls_destroy;
@@ -166,6 +182,46 @@ IoT_Error_t iot_tls_write(Network* pNetwork, unsigned char* pMsg, size_t len, Ti
     return SUCCESS;
 }
 
+// Modem takes all segments in one CCHSEND, nothing is copied on MCU.
+static IoT_Error_t _iot_tls_write_segments(Network* pNetwork, const IoT_Net_Segment* pSegments, size_t count,
+    Timer* timer, size_t* written_len)
+{
+    gprs_segment_t segments[IOT_TLS_MAX_WRITE_SEGMENTS];
+    size_t i;
+    size_t len = 0;
+    int ret;
+    int session_id = pNetwork->tlsDataParams.session_id;
+
+    *written_len = 0;
+
+    if (count > IOT_TLS_MAX_WRITE_SEGMENTS)
+        return NETWORK_SSL_WRITE_ERROR;
+
+    for (i = 0; i < count; i++) {
+        segments[i].buf = pSegments[i].pBuf;
+        segments[i].len = (int)pSegments[i].len;
+        len += pSegments[i].len;
+    }
+
+    if (has_timer_expired(timer))
+        return NETWORK_SSL_WRITE_TIMEOUT_ERROR;
+
+    ret = gprs_ssl_sendv(session_id, segments, (int)count, (int)left_ms(timer));
+    if (ret < 0) {
+        dbg_printf(DEBUG_LEVEL_ERROR, "gprs_ssl_sendv: %d\r\n", ret);
+        if (ret == GPRS_ERROR_TIMEOUT)
+            return NETWORK_SSL_WRITE_TIMEOUT_ERROR;
+        return NETWORK_SSL_WRITE_ERROR;
+    }
+
+    *written_len = (size_t)ret;
+
+    if ((size_t)ret != len)
+        return NETWORK_SSL_WRITE_TIMEOUT_ERROR;
+
+    return SUCCESS;
+}
+
 IoT_Error_t iot_tls_read(Network* pNetwork, unsigned char* pMsg, size_t len, Timer* timer, size_t* read_len)
 {
     size_t rxLen = 0;
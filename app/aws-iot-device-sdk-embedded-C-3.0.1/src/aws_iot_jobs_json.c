@@ -22,67 +22,14 @@ extern "C" {
 #include <stdbool.h>
 #include <stdlib.h>
 #include <stddef.h>
-#include <stdio.h>
-#include <stdarg.h>
 
 #include "jsmn.h"
 #include "aws_iot_jobs_json.h"
+#include "aws_iot_json_writer.h"
 
-struct _SerializeState {
-	int totalSize;
-	char *nextPtr;
-	size_t remaingSize;
-};
-
-static void _printToBuffer(struct _SerializeState *state, const char *fmt, ...) {
-	if (state->totalSize == -1) return;
-
-	va_list vl;
-	va_start(vl, fmt);
-	int len = vsnprintf(state->nextPtr, state->remaingSize, fmt, vl);
-	if (len < 0) {
-		state->totalSize = -1;
-	} else {
-		state->totalSize += len;
-		if (state->nextPtr != NULL) {
-			if (state->remaingSize > (size_t) len) {
-				state->remaingSize -= (size_t) len;
-				state->nextPtr += len;
-			} else {
-				state->remaingSize = 0;
-				state->nextPtr = NULL;
-			}
-		}
-	}
-	va_end(vl);
-}
-
-static void _printKey(struct _SerializeState *state, bool first, const char *key) {
-	if (first) {
-		_printToBuffer(state, "{\"%s\":", key);
-	} else {
-		_printToBuffer(state, ",\"%s\":", key);
-	}
-}
-
-static void _printStringValue(struct _SerializeState *state, const char *value) {
-	if (value == NULL) {
-		_printToBuffer(state, "null");
-	} else {
-		_printToBuffer(state, "\"%s\"", value);
-	}
-}
-
-static void _printLongValue(struct _SerializeState *state, int64_t value) {
-	_printToBuffer(state, "%lld", value);
-}
-
-static void _printBooleanValue(struct _SerializeState *state, bool value) {
-	if(value) {
-		_printToBuffer(state, "true");
-	} else {
-		_printToBuffer(state, "false");
-	}
+static int _serializeResult(const AwsIotJsonWriter *writer) {
+	if (writer->rc != SUCCESS && writer->rc != SHADOW_JSON_BUFFER_TRUNCATED) return -1;
+	return (int) writer->length;
 }
 
 int aws_iot_jobs_json_serialize_update_job_execution_request(
@@ -91,105 +38,86 @@ int aws_iot_jobs_json_serialize_update_job_execution_request(
 {
 	const char *statusStr = aws_iot_jobs_map_status_to_string(request->status);
 	if (statusStr == NULL) return -1;
-	if (requestBuffer == NULL) bufferSize = 0;
 
-	struct _SerializeState state = { 0, requestBuffer, bufferSize };
-	_printKey(&state, true, "status");
-	_printStringValue(&state, statusStr);
+	AwsIotJsonWriter writer;
+	aws_iot_json_writer_init(&writer, requestBuffer, bufferSize);
+	aws_iot_json_writer_begin_object(&writer, NULL);
+	aws_iot_json_writer_string(&writer, "status", statusStr);
 	if (request->statusDetails != NULL) {
-		_printKey(&state, false, "statusDetails");
-		_printToBuffer(&state, "%s", request->statusDetails);
+		aws_iot_json_writer_object(&writer, "statusDetails", request->statusDetails);
 	}
 	if (request->executionNumber != 0) {
-		_printKey(&state, false, "executionNumber");
-		_printLongValue(&state, request->executionNumber);
+		aws_iot_json_writer_int64(&writer, "executionNumber", request->executionNumber);
 	}
 	if (request->expectedVersion != 0) {
-		_printKey(&state, false, "expectedVersion");
-		_printLongValue(&state, request->expectedVersion);
+		aws_iot_json_writer_int64(&writer, "expectedVersion", request->expectedVersion);
 	}
 	if (request->includeJobExecutionState) {
-		_printKey(&state, false, "includeJobExecutionState");
-		_printBooleanValue(&state, request->includeJobExecutionState);
+		aws_iot_json_writer_bool(&writer, "includeJobExecutionState", request->includeJobExecutionState);
 	}
 	if (request->includeJobDocument) {
-		_printKey(&state, false, "includeJobDocument");
-		_printBooleanValue(&state, request->includeJobDocument);
+		aws_iot_json_writer_bool(&writer, "includeJobDocument", request->includeJobDocument);
 	}
 	if (request->clientToken != NULL) {
-		_printKey(&state, false, "clientToken");
-		_printStringValue(&state, request->clientToken);
+		aws_iot_json_writer_string(&writer, "clientToken", request->clientToken);
 	}
+	aws_iot_json_writer_end_object(&writer);
 
-	_printToBuffer(&state, "}");
-
-	return state.totalSize;
+	return _serializeResult(&writer);
 }
 
 int aws_iot_jobs_json_serialize_client_token_only_request(
 		char *requestBuffer, size_t bufferSize,
 		const char *clientToken)
 {
-	struct _SerializeState state = { 0, requestBuffer, bufferSize };
-	_printKey(&state, true, "clientToken");
-	_printStringValue(&state, clientToken);
-	_printToBuffer(&state, "}");
+	AwsIotJsonWriter writer;
+	aws_iot_json_writer_init(&writer, requestBuffer, bufferSize);
+	aws_iot_json_writer_begin_object(&writer, NULL);
+	aws_iot_json_writer_string(&writer, "clientToken", clientToken);
+	aws_iot_json_writer_end_object(&writer);
 
-	return state.totalSize;
+	return _serializeResult(&writer);
 }
 
 int aws_iot_jobs_json_serialize_describe_job_execution_request(
 		char *requestBuffer, size_t bufferSize,
 		const AwsIotDescribeJobExecutionRequest *request)
 {
-	bool first = true;
-
 	if (requestBuffer == NULL) return 0;
 
-	struct _SerializeState state = { 0, requestBuffer, bufferSize };
+	AwsIotJsonWriter writer;
+	aws_iot_json_writer_init(&writer, requestBuffer, bufferSize);
+	aws_iot_json_writer_begin_object(&writer, NULL);
 	if (request->clientToken != NULL) {
-		_printKey(&state, first, "clientToken");
-		_printStringValue(&state, request->clientToken);
-		first = false;
+		aws_iot_json_writer_string(&writer, "clientToken", request->clientToken);
 	}
 	if (request->executionNumber != 0) {
-		_printKey(&state, first, "executionNumber");
-		_printLongValue(&state, request->executionNumber);
-		first = false;
+		aws_iot_json_writer_int64(&writer, "executionNumber", request->executionNumber);
 	}
 	if (request->includeJobDocument) {
-		_printKey(&state, first, "includeJobDocument");
-		_printBooleanValue(&state, request->includeJobDocument);
+		aws_iot_json_writer_bool(&writer, "includeJobDocument", request->includeJobDocument);
 	}
+	aws_iot_json_writer_end_object(&writer);
 
-	_printToBuffer(&state, "}");
-
-	return state.totalSize;
+	return _serializeResult(&writer);
 }
 
 int aws_iot_jobs_json_serialize_start_next_job_execution_request(
 		char *requestBuffer, size_t bufferSize,
 		const AwsIotStartNextPendingJobExecutionRequest *request)
 {
-	if (requestBuffer == NULL) bufferSize = 0;
-	struct _SerializeState state = { 0, requestBuffer, bufferSize };
+	AwsIotJsonWriter writer;
+	aws_iot_json_writer_init(&writer, requestBuffer, bufferSize);
+	aws_iot_json_writer_begin_object(&writer, NULL);
 	if (request->statusDetails != NULL) {
-		_printKey(&state, true, "statusDetails");
-		_printToBuffer(&state, "%s", request->statusDetails);
+		aws_iot_json_writer_object(&writer, "statusDetails", request->statusDetails);
 	}
 	if (request->clientToken != NULL) {
-		if(request->statusDetails != NULL) {
-			_printKey(&state, false, "clientToken");
-		} else {
-			_printKey(&state, true, "clientToken");
-		}
-		_printStringValue(&state, request->clientToken);
+		aws_iot_json_writer_string(&writer, "clientToken", request->clientToken);
 	}
-	if (request->clientToken == NULL && request->statusDetails == NULL) {
-		_printToBuffer(&state, "{");
-	}
-	_printToBuffer(&state, "}");
-	return state.totalSize;
+	aws_iot_json_writer_end_object(&writer);
+
+	return _serializeResult(&writer);
 }
 
 #ifdef __cplusplus
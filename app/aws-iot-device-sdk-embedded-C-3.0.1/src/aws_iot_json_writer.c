@@ -0,0 +1,214 @@
+/*
+ * Copyright 2010-2015 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file aws_iot_json_writer.c
+ * @brief Cursor based JSON writer used to build Shadow and Jobs documents
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "aws_iot_json_writer.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+static bool writerIsWritable(const AwsIotJsonWriter *pWriter) {
+	return pWriter->rc == SUCCESS || pWriter->rc == SHADOW_JSON_BUFFER_TRUNCATED;
+}
+
+/* Account for length bytes that did not fit; the buffer keeps the last complete prefix */
+static void writerTruncate(AwsIotJsonWriter *pWriter, size_t length) {
+	if(pWriter->rc == SUCCESS && pWriter->pBuffer != NULL && pWriter->bufferSize > 0) {
+		pWriter->pBuffer[pWriter->length] = '\0';
+	}
+	pWriter->rc = SHADOW_JSON_BUFFER_TRUNCATED;
+	pWriter->length += length;
+}
+
+static void writerAppend(AwsIotJsonWriter *pWriter, const char *pData, size_t length) {
+	if(!writerIsWritable(pWriter)) {
+		return;
+	}
+
+	if(pWriter->rc == SUCCESS && pWriter->length + length < pWriter->bufferSize) {
+		memcpy(pWriter->pBuffer + pWriter->length, pData, length);
+		pWriter->length += length;
+		pWriter->pBuffer[pWriter->length] = '\0';
+	} else {
+		writerTruncate(pWriter, length);
+	}
+}
+
+static void writerVprintf(AwsIotJsonWriter *pWriter, const char *pFormat, va_list args) {
+	char *pCursor = NULL;
+	size_t remaining = 0;
+	int written;
+
+	if(!writerIsWritable(pWriter)) {
+		return;
+	}
+
+	if(pWriter->rc == SUCCESS) {
+		pCursor = pWriter->pBuffer + pWriter->length;
+		remaining = pWriter->bufferSize - pWriter->length;
+	}
+
+	written = vsnprintf(pCursor, remaining, pFormat, args);
+	if(written < 0) {
+		pWriter->rc = SHADOW_JSON_ERROR;
+	} else if((size_t) written < remaining) {
+		pWriter->length += (size_t) written;
+	} else {
+		writerTruncate(pWriter, (size_t) written);
+	}
+}
+
+static void writerPrintf(AwsIotJsonWriter *pWriter, const char *pFormat, ...) {
+	va_list args;
+
+	va_start(args, pFormat);
+	writerVprintf(pWriter, pFormat, args);
+	va_end(args);
+}
+
+static void writerBeginValue(AwsIotJsonWriter *pWriter, const char *pKey) {
+	if(pKey != NULL) {
+		aws_iot_json_writer_key(pWriter, pKey);
+	}
+	pWriter->needSeparator = true;
+}
+
+void aws_iot_json_writer_init(AwsIotJsonWriter *pWriter, char *pBuffer, size_t bufferSize) {
+	aws_iot_json_writer_resume(pWriter, pBuffer, bufferSize, 0);
+}
+
+void aws_iot_json_writer_resume(AwsIotJsonWriter *pWriter, char *pBuffer, size_t bufferSize, size_t length) {
+	pWriter->pBuffer = pBuffer;
+	pWriter->bufferSize = (pBuffer != NULL) ? bufferSize : 0;
+	pWriter->length = length;
+	pWriter->needSeparator = (pBuffer != NULL && length > 0 && pBuffer[length - 1] != '{');
+	pWriter->rc = SUCCESS;
+
+	if(length >= pWriter->bufferSize) {
+		pWriter->rc = SHADOW_JSON_BUFFER_TRUNCATED;
+	} else {
+		pBuffer[length] = '\0';
+	}
+}
+
+void aws_iot_json_writer_begin_object(AwsIotJsonWriter *pWriter, const char *pKey) {
+	writerBeginValue(pWriter, pKey);
+	writerAppend(pWriter, "{", 1);
+	pWriter->needSeparator = false;
+}
+
+void aws_iot_json_writer_end_object(AwsIotJsonWriter *pWriter) {
+	writerAppend(pWriter, "}", 1);
+	pWriter->needSeparator = true;
+}
+
+void aws_iot_json_writer_key(AwsIotJsonWriter *pWriter, const char *pKey) {
+	if(pWriter->needSeparator) {
+		writerAppend(pWriter, ",", 1);
+	}
+	writerAppend(pWriter, "\"", 1);
+	writerAppend(pWriter, pKey, strlen(pKey));
+	writerAppend(pWriter, "\":", 2);
+	pWriter->needSeparator = false;
+}
+
+void aws_iot_json_writer_int32(AwsIotJsonWriter *pWriter, const char *pKey, int32_t value) {
+	writerBeginValue(pWriter, pKey);
+	writerPrintf(pWriter, "%ld", (long) value);
+}
+
+void aws_iot_json_writer_uint32(AwsIotJsonWriter *pWriter, const char *pKey, uint32_t value) {
+	writerBeginValue(pWriter, pKey);
+	writerPrintf(pWriter, "%lu", (unsigned long) value);
+}
+
+void aws_iot_json_writer_int64(AwsIotJsonWriter *pWriter, const char *pKey, int64_t value) {
+	writerBeginValue(pWriter, pKey);
+	writerPrintf(pWriter, "%lld", (long long) value);
+}
+
+void aws_iot_json_writer_double(AwsIotJsonWriter *pWriter, const char *pKey, double value) {
+	writerBeginValue(pWriter, pKey);
+	writerPrintf(pWriter, "%f", value);
+}
+
+void aws_iot_json_writer_bool(AwsIotJsonWriter *pWriter, const char *pKey, bool value) {
+	writerBeginValue(pWriter, pKey);
+	if(value) {
+		writerAppend(pWriter, "true", 4);
+	} else {
+		writerAppend(pWriter, "false", 5);
+	}
+}
+
+void aws_iot_json_writer_string(AwsIotJsonWriter *pWriter, const char *pKey, const char *pValue) {
+	const char *pRun;
+	char escaped[7];
+
+	writerBeginValue(pWriter, pKey);
+	if(pValue == NULL) {
+		writerAppend(pWriter, "null", 4);
+		return;
+	}
+
+	writerAppend(pWriter, "\"", 1);
+	pRun = pValue;
+	for(; *pValue != '\0'; pValue++) {
+		unsigned char c = (unsigned char) *pValue;
+		if(c != '"' && c != '\\' && c >= 0x20) {
+			continue;
+		}
+		/* Copy the plain run in one go, then the escape for this character */
+		writerAppend(pWriter, pRun, (size_t) (pValue - pRun));
+		if(c == '"' || c == '\\') {
+			escaped[0] = '\\';
+			escaped[1] = (char) c;
+			writerAppend(pWriter, escaped, 2);
+		} else {
+			snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+			writerAppend(pWriter, escaped, 6);
+		}
+		pRun = pValue + 1;
+	}
+	writerAppend(pWriter, pRun, (size_t) (pValue - pRun));
+	writerAppend(pWriter, "\"", 1);
+}
+
+void aws_iot_json_writer_object(AwsIotJsonWriter *pWriter, const char *pKey, const char *pJson) {
+	writerBeginValue(pWriter, pKey);
+	writerAppend(pWriter, pJson, strlen(pJson));
+}
+
+void aws_iot_json_writer_format(AwsIotJsonWriter *pWriter, const char *pFormat, ...) {
+	va_list args;
+
+	va_start(args, pFormat);
+	writerVprintf(pWriter, pFormat, args);
+	va_end(args);
+	pWriter->needSeparator = true;
+}
+
+#ifdef __cplusplus
+}
+#endif
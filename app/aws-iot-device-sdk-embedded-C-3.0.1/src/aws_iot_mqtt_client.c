@@ -42,7 +42,7 @@ extern "C" {
 #include <string.h>
 
 #include "aws_iot_log.h"
-#include "aws_iot_mqtt_client_interface.h"
+#include "aws_iot_mqtt_client_common_internal.h"
 #include "aws_iot_version.h"
 
 #if !DISABLE_METRICS
@@ -217,9 +217,16 @@ IoT_Error_t aws_iot_mqtt_init(AWS_IoT_Client *pClient, IoT_Client_Init_Params *p
 	for(i = 0; i < AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS; ++i) {
 		pClient->clientData.messageHandlers[i].topicName = NULL;
 		pClient->clientData.messageHandlers[i].pApplicationHandler = NULL;
+		pClient->clientData.messageHandlers[i].pStreamHandler = NULL;
 		pClient->clientData.messageHandlers[i].pApplicationHandlerData = NULL;
 		pClient->clientData.messageHandlers[i].qos = QOS0;
 	}
+	aws_iot_mqtt_internal_index_topic_filters(pClient);
+
+	for(i = 0; i < AWS_IOT_MQTT_MAX_INFLIGHT_PUBLISH; ++i) {
+		pClient->clientData.inflightPublish[i].isUsed = false;
+	}
+	pClient->clientData.inflightCount = 0;
 
 	pClient->clientData.packetTimeoutMs = pInitParams->mqttPacketTimeout_ms;
 	pClient->clientData.commandTimeoutMs = pInitParams->mqttCommandTimeout_ms;
@@ -229,6 +236,8 @@ IoT_Error_t aws_iot_mqtt_init(AWS_IoT_Client *pClient, IoT_Client_Init_Params *p
 	pClient->clientData.disconnectHandler = pInitParams->disconnectHandler;
 	pClient->clientData.disconnectHandlerData = pInitParams->disconnectHandlerData;
 	pClient->clientData.nextPacketId = 1;
+	pClient->clientData.pingIntervalSec = 0;
+	pClient->clientData.pingResponseCount = 0;
 
 	/* Initialize default connection options */
 	rc = aws_iot_mqtt_set_connect_params(pClient, &default_options);
@@ -257,6 +266,7 @@ IoT_Error_t aws_iot_mqtt_init(AWS_IoT_Client *pClient, IoT_Client_Init_Params *p
 
 	pClient->clientStatus.isPingOutstanding = 0;
 	pClient->clientStatus.isAutoReconnectEnabled = pInitParams->enableAutoReconnect;
+	pClient->clientStatus.isSessionPresent = false;
 
 	rc = iot_tls_init(&(pClient->networkStack), pInitParams->pRootCALocation, pInitParams->pDeviceCertLocation,
 					  pInitParams->pDevicePrivateKeyLocation, pInitParams->pHostURL, pInitParams->port,
@@ -280,9 +290,53 @@ IoT_Error_t aws_iot_mqtt_init(AWS_IoT_Client *pClient, IoT_Client_Init_Params *p
 	FUNC_EXIT_RC(SUCCESS);
 }
 
+static bool _aws_iot_mqtt_is_packet_id_inflight(AWS_IoT_Client *pClient, uint16_t packetId) {
+	uint32_t itr;
+
+	for(itr = 0; itr < AWS_IOT_MQTT_MAX_INFLIGHT_PUBLISH; ++itr) {
+		if(pClient->clientData.inflightPublish[itr].isUsed
+		   && packetId == pClient->clientData.inflightPublish[itr].packetId) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
 uint16_t aws_iot_mqtt_get_next_packet_id(AWS_IoT_Client *pClient) {
-	return pClient->clientData.nextPacketId = (uint16_t) ((MAX_PACKET_ID == pClient->clientData.nextPacketId) ? 1 : (
-			pClient->clientData.nextPacketId + 1));
+	/* Unacknowledged publishes keep their id across reconnects, don't reuse it after wrap around */
+	do {
+		pClient->clientData.nextPacketId = (uint16_t) ((MAX_PACKET_ID == pClient->clientData.nextPacketId) ? 1 : (
+				pClient->clientData.nextPacketId + 1));
+	} while(_aws_iot_mqtt_is_packet_id_inflight(pClient, pClient->clientData.nextPacketId));
+
+	return pClient->clientData.nextPacketId;
+}
+
+IoT_Error_t aws_iot_mqtt_set_ping_interval(AWS_IoT_Client *pClient, uint16_t pingIntervalSec) {
+	if(NULL == pClient) {
+		return NULL_VALUE_ERROR;
+	}
+
+	pClient->clientData.pingIntervalSec = pingIntervalSec;
+
+	return SUCCESS;
+}
+
+uint32_t aws_iot_mqtt_get_ping_response_count(AWS_IoT_Client *pClient) {
+	if(NULL == pClient) {
+		return 0;
+	}
+
+	return pClient->clientData.pingResponseCount;
+}
+
+bool aws_iot_mqtt_is_session_present(AWS_IoT_Client *pClient) {
+	if(NULL == pClient) {
+		return false;
+	}
+
+	return pClient->clientStatus.isSessionPresent;
 }
 
 bool aws_iot_mqtt_is_client_connected(AWS_IoT_Client *pClient) {
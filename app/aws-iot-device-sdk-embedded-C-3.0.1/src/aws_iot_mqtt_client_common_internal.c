@@ -46,6 +46,14 @@ extern "C" {
 /* Max length of packet header */
 #define MAX_NO_OF_REMAINING_LENGTH_BYTES 4
 
+/* Bit per message handler, set when its topic filter matches */
+#define HANDLER_MATCH_WORDS ((AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS + 31) / 32)
+#define HANDLER_MATCHED(pMatched, itr) (0 != ((pMatched)[(itr) / 32] & ((uint32_t) 1 << ((itr) % 32))))
+
+#if AWS_IOT_MQTT_TOPIC_NODES > 32767
+#error "Topic filter index nodes are numbered with int16_t"
+#endif
+
 /**
  * Encodes the message length according to the MQTT algorithm
  * @param buf the buffer into which the encoded data is written
@@ -177,6 +185,115 @@ void aws_iot_mqtt_internal_write_utf8_string(unsigned char **pptr, const char *s
 	}
 }
 
+/**
+ * Reads MQTT 5 properties: variable byte length followed by identifier/value pairs.
+ * Properties the client acts on are returned in pProps, all others are skipped.
+ * @param pptr pointer to the input buffer - incremented past the properties
+ * @param pEnd end of the packet, properties must not extend beyond it
+ * @param pProps returned properties, may be NULL to only skip them
+ * @return SUCCESS, or FAILURE on malformed or unknown property
+ */
+IoT_Error_t aws_iot_mqtt_internal_read_properties(unsigned char **pptr, unsigned char *pEnd, MQTT5Properties *pProps) {
+	unsigned char *curData = *pptr;
+	unsigned char *propsEnd;
+	unsigned char id;
+	uint32_t propsLen = 0;
+	uint32_t readBytesLen = 0;
+	size_t valueLen;
+	IoT_Error_t rc;
+
+	FUNC_ENTRY;
+
+	if(curData >= pEnd) {
+		FUNC_EXIT_RC(FAILURE);
+	}
+
+	rc = aws_iot_mqtt_internal_decode_remaining_length_from_buffer(curData, &propsLen, &readBytesLen);
+	if(SUCCESS != rc) {
+		FUNC_EXIT_RC(rc);
+	}
+	curData += readBytesLen;
+	if(curData > pEnd || propsLen > (uint32_t) (pEnd - curData)) {
+		FUNC_EXIT_RC(FAILURE);
+	}
+	propsEnd = curData + propsLen;
+
+	while(curData < propsEnd) {
+		id = aws_iot_mqtt_internal_read_char(&curData);
+		switch(id) {
+			case 0x01: case 0x17: case 0x19: case 0x24: case 0x25: case 0x28: case 0x29: case 0x2A:
+				valueLen = 1;
+				break;
+			case 0x13: case 0x21: case 0x22: case 0x23:
+				valueLen = 2;
+				break;
+			case 0x02: case 0x11: case 0x18: case 0x27:
+				valueLen = 4;
+				break;
+			case 0x0B:
+				/* Subscription identifier, variable byte integer */
+				valueLen = 1;
+				while(curData + valueLen <= propsEnd && (curData[valueLen - 1] & 0x80) && valueLen < 4) {
+					valueLen++;
+				}
+				break;
+			case 0x03: case 0x08: case 0x09: case 0x12: case 0x15: case 0x16: case 0x1A: case 0x1C: case 0x1F:
+				/* UTF-8 string or binary data */
+				if(propsEnd - curData < 2) {
+					FUNC_EXIT_RC(FAILURE);
+				}
+				valueLen = 2 + (size_t) ((curData[0] << 8) | curData[1]);
+				break;
+			case 0x26:
+				/* User property, string pair */
+				if(propsEnd - curData < 2) {
+					FUNC_EXIT_RC(FAILURE);
+				}
+				valueLen = 2 + (size_t) ((curData[0] << 8) | curData[1]);
+				if((size_t) (propsEnd - curData) < valueLen + 2) {
+					FUNC_EXIT_RC(FAILURE);
+				}
+				valueLen += 2 + (size_t) ((curData[valueLen] << 8) | curData[valueLen + 1]);
+				break;
+			default:
+				FUNC_EXIT_RC(FAILURE);
+		}
+
+		if((size_t) (propsEnd - curData) < valueLen) {
+			FUNC_EXIT_RC(FAILURE);
+		}
+
+		if(NULL != pProps) {
+			unsigned char *value = curData;
+
+			switch(id) {
+				case MQTT5_PROP_RECEIVE_MAXIMUM:
+					pProps->receiveMaximum = aws_iot_mqtt_internal_read_uint16_t(&value);
+					break;
+				case MQTT5_PROP_TOPIC_ALIAS_MAXIMUM:
+					pProps->topicAliasMaximum = aws_iot_mqtt_internal_read_uint16_t(&value);
+					break;
+				case MQTT5_PROP_SERVER_KEEP_ALIVE:
+					pProps->serverKeepAlive = aws_iot_mqtt_internal_read_uint16_t(&value);
+					pProps->hasServerKeepAlive = true;
+					break;
+				case MQTT5_PROP_REASON_STRING:
+					pProps->reasonStringLen = (uint16_t) (valueLen - 2);
+					pProps->pReasonString = (const char *) &value[2];
+					break;
+				default:
+					break;
+			}
+		}
+
+		curData += valueLen;
+	}
+
+	*pptr = curData;
+
+	FUNC_EXIT_RC(SUCCESS);
+}
+
 /**
  * Initialize the MQTTHeader structure. Used to ensure that Header bits are
  * always initialized using the proper mappings. No Endianness issues here since
@@ -311,13 +428,119 @@ IoT_Error_t aws_iot_mqtt_internal_send_packet(AWS_IoT_Client *pClient, size_t le
 
 	if(sent == length) {
 		/* record the fact that we have successfully sent the packet */
-		//countdown_sec(&c->pingTimer, c->clientData.keepAliveInterval);
+		aws_iot_mqtt_internal_restart_ping_timer(pClient);
 		FUNC_EXIT_RC(SUCCESS);
 	}
 
 	FUNC_EXIT_RC(rc) 
 }
 
+/**
+ * @brief Restarts idle time before next PINGREQ
+ *
+ * Any packet sent keeps the connection alive for broker and carrier NAT alike,
+ * so ping is only needed after ping interval without other traffic. Wait for an
+ * outstanding PINGRESP is not extended.
+ *
+ * @param pClient Reference to the IoT Client
+ */
+void aws_iot_mqtt_internal_restart_ping_timer(AWS_IoT_Client *pClient) {
+	uint16_t interval = pClient->clientData.keepAliveInterval;
+
+	if(pClient->clientStatus.isPingOutstanding || 0 == interval) {
+		return;
+	}
+
+	if(0 != pClient->clientData.pingIntervalSec && pClient->clientData.pingIntervalSec < interval) {
+		interval = pClient->clientData.pingIntervalSec;
+	}
+
+	countdown_sec(&pClient->pingTimer, interval);
+}
+
+/**
+ * @brief Sends a packet made of several buffers
+ *
+ * Buffers are passed to network layer as they are when it supports gather write,
+ * otherwise each one is written on its own. Neither uses the TX buffer.
+ *
+ * @param pClient Reference to the IoT Client
+ * @param pSegments Buffers in packet order
+ * @param segmentCount Number of buffers
+ * @param pTimer Timer to keep track of timeout
+ *
+ * @return An IoT Error Type defining successful/failed send
+ */
+IoT_Error_t aws_iot_mqtt_internal_send_segments(AWS_IoT_Client *pClient, const IoT_Net_Segment *pSegments,
+												size_t segmentCount, Timer *pTimer) {
+	size_t itr, total, sent, sentLen;
+	IoT_Error_t rc = SUCCESS;
+
+	FUNC_ENTRY;
+
+	if(NULL == pClient || NULL == pSegments || NULL == pTimer) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	total = 0;
+	for(itr = 0; itr < segmentCount; itr++) {
+		total += pSegments[itr].len;
+	}
+
+#ifdef _ENABLE_THREAD_SUPPORT_
+	rc = aws_iot_mqtt_client_lock_mutex(pClient, &(pClient->clientData.tls_write_mutex));
+	if(SUCCESS != rc) {
+		FUNC_EXIT_RC(rc);
+	}
+#endif
+
+	sent = 0;
+
+	if(NULL != pClient->networkStack.writeSegments) {
+		rc = pClient->networkStack.writeSegments(&(pClient->networkStack), pSegments, segmentCount, pTimer, &sent);
+	} else {
+		for(itr = 0; itr < segmentCount && SUCCESS == rc; itr++) {
+			size_t segmentSent = 0;
+
+			while(segmentSent < pSegments[itr].len && !has_timer_expired(pTimer)) {
+				rc = pClient->networkStack.write(&(pClient->networkStack),
+								 (unsigned char *) &pSegments[itr].pBuf[segmentSent],
+								 (pSegments[itr].len - segmentSent),
+								 pTimer,
+								 &sentLen);
+				if(SUCCESS != rc) {
+					break;
+				}
+				segmentSent += sentLen;
+			}
+			sent += segmentSent;
+			if(segmentSent != pSegments[itr].len) {
+				break;
+			}
+		}
+	}
+
+#ifdef _ENABLE_THREAD_SUPPORT_
+	{
+		IoT_Error_t threadRc = aws_iot_mqtt_client_unlock_mutex(pClient, &(pClient->clientData.tls_write_mutex));
+		if(SUCCESS != threadRc) {
+			FUNC_EXIT_RC(threadRc);
+		}
+	}
+#endif
+
+	if(sent == total) {
+		aws_iot_mqtt_internal_restart_ping_timer(pClient);
+		FUNC_EXIT_RC(SUCCESS);
+	}
+
+	if(SUCCESS == rc) {
+		rc = NETWORK_SSL_WRITE_TIMEOUT_ERROR;
+	}
+
+	FUNC_EXIT_RC(rc);
+}
+
 static IoT_Error_t _aws_iot_mqtt_internal_readWrapper( AWS_IoT_Client *pClient, size_t offset, size_t size, Timer *pTimer, size_t * read_len ) {
     IoT_Error_t rc;
     int byteToRead;
@@ -378,6 +601,216 @@ static IoT_Error_t _aws_iot_mqtt_internal_decode_packet_remaining_len(AWS_IoT_Cl
 	FUNC_EXIT_RC(rc);
 }
 
+static void _aws_iot_mqtt_internal_match_handlers(const ClientData *pData, const char *pTopicName,
+												  uint16_t topicNameLen, uint32_t *pMatched);
+
+static bool _aws_iot_mqtt_internal_stream_fragment(AWS_IoT_Client *pClient, char *pTopicName, uint16_t topicNameLen,
+												   const uint32_t *pMatched,
+												   IoT_Publish_Message_Params *pMsg, size_t offset,
+												   const unsigned char *pFragment, size_t fragmentLen) {
+	uint32_t itr;
+	bool delivered = false;
+	ClientState clientState;
+
+	clientState = aws_iot_mqtt_get_client_state(pClient);
+	aws_iot_mqtt_set_client_state(pClient, clientState, CLIENT_STATE_CONNECTED_WAIT_FOR_CB_RETURN);
+
+	for(itr = 0; itr < AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS; ++itr) {
+		MessageHandlers *pHandler = &(pClient->clientData.messageHandlers[itr]);
+
+		if(HANDLER_MATCHED(pMatched, itr) && NULL != pHandler->topicName && NULL != pHandler->pStreamHandler) {
+			pHandler->pStreamHandler(pClient, pTopicName, topicNameLen, pMsg, offset, pFragment, fragmentLen,
+									 pHandler->pApplicationHandlerData);
+			delivered = true;
+		}
+	}
+
+	aws_iot_mqtt_set_client_state(pClient, CLIENT_STATE_CONNECTED_WAIT_FOR_CB_RETURN, clientState);
+
+	return delivered;
+}
+
+/**
+ * @brief Reads MQTT 5 properties of a streamed PUBLISH into RX buffer after topic and packet id
+ *
+ * Property length is read one byte at a time since its size is known only from its own bytes.
+ *
+ * @param pClient Reference to the IoT Client
+ * @param offset Length of fixed header already in RX buffer
+ * @param rem_len Remaining length of packet
+ * @param pHdrLen Variable header length read so far, extended by properties
+ * @param pTimer Timer to keep track of timeout
+ *
+ * @return SUCCESS, MQTT_RX_BUFFER_TOO_SHORT_ERROR if properties do not fit RX buffer
+ */
+static IoT_Error_t _aws_iot_mqtt_internal_stream_properties(AWS_IoT_Client *pClient, size_t offset, size_t rem_len,
+															size_t *pHdrLen, Timer *pTimer) {
+	unsigned char *ptr;
+	unsigned char encodedByte;
+	size_t start = *pHdrLen;
+	size_t read_len;
+	uint32_t propsLen = 0;
+	uint32_t multiplier = 1;
+	IoT_Error_t rc;
+
+	FUNC_ENTRY;
+
+	do {
+		if(*pHdrLen - start >= MAX_NO_OF_REMAINING_LENGTH_BYTES) {
+			FUNC_EXIT_RC(MQTT_DECODE_REMAINING_LENGTH_ERROR);
+		}
+		if(*pHdrLen >= rem_len || offset + *pHdrLen + 1 >= pClient->clientData.readBufSize) {
+			FUNC_EXIT_RC(MQTT_RX_BUFFER_TOO_SHORT_ERROR);
+		}
+
+		rc = _aws_iot_mqtt_internal_readWrapper(pClient, offset + *pHdrLen, 1, pTimer, &read_len);
+		if(SUCCESS != rc || 1 != read_len) {
+			FUNC_EXIT_RC(NETWORK_SSL_READ_ERROR);
+		}
+
+		encodedByte = pClient->clientData.readBuf[offset + *pHdrLen];
+		(*pHdrLen)++;
+		propsLen += (encodedByte & 127) * multiplier;
+		multiplier *= 128;
+	} while((encodedByte & 128) != 0);
+
+	if(*pHdrLen + propsLen > rem_len || offset + *pHdrLen + propsLen >= pClient->clientData.readBufSize) {
+		FUNC_EXIT_RC(MQTT_RX_BUFFER_TOO_SHORT_ERROR);
+	}
+
+	if(0 < propsLen) {
+		rc = _aws_iot_mqtt_internal_readWrapper(pClient, offset + *pHdrLen, propsLen, pTimer, &read_len);
+		if(SUCCESS != rc || propsLen != read_len) {
+			FUNC_EXIT_RC(NETWORK_SSL_READ_ERROR);
+		}
+		*pHdrLen += propsLen;
+	}
+
+	ptr = &(pClient->clientData.readBuf[offset + start]);
+	rc = aws_iot_mqtt_internal_read_properties(&ptr, &(pClient->clientData.readBuf[offset + *pHdrLen]), NULL);
+
+	FUNC_EXIT_RC(rc);
+}
+
+/**
+ * @brief Delivers a PUBLISH larger than RX buffer to streaming handlers
+ *
+ * Topic and packet id are read into RX buffer after fixed header, rest of the RX buffer
+ * then takes payload one fragment at a time. QoS1 message is acknowledged after its
+ * last fragment.
+ *
+ * @param pClient Reference to the IoT Client
+ * @param offset Length of fixed header already in RX buffer
+ * @param rem_len Remaining length of packet
+ * @param pTimer Timer to keep track of timeout
+ * @param pConsumed Set to number of bytes of remaining length read from network
+ *
+ * @return SUCCESS if message was streamed, MQTT_RX_BUFFER_TOO_SHORT_ERROR if there is
+ *         no streaming handler for topic or header does not fit RX buffer
+ */
+static IoT_Error_t _aws_iot_mqtt_internal_stream_publish(AWS_IoT_Client *pClient, size_t offset, size_t rem_len,
+														 Timer *pTimer, size_t *pConsumed) {
+	unsigned char *ptr;
+	unsigned char *pFragment;
+	size_t hdr_len, fragment_len, read_len, pos;
+	uint16_t topicNameLen;
+	char *pTopicName;
+	uint32_t len = 0;
+	IoT_Publish_Message_Params msg;
+	uint32_t matched[HANDLER_MATCH_WORDS];
+	MQTTHeader header = {0};
+	Timer fragmentTimer;
+	IoT_Error_t rc;
+
+	FUNC_ENTRY;
+
+	*pConsumed = 0;
+
+	header.byte = pClient->clientData.readBuf[0];
+	msg.isDup = (uint8_t) MQTT_HEADER_FIELD_DUP(header.byte);
+	msg.qos = (QoS) MQTT_HEADER_FIELD_QOS(header.byte);
+	msg.isRetained = (uint8_t) MQTT_HEADER_FIELD_RETAIN(header.byte);
+	msg.id = 0;
+
+	rc = _aws_iot_mqtt_internal_readWrapper(pClient, offset, 2, pTimer, &read_len);
+	if(SUCCESS != rc || 2 != read_len) {
+		FUNC_EXIT_RC(NETWORK_SSL_READ_ERROR);
+	}
+	*pConsumed = 2;
+
+	ptr = &(pClient->clientData.readBuf[offset]);
+	topicNameLen = aws_iot_mqtt_internal_read_uint16_t(&ptr);
+
+	hdr_len = 2 + (size_t) topicNameLen + ((QOS0 != msg.qos) ? 2 : 0);
+	if(hdr_len > rem_len || offset + hdr_len >= pClient->clientData.readBufSize) {
+		FUNC_EXIT_RC(MQTT_RX_BUFFER_TOO_SHORT_ERROR);
+	}
+
+	rc = _aws_iot_mqtt_internal_readWrapper(pClient, offset + 2, hdr_len - 2, pTimer, &read_len);
+	if(SUCCESS != rc || hdr_len - 2 != read_len) {
+		FUNC_EXIT_RC(NETWORK_SSL_READ_ERROR);
+	}
+	*pConsumed = hdr_len;
+
+	if(AWS_IOT_MQTT_IS_V5(pClient)) {
+		rc = _aws_iot_mqtt_internal_stream_properties(pClient, offset, rem_len, &hdr_len, pTimer);
+		*pConsumed = hdr_len;
+		if(SUCCESS != rc) {
+			FUNC_EXIT_RC(rc);
+		}
+	}
+
+	pTopicName = (char *) &(pClient->clientData.readBuf[offset + 2]);
+	ptr = &(pClient->clientData.readBuf[offset + 2 + topicNameLen]);
+	if(QOS0 != msg.qos) {
+		msg.id = aws_iot_mqtt_internal_read_uint16_t(&ptr);
+	}
+	_aws_iot_mqtt_internal_match_handlers(&(pClient->clientData), pTopicName, topicNameLen, matched);
+
+	pFragment = &(pClient->clientData.readBuf[offset + hdr_len]);
+	msg.payloadLen = rem_len - hdr_len;
+
+	for(pos = 0; pos < msg.payloadLen; pos += fragment_len) {
+		fragment_len = pClient->clientData.readBufSize - (offset + hdr_len);
+		if(fragment_len > msg.payloadLen - pos) {
+			fragment_len = msg.payloadLen - pos;
+		}
+
+		/* Slow link gets packet timeout for each fragment, not for whole message */
+		init_timer(&fragmentTimer);
+		countdown_ms(&fragmentTimer, pClient->clientData.packetTimeoutMs);
+
+		rc = pClient->networkStack.read(&(pClient->networkStack), pFragment, fragment_len, &fragmentTimer, &read_len);
+		if(SUCCESS != rc || fragment_len != read_len) {
+			/* Stream position is lost, connection has to be restarted */
+			_aws_iot_mqtt_internal_stream_fragment(pClient, pTopicName, topicNameLen, matched, &msg, pos, NULL, 0);
+			FUNC_EXIT_RC(NETWORK_SSL_READ_ERROR);
+		}
+		*pConsumed += read_len;
+
+		msg.payload = pFragment;
+		if(!_aws_iot_mqtt_internal_stream_fragment(pClient, pTopicName, topicNameLen, matched, &msg, pos,
+												   pFragment, fragment_len)) {
+			/* No streaming subscription, caller drains rest */
+			FUNC_EXIT_RC(MQTT_RX_BUFFER_TOO_SHORT_ERROR);
+		}
+	}
+
+	if(QOS0 == msg.qos) {
+		FUNC_EXIT_RC(SUCCESS);
+	}
+
+	rc = aws_iot_mqtt_internal_serialize_ack(pClient->clientData.writeBuf, pClient->clientData.writeBufSize,
+											 PUBACK, 0, msg.id, &len);
+	if(SUCCESS != rc) {
+		FUNC_EXIT_RC(rc);
+	}
+
+	rc = aws_iot_mqtt_internal_send_packet(pClient, len, pTimer);
+
+	FUNC_EXIT_RC(rc);
+}
+
 static IoT_Error_t _aws_iot_mqtt_internal_read_packet(AWS_IoT_Client *pClient, Timer *pTimer, uint8_t *pPacketType) {
 	size_t rem_len, total_bytes_read, bytes_to_be_read, read_len;
 	IoT_Error_t rc;
@@ -406,10 +839,25 @@ static IoT_Error_t _aws_iot_mqtt_internal_read_packet(AWS_IoT_Client *pClient, T
 		return rc;
 	} 
      
-	/* if the buffer is too short then the message will be dropped silently */
+	/* if the buffer is too short then the message is streamed to a streaming
+	 * subscription, or else dropped silently */
 	if((rem_len + offset) >= pClient->clientData.readBufSize) {
-		bytes_to_be_read = pClient->clientData.readBufSize;
-		do {
+		if(PUBLISH == MQTT_HEADER_FIELD_TYPE(pClient->clientData.readBuf[0])) {
+			rc = _aws_iot_mqtt_internal_stream_publish(pClient, offset, rem_len, pTimer, &total_bytes_read);
+			if(MQTT_RX_BUFFER_TOO_SHORT_ERROR != rc) {
+				aws_iot_mqtt_internal_flushBuffers( pClient );
+				/* Already handled, nothing left for caller */
+				*pPacketType = 0;
+				return rc;
+			}
+			rc = SUCCESS;
+		}
+
+		bytes_to_be_read = rem_len - total_bytes_read;
+		if(bytes_to_be_read > pClient->clientData.readBufSize) {
+			bytes_to_be_read = pClient->clientData.readBufSize;
+		}
+		while(total_bytes_read < rem_len && SUCCESS == rc) {
 			rc = pClient->networkStack.read(&(pClient->networkStack), pClient->clientData.readBuf, bytes_to_be_read,
 											pTimer, &read_len);
 			if(SUCCESS == rc) {
@@ -420,7 +868,7 @@ static IoT_Error_t _aws_iot_mqtt_internal_read_packet(AWS_IoT_Client *pClient, T
 					bytes_to_be_read = rem_len - total_bytes_read;
 				}
 			}
-		} while(total_bytes_read < rem_len && SUCCESS == rc);
+		}
 
         /* Check buffer was correctly emptied, otherwise, return error message. */
         if ( total_bytes_read == rem_len )
@@ -450,43 +898,267 @@ static IoT_Error_t _aws_iot_mqtt_internal_read_packet(AWS_IoT_Client *pClient, T
 	FUNC_EXIT_RC(rc);
 }
 
-// assume topic filter and name is in correct format
-// # can only be at end
-// + and # can only be next to separator
-static bool _aws_iot_mqtt_internal_is_topic_matched(char *pTopicFilter, char *pTopicName, uint16_t topicNameLen) {
+/**
+ * @brief Matches topic name against topic filter one level at a time
+ *
+ * Used for topic filters too deep for the topic filter index, follows the same
+ * MQTT 3.1.1 section 4.7.1 rules: '+' matches one level, also an empty one,
+ * and '#' matches the remaining levels including its parent level.
+ *
+ * @param pTopicFilter Topic filter, not necessarily null terminated
+ * @param topicFilterLen Length of topic filter
+ * @param pTopicName Topic name, not necessarily null terminated
+ * @param topicNameLen Length of topic name
+ *
+ * @return true if topic name matches filter
+ */
+static bool _aws_iot_mqtt_internal_is_topic_matched(const char *pTopicFilter, uint16_t topicFilterLen,
+													const char *pTopicName, uint16_t topicNameLen) {
+	const char *pFilterEnd = pTopicFilter + topicFilterLen;
+	const char *pNameEnd = pTopicName + topicNameLen;
+	const char *pFilterSep, *pNameSep;
+	bool nameDone = false;
+
+	for(;;) {
+		pFilterSep = memchr(pTopicFilter, '/', (size_t) (pFilterEnd - pTopicFilter));
+		if(NULL == pFilterSep) {
+			pFilterSep = pFilterEnd;
+		}
+		if(1 == pFilterSep - pTopicFilter && '#' == *pTopicFilter) {
+			return true;
+		}
+		if(nameDone) {
+			return false;
+		}
 
-	char *curf, *curn, *curn_end;
+		pNameSep = memchr(pTopicName, '/', (size_t) (pNameEnd - pTopicName));
+		if(NULL == pNameSep) {
+			pNameSep = pNameEnd;
+		}
+		if(!(1 == pFilterSep - pTopicFilter && '+' == *pTopicFilter)
+		   && (pFilterSep - pTopicFilter != pNameSep - pTopicName
+			   || 0 != memcmp(pTopicFilter, pTopicName, (size_t) (pNameSep - pTopicName)))) {
+			return false;
+		}
 
-	if(NULL == pTopicFilter || NULL == pTopicName) {
-		return false;
+		if(pFilterSep == pFilterEnd) {
+			return pNameSep == pNameEnd;
+		}
+		pTopicFilter = pFilterSep + 1;
+		nameDone = (pNameSep == pNameEnd);
+		pTopicName = nameDone ? pNameEnd : pNameSep + 1;
 	}
+}
 
-	curf = pTopicFilter;
-	curn = pTopicName;
-	curn_end = curn + topicNameLen;
+static uint32_t _aws_iot_mqtt_internal_node_slot(int16_t parent, const char *pLevel, size_t levelLen) {
+	/* FNV-1a of level text, seeded with parent */
+	uint32_t hash = 2166136261u ^ (uint16_t) parent;
+	size_t i;
 
-	while(*curf && (curn < curn_end)) {
-		if(*curn == '/' && *curf != '/') {
-			break;
+	for(i = 0; i < levelLen; i++) {
+		hash = (hash ^ (uint8_t) pLevel[i]) * 16777619u;
+	}
+
+	return hash % (2 * AWS_IOT_MQTT_TOPIC_NODES);
+}
+
+static int16_t _aws_iot_mqtt_internal_find_node(const ClientData *pData, int16_t parent, const char *pLevel,
+												size_t levelLen) {
+	uint32_t slot = _aws_iot_mqtt_internal_node_slot(parent, pLevel, levelLen);
+	const MQTTTopicNode *pNode;
+	int16_t node;
+
+	while(-1 != (node = pData->topicNodeSlots[slot])) {
+		pNode = &(pData->topicNodes[node]);
+		if(parent == pNode->parent && levelLen == pNode->levelLen && 0 == memcmp(pNode->pLevel, pLevel, levelLen)) {
+			return node;
 		}
-		if(*curf != '+' && *curf != '#' && *curf != *curn) {
-			break;
+		slot = (slot + 1) % (2 * AWS_IOT_MQTT_TOPIC_NODES);
+	}
+
+	return -1;
+}
+
+static int16_t _aws_iot_mqtt_internal_add_node(ClientData *pData, int16_t parent, const char *pLevel,
+											   size_t levelLen) {
+	/* At most AWS_IOT_MQTT_MAX_TOPIC_LEVELS nodes per handler, always fits */
+	int16_t node = (int16_t) pData->topicNodeCount++;
+	MQTTTopicNode *pNode = &(pData->topicNodes[node]);
+
+	pNode->pLevel = pLevel;
+	pNode->levelLen = (uint16_t) levelLen;
+	pNode->parent = parent;
+	pNode->plusChild = -1;
+	pNode->hashChild = -1;
+	pNode->firstHandler = -1;
+
+	return node;
+}
+
+/**
+ * @brief Rebuilds topic filter index from subscribed message handlers
+ *
+ * Called whenever a handler is added or removed. Subscriptions change rarely,
+ * so the index is built again from all handlers rather than edited. Level text
+ * points into handler topic filters, which stay valid while subscribed. Filters
+ * deeper than AWS_IOT_MQTT_MAX_TOPIC_LEVELS are left out and matched one by one.
+ *
+ * @param pClient Reference to the IoT Client
+ */
+void aws_iot_mqtt_internal_index_topic_filters(AWS_IoT_Client *pClient) {
+	ClientData *pData = &(pClient->clientData);
+	MessageHandlers *pHandler;
+	const char *pLevel, *pSep, *pEnd;
+	uint32_t itr, levels, slot;
+	int16_t node, child;
+	size_t levelLen;
+
+	memset(pData->topicNodeSlots, 0xFF, sizeof(pData->topicNodeSlots));
+	pData->topicNodeCount = 0;
+	_aws_iot_mqtt_internal_add_node(pData, -1, NULL, 0);
+	pData->firstUnindexedHandler = -1;
+
+	for(itr = 0; itr < AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS; itr++) {
+		pHandler = &(pData->messageHandlers[itr]);
+		pHandler->nextHandler = -1;
+		if(NULL == pHandler->topicName) {
+			continue;
+		}
+
+		pEnd = pHandler->topicName + pHandler->topicNameLen;
+		levels = 1;
+		for(pLevel = pHandler->topicName; pLevel < pEnd; pLevel++) {
+			if('/' == *pLevel) {
+				levels++;
+			}
 		}
-		if(*curf == '+') {
-			/* skip until we meet the next separator, or end of string */
-			char *nextpos = curn + 1;
-			while(nextpos < curn_end && *nextpos != '/')
-				nextpos = ++curn + 1;
-		} else if(*curf == '#') {
-			/* skip until end of string */
-			curn = curn_end - 1;
+		if(AWS_IOT_MQTT_MAX_TOPIC_LEVELS < levels) {
+			pHandler->nextHandler = pData->firstUnindexedHandler;
+			pData->firstUnindexedHandler = (int16_t) itr;
+			continue;
 		}
 
-		curf++;
-		curn++;
-	};
+		node = 0;
+		pLevel = pHandler->topicName;
+		for(;;) {
+			pSep = memchr(pLevel, '/', (size_t) (pEnd - pLevel));
+			if(NULL == pSep) {
+				pSep = pEnd;
+			}
+			levelLen = (size_t) (pSep - pLevel);
+
+			if(1 == levelLen && '+' == *pLevel) {
+				if(-1 == pData->topicNodes[node].plusChild) {
+					pData->topicNodes[node].plusChild = _aws_iot_mqtt_internal_add_node(pData, node, pLevel, levelLen);
+				}
+				child = pData->topicNodes[node].plusChild;
+			} else if(1 == levelLen && '#' == *pLevel) {
+				if(-1 == pData->topicNodes[node].hashChild) {
+					pData->topicNodes[node].hashChild = _aws_iot_mqtt_internal_add_node(pData, node, pLevel, levelLen);
+				}
+				child = pData->topicNodes[node].hashChild;
+			} else {
+				child = _aws_iot_mqtt_internal_find_node(pData, node, pLevel, levelLen);
+				if(-1 == child) {
+					child = _aws_iot_mqtt_internal_add_node(pData, node, pLevel, levelLen);
+					slot = _aws_iot_mqtt_internal_node_slot(node, pLevel, levelLen);
+					while(-1 != pData->topicNodeSlots[slot]) {
+						slot = (slot + 1) % (2 * AWS_IOT_MQTT_TOPIC_NODES);
+					}
+					pData->topicNodeSlots[slot] = child;
+				}
+			}
+			node = child;
+
+			if(pSep == pEnd) {
+				break;
+			}
+			pLevel = pSep + 1;
+		}
+
+		pHandler->nextHandler = pData->topicNodes[node].firstHandler;
+		pData->topicNodes[node].firstHandler = (int16_t) itr;
+	}
+}
+
+static void _aws_iot_mqtt_internal_mark_handlers(const ClientData *pData, int16_t node, uint32_t *pMatched) {
+	int16_t itr;
+
+	for(itr = pData->topicNodes[node].firstHandler; -1 != itr; itr = pData->messageHandlers[itr].nextHandler) {
+		pMatched[itr / 32] |= (uint32_t) 1 << (itr % 32);
+	}
+}
+
+/**
+ * @brief Walks topic filter index down the levels of a topic name
+ *
+ * Each level costs a hash lookup whatever the number of subscriptions, plus a
+ * branch for '+'. Recursion is as deep as the index, at most
+ * AWS_IOT_MQTT_MAX_TOPIC_LEVELS.
+ *
+ * @param pData Client data holding the index
+ * @param node Node matched by the topic name levels before pTopicName
+ * @param pTopicName Next level of topic name
+ * @param pNameEnd End of topic name
+ * @param nameDone True when all levels of topic name are matched
+ * @param pMatched Bit per handler, set when its topic filter matches
+ */
+static void _aws_iot_mqtt_internal_match_nodes(const ClientData *pData, int16_t node, const char *pTopicName,
+											   const char *pNameEnd, bool nameDone, uint32_t *pMatched) {
+	const MQTTTopicNode *pNode = &(pData->topicNodes[node]);
+	const char *pSep;
+	int16_t child;
+
+	if(nameDone) {
+		_aws_iot_mqtt_internal_mark_handlers(pData, node, pMatched);
+	}
+	if(-1 != pNode->hashChild) {
+		/* matches this and all following levels, parent level included */
+		_aws_iot_mqtt_internal_mark_handlers(pData, pNode->hashChild, pMatched);
+	}
+	if(nameDone) {
+		return;
+	}
 
-	return (curn == curn_end) && (*curf == '\0');
+	pSep = memchr(pTopicName, '/', (size_t) (pNameEnd - pTopicName));
+	if(NULL == pSep) {
+		pSep = pNameEnd;
+	}
+
+	if(-1 != pNode->plusChild) {
+		_aws_iot_mqtt_internal_match_nodes(pData, pNode->plusChild, (pSep == pNameEnd) ? pNameEnd : pSep + 1,
+										   pNameEnd, pSep == pNameEnd, pMatched);
+	}
+	child = _aws_iot_mqtt_internal_find_node(pData, node, pTopicName, (size_t) (pSep - pTopicName));
+	if(-1 != child) {
+		_aws_iot_mqtt_internal_match_nodes(pData, child, (pSep == pNameEnd) ? pNameEnd : pSep + 1, pNameEnd,
+										   pSep == pNameEnd, pMatched);
+	}
+}
+
+/**
+ * @brief Finds message handlers whose topic filter matches topic name
+ *
+ * @param pData Client data holding handlers and their index
+ * @param pTopicName Topic name, not necessarily null terminated
+ * @param topicNameLen Length of topic name
+ * @param pMatched HANDLER_MATCH_WORDS words, bit per handler set when its topic filter matches
+ */
+static void _aws_iot_mqtt_internal_match_handlers(const ClientData *pData, const char *pTopicName,
+												  uint16_t topicNameLen, uint32_t *pMatched) {
+	const MessageHandlers *pHandler;
+	int16_t itr;
+
+	memset(pMatched, 0, HANDLER_MATCH_WORDS * sizeof(uint32_t));
+	_aws_iot_mqtt_internal_match_nodes(pData, 0, pTopicName, pTopicName + topicNameLen, false, pMatched);
+
+	for(itr = pData->firstUnindexedHandler; -1 != itr; itr = pHandler->nextHandler) {
+		pHandler = &(pData->messageHandlers[itr]);
+		if(_aws_iot_mqtt_internal_is_topic_matched(pHandler->topicName, pHandler->topicNameLen,
+												   pTopicName, topicNameLen)) {
+			pMatched[itr / 32] |= (uint32_t) 1 << (itr % 32);
+		}
+	}
 }
 
 static IoT_Error_t _aws_iot_mqtt_internal_deliver_message(AWS_IoT_Client *pClient, char *pTopicName,
@@ -495,6 +1167,7 @@ static IoT_Error_t _aws_iot_mqtt_internal_deliver_message(AWS_IoT_Client *pClien
 	uint32_t itr;
 	IoT_Error_t rc;
 	ClientState clientState;
+	uint32_t matched[HANDLER_MATCH_WORDS];
 
 	FUNC_ENTRY;
 
@@ -502,6 +1175,9 @@ static IoT_Error_t _aws_iot_mqtt_internal_deliver_message(AWS_IoT_Client *pClien
 		FUNC_EXIT_RC(NULL_VALUE_ERROR);
 	}
 
+	/* Index walk finds the handlers, cost follows topic depth rather than handler count */
+	_aws_iot_mqtt_internal_match_handlers(&(pClient->clientData), pTopicName, topicNameLen, matched);
+
 	/* This function can be called from all MQTT APIs
 	 * But while callback return is in progress, Yield should not be called.
 	 * The state for CB_RETURN accomplishes that, as yield cannot be called while in that state */
@@ -510,18 +1186,25 @@ static IoT_Error_t _aws_iot_mqtt_internal_deliver_message(AWS_IoT_Client *pClien
 
 	/* Find the right message handler - indexed by topic */
 	for(itr = 0; itr < AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS; ++itr) {
-		if(NULL != pClient->clientData.messageHandlers[itr].topicName) {
-			if(((topicNameLen == pClient->clientData.messageHandlers[itr].topicNameLen)
-				&&
-				(strncmp(pTopicName, (char *) pClient->clientData.messageHandlers[itr].topicName, topicNameLen) == 0))
-			   || _aws_iot_mqtt_internal_is_topic_matched((char *) pClient->clientData.messageHandlers[itr].topicName,
-														  pTopicName, topicNameLen)) {
-				if(NULL != pClient->clientData.messageHandlers[itr].pApplicationHandler) {
-					pClient->clientData.messageHandlers[itr].pApplicationHandler(pClient, pTopicName, topicNameLen,
-																				 pMessageParams,
-																				 pClient->clientData.messageHandlers[itr].pApplicationHandlerData);
-				}
-			}
+		MessageHandlers *pHandler = &(pClient->clientData.messageHandlers[itr]);
+
+		if(0 == matched[itr / 32]) {
+			/* none of these 32 handlers */
+			itr |= 31;
+			continue;
+		}
+		if(!HANDLER_MATCHED(matched, itr) || NULL == pHandler->topicName) {
+			continue;
+		}
+
+		if(NULL != pHandler->pStreamHandler) {
+			/* Whole message fits RX buffer, single fragment */
+			pHandler->pStreamHandler(pClient, pTopicName, topicNameLen, pMessageParams, 0,
+									 (const unsigned char *) pMessageParams->payload, pMessageParams->payloadLen,
+									 pHandler->pApplicationHandlerData);
+		} else if(NULL != pHandler->pApplicationHandler) {
+			pHandler->pApplicationHandler(pClient, pTopicName, topicNameLen, pMessageParams,
+										  pHandler->pApplicationHandlerData);
 		}
 	}
 	rc = aws_iot_mqtt_set_client_state(pClient, CLIENT_STATE_CONNECTED_WAIT_FOR_CB_RETURN, clientState);
@@ -545,7 +1228,7 @@ static IoT_Error_t _aws_iot_mqtt_internal_handle_publish(AWS_IoT_Client *pClient
 	rc = aws_iot_mqtt_internal_deserialize_publish(&msg.isDup, &msg.qos, &msg.isRetained,
 												   &msg.id, &topicName, &topicNameLen,
 												   (unsigned char **) &msg.payload, &msg.payloadLen,
-												   pClient->clientData.readBuf,
+												   AWS_IOT_MQTT_IS_V5(pClient), pClient->clientData.readBuf,
 												   pClient->clientData.readBufSize);
 
 	if(SUCCESS != rc) {
@@ -614,8 +1297,25 @@ IoT_Error_t aws_iot_mqtt_internal_cycle_read(AWS_IoT_Client *pClient, Timer *pTi
 	}
 
 	switch(*pPacketType) {
+		case 0:
+			/* Packet was fully handled while reading, e.g. streamed PUBLISH */
+			break;
+		case PUBACK: {
+			unsigned char type, dup, reason;
+			uint16_t packet_id;
+
+			/* Acks of async publishes are consumed here, blocking publish waits only for its own */
+			if(SUCCESS == aws_iot_mqtt_internal_deserialize_ack(&type, &dup, &packet_id, &reason,
+																 pClient->clientData.readBuf,
+																 pClient->clientData.readBufSize)
+			   && aws_iot_mqtt_internal_inflight_ack(pClient, packet_id,
+													 (MQTT5_REASON_FAILURE <= reason) ? MQTT_REQUEST_REJECTED_ERROR
+																					  : SUCCESS)) {
+				*pPacketType = 0;
+			}
+			break;
+		}
 		case CONNACK:
-		case PUBACK:
 		case SUBACK:
 		case UNSUBACK:
 			/* SDK is blocking, these responses will be forwarded to calling function to process */
@@ -630,7 +1330,23 @@ IoT_Error_t aws_iot_mqtt_internal_cycle_read(AWS_IoT_Client *pClient, Timer *pTi
 			break;
 		case PINGRESP: {
 			pClient->clientStatus.isPingOutstanding = 0;
-			countdown_sec(&pClient->pingTimer, pClient->clientData.keepAliveInterval);
+			pClient->clientData.pingResponseCount++;
+			aws_iot_mqtt_internal_restart_ping_timer(pClient);
+			break;
+		}
+		case DISCONNECT: {
+			/* MQTT 5 broker closes connection with a reason code, handled as failed read so
+			 * yield tears connection down and reconnects */
+			unsigned char *ptr = &(pClient->clientData.readBuf[1]);
+			uint32_t decodedLen = 0, readBytesLen = 0;
+
+			if(SUCCESS == aws_iot_mqtt_internal_decode_remaining_length_from_buffer(ptr, &decodedLen, &readBytesLen)
+			   && 0 < decodedLen) {
+				IOT_WARN("Broker disconnected, reason 0x%02X", pClient->clientData.readBuf[1 + readBytesLen]);
+			} else {
+				IOT_WARN("Broker disconnected");
+			}
+			rc = NETWORK_SSL_READ_ERROR;
 			break;
 		}
 		default: {
@@ -105,6 +105,16 @@ typedef enum {
 	CONNACK_NOT_AUTHORIZED_ERROR = 5
 } MQTT_Connack_Return_Codes;    /**< Connect request response codes from server */
 
+typedef enum {
+	CONNACK5_UNSUPPORTED_PROTOCOL_VERSION = 0x84,
+	CONNACK5_CLIENT_IDENTIFIER_NOT_VALID = 0x85,
+	CONNACK5_BAD_USER_NAME_OR_PASSWORD = 0x86,
+	CONNACK5_NOT_AUTHORIZED = 0x87,
+	CONNACK5_SERVER_UNAVAILABLE = 0x88,
+	CONNACK5_SERVER_BUSY = 0x89,
+	CONNACK5_CONNECTION_RATE_EXCEEDED = 0x9F
+} MQTT5_Connack_Reason_Codes;    /**< MQTT 5 connect reason codes mapped to MQTT 3.1.1 errors */
+
 
 /**
   * Determines the length of the MQTT connect packet that would be produced using the supplied connect options.
@@ -126,8 +136,19 @@ static uint32_t _aws_iot_get_connect_packet_length(IoT_Client_Connect_Params *pC
 	len = 10; // Len = 10 for MQTT_3_1_1
 	len = len + pConnectParams->clientIDLen + 2;
 
+	if(MQTT_5 == pConnectParams->MQTTVersion) {
+		/* Property length, session expiry for persistent session */
+		len += 1;
+		if(!pConnectParams->isCleanSession) {
+			len += 5;
+		}
+	}
+
 	if(pConnectParams->isWillMsgPresent) {
 		len = len + pConnectParams->will.topicNameLen + 2 + pConnectParams->will.msgLen + 2;
+		if(MQTT_5 == pConnectParams->MQTTVersion) {
+			len += 1; /* will property length */
+		}
 	}
 
 	if(NULL != pConnectParams->pUsername) {
@@ -169,6 +190,7 @@ static IoT_Error_t _aws_iot_mqtt_serialize_connect(unsigned char *pTxBuf, size_t
 	/* Check needed here before we start writing to the Tx buffer */
 	switch(pConnectParams->MQTTVersion) {
 		case MQTT_3_1_1:
+		case MQTT_5:
 			break;
 		default:
 			return MQTT_CONNACK_UNACCEPTABLE_PROTOCOL_VERSION_ERROR;
@@ -220,6 +242,20 @@ static IoT_Error_t _aws_iot_mqtt_serialize_connect(unsigned char *pTxBuf, size_t
 	aws_iot_mqtt_internal_write_char(&ptr, flags.all);
 	aws_iot_mqtt_internal_write_uint_16(&ptr, pConnectParams->keepAliveIntervalInSec);
 
+	if(MQTT_5 == pConnectParams->MQTTVersion) {
+		/* MQTT 5 ends session on disconnect unless it is given an expiry */
+		if(pConnectParams->isCleanSession) {
+			aws_iot_mqtt_internal_write_char(&ptr, 0);
+		} else {
+			uint32_t expiry = AWS_IOT_MQTT5_SESSION_EXPIRY_SEC;
+
+			aws_iot_mqtt_internal_write_char(&ptr, 5);
+			aws_iot_mqtt_internal_write_char(&ptr, MQTT5_PROP_SESSION_EXPIRY_INTERVAL);
+			aws_iot_mqtt_internal_write_uint_16(&ptr, (uint16_t) (expiry >> 16));
+			aws_iot_mqtt_internal_write_uint_16(&ptr, (uint16_t) (expiry & 0xFFFF));
+		}
+	}
+
 	/* If the code have passed the check for incorrect values above, no client id was passed as argument */
 	if(NULL == pConnectParams->pClientID) {
 		aws_iot_mqtt_internal_write_uint_16(&ptr, 0);
@@ -228,6 +264,9 @@ static IoT_Error_t _aws_iot_mqtt_serialize_connect(unsigned char *pTxBuf, size_t
 	}
 
 	if(pConnectParams->isWillMsgPresent) {
+		if(MQTT_5 == pConnectParams->MQTTVersion) {
+			aws_iot_mqtt_internal_write_char(&ptr, 0);
+		}
 		aws_iot_mqtt_internal_write_utf8_string(&ptr, pConnectParams->will.pTopicName,
 												pConnectParams->will.topicNameLen);
 		aws_iot_mqtt_internal_write_utf8_string(&ptr, pConnectParams->will.pMessage, pConnectParams->will.msgLen);
@@ -250,12 +289,14 @@ static IoT_Error_t _aws_iot_mqtt_serialize_connect(unsigned char *pTxBuf, size_t
   * Deserializes the supplied (wire) buffer into connack data - return code
   * @param sessionPresent the session present flag returned (only for MQTT 3.1.1)
   * @param connack_rc returned integer value of the connack return code
+  * @param pProps returned MQTT 5 properties, NULL for MQTT 3.1.1
   * @param buf the raw buffer data, of the correct length determined by the remaining length field
   * @param buflen the length in bytes of the data in the supplied buffer
   * @return IoT_Error_t indicating function execution status
   */
 static IoT_Error_t _aws_iot_mqtt_deserialize_connack(unsigned char *pSessionPresent, IoT_Error_t *pConnackRc,
-													 unsigned char *pRxBuf, size_t rxBufLen) {
+													 MQTT5Properties *pProps, unsigned char *pRxBuf,
+													 size_t rxBufLen) {
 	unsigned char *curdata, *enddata;
 	unsigned char connack_rc_char;
 	uint32_t decodedLen, readBytesLen;
@@ -292,15 +333,18 @@ static IoT_Error_t _aws_iot_mqtt_deserialize_connack(unsigned char *pSessionPres
 		FUNC_EXIT_RC(rc);
 	}
 
-	/* CONNACK remaining length should always be 2 as per MQTT 3.1.1 spec */
+	/* CONNACK remaining length should always be 2 as per MQTT 3.1.1 spec,
+	 * MQTT 5 adds properties */
 	curdata += (readBytesLen);
 	enddata = curdata + decodedLen;
-	if(2 != (enddata - curdata)) {
+	if((NULL == pProps && 2 != (enddata - curdata)) || 2 > (enddata - curdata)
+	   || (size_t) (enddata - pRxBuf) > rxBufLen) {
 		FUNC_EXIT_RC(MQTT_DECODE_REMAINING_LENGTH_ERROR);
 	}
 
 	flags.all = aws_iot_mqtt_internal_read_char(&curdata);
-	*pSessionPresent = flags.bits.sessionpresent;
+	/* Session present is bit 0, the non REVERSED bit field above maps it to bit 7 with GCC */
+	*pSessionPresent = (unsigned char) (flags.all & 0x01);
 	connack_rc_char = aws_iot_mqtt_internal_read_char(&curdata);
 	switch(connack_rc_char) {
 		case CONNACK_CONNECTION_ACCEPTED:
@@ -319,13 +363,39 @@ static IoT_Error_t _aws_iot_mqtt_deserialize_connack(unsigned char *pSessionPres
 			*pConnackRc = MQTT_CONNACK_BAD_USERDATA_ERROR;
 			break;
 		case CONNACK_NOT_AUTHORIZED_ERROR:
+		case CONNACK5_NOT_AUTHORIZED:
 			*pConnackRc = MQTT_CONNACK_NOT_AUTHORIZED_ERROR;
 			break;
+		case CONNACK5_UNSUPPORTED_PROTOCOL_VERSION:
+			*pConnackRc = MQTT_CONNACK_UNACCEPTABLE_PROTOCOL_VERSION_ERROR;
+			break;
+		case CONNACK5_CLIENT_IDENTIFIER_NOT_VALID:
+			*pConnackRc = MQTT_CONNACK_IDENTIFIER_REJECTED_ERROR;
+			break;
+		case CONNACK5_BAD_USER_NAME_OR_PASSWORD:
+			*pConnackRc = MQTT_CONNACK_BAD_USERDATA_ERROR;
+			break;
+		case CONNACK5_SERVER_UNAVAILABLE:
+		case CONNACK5_SERVER_BUSY:
+		case CONNACK5_CONNECTION_RATE_EXCEEDED:
+			*pConnackRc = MQTT_CONNACK_SERVER_UNAVAILABLE_ERROR;
+			break;
 		default:
 			*pConnackRc = MQTT_CONNACK_UNKNOWN_ERROR;
 			break;
 	}
 
+	if(NULL != pProps) {
+		rc = aws_iot_mqtt_internal_read_properties(&curdata, enddata, pProps);
+		if(SUCCESS != rc) {
+			FUNC_EXIT_RC(rc);
+		}
+		if(MQTT_CONNACK_CONNECTION_ACCEPTED != *pConnackRc) {
+			IOT_ERROR("Connect refused, reason 0x%02X %.*s", connack_rc_char, pProps->reasonStringLen,
+					  (NULL != pProps->pReasonString) ? pProps->pReasonString : "");
+		}
+	}
+
 	FUNC_EXIT_RC(SUCCESS);
 }
 
@@ -384,6 +454,7 @@ static bool _aws_iot_mqtt_is_client_state_valid_for_connect(ClientState clientSt
  */
 static IoT_Error_t _aws_iot_mqtt_internal_connect(AWS_IoT_Client *pClient, IoT_Client_Connect_Params *pConnectParams) {
 	Timer connect_timer;
+	MQTT5Properties props = {0};
 	IoT_Error_t connack_rc = FAILURE;
 	char sessionPresent = 0;
 	size_t len = 0;
@@ -428,8 +499,12 @@ static IoT_Error_t _aws_iot_mqtt_internal_connect(AWS_IoT_Client *pClient, IoT_C
 	}
 
 	/* Received CONNACK, check the return code */
-	rc = _aws_iot_mqtt_deserialize_connack((unsigned char *) &sessionPresent, &connack_rc, pClient->clientData.readBuf,
-										   pClient->clientData.readBufSize);
+	/* Defaults of MQTT 5 when broker does not send the properties */
+	props.receiveMaximum = 65535;
+	props.topicAliasMaximum = 0;
+	rc = _aws_iot_mqtt_deserialize_connack((unsigned char *) &sessionPresent, &connack_rc,
+										   AWS_IOT_MQTT_IS_V5(pClient) ? &props : NULL,
+										   pClient->clientData.readBuf, pClient->clientData.readBufSize);
 	if(SUCCESS != rc) {
 		FUNC_EXIT_RC(rc);
 	}
@@ -438,8 +513,20 @@ static IoT_Error_t _aws_iot_mqtt_internal_connect(AWS_IoT_Client *pClient, IoT_C
 		FUNC_EXIT_RC(connack_rc);
 	}
 
+	/* Broker must not report a session for clean session connect, ignore it if it does */
+	pClient->clientStatus.isSessionPresent = (0 != sessionPresent) && !pClient->clientData.options.isCleanSession;
+
+	/* Aliases are per connection, broker forgets them on disconnect */
+	pClient->clientData.serverReceiveMaximum = props.receiveMaximum;
+	pClient->clientData.serverTopicAliasMaximum = props.topicAliasMaximum;
+	pClient->clientData.topicAliasCount = 0;
+	if(props.hasServerKeepAlive) {
+		/* MQTT 5 broker may override keep alive, it must then be used */
+		pClient->clientData.keepAliveInterval = props.serverKeepAlive;
+	}
+
 	pClient->clientStatus.isPingOutstanding = false;
-	countdown_sec(&pClient->pingTimer, pClient->clientData.keepAliveInterval);
+	aws_iot_mqtt_internal_restart_ping_timer(pClient);
 
 	FUNC_EXIT_RC(SUCCESS);
 }
@@ -615,9 +702,12 @@ IoT_Error_t aws_iot_mqtt_attempt_reconnect(AWS_IoT_Client *pClient) {
 		FUNC_EXIT_RC(NETWORK_ATTEMPTING_RECONNECT);
 	}
 
-	rc = aws_iot_mqtt_resubscribe(pClient);
-	if(SUCCESS != rc) {
-		FUNC_EXIT_RC(rc);
+	/* Resumed session still has all subscriptions on broker side */
+	if(!pClient->clientStatus.isSessionPresent) {
+		rc = aws_iot_mqtt_resubscribe(pClient);
+		if(SUCCESS != rc) {
+			FUNC_EXIT_RC(rc);
+		}
 	}
 
 	FUNC_EXIT_RC(NETWORK_RECONNECTED);
@@ -42,6 +42,13 @@ extern "C" {
 
 #include "aws_iot_mqtt_client_common_internal.h"
 
+/* Largest value of MQTT remaining length field */
+#define MQTT_MAX_REMAINING_LENGTH 268435455U
+#define MQTT_MAX_REMAINING_LENGTH_BYTES 4
+
+/* MQTT 5 PUBLISH properties sent by client: length and topic alias */
+#define MQTT5_PUBLISH_PROPERTIES_MAX_LEN 4
+
 /**
  * @param stringVar pointer to the String into which the data is to be read
  * @param stringLen pointer to variable which has the length of the string
@@ -78,6 +85,8 @@ static IoT_Error_t _aws_iot_mqtt_read_string_with_len(char **stringVar, uint16_t
   * @param packetId uint16_t - the MQTT packet identifier
   * @param pTopicName char * - the MQTT topic in the publish
   * @param topicNameLen uint16_t - the length of the Topic Name
+  * @param pProps MQTT 5 properties including their length, NULL for MQTT 3.1.1
+  * @param propsLen size_t - the length of pProps
   * @param pPayload byte buffer - the MQTT publish payload
   * @param payloadLen size_t - the length of the MQTT payload
   * @param pSerializedLen uint32_t - pointer to the variable that stores serialized len
@@ -87,6 +96,7 @@ static IoT_Error_t _aws_iot_mqtt_read_string_with_len(char **stringVar, uint16_t
 static IoT_Error_t _aws_iot_mqtt_internal_serialize_publish(unsigned char *pTxBuf, size_t txBufLen, uint8_t dup,
 															QoS qos, uint8_t retained, uint16_t packetId,
 															const char *pTopicName, uint16_t topicNameLen,
+															const unsigned char *pProps, size_t propsLen,
 															const unsigned char *pPayload, size_t payloadLen,
 															uint32_t *pSerializedLen) {
 	unsigned char *ptr;
@@ -102,7 +112,7 @@ static IoT_Error_t _aws_iot_mqtt_internal_serialize_publish(unsigned char *pTxBu
 	ptr = pTxBuf;
 	rem_len = 0;
 
-	rem_len += (uint32_t) (topicNameLen + payloadLen + 2);
+	rem_len += (uint32_t) (topicNameLen + propsLen + payloadLen + 2);
 	if(qos > 0) {
 		rem_len += 2; /* packetId */
 	}
@@ -124,6 +134,11 @@ static IoT_Error_t _aws_iot_mqtt_internal_serialize_publish(unsigned char *pTxBu
 		aws_iot_mqtt_internal_write_uint_16(&ptr, packetId);
 	}
 
+	if(NULL != pProps) {
+		memcpy(ptr, pProps, propsLen);
+		ptr += propsLen;
+	}
+
 	memcpy(ptr, pPayload, payloadLen);
 	ptr += payloadLen;
 
@@ -132,6 +147,184 @@ static IoT_Error_t _aws_iot_mqtt_internal_serialize_publish(unsigned char *pTxBu
 	FUNC_EXIT_RC(SUCCESS);
 }
 
+/**
+ * @brief Finds MQTT 5 topic alias for a topic, or picks next free one
+ *
+ * @param pClient Reference to the IoT Client
+ * @param pTopicName Topic of the publish
+ * @param topicNameLen Length of the topic
+ * @param pIsKnown Set to true when broker already has the alias, topic can then be left out
+ *
+ * @return Alias, 0 if topic is not aliased
+ */
+static uint16_t _aws_iot_mqtt_find_topic_alias(AWS_IoT_Client *pClient, const char *pTopicName,
+											   uint16_t topicNameLen, bool *pIsKnown) {
+	ClientData *pData = &(pClient->clientData);
+	uint16_t limit = pData->serverTopicAliasMaximum;
+	uint8_t itr;
+
+	*pIsKnown = false;
+
+	for(itr = 0; itr < pData->topicAliasCount; ++itr) {
+		if(topicNameLen == pData->topicAliasLen[itr] && 0 == memcmp(pTopicName, pData->topicAlias[itr], topicNameLen)) {
+			*pIsKnown = true;
+			return (uint16_t) (itr + 1);
+		}
+	}
+
+	if(limit > AWS_IOT_MQTT_MAX_TOPIC_ALIASES) {
+		limit = AWS_IOT_MQTT_MAX_TOPIC_ALIASES;
+	}
+	if(pData->topicAliasCount >= limit || topicNameLen > AWS_IOT_MQTT_TOPIC_ALIAS_MAX_LEN) {
+		return 0;
+	}
+
+	return (uint16_t) (pData->topicAliasCount + 1);
+}
+
+/**
+ * @brief Records alias picked by _aws_iot_mqtt_find_topic_alias once its publish is sent
+ */
+static void _aws_iot_mqtt_add_topic_alias(AWS_IoT_Client *pClient, uint16_t alias, const char *pTopicName,
+										  uint16_t topicNameLen) {
+	ClientData *pData = &(pClient->clientData);
+
+	memcpy(pData->topicAlias[alias - 1], pTopicName, topicNameLen);
+	pData->topicAliasLen[alias - 1] = topicNameLen;
+	pData->topicAliasCount = (uint8_t) alias;
+}
+
+/**
+  * Sends a publish packet. Payload and topic are not copied into the TX buffer
+  * when network layer supports gather write, or when packet does not fit TX
+  * buffer. Small packets on network layers without gather write are serialized
+  * into TX buffer so they go out in one write, as one TLS record.
+  * With MQTT 5 the topic is replaced by a topic alias once broker has seen it.
+  * @param pClient Reference to the IoT Client
+  * @param dup uint8_t - the MQTT dup flag
+  * @param qos QoS - the MQTT QoS value
+  * @param retained uint8_t - the MQTT retained flag
+  * @param packetId uint16_t - the MQTT packet identifier
+  * @param pTopicName char * - the MQTT topic in the publish
+  * @param topicNameLen uint16_t - the length of the Topic Name
+  * @param pPayload byte buffer - the MQTT publish payload
+  * @param payloadLen size_t - the length of the MQTT payload
+  * @param pTimer Timer to keep track of timeout
+  *
+  * @return An IoT Error Type defining successful/failed call
+  */
+static IoT_Error_t _aws_iot_mqtt_internal_send_publish(AWS_IoT_Client *pClient, uint8_t dup, QoS qos,
+													   uint8_t retained, uint16_t packetId,
+													   const char *pTopicName, uint16_t topicNameLen,
+													   const unsigned char *pPayload, size_t payloadLen,
+													   Timer *pTimer) {
+	/* Fixed header, up to 4 bytes of remaining length and topic length */
+	unsigned char header[1 + MQTT_MAX_REMAINING_LENGTH_BYTES + 2];
+	/* Packet id followed by MQTT 5 properties */
+	unsigned char tail[2 + MQTT5_PUBLISH_PROPERTIES_MAX_LEN];
+	unsigned char props[MQTT5_PUBLISH_PROPERTIES_MAX_LEN];
+	unsigned char *ptr;
+	IoT_Net_Segment segments[4];
+	size_t segmentCount;
+	size_t propsLen = 0;
+	uint16_t alias = 0;
+	uint16_t wireTopicLen = topicNameLen;
+	bool isAliasKnown = false;
+	uint32_t rem_len;
+	uint32_t len = 0;
+	IoT_Error_t rc;
+	MQTTHeader mqttHeader = {0};
+
+	FUNC_ENTRY;
+
+	if(NULL == pPayload) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	if(payloadLen > MQTT_MAX_REMAINING_LENGTH - topicNameLen - 4 - MQTT5_PUBLISH_PROPERTIES_MAX_LEN) {
+		FUNC_EXIT_RC(MQTT_TX_BUFFER_TOO_SHORT_ERROR);
+	}
+
+	if(AWS_IOT_MQTT_IS_V5(pClient)) {
+		alias = _aws_iot_mqtt_find_topic_alias(pClient, pTopicName, topicNameLen, &isAliasKnown);
+		ptr = props;
+		if(0 != alias) {
+			aws_iot_mqtt_internal_write_char(&ptr, 3);
+			aws_iot_mqtt_internal_write_char(&ptr, MQTT5_PROP_TOPIC_ALIAS);
+			aws_iot_mqtt_internal_write_uint_16(&ptr, alias);
+		} else {
+			aws_iot_mqtt_internal_write_char(&ptr, 0);
+		}
+		propsLen = (size_t) (ptr - props);
+
+		if(isAliasKnown) {
+			/* Broker maps empty topic to the alias */
+			wireTopicLen = 0;
+		}
+	}
+
+	rem_len = (uint32_t) (wireTopicLen + propsLen + payloadLen + 2);
+	if(qos > 0) {
+		rem_len += 2; /* packetId */
+	}
+
+	if(NULL == pClient->networkStack.writeSegments &&
+	   aws_iot_mqtt_internal_get_final_packet_length_from_remaining_length(rem_len) < pClient->clientData.writeBufSize) {
+		rc = _aws_iot_mqtt_internal_serialize_publish(pClient->clientData.writeBuf, pClient->clientData.writeBufSize,
+													  dup, qos, retained, packetId, pTopicName, wireTopicLen,
+													  (0 < propsLen) ? props : NULL, propsLen,
+													  pPayload, payloadLen, &len);
+		if(SUCCESS != rc) {
+			FUNC_EXIT_RC(rc);
+		}
+
+		rc = aws_iot_mqtt_internal_send_packet(pClient, len, pTimer);
+		if(SUCCESS == rc && 0 != alias && !isAliasKnown) {
+			_aws_iot_mqtt_add_topic_alias(pClient, alias, pTopicName, topicNameLen);
+		}
+		FUNC_EXIT_RC(rc);
+	}
+
+	rc = aws_iot_mqtt_internal_init_header(&mqttHeader, PUBLISH, qos, dup, retained);
+	if(SUCCESS != rc) {
+		FUNC_EXIT_RC(rc);
+	}
+
+	ptr = header;
+	aws_iot_mqtt_internal_write_char(&ptr, mqttHeader.byte);
+	ptr += aws_iot_mqtt_internal_write_len_to_buffer(ptr, rem_len);
+	aws_iot_mqtt_internal_write_uint_16(&ptr, wireTopicLen);
+
+	segmentCount = 0;
+	segments[segmentCount].pBuf = header;
+	segments[segmentCount++].len = (size_t) (ptr - header);
+	if(0 < wireTopicLen) {
+		segments[segmentCount].pBuf = (const unsigned char *) pTopicName;
+		segments[segmentCount++].len = wireTopicLen;
+	}
+
+	ptr = tail;
+	if(qos > 0) {
+		aws_iot_mqtt_internal_write_uint_16(&ptr, packetId);
+	}
+	memcpy(ptr, props, propsLen);
+	ptr += propsLen;
+	if(ptr != tail) {
+		segments[segmentCount].pBuf = tail;
+		segments[segmentCount++].len = (size_t) (ptr - tail);
+	}
+
+	segments[segmentCount].pBuf = pPayload;
+	segments[segmentCount++].len = payloadLen;
+
+	rc = aws_iot_mqtt_internal_send_segments(pClient, segments, segmentCount, pTimer);
+	if(SUCCESS == rc && 0 != alias && !isAliasKnown) {
+		_aws_iot_mqtt_add_topic_alias(pClient, alias, pTopicName, topicNameLen);
+	}
+
+	FUNC_EXIT_RC(rc);
+}
+
 /**
   * Serializes the ack packet into the supplied buffer.
   * @param pTxBuf the buffer into which the packet will be serialized
@@ -197,9 +390,8 @@ IoT_Error_t aws_iot_mqtt_internal_serialize_ack(unsigned char *pTxBuf, size_t tx
 static IoT_Error_t _aws_iot_mqtt_internal_publish(AWS_IoT_Client *pClient, const char *pTopicName,
 												  uint16_t topicNameLen, IoT_Publish_Message_Params *pParams) {
 	Timer timer;
-	uint32_t len = 0;
 	uint16_t packet_id;
-	unsigned char dup, type;
+	unsigned char dup, type, reason;
 	IoT_Error_t rc;
 
 	FUNC_ENTRY;
@@ -208,19 +400,18 @@ static IoT_Error_t _aws_iot_mqtt_internal_publish(AWS_IoT_Client *pClient, const
 	countdown_ms(&timer, pClient->clientData.commandTimeoutMs);
 
 	if(QOS1 == pParams->qos) {
+		if(AWS_IOT_MQTT_IS_V5(pClient)
+		   && pClient->clientData.inflightCount >= aws_iot_mqtt_get_inflight_window(pClient)) {
+			/* Broker receive maximum reached by async publishes, MQTT 3.1.1 has no such limit */
+			FUNC_EXIT_RC(LIMIT_EXCEEDED_ERROR);
+		}
 		pParams->id = aws_iot_mqtt_get_next_packet_id(pClient);
 	}
 
-	rc = _aws_iot_mqtt_internal_serialize_publish(pClient->clientData.writeBuf, pClient->clientData.writeBufSize, 0,
-												  pParams->qos, pParams->isRetained, pParams->id, pTopicName,
-												  topicNameLen, (unsigned char *) pParams->payload,
-												  pParams->payloadLen, &len);
-	if(SUCCESS != rc) {
-		FUNC_EXIT_RC(rc);
-	}
-
 	/* send the publish packet */
-	rc = aws_iot_mqtt_internal_send_packet(pClient, len, &timer);
+	rc = _aws_iot_mqtt_internal_send_publish(pClient, 0, pParams->qos, pParams->isRetained, pParams->id, pTopicName,
+											 topicNameLen, (const unsigned char *) pParams->payload,
+											 pParams->payloadLen, &timer);
 	if(SUCCESS != rc) {
 		FUNC_EXIT_RC(rc);
 	}
@@ -232,11 +423,16 @@ static IoT_Error_t _aws_iot_mqtt_internal_publish(AWS_IoT_Client *pClient, const
 			FUNC_EXIT_RC(rc);
 		}
 
-		rc = aws_iot_mqtt_internal_deserialize_ack(&type, &dup, &packet_id, pClient->clientData.readBuf,
+		rc = aws_iot_mqtt_internal_deserialize_ack(&type, &dup, &packet_id, &reason, pClient->clientData.readBuf,
 												   pClient->clientData.readBufSize);
 		if(SUCCESS != rc) {
 			FUNC_EXIT_RC(rc);
 		}
+
+		if(MQTT5_REASON_FAILURE <= reason) {
+			IOT_WARN("Publish %u rejected, reason 0x%02X", packet_id, reason);
+			FUNC_EXIT_RC(MQTT_REQUEST_REJECTED_ERROR);
+		}
 	}
 
 	FUNC_EXIT_RC(SUCCESS);
@@ -294,6 +490,229 @@ IoT_Error_t aws_iot_mqtt_publish(AWS_IoT_Client *pClient, const char *pTopicName
 	FUNC_EXIT_RC(pubRc);
 }
 
+static InflightPublish *_aws_iot_mqtt_inflight_alloc(AWS_IoT_Client *pClient) {
+	uint32_t itr;
+
+	for(itr = 0; itr < AWS_IOT_MQTT_MAX_INFLIGHT_PUBLISH; ++itr) {
+		if(!pClient->clientData.inflightPublish[itr].isUsed) {
+			return &pClient->clientData.inflightPublish[itr];
+		}
+	}
+
+	return NULL;
+}
+
+static void _aws_iot_mqtt_inflight_free(AWS_IoT_Client *pClient, InflightPublish *pInflight) {
+	pInflight->isUsed = false;
+	pClient->clientData.inflightCount--;
+}
+
+/**
+ * @brief Calls completion handler of an async publish
+ *
+ * Slot is freed before handler runs, so handler can publish again. Client state is set
+ * to CB_RETURN as for subscribe callbacks, which allows publish but not yield.
+ */
+static void _aws_iot_mqtt_inflight_complete(AWS_IoT_Client *pClient, InflightPublish *pInflight, IoT_Error_t rc) {
+	pPublishCompleteHandler_t handler = pInflight->completeHandler;
+	void *pData = pInflight->pCompleteHandlerData;
+	uint16_t packetId = pInflight->packetId;
+	ClientState clientState;
+
+	_aws_iot_mqtt_inflight_free(pClient, pInflight);
+
+	if(NULL == handler) {
+		return;
+	}
+
+	clientState = aws_iot_mqtt_get_client_state(pClient);
+	aws_iot_mqtt_set_client_state(pClient, clientState, CLIENT_STATE_CONNECTED_WAIT_FOR_CB_RETURN);
+	handler(pClient, packetId, rc, pData);
+	aws_iot_mqtt_set_client_state(pClient, CLIENT_STATE_CONNECTED_WAIT_FOR_CB_RETURN, clientState);
+}
+
+static IoT_Error_t _aws_iot_mqtt_inflight_send(AWS_IoT_Client *pClient, InflightPublish *pInflight, uint8_t dup) {
+	Timer timer;
+	IoT_Error_t rc;
+
+	FUNC_ENTRY;
+
+	init_timer(&timer);
+	countdown_ms(&timer, pClient->clientData.commandTimeoutMs);
+
+	rc = _aws_iot_mqtt_internal_send_publish(pClient, dup, QOS1, pInflight->isRetained, pInflight->packetId,
+											 pInflight->pTopicName, pInflight->topicNameLen,
+											 (const unsigned char *) pInflight->pPayload, pInflight->payloadLen,
+											 &timer);
+	if(SUCCESS != rc) {
+		FUNC_EXIT_RC(rc);
+	}
+
+	countdown_ms(&pInflight->retryTimer, AWS_IOT_MQTT_INFLIGHT_RETRY_MS);
+
+	FUNC_EXIT_RC(SUCCESS);
+}
+
+IoT_Error_t aws_iot_mqtt_publish_async(AWS_IoT_Client *pClient, const char *pTopicName, uint16_t topicNameLen,
+									   IoT_Publish_Message_Params *pParams,
+									   pPublishCompleteHandler_t completeHandler, void *pCompleteHandlerData) {
+	IoT_Error_t rc, pubRc;
+	ClientState clientState;
+	InflightPublish *pInflight = NULL;
+
+	FUNC_ENTRY;
+
+	if(NULL == pClient || NULL == pTopicName || 0 == topicNameLen || NULL == pParams) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	if(!aws_iot_mqtt_is_client_connected(pClient)) {
+		FUNC_EXIT_RC(NETWORK_DISCONNECTED_ERROR);
+	}
+
+	clientState = aws_iot_mqtt_get_client_state(pClient);
+	if(CLIENT_STATE_CONNECTED_IDLE != clientState && CLIENT_STATE_CONNECTED_WAIT_FOR_CB_RETURN != clientState) {
+		FUNC_EXIT_RC(MQTT_CLIENT_NOT_IDLE_ERROR);
+	}
+
+	if(QOS0 == pParams->qos) {
+		pubRc = aws_iot_mqtt_publish(pClient, pTopicName, topicNameLen, pParams);
+		if(SUCCESS == pubRc && NULL != completeHandler) {
+			completeHandler(pClient, 0, SUCCESS, pCompleteHandlerData);
+		}
+		FUNC_EXIT_RC(pubRc);
+	}
+
+	pInflight = (pClient->clientData.inflightCount < aws_iot_mqtt_get_inflight_window(pClient))
+				? _aws_iot_mqtt_inflight_alloc(pClient) : NULL;
+	if(NULL == pInflight) {
+		FUNC_EXIT_RC(LIMIT_EXCEEDED_ERROR);
+	}
+
+	rc = aws_iot_mqtt_set_client_state(pClient, clientState, CLIENT_STATE_CONNECTED_PUBLISH_IN_PROGRESS);
+	if(SUCCESS != rc) {
+		FUNC_EXIT_RC(rc);
+	}
+
+	pParams->id = aws_iot_mqtt_get_next_packet_id(pClient);
+
+	pInflight->isUsed = true;
+	pInflight->packetId = pParams->id;
+	pInflight->retries = 0;
+	pInflight->isRetained = pParams->isRetained;
+	pInflight->pTopicName = pTopicName;
+	pInflight->topicNameLen = topicNameLen;
+	pInflight->pPayload = pParams->payload;
+	pInflight->payloadLen = pParams->payloadLen;
+	pInflight->completeHandler = completeHandler;
+	pInflight->pCompleteHandlerData = pCompleteHandlerData;
+	init_timer(&pInflight->retryTimer);
+	pClient->clientData.inflightCount++;
+
+	pubRc = _aws_iot_mqtt_inflight_send(pClient, pInflight, 0);
+	if(SUCCESS != pubRc) {
+		/* Not accepted, caller still owns message and no handler is called */
+		_aws_iot_mqtt_inflight_free(pClient, pInflight);
+	}
+
+	rc = aws_iot_mqtt_set_client_state(pClient, CLIENT_STATE_CONNECTED_PUBLISH_IN_PROGRESS, clientState);
+	if(SUCCESS == pubRc && SUCCESS != rc) {
+		pubRc = rc;
+	}
+
+	FUNC_EXIT_RC(pubRc);
+}
+
+uint8_t aws_iot_mqtt_get_inflight_count(AWS_IoT_Client *pClient) {
+	if(NULL == pClient) {
+		return 0;
+	}
+
+	return pClient->clientData.inflightCount;
+}
+
+uint8_t aws_iot_mqtt_get_inflight_window(AWS_IoT_Client *pClient) {
+	if(NULL == pClient) {
+		return 0;
+	}
+
+	if(AWS_IOT_MQTT_IS_V5(pClient) && pClient->clientData.serverReceiveMaximum < AWS_IOT_MQTT_MAX_INFLIGHT_PUBLISH) {
+		return (uint8_t) pClient->clientData.serverReceiveMaximum;
+	}
+
+	return AWS_IOT_MQTT_MAX_INFLIGHT_PUBLISH;
+}
+
+/**
+ * @brief Completes async publish matching a received PUBACK
+ *
+ * @param rc SUCCESS, or MQTT_REQUEST_REJECTED_ERROR for MQTT 5 failure reason code
+ *
+ * @return true if packet id belonged to an async publish
+ */
+bool aws_iot_mqtt_internal_inflight_ack(AWS_IoT_Client *pClient, uint16_t packetId, IoT_Error_t rc) {
+	uint32_t itr;
+	InflightPublish *pInflight;
+
+	for(itr = 0; itr < AWS_IOT_MQTT_MAX_INFLIGHT_PUBLISH; ++itr) {
+		pInflight = &pClient->clientData.inflightPublish[itr];
+		if(pInflight->isUsed && packetId == pInflight->packetId) {
+			if(SUCCESS != rc) {
+				IOT_WARN("Publish %u rejected by broker", packetId);
+			}
+			_aws_iot_mqtt_inflight_complete(pClient, pInflight, rc);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/**
+ * @brief Resends timed out async publishes with DUP flag, gives up after max retries
+ *
+ * @return SUCCESS or error of failed send
+ */
+IoT_Error_t aws_iot_mqtt_internal_inflight_retry(AWS_IoT_Client *pClient) {
+	uint32_t itr;
+	IoT_Error_t rc;
+	InflightPublish *pInflight;
+
+	FUNC_ENTRY;
+
+	for(itr = 0; itr < AWS_IOT_MQTT_MAX_INFLIGHT_PUBLISH && 0 < pClient->clientData.inflightCount; ++itr) {
+		pInflight = &pClient->clientData.inflightPublish[itr];
+		if(!pInflight->isUsed || !has_timer_expired(&pInflight->retryTimer)) {
+			continue;
+		}
+
+		if(AWS_IOT_MQTT_INFLIGHT_MAX_RETRIES <= pInflight->retries) {
+			IOT_WARN("Publish %u not acknowledged, giving up", pInflight->packetId);
+			_aws_iot_mqtt_inflight_complete(pClient, pInflight, MQTT_REQUEST_TIMEOUT_ERROR);
+			continue;
+		}
+
+		pInflight->retries++;
+		rc = _aws_iot_mqtt_inflight_send(pClient, pInflight, 1);
+		if(SUCCESS != rc) {
+			FUNC_EXIT_RC(rc);
+		}
+	}
+
+	FUNC_EXIT_RC(SUCCESS);
+}
+
+/**
+ * @brief Makes all async publishes due for resend, used after reconnect
+ */
+void aws_iot_mqtt_internal_inflight_resend_now(AWS_IoT_Client *pClient) {
+	uint32_t itr;
+
+	for(itr = 0; itr < AWS_IOT_MQTT_MAX_INFLIGHT_PUBLISH; ++itr) {
+		init_timer(&pClient->clientData.inflightPublish[itr].retryTimer);
+	}
+}
+
 /**
   * Deserializes the supplied (wire) buffer into publish data
   * @param dup returned uint8_t - the MQTT dup flag
@@ -304,6 +723,7 @@ IoT_Error_t aws_iot_mqtt_publish(AWS_IoT_Client *pClient, const char *pTopicName
   * @param topicNameLen returned uint16_t - the length of the MQTT topic in the publish
   * @param payload returned byte buffer - the MQTT publish payload
   * @param payloadlen returned size_t - the length of the MQTT payload
+  * @param isMqtt5 properties follow packet id
   * @param pRxBuf the raw buffer data, of the correct length determined by the remaining length field
   * @param rxBufLen the length in bytes of the data in the supplied buffer
   *
@@ -313,7 +733,7 @@ IoT_Error_t aws_iot_mqtt_internal_deserialize_publish(uint8_t *dup, QoS *qos,
 													  uint8_t *retained, uint16_t *pPacketId,
 													  char **pTopicName, uint16_t *topicNameLen,
 													  unsigned char **payload, size_t *payloadLen,
-													  unsigned char *pRxBuf, size_t rxBufLen) {
+													  bool isMqtt5, unsigned char *pRxBuf, size_t rxBufLen) {
 	unsigned char *curData = pRxBuf;
 	unsigned char *endData = NULL;
 	IoT_Error_t rc = FAILURE;
@@ -364,6 +784,10 @@ IoT_Error_t aws_iot_mqtt_internal_deserialize_publish(uint8_t *dup, QoS *qos,
 		*pPacketId = aws_iot_mqtt_internal_read_uint16_t(&curData);
 	}
 
+	if(isMqtt5 && SUCCESS != aws_iot_mqtt_internal_read_properties(&curData, endData, NULL)) {
+		FUNC_EXIT_RC(FAILURE);
+	}
+
 	*payloadLen = (size_t) (endData - curData);
 	*payload = curData;
 
@@ -375,14 +799,15 @@ IoT_Error_t aws_iot_mqtt_internal_deserialize_publish(uint8_t *dup, QoS *qos,
   * @param pPacketType returned integer - the MQTT packet type
   * @param dup returned integer - the MQTT dup flag
   * @param pPacketId returned integer - the MQTT packet identifier
+  * @param pReasonCode returned MQTT 5 PUBACK reason code, 0 (success) when ack has none, may be NULL
   * @param pRxBuf the raw buffer data, of the correct length determined by the remaining length field
   * @param rxBuflen the length in bytes of the data in the supplied buffer
   *
   * @return An IoT Error Type defining successful/failed call
   */
 IoT_Error_t aws_iot_mqtt_internal_deserialize_ack(unsigned char *pPacketType, unsigned char *dup,
-												  uint16_t *pPacketId, unsigned char *pRxBuf,
-												  size_t rxBuflen) {
+												  uint16_t *pPacketId, unsigned char *pReasonCode,
+												  unsigned char *pRxBuf, size_t rxBuflen) {
 	IoT_Error_t rc = FAILURE;
 	unsigned char *curdata = pRxBuf;
 	unsigned char *enddata = NULL;
@@ -420,6 +845,11 @@ IoT_Error_t aws_iot_mqtt_internal_deserialize_ack(unsigned char *pPacketType, un
 
 	*pPacketId = aws_iot_mqtt_internal_read_uint16_t(&curdata);
 
+	if(NULL != pReasonCode) {
+		/* MQTT 5 leaves reason code out when it is success */
+		*pReasonCode = (curdata < enddata) ? aws_iot_mqtt_internal_read_char(&curdata) : 0;
+	}
+
 	FUNC_EXIT_RC(SUCCESS);
 }
 
@@ -51,6 +51,7 @@ extern "C" {
   * @param pTopicNameList - array of topic filter names
   * @param pTopicNameLenList - array of length of topic filter names
   * @param pRequestedQoSs - array of requested QoS
+  * @param isMqtt5 - write empty MQTT 5 properties after packet identifier
   * @param pSerializedLen - the length of the serialized data
   *
   * @return An IoT Error Type defining successful/failed operation
@@ -58,7 +59,7 @@ extern "C" {
 static IoT_Error_t _aws_iot_mqtt_serialize_subscribe(unsigned char *pTxBuf, size_t txBufLen,
 													 unsigned char dup, uint16_t packetId, uint32_t topicCount,
 													 const char **pTopicNameList, uint16_t *pTopicNameLenList,
-													 QoS *pRequestedQoSs, uint32_t *pSerializedLen) {
+													 QoS *pRequestedQoSs, bool isMqtt5, uint32_t *pSerializedLen) {
 	unsigned char *ptr;
 	uint32_t itr, rem_len;
 	IoT_Error_t rc;
@@ -71,6 +72,9 @@ static IoT_Error_t _aws_iot_mqtt_serialize_subscribe(unsigned char *pTxBuf, size
 
 	ptr = pTxBuf;
 	rem_len = 2; /* packetId */
+	if(isMqtt5) {
+		rem_len += 1; /* property length */
+	}
 
 	for(itr = 0; itr < topicCount; ++itr) {
 		rem_len += (uint32_t) (pTopicNameLenList[itr] + 2 + 1); /* topic + length + req_qos */
@@ -91,9 +95,13 @@ static IoT_Error_t _aws_iot_mqtt_serialize_subscribe(unsigned char *pTxBuf, size
 	ptr += aws_iot_mqtt_internal_write_len_to_buffer(ptr, rem_len);
 
 	aws_iot_mqtt_internal_write_uint_16(&ptr, packetId);
+	if(isMqtt5) {
+		aws_iot_mqtt_internal_write_char(&ptr, 0);
+	}
 
 	for(itr = 0; itr < topicCount; ++itr) {
 		aws_iot_mqtt_internal_write_utf8_string(&ptr, pTopicNameList[itr], pTopicNameLenList[itr]);
+		/* MQTT 5 subscription options keep QoS in the same bits */
 		aws_iot_mqtt_internal_write_char(&ptr, (unsigned char) pRequestedQoSs[itr]);
 	}
 
@@ -108,13 +116,14 @@ static IoT_Error_t _aws_iot_mqtt_serialize_subscribe(unsigned char *pTxBuf, size
   * @param maxExpectedQoSCount - the maximum number of members allowed in the grantedQoSs array
   * @param pGrantedQoSCount returned uint32_t - number of members in the grantedQoSs array
   * @param pGrantedQoSs returned array of QoS type - the granted qualities of service
+  * @param isMqtt5 properties follow packet identifier
   * @param pRxBuf the raw buffer data, of the correct length determined by the remaining length field
   * @param rxBufLen the length in bytes of the data in the supplied buffer
   *
   * @return An IoT Error Type defining successful/failed operation
   */
 static IoT_Error_t _aws_iot_mqtt_deserialize_suback(uint16_t *pPacketId, uint32_t maxExpectedQoSCount,
-													uint32_t *pGrantedQoSCount, QoS *pGrantedQoSs,
+													uint32_t *pGrantedQoSCount, QoS *pGrantedQoSs, bool isMqtt5,
 													unsigned char *pRxBuf, size_t rxBufLen) {
 	unsigned char *curData, *endData;
 	uint32_t decodedLen, readBytesLen;
@@ -158,9 +167,13 @@ static IoT_Error_t _aws_iot_mqtt_deserialize_suback(uint16_t *pPacketId, uint32_
 
 	*pPacketId = aws_iot_mqtt_internal_read_uint16_t(&curData);
 
+	if(isMqtt5 && SUCCESS != aws_iot_mqtt_internal_read_properties(&curData, endData, NULL)) {
+		FUNC_EXIT_RC(FAILURE);
+	}
+
 	*pGrantedQoSCount = 0;
 	while(curData < endData) {
-		if(*pGrantedQoSCount > maxExpectedQoSCount) {
+		if(*pGrantedQoSCount >= maxExpectedQoSCount) {
 			FUNC_EXIT_RC(FAILURE);
 		}
 		pGrantedQoSs[(*pGrantedQoSCount)++] = (QoS) aws_iot_mqtt_internal_read_char(&curData);
@@ -184,56 +197,46 @@ static uint32_t _aws_iot_mqtt_get_free_message_handler_index(AWS_IoT_Client *pCl
 	FUNC_EXIT_RC(itr);
 }
 
+/* Granted QoS value of a SUBACK entry for a refused topic filter, MQTT3.1.1 specification 3.9.3.
+ * MQTT 5 has several failure reason codes, all of them from this value up */
+#define MQTT_SUBACK_FAILURE 0x80
+
 /**
- * @brief Subscribe to an MQTT topic.
- *
- * Called to send a subscribe message to the broker requesting a subscription
- * to an MQTT topic. This is the internal function which is called by the
- * subscribe API to perform the operation. Not meant to be called directly as
- * it doesn't do validations or client state changes
- * @note Call is blocking.  The call returns after the receipt of the SUBACK control packet.
- * @warning pTopicName and pApplicationHandlerData need to be static in memory.
+ * @brief Sends one SUBSCRIBE with several topic filters and waits for its SUBACK
  *
  * @param pClient Reference to the IoT Client
- * @param pTopicName Topic Name to publish to. pTopicName needs to be static in memory since 
- *     no malloc are performed by the SDK
- * @param topicNameLen Length of the topic name
- * @param pApplicationHandler_t Reference to the handler function for this subscription
- * @param pApplicationHandlerData Point to data passed to the callback. 
- *    pApplicationHandlerData also needs to be static in memory  since no malloc are performed by the SDK
+ * @param count Number of topic filters
+ * @param pTopicNameList Topic filters
+ * @param pTopicNameLenList Lengths of topic filters
+ * @param pRequestedQoSs Requested QoS of each topic filter
+ * @param pGrantedQoSs Returned granted QoS of each topic filter, MQTT_SUBACK_FAILURE if refused
  *
- * @return An IoT Error Type defining successful/failed subscription
+ * @return An IoT Error Type defining successful/failed operation
  */
-static IoT_Error_t _aws_iot_mqtt_internal_subscribe(AWS_IoT_Client *pClient, const char *pTopicName,
-													uint16_t topicNameLen, QoS qos,
-													pApplicationHandler_t pApplicationHandler,
-													void *pApplicationHandlerData) {
-	uint16_t txPacketId, rxPacketId;
-	uint32_t serializedLen, indexOfFreeMessageHandler, count;
+static IoT_Error_t _aws_iot_mqtt_internal_send_subscribe(AWS_IoT_Client *pClient, uint32_t count,
+														 const char **pTopicNameList, uint16_t *pTopicNameLenList,
+														 QoS *pRequestedQoSs, QoS *pGrantedQoSs) {
+	uint16_t rxPacketId;
+	uint32_t serializedLen, grantedCount;
 	IoT_Error_t rc;
 	Timer timer;
-	QoS grantedQoS[3] = {QOS0, QOS0, QOS0};
 
 	FUNC_ENTRY;
 	init_timer(&timer);
 	countdown_ms(&timer, pClient->clientData.commandTimeoutMs);
 
 	serializedLen = 0;
-	count = 0;
-	txPacketId = aws_iot_mqtt_get_next_packet_id(pClient);
+	grantedCount = 0;
 	rxPacketId = 0;
 
 	rc = _aws_iot_mqtt_serialize_subscribe(pClient->clientData.writeBuf, pClient->clientData.writeBufSize, 0,
-										   txPacketId, 1, &pTopicName, &topicNameLen, &qos, &serializedLen);
+										   aws_iot_mqtt_get_next_packet_id(pClient), count,
+										   pTopicNameList, pTopicNameLenList, pRequestedQoSs,
+										   AWS_IOT_MQTT_IS_V5(pClient), &serializedLen);
 	if(SUCCESS != rc) {
 		FUNC_EXIT_RC(rc);
 	}
 
-	indexOfFreeMessageHandler = _aws_iot_mqtt_get_free_message_handler_index(pClient);
-	if(AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS <= indexOfFreeMessageHandler) {
-		FUNC_EXIT_RC(MQTT_MAX_SUBSCRIPTIONS_REACHED_ERROR);
-	}
-
 	/* send the subscribe packet */
 	rc = aws_iot_mqtt_internal_send_packet(pClient, serializedLen, &timer);
 	if(SUCCESS != rc) {
@@ -246,64 +249,127 @@ static IoT_Error_t _aws_iot_mqtt_internal_subscribe(AWS_IoT_Client *pClient, con
 		FUNC_EXIT_RC(rc);
 	}
 
-	/* Granted QoS can be 0, 1 or 2 */
-	rc = _aws_iot_mqtt_deserialize_suback(&rxPacketId, 1, &count, grantedQoS, pClient->clientData.readBuf,
+	/* Granted QoS can be 0, 1 or 2, or 0x80 and up for each refused filter */
+	rc = _aws_iot_mqtt_deserialize_suback(&rxPacketId, count, &grantedCount, pGrantedQoSs,
+										  AWS_IOT_MQTT_IS_V5(pClient), pClient->clientData.readBuf,
 										  pClient->clientData.readBufSize);
 	if(SUCCESS != rc) {
 		FUNC_EXIT_RC(rc);
 	}
 
-	/* TODO : Figure out how to test this before activating this check */
-	//if(txPacketId != rxPacketId) {
-	/* Different SUBACK received than expected. Return error
-	 * This can cause issues if the request timeout value is too small */
-	//	return RX_MESSAGE_INVALID_ERROR;
-	//}
-
-	pClient->clientData.messageHandlers[indexOfFreeMessageHandler].topicName =
-			pTopicName;
-	pClient->clientData.messageHandlers[indexOfFreeMessageHandler].topicNameLen =
-			topicNameLen;
-	pClient->clientData.messageHandlers[indexOfFreeMessageHandler].pApplicationHandler =
-			pApplicationHandler;
-	pClient->clientData.messageHandlers[indexOfFreeMessageHandler].pApplicationHandlerData =
-			pApplicationHandlerData;
-	pClient->clientData.messageHandlers[indexOfFreeMessageHandler].qos = qos;
+	if(grantedCount != count) {
+		FUNC_EXIT_RC(FAILURE);
+	}
 
 	FUNC_EXIT_RC(SUCCESS);
 }
 
 /**
- * @brief Subscribe to an MQTT topic.
+ * @brief Subscribe to several MQTT topics with one SUBSCRIBE packet.
  *
- * Called to send a subscribe message to the broker requesting a subscription
- * to an MQTT topic. This is the outer function which does the validations and
+ * This is the internal function which is called by the subscribe APIs to perform
+ * the operation. Not meant to be called directly as it doesn't do validations or
+ * client state changes
+ * @note Call is blocking.  The call returns after the receipt of the SUBACK control packet.
+ *
+ * @param pClient Reference to the IoT Client
+ * @param pParams Subscriptions, topic names and handler data need to be static in memory
+ * @param count Number of subscriptions
+ *
+ * @return An IoT Error Type defining successful/failed subscription
+ */
+static IoT_Error_t _aws_iot_mqtt_internal_subscribe(AWS_IoT_Client *pClient, const IoT_Subscribe_Params *pParams,
+													uint32_t count) {
+	uint32_t itr, freeCount, indexOfFreeMessageHandler;
+	IoT_Error_t rc;
+	MessageHandlers *pHandler;
+	const char *topicNames[AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS];
+	uint16_t topicNameLens[AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS];
+	QoS requestedQoS[AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS];
+	QoS grantedQoS[AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS];
+
+	FUNC_ENTRY;
+
+	freeCount = 0;
+	for(itr = 0; itr < AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS; itr++) {
+		if(NULL == pClient->clientData.messageHandlers[itr].topicName) {
+			freeCount++;
+		}
+	}
+	if(0 == count || count > freeCount) {
+		FUNC_EXIT_RC(MQTT_MAX_SUBSCRIPTIONS_REACHED_ERROR);
+	}
+
+	for(itr = 0; itr < count; itr++) {
+		topicNames[itr] = pParams[itr].pTopicName;
+		topicNameLens[itr] = pParams[itr].topicNameLen;
+		requestedQoS[itr] = pParams[itr].qos;
+	}
+
+	rc = _aws_iot_mqtt_internal_send_subscribe(pClient, count, topicNames, topicNameLens, requestedQoS, grantedQoS);
+	if(SUCCESS != rc) {
+		FUNC_EXIT_RC(rc);
+	}
+
+	for(itr = 0; itr < count; itr++) {
+		if(MQTT_SUBACK_FAILURE <= (uint8_t) grantedQoS[itr]) {
+			IOT_WARN("Subscription to %.*s refused", pParams[itr].topicNameLen, pParams[itr].pTopicName);
+			rc = MQTT_SUBSCRIBE_REJECTED_ERROR;
+			continue;
+		}
+
+		indexOfFreeMessageHandler = _aws_iot_mqtt_get_free_message_handler_index(pClient);
+		pHandler = &(pClient->clientData.messageHandlers[indexOfFreeMessageHandler]);
+
+		pHandler->topicName = pParams[itr].pTopicName;
+		pHandler->topicNameLen = pParams[itr].topicNameLen;
+		pHandler->pApplicationHandler = pParams[itr].pApplicationHandler;
+		pHandler->pStreamHandler = pParams[itr].pStreamHandler;
+		pHandler->pApplicationHandlerData = pParams[itr].pApplicationHandlerData;
+		pHandler->qos = pParams[itr].qos;
+	}
+
+	/* Dispatch walks the index, not the handlers */
+	aws_iot_mqtt_internal_index_topic_filters(pClient);
+
+	FUNC_EXIT_RC(rc);
+}
+
+/**
+ * @brief Subscribe to several MQTT topics with one SUBSCRIBE packet.
+ *
+ * Called to send a subscribe message to the broker requesting subscriptions
+ * to MQTT topics. This is the outer function which does the validations and
  * calls the internal subscribe above to perform the actual operation.
  * It is also responsible for client state changes
  * @note Call is blocking.  The call returns after the receipt of the SUBACK control packet.
- * @warning pTopicName and pApplicationHandlerData need to be static in memory.
+ * @warning Topic names and handler data need to be static in memory since no malloc are performed by the SDK
  *
  * @param pClient Reference to the IoT Client
- * @param pTopicName Topic Name to publish to. pTopicName needs to be static in memory since 
- *     no malloc are performed by the SDK
- * @param topicNameLen Length of the topic name
- * @param pApplicationHandler_t Reference to the handler function for this subscription
- * @param pApplicationHandlerData Point to data passed to the callback. 
- *    pApplicationHandlerData also needs to be static in memory  since no malloc are performed by the SDK
+ * @param pParams Subscriptions
+ * @param count Number of subscriptions
  *
  * @return An IoT Error Type defining successful/failed subscription
  */
-IoT_Error_t aws_iot_mqtt_subscribe(AWS_IoT_Client *pClient, const char *pTopicName, uint16_t topicNameLen,
-								   QoS qos, pApplicationHandler_t pApplicationHandler, void *pApplicationHandlerData) {
+IoT_Error_t aws_iot_mqtt_subscribe_batch(AWS_IoT_Client *pClient, const IoT_Subscribe_Params *pParams,
+										 uint32_t count) {
+	uint32_t itr;
 	ClientState clientState;
 	IoT_Error_t rc, subRc;
 
 	FUNC_ENTRY;
 
-	if(NULL == pClient || NULL == pTopicName || NULL == pApplicationHandler) {
+	if(NULL == pClient || NULL == pParams) {
 		FUNC_EXIT_RC(NULL_VALUE_ERROR);
 	}
 
+	for(itr = 0; itr < count; itr++) {
+		if(NULL == pParams[itr].pTopicName
+		   || (NULL == pParams[itr].pApplicationHandler && NULL == pParams[itr].pStreamHandler)) {
+			FUNC_EXIT_RC(NULL_VALUE_ERROR);
+		}
+	}
+
 	if(!aws_iot_mqtt_is_client_connected(pClient)) {
 		FUNC_EXIT_RC(NETWORK_DISCONNECTED_ERROR);
 	}
@@ -318,8 +384,7 @@ IoT_Error_t aws_iot_mqtt_subscribe(AWS_IoT_Client *pClient, const char *pTopicNa
 		FUNC_EXIT_RC(rc);
 	}
 
-	subRc = _aws_iot_mqtt_internal_subscribe(pClient, pTopicName, topicNameLen, qos,
-											 pApplicationHandler, pApplicationHandlerData);
+	subRc = _aws_iot_mqtt_internal_subscribe(pClient, pParams, count);
 
 	rc = aws_iot_mqtt_set_client_state(pClient, CLIENT_STATE_CONNECTED_SUBSCRIBE_IN_PROGRESS, clientState);
 	if(SUCCESS == subRc && SUCCESS != rc) {
@@ -329,6 +394,28 @@ IoT_Error_t aws_iot_mqtt_subscribe(AWS_IoT_Client *pClient, const char *pTopicNa
 	FUNC_EXIT_RC(subRc);
 }
 
+IoT_Error_t aws_iot_mqtt_subscribe(AWS_IoT_Client *pClient, const char *pTopicName, uint16_t topicNameLen,
+								   QoS qos, pApplicationHandler_t pApplicationHandler, void *pApplicationHandlerData) {
+	IoT_Subscribe_Params params = {pTopicName, topicNameLen, qos, pApplicationHandler, NULL, pApplicationHandlerData};
+
+	if(NULL == pApplicationHandler) {
+		return NULL_VALUE_ERROR;
+	}
+
+	return aws_iot_mqtt_subscribe_batch(pClient, &params, 1);
+}
+
+IoT_Error_t aws_iot_mqtt_subscribe_stream(AWS_IoT_Client *pClient, const char *pTopicName, uint16_t topicNameLen,
+										  QoS qos, pStreamHandler_t pStreamHandler, void *pStreamHandlerData) {
+	IoT_Subscribe_Params params = {pTopicName, topicNameLen, qos, NULL, pStreamHandler, pStreamHandlerData};
+
+	if(NULL == pStreamHandler) {
+		return NULL_VALUE_ERROR;
+	}
+
+	return aws_iot_mqtt_subscribe_batch(pClient, &params, 1);
+}
+
 /**
  * @brief Subscribe to an MQTT topic.
  *
@@ -343,51 +430,47 @@ IoT_Error_t aws_iot_mqtt_subscribe(AWS_IoT_Client *pClient, const char *pTopicNa
  * @return An IoT Error Type defining successful/failed subscription
  */
 static IoT_Error_t _aws_iot_mqtt_internal_resubscribe(AWS_IoT_Client *pClient) {
-	uint16_t packetId;
-	uint32_t len, count, existingSubCount, itr;
+	uint32_t itr, count, rem_len;
 	IoT_Error_t rc;
-	Timer timer;
-	QoS grantedQoS[3] = {QOS0, QOS0, QOS0};
+	MessageHandlers *pHandler;
+	const char *topicNames[AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS];
+	uint16_t topicNameLens[AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS];
+	QoS requestedQoS[AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS];
+	QoS grantedQoS[AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS];
 
 	FUNC_ENTRY;
 
-	packetId = 0;
-	len = 0;
 	count = 0;
-	existingSubCount = _aws_iot_mqtt_get_free_message_handler_index(pClient);
+	rem_len = 2; /* packetId */
 
-	for(itr = 0; itr < existingSubCount; itr++) {
-		if(pClient->clientData.messageHandlers[itr].topicName == NULL) {
+	/* As many filters per SUBSCRIBE as fit TX buffer, usually all of them */
+	for(itr = 0; itr < AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS; itr++) {
+		pHandler = &(pClient->clientData.messageHandlers[itr]);
+		if(NULL == pHandler->topicName) {
 			continue;
 		}
 
-		init_timer(&timer);
-		countdown_ms(&timer, pClient->clientData.commandTimeoutMs);
-
-		rc = _aws_iot_mqtt_serialize_subscribe(pClient->clientData.writeBuf, pClient->clientData.writeBufSize, 0,
-											   aws_iot_mqtt_get_next_packet_id(pClient), 1,
-											   &(pClient->clientData.messageHandlers[itr].topicName),
-											   &(pClient->clientData.messageHandlers[itr].topicNameLen),
-											   &(pClient->clientData.messageHandlers[itr].qos), &len);
-		if(SUCCESS != rc) {
-			FUNC_EXIT_RC(rc);
-		}
-
-		/* send the subscribe packet */
-		rc = aws_iot_mqtt_internal_send_packet(pClient, len, &timer);
-		if(SUCCESS != rc) {
-			FUNC_EXIT_RC(rc);
+		if(0 < count && aws_iot_mqtt_internal_get_final_packet_length_from_remaining_length(
+				rem_len + pHandler->topicNameLen + 2 + 1) > pClient->clientData.writeBufSize) {
+			rc = _aws_iot_mqtt_internal_send_subscribe(pClient, count, topicNames, topicNameLens, requestedQoS,
+													   grantedQoS);
+			if(SUCCESS != rc) {
+				FUNC_EXIT_RC(rc);
+			}
+			count = 0;
+			rem_len = 2;
 		}
 
-		/* wait for suback */
-		rc = aws_iot_mqtt_internal_wait_for_read(pClient, SUBACK, &timer);
-		if(SUCCESS != rc) {
-			FUNC_EXIT_RC(rc);
-		}
+		topicNames[count] = pHandler->topicName;
+		topicNameLens[count] = pHandler->topicNameLen;
+		requestedQoS[count] = pHandler->qos;
+		rem_len += (uint32_t) (pHandler->topicNameLen + 2 + 1);
+		count++;
+	}
 
-		/* Granted QoS can be 0, 1 or 2 */
-		rc = _aws_iot_mqtt_deserialize_suback(&packetId, 1, &count, grantedQoS, pClient->clientData.readBuf,
-											  pClient->clientData.readBufSize);
+	if(0 < count) {
+		rc = _aws_iot_mqtt_internal_send_subscribe(pClient, count, topicNames, topicNameLens, requestedQoS,
+												   grantedQoS);
 		if(SUCCESS != rc) {
 			FUNC_EXIT_RC(rc);
 		}
@@ -50,13 +50,15 @@ extern "C" {
   * @param count - number of members in the topicFilters array
   * @param pTopicNameList - array of topic filter names
   * @param pTopicNameLenList - array of length of topic filter names in pTopicNameList
+  * @param isMqtt5 - write empty MQTT 5 properties after packet identifier
   * @param pSerializedLen - the length of the serialized data
   * @return IoT_Error_t indicating function execution status
   */
 static IoT_Error_t _aws_iot_mqtt_serialize_unsubscribe(unsigned char *pTxBuf, size_t txBufLen,
 													   uint8_t dup, uint16_t packetId,
 													   uint32_t count, const char **pTopicNameList,
-													   uint16_t *pTopicNameLenList, uint32_t *pSerializedLen) {
+													   uint16_t *pTopicNameLenList, bool isMqtt5,
+													   uint32_t *pSerializedLen) {
 	unsigned char *ptr = pTxBuf;
 	uint32_t i = 0;
 	uint32_t rem_len = 2; /* packetId */
@@ -65,6 +67,10 @@ static IoT_Error_t _aws_iot_mqtt_serialize_unsubscribe(unsigned char *pTxBuf, si
 
 	FUNC_ENTRY;
 
+	if(isMqtt5) {
+		rem_len += 1; /* property length */
+	}
+
 	for(i = 0; i < count; ++i) {
 		rem_len += (uint32_t) (pTopicNameLenList[i] + 2); /* topic + length */
 	}
@@ -82,6 +88,9 @@ static IoT_Error_t _aws_iot_mqtt_serialize_unsubscribe(unsigned char *pTxBuf, si
 	ptr += aws_iot_mqtt_internal_write_len_to_buffer(ptr, rem_len); /* write remaining length */
 
 	aws_iot_mqtt_internal_write_uint_16(&ptr, packetId);
+	if(isMqtt5) {
+		aws_iot_mqtt_internal_write_char(&ptr, 0);
+	}
 
 	for(i = 0; i < count; ++i) {
 		aws_iot_mqtt_internal_write_utf8_string(&ptr, pTopicNameList[i], pTopicNameLenList[i]);
@@ -96,23 +105,53 @@ static IoT_Error_t _aws_iot_mqtt_serialize_unsubscribe(unsigned char *pTxBuf, si
 /**
   * Deserializes the supplied (wire) buffer into unsuback data
   * @param pPacketId returned integer - the MQTT packet identifier
+  * @param isMqtt5 properties and reason codes follow packet identifier
   * @param pRxBuf the raw buffer data, of the correct length determined by the remaining length field
   * @param rxBufLen the length in bytes of the data in the supplied buffer
   * @return IoT_Error_t indicating function execution status
   */
-static IoT_Error_t _aws_iot_mqtt_deserialize_unsuback(uint16_t *pPacketId, unsigned char *pRxBuf, size_t rxBufLen) {
+static IoT_Error_t _aws_iot_mqtt_deserialize_unsuback(uint16_t *pPacketId, bool isMqtt5, unsigned char *pRxBuf,
+													  size_t rxBufLen) {
 	unsigned char type = 0;
 	unsigned char dup = 0;
+	unsigned char *curData, *endData;
+	uint32_t decodedLen = 0;
+	uint32_t readBytesLen = 0;
 	IoT_Error_t rc;
 
 	FUNC_ENTRY;
 
-	rc = aws_iot_mqtt_internal_deserialize_ack(&type, &dup, pPacketId, pRxBuf, rxBufLen);
+	rc = aws_iot_mqtt_internal_deserialize_ack(&type, &dup, pPacketId, NULL, pRxBuf, rxBufLen);
 	if(SUCCESS == rc && UNSUBACK != type) {
 		rc = FAILURE;
 	}
 
-	FUNC_EXIT_RC(rc);
+	if(SUCCESS != rc || !isMqtt5) {
+		FUNC_EXIT_RC(rc);
+	}
+
+	/* MQTT 5 has properties and a reason code per topic filter after packet id */
+	rc = aws_iot_mqtt_internal_decode_remaining_length_from_buffer(&pRxBuf[1], &decodedLen, &readBytesLen);
+	if(SUCCESS != rc) {
+		FUNC_EXIT_RC(rc);
+	}
+	curData = &pRxBuf[1 + readBytesLen + 2];
+	endData = &pRxBuf[1 + readBytesLen + decodedLen];
+
+	if(SUCCESS != aws_iot_mqtt_internal_read_properties(&curData, endData, NULL)) {
+		FUNC_EXIT_RC(FAILURE);
+	}
+
+	while(curData < endData) {
+		/* 0x11 no subscription existed is a success */
+		if(MQTT5_REASON_FAILURE <= *curData) {
+			IOT_WARN("Unsubscribe rejected, reason 0x%02X", *curData);
+			FUNC_EXIT_RC(MQTT_REQUEST_REJECTED_ERROR);
+		}
+		curData++;
+	}
+
+	FUNC_EXIT_RC(SUCCESS);
 }
 
 /**
@@ -162,7 +201,7 @@ static IoT_Error_t _aws_iot_mqtt_internal_unsubscribe(AWS_IoT_Client *pClient, c
 
 	rc = _aws_iot_mqtt_serialize_unsubscribe(pClient->clientData.writeBuf, pClient->clientData.writeBufSize, 0,
 											 aws_iot_mqtt_get_next_packet_id(pClient), 1, &pTopicFilter,
-											 &topicFilterLen, &serializedLen);
+											 &topicFilterLen, AWS_IOT_MQTT_IS_V5(pClient), &serializedLen);
 	if(SUCCESS != rc) {
 		FUNC_EXIT_RC(rc);
 	}
@@ -178,7 +217,8 @@ static IoT_Error_t _aws_iot_mqtt_internal_unsubscribe(AWS_IoT_Client *pClient, c
 		FUNC_EXIT_RC(rc);
 	}
 
-	rc = _aws_iot_mqtt_deserialize_unsuback(&packet_id, pClient->clientData.readBuf, pClient->clientData.readBufSize);
+	rc = _aws_iot_mqtt_deserialize_unsuback(&packet_id, AWS_IOT_MQTT_IS_V5(pClient), pClient->clientData.readBuf,
+											pClient->clientData.readBufSize);
 	if(SUCCESS != rc) {
 		FUNC_EXIT_RC(rc);
 	}
@@ -192,6 +232,7 @@ static IoT_Error_t _aws_iot_mqtt_internal_unsubscribe(AWS_IoT_Client *pClient, c
              * with 2 callbacks. Unlikely scenario */
 		}
 	}
+	aws_iot_mqtt_internal_index_topic_filters(pClient);
 
 	FUNC_EXIT_RC(SUCCESS);
 }
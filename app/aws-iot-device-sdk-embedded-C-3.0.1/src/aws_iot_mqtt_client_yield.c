@@ -95,6 +95,9 @@ static IoT_Error_t _aws_iot_mqtt_handle_reconnect(AWS_IoT_Client *pClient) {
 			if(SUCCESS != rc) {
 				FUNC_EXIT_RC(rc);
 			}
+			/* Unacknowledged publishes are resent with DUP right away, a resumed
+			 * session requires it and a new session would have lost them */
+			aws_iot_mqtt_internal_inflight_resend_now(pClient);
 			FUNC_EXIT_RC(NETWORK_RECONNECTED);
 		}
 	}
@@ -152,8 +155,9 @@ static IoT_Error_t _aws_iot_mqtt_keep_alive(AWS_IoT_Client *pClient) {
 	}
 
 	pClient->clientStatus.isPingOutstanding = true;
-	/* start a timer to wait for PINGRESP from server */
-	countdown_sec(&pClient->pingTimer, pClient->clientData.keepAliveInterval);
+	/* start a timer to wait for PINGRESP from server, a command round trip rather than
+	 * whole keepalive so that a link dropped by carrier NAT is noticed early */
+	countdown_ms(&pClient->pingTimer, pClient->clientData.commandTimeoutMs);
 
 	FUNC_EXIT_RC(SUCCESS);
 }
@@ -206,6 +210,13 @@ static IoT_Error_t _aws_iot_mqtt_internal_yield(AWS_IoT_Client *pClient, uint32_
 		yieldRc = aws_iot_mqtt_internal_cycle_read(pClient, &timer, &packet_type);
 		if(SUCCESS == yieldRc) {
 			yieldRc = _aws_iot_mqtt_keep_alive(pClient);
+			if(SUCCESS == yieldRc) {
+				yieldRc = aws_iot_mqtt_internal_inflight_retry(pClient);
+				if(SUCCESS != yieldRc) {
+					/* As with PING, a failed resend means connection is lost */
+					yieldRc = _aws_iot_mqtt_handle_disconnect(pClient);
+				}
+			}
 		} else {
 			// SSL read and write errors are terminal, connection must be closed and retried
 			if(NETWORK_SSL_READ_ERROR == yieldRc || NETWORK_SSL_WRITE_ERROR == yieldRc || NETWORK_SSL_WRITE_TIMEOUT_ERROR == yieldRc) {
@@ -305,6 +316,45 @@ IoT_Error_t aws_iot_mqtt_yield(AWS_IoT_Client *pClient, uint32_t timeout_ms) {
 	FUNC_EXIT_RC(yieldRc);
 }
 
+uint32_t aws_iot_mqtt_get_next_deadline_ms(AWS_IoT_Client *pClient, uint32_t max_ms) {
+	uint32_t deadline = max_ms;
+	uint32_t left;
+	uint32_t itr;
+	ClientState clientState;
+
+	if(NULL == pClient) {
+		return 0;
+	}
+
+	clientState = aws_iot_mqtt_get_client_state(pClient);
+	if(CLIENT_STATE_PENDING_RECONNECT == clientState) {
+		left = left_ms(&(pClient->reconnectDelayTimer));
+		return (left < deadline) ? left : deadline;
+	}
+
+	if(!aws_iot_mqtt_is_client_connected(pClient)) {
+		return deadline;
+	}
+
+	if(0 != pClient->clientData.keepAliveInterval) {
+		left = left_ms(&(pClient->pingTimer));
+		if(left < deadline) {
+			deadline = left;
+		}
+	}
+
+	for(itr = 0; itr < AWS_IOT_MQTT_MAX_INFLIGHT_PUBLISH; itr++) {
+		if(pClient->clientData.inflightPublish[itr].isUsed) {
+			left = left_ms(&(pClient->clientData.inflightPublish[itr].retryTimer));
+			if(left < deadline) {
+				deadline = left;
+			}
+		}
+	}
+
+	return deadline;
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -33,63 +33,35 @@ extern "C" {
 #include "aws_iot_config.h"
 
 extern char mqttClientID[MAX_SIZE_OF_UNIQUE_CLIENT_ID_BYTES];
-#define AWS_IOT_SHADOW_CLIENT_TOKEN_KEY "{\"clientToken\":\""
 static uint32_t clientTokenNum = 0;
 
-//helper functions
-static IoT_Error_t convertDataToString(char *pStringBuffer, size_t maxSizoStringBuffer, JsonPrimitiveType type,
-									   void *pData);
-
 void resetClientTokenSequenceNum(void) {
 	clientTokenNum = 0;
 }
 
-static IoT_Error_t emptyJsonWithClientToken(char *pBuffer, size_t bufferSize) {
+static void writeClientToken(AwsIotJsonWriter *pWriter) {
+	aws_iot_json_writer_key(pWriter, SHADOW_CLIENT_TOKEN_STRING);
+	aws_iot_json_writer_format(pWriter, "\"%s-%d\"", mqttClientID, (int) clientTokenNum++);
+}
 
-    IoT_Error_t rc = SUCCESS;
-    size_t dataLenInBuffer = 0;
+static IoT_Error_t emptyJsonWithClientToken(char *pBuffer, size_t bufferSize) {
+	AwsIotJsonWriter writer;
 
-	if(pBuffer != NULL)
-    {
-        dataLenInBuffer = (size_t)snprintf(pBuffer, bufferSize, AWS_IOT_SHADOW_CLIENT_TOKEN_KEY);
-    }else
-	{
-	    IOT_ERROR("NULL buffer in emptyJsonWithClientToken\n");
-        rc = FAILURE;
+	if(pBuffer == NULL) {
+		IOT_ERROR("NULL buffer in emptyJsonWithClientToken\n");
+		return FAILURE;
 	}
 
-	if(rc == SUCCESS)
-	{
-	    if ( dataLenInBuffer < bufferSize )
-	    {
-	        dataLenInBuffer += (size_t)snprintf(pBuffer + dataLenInBuffer, bufferSize - dataLenInBuffer, "%s-%d", mqttClientID, ( int )clientTokenNum++);
-	    }
-	    else
-	    {
-	        rc = FAILURE;
-	        IOT_ERROR("Supplied buffer too small to create JSON file\n");
-	    }
-    }
-
-	if(rc == SUCCESS)
-	{
-	    if ( dataLenInBuffer < bufferSize )
-	    {
-	        dataLenInBuffer += (size_t)snprintf( pBuffer + dataLenInBuffer, bufferSize - dataLenInBuffer, "\"}" );
-	        if ( dataLenInBuffer > bufferSize )
-	        {
-	            rc = FAILURE;
-	            IOT_ERROR( "Supplied buffer too small to create JSON file\n" );
-	        }
-	    }
-	    else
-	    {
-	        rc = FAILURE;
-	        IOT_ERROR( "Supplied buffer too small to create JSON file\n" );
-	    }
-    }
-
-    FUNC_EXIT_RC(rc);
+	aws_iot_json_writer_init(&writer, pBuffer, bufferSize);
+	aws_iot_json_writer_begin_object(&writer, NULL);
+	writeClientToken(&writer);
+	aws_iot_json_writer_end_object(&writer);
+
+	if(writer.rc != SUCCESS) {
+		IOT_ERROR("Supplied buffer too small to create JSON file\n");
+		return FAILURE;
+	}
+	return SUCCESS;
 }
 
 IoT_Error_t aws_iot_shadow_internal_get_request_json(char *pBuffer, size_t bufferSize) {
@@ -109,160 +81,177 @@ static inline IoT_Error_t checkReturnValueOfSnPrintf(int32_t snPrintfReturn, siz
 	return SUCCESS;
 }
 
-IoT_Error_t aws_iot_shadow_init_json_document(char *pJsonDocument, size_t maxSizeOfJsonDocument) {
+static IoT_Error_t writeJsonStruct(AwsIotJsonWriter *pWriter, const jsonStruct_t *pStruct) {
+	if(pStruct == NULL || pStruct->pKey == NULL || pStruct->pData == NULL) {
+		return NULL_VALUE_ERROR;
+	}
 
-	IoT_Error_t ret_val = SUCCESS;
-	int32_t snPrintfReturn = 0;
+	switch(pStruct->type) {
+		case SHADOW_JSON_INT32:
+			aws_iot_json_writer_int32(pWriter, pStruct->pKey, *(int32_t *) (pStruct->pData));
+			break;
+		case SHADOW_JSON_INT16:
+			aws_iot_json_writer_int32(pWriter, pStruct->pKey, *(int16_t *) (pStruct->pData));
+			break;
+		case SHADOW_JSON_INT8:
+			aws_iot_json_writer_int32(pWriter, pStruct->pKey, *(int8_t *) (pStruct->pData));
+			break;
+		case SHADOW_JSON_UINT32:
+			aws_iot_json_writer_uint32(pWriter, pStruct->pKey, *(uint32_t *) (pStruct->pData));
+			break;
+		case SHADOW_JSON_UINT16:
+			aws_iot_json_writer_uint32(pWriter, pStruct->pKey, *(uint16_t *) (pStruct->pData));
+			break;
+		case SHADOW_JSON_UINT8:
+			aws_iot_json_writer_uint32(pWriter, pStruct->pKey, *(uint8_t *) (pStruct->pData));
+			break;
+		case SHADOW_JSON_DOUBLE:
+			aws_iot_json_writer_double(pWriter, pStruct->pKey, *(double *) (pStruct->pData));
+			break;
+		case SHADOW_JSON_FLOAT:
+			aws_iot_json_writer_double(pWriter, pStruct->pKey, *(float *) (pStruct->pData));
+			break;
+		case SHADOW_JSON_BOOL:
+			aws_iot_json_writer_bool(pWriter, pStruct->pKey, *(bool *) (pStruct->pData));
+			break;
+		case SHADOW_JSON_STRING:
+			aws_iot_json_writer_string(pWriter, pStruct->pKey, (const char *) (pStruct->pData));
+			break;
+		case SHADOW_JSON_OBJECT:
+			aws_iot_json_writer_object(pWriter, pStruct->pKey, (const char *) (pStruct->pData));
+			break;
+		default:
+			return SHADOW_JSON_ERROR;
+	}
 
-	if(pJsonDocument == NULL) {
+	/* Truncation is left in the writer, later fields still count towards the size needed */
+	return SUCCESS;
+}
+
+IoT_Error_t aws_iot_shadow_writer_init(AwsIotJsonWriter *pWriter, char *pJsonDocument, size_t maxSizeOfJsonDocument) {
+	if(pWriter == NULL || pJsonDocument == NULL) {
 		return NULL_VALUE_ERROR;
 	}
-	snPrintfReturn = snprintf(pJsonDocument, maxSizeOfJsonDocument, "{\"state\":{");
 
-	ret_val = checkReturnValueOfSnPrintf(snPrintfReturn, maxSizeOfJsonDocument);
-
-	return ret_val;
+	aws_iot_json_writer_init(pWriter, pJsonDocument, maxSizeOfJsonDocument);
+	aws_iot_json_writer_begin_object(pWriter, NULL);
+	aws_iot_json_writer_begin_object(pWriter, SHADOW_STATE_STRING);
 
+	return pWriter->rc;
 }
 
-IoT_Error_t aws_iot_shadow_add_desired(char *pJsonDocument, size_t maxSizeOfJsonDocument, uint8_t count, ...) {
+IoT_Error_t aws_iot_shadow_writer_add_section(AwsIotJsonWriter *pWriter, const char *pSectionKey,
+											  jsonStruct_t *const *ppFields, uint8_t count, uint32_t fieldMask) {
 	IoT_Error_t ret_val = SUCCESS;
-	size_t tempSize = 0;
-	int8_t i;
-	size_t remSizeOfJsonBuffer = maxSizeOfJsonDocument;
-	int32_t snPrintfReturn = 0;
-	va_list pArgs;
-	jsonStruct_t *pTemporary = NULL;
-	va_start(pArgs, count);
+	uint8_t i;
 
-	if(pJsonDocument == NULL) {
-		va_end(pArgs);
+	if(pWriter == NULL || pSectionKey == NULL || (ppFields == NULL && count > 0)) {
 		return NULL_VALUE_ERROR;
 	}
 
-	tempSize = maxSizeOfJsonDocument - strlen(pJsonDocument);
-	if(tempSize <= 1) {
-		va_end(pArgs);
-		return SHADOW_JSON_ERROR;
+	if(count < 32) {
+		fieldMask &= (1UL << count) - 1;
 	}
-	remSizeOfJsonBuffer = tempSize;
-
-	snPrintfReturn = snprintf(pJsonDocument + strlen(pJsonDocument), remSizeOfJsonBuffer, "\"desired\":{");
-	ret_val = checkReturnValueOfSnPrintf(snPrintfReturn, remSizeOfJsonBuffer);
-
-	if(ret_val != SUCCESS) {
-		va_end(pArgs);
-		return ret_val;
+	if(count <= 32 && fieldMask == 0) {
+		/* Nothing changed, leave the section out instead of sending an empty object */
+		return pWriter->rc;
 	}
 
-	for(i = 0; i < count; i++) {
-		tempSize = maxSizeOfJsonDocument - strlen(pJsonDocument);
-		if(tempSize <= 1) {
-			va_end(pArgs);
-			return SHADOW_JSON_ERROR;
-		}
-		remSizeOfJsonBuffer = tempSize;
-		pTemporary = va_arg (pArgs, jsonStruct_t *);
-		if(pTemporary != NULL) {
-			snPrintfReturn = snprintf(pJsonDocument + strlen(pJsonDocument), remSizeOfJsonBuffer, "\"%s\":",
-									  pTemporary->pKey);
-			ret_val = checkReturnValueOfSnPrintf(snPrintfReturn, remSizeOfJsonBuffer);
-			if(ret_val != SUCCESS) {
-				va_end(pArgs);
-				return ret_val;
-			}
-			if(pTemporary->pKey != NULL && pTemporary->pData != NULL) {
-				ret_val = convertDataToString(pJsonDocument + strlen(pJsonDocument), remSizeOfJsonBuffer,
-											  pTemporary->type, pTemporary->pData);
-			} else {
-				va_end(pArgs);
-				return NULL_VALUE_ERROR;
-			}
-			if(ret_val != SUCCESS) {
-				va_end(pArgs);
-				return ret_val;
-			}
-		} else {
-			va_end(pArgs);
-			return NULL_VALUE_ERROR;
+	aws_iot_json_writer_begin_object(pWriter, pSectionKey);
+	for(i = 0; i < count && ret_val == SUCCESS; i++) {
+		if(i < 32 && (fieldMask & (1UL << i)) == 0) {
+			continue;
 		}
+		ret_val = writeJsonStruct(pWriter, ppFields[i]);
 	}
+	aws_iot_json_writer_end_object(pWriter);
 
-	va_end(pArgs);
-	snPrintfReturn = snprintf(pJsonDocument + strlen(pJsonDocument) - 1, remSizeOfJsonBuffer, "},");
-	ret_val = checkReturnValueOfSnPrintf(snPrintfReturn, remSizeOfJsonBuffer);
-	return ret_val;
+	return (ret_val != SUCCESS) ? ret_val : pWriter->rc;
 }
 
-IoT_Error_t aws_iot_shadow_add_reported(char *pJsonDocument, size_t maxSizeOfJsonDocument, uint8_t count, ...) {
-	IoT_Error_t ret_val = SUCCESS;
+IoT_Error_t aws_iot_shadow_writer_finalize(AwsIotJsonWriter *pWriter, uint32_t version) {
+	if(pWriter == NULL) {
+		return NULL_VALUE_ERROR;
+	}
 
-	int8_t i;
-	size_t remSizeOfJsonBuffer = maxSizeOfJsonDocument;
-	int32_t snPrintfReturn = 0;
-	size_t tempSize = 0;
-	jsonStruct_t *pTemporary;
-	va_list pArgs;
-	va_start(pArgs, count);
+	aws_iot_json_writer_end_object(pWriter);
+	if(version != 0) {
+		aws_iot_json_writer_uint32(pWriter, SHADOW_VERSION_STRING, version);
+	}
+	writeClientToken(pWriter);
+	aws_iot_json_writer_end_object(pWriter);
+
+	return pWriter->rc;
+}
+
+/* The variadic API below carries no state between calls, so each call finds the
+ * end of the document once and then writes at the cursor. Documents built with
+ * it always end in a complete member, a trailing comma left by older callers is
+ * dropped. */
+static IoT_Error_t resumeJsonDocument(AwsIotJsonWriter *pWriter, char *pJsonDocument, size_t maxSizeOfJsonDocument) {
+	size_t length;
 
 	if(pJsonDocument == NULL) {
-		va_end(pArgs);
 		return NULL_VALUE_ERROR;
 	}
 
-
-	tempSize = maxSizeOfJsonDocument - strlen(pJsonDocument);
-	if(tempSize <= 1) {
-		va_end(pArgs);
+	length = strlen(pJsonDocument);
+	if(length + 1 >= maxSizeOfJsonDocument) {
 		return SHADOW_JSON_ERROR;
 	}
-	remSizeOfJsonBuffer = tempSize;
+	if(length > 0 && pJsonDocument[length - 1] == ',') {
+		length--;
+	}
+
+	aws_iot_json_writer_resume(pWriter, pJsonDocument, maxSizeOfJsonDocument, length);
+	return SUCCESS;
+}
 
-	snPrintfReturn = snprintf(pJsonDocument + strlen(pJsonDocument), remSizeOfJsonBuffer, "\"reported\":{");
-	ret_val = checkReturnValueOfSnPrintf(snPrintfReturn, remSizeOfJsonBuffer);
+static IoT_Error_t addSectionFromArgs(char *pJsonDocument, size_t maxSizeOfJsonDocument, const char *pSectionKey,
+									  uint8_t count, va_list pArgs) {
+	AwsIotJsonWriter writer;
+	IoT_Error_t ret_val;
+	uint8_t i;
 
+	ret_val = resumeJsonDocument(&writer, pJsonDocument, maxSizeOfJsonDocument);
 	if(ret_val != SUCCESS) {
-		va_end(pArgs);
 		return ret_val;
 	}
 
-	for(i = 0; i < count; i++) {
-		tempSize = maxSizeOfJsonDocument - strlen(pJsonDocument);
-		if(tempSize <= 1) {
-			va_end(pArgs);
-			return SHADOW_JSON_ERROR;
-		}
-		remSizeOfJsonBuffer = tempSize;
-
-		pTemporary = va_arg (pArgs, jsonStruct_t *);
-		if(pTemporary != NULL) {
-			snPrintfReturn = snprintf(pJsonDocument + strlen(pJsonDocument), remSizeOfJsonBuffer, "\"%s\":",
-									  pTemporary->pKey);
-			ret_val = checkReturnValueOfSnPrintf(snPrintfReturn, remSizeOfJsonBuffer);
-			if(ret_val != SUCCESS) {
-				va_end(pArgs);
-				return ret_val;
-			}
-			if(pTemporary->pKey != NULL && pTemporary->pData != NULL) {
-				ret_val = convertDataToString(pJsonDocument + strlen(pJsonDocument), remSizeOfJsonBuffer,
-											  pTemporary->type, pTemporary->pData);
-			} else {
-				va_end(pArgs);
-				return NULL_VALUE_ERROR;
-			}
-			if(ret_val != SUCCESS) {
-				va_end(pArgs);
-				return ret_val;
-			}
-		} else {
-			va_end(pArgs);
-			return NULL_VALUE_ERROR;
-		}
+	aws_iot_json_writer_begin_object(&writer, pSectionKey);
+	for(i = 0; i < count && ret_val == SUCCESS; i++) {
+		ret_val = writeJsonStruct(&writer, va_arg(pArgs, jsonStruct_t *));
 	}
+	aws_iot_json_writer_end_object(&writer);
+
+	return (ret_val != SUCCESS) ? ret_val : writer.rc;
+}
+
+IoT_Error_t aws_iot_shadow_init_json_document(char *pJsonDocument, size_t maxSizeOfJsonDocument) {
+	AwsIotJsonWriter writer;
+
+	return aws_iot_shadow_writer_init(&writer, pJsonDocument, maxSizeOfJsonDocument);
+}
+
+IoT_Error_t aws_iot_shadow_add_desired(char *pJsonDocument, size_t maxSizeOfJsonDocument, uint8_t count, ...) {
+	IoT_Error_t ret_val;
+	va_list pArgs;
+
+	va_start(pArgs, count);
+	ret_val = addSectionFromArgs(pJsonDocument, maxSizeOfJsonDocument, SHADOW_DESIRED_STRING, count, pArgs);
+	va_end(pArgs);
+
+	return ret_val;
+}
 
+IoT_Error_t aws_iot_shadow_add_reported(char *pJsonDocument, size_t maxSizeOfJsonDocument, uint8_t count, ...) {
+	IoT_Error_t ret_val;
+	va_list pArgs;
+
+	va_start(pArgs, count);
+	ret_val = addSectionFromArgs(pJsonDocument, maxSizeOfJsonDocument, SHADOW_REPORTED_STRING, count, pArgs);
 	va_end(pArgs);
-	snPrintfReturn = snprintf(pJsonDocument + strlen(pJsonDocument) - 1, remSizeOfJsonBuffer, "},");
-	ret_val = checkReturnValueOfSnPrintf(snPrintfReturn, remSizeOfJsonBuffer);
+
 	return ret_val;
 }
 
@@ -284,93 +273,15 @@ IoT_Error_t aws_iot_fill_with_client_token(char *pBufferToBeUpdatedWithClientTok
 }
 
 IoT_Error_t aws_iot_finalize_json_document(char *pJsonDocument, size_t maxSizeOfJsonDocument) {
-	size_t remSizeOfJsonBuffer = maxSizeOfJsonDocument;
-	int32_t snPrintfReturn = 0;
-	size_t tempSize = 0;
-	IoT_Error_t ret_val = SUCCESS;
-
-	if(pJsonDocument == NULL) {
-		return NULL_VALUE_ERROR;
-	}
-
-	tempSize = maxSizeOfJsonDocument - strlen(pJsonDocument);
-	if(tempSize <= 1) {
-		return SHADOW_JSON_ERROR;
-	}
-	remSizeOfJsonBuffer = tempSize;
-
-	// strlen(ShadowTxBuffer) - 1 is to ensure we remove the last ,(comma) that was added
-	snPrintfReturn = snprintf(pJsonDocument + strlen(pJsonDocument) - 1, remSizeOfJsonBuffer, "}, \"%s\":\"",
-							  SHADOW_CLIENT_TOKEN_STRING);
-	ret_val = checkReturnValueOfSnPrintf(snPrintfReturn, remSizeOfJsonBuffer);
-
-	if(ret_val != SUCCESS) {
-		return ret_val;
-	}
-	// refactor this XXX repeated code
-	tempSize = maxSizeOfJsonDocument - strlen(pJsonDocument);
-	if(tempSize <= 1) {
-		return SHADOW_JSON_ERROR;
-	}
-	remSizeOfJsonBuffer = tempSize;
-
-
-	snPrintfReturn = FillWithClientTokenSize(pJsonDocument + strlen(pJsonDocument), remSizeOfJsonBuffer);
-	ret_val = checkReturnValueOfSnPrintf(snPrintfReturn, remSizeOfJsonBuffer);
+	AwsIotJsonWriter writer;
+	IoT_Error_t ret_val;
 
+	ret_val = resumeJsonDocument(&writer, pJsonDocument, maxSizeOfJsonDocument);
 	if(ret_val != SUCCESS) {
 		return ret_val;
 	}
-	tempSize = maxSizeOfJsonDocument - strlen(pJsonDocument);
-	if(tempSize <= 1) {
-		return SHADOW_JSON_ERROR;
-	}
-	remSizeOfJsonBuffer = tempSize;
-
-
-	snPrintfReturn = snprintf(pJsonDocument + strlen(pJsonDocument), remSizeOfJsonBuffer, "\"}");
-	ret_val = checkReturnValueOfSnPrintf(snPrintfReturn, remSizeOfJsonBuffer);
 
-	return ret_val;
-}
-
-static IoT_Error_t convertDataToString(char *pStringBuffer, size_t maxSizoStringBuffer, JsonPrimitiveType type,
-									   void *pData) {
-	int32_t snPrintfReturn = 0;
-	IoT_Error_t ret_val = SUCCESS;
-
-	if(maxSizoStringBuffer == 0) {
-		return SHADOW_JSON_ERROR;
-	}
-
-	if(type == SHADOW_JSON_INT32) {
-		snPrintfReturn = snprintf(pStringBuffer, maxSizoStringBuffer, "%i,", *(int32_t *) (pData));
-	} else if(type == SHADOW_JSON_INT16) {
-		snPrintfReturn = snprintf(pStringBuffer, maxSizoStringBuffer, "%hi,", *(int16_t *) (pData));
-	} else if(type == SHADOW_JSON_INT8) {
-		snPrintfReturn = snprintf(pStringBuffer, maxSizoStringBuffer, "%hhi,", *(int8_t *) (pData));
-	} else if(type == SHADOW_JSON_UINT32) {
-		snPrintfReturn = snprintf(pStringBuffer, maxSizoStringBuffer, "%u,", *(uint32_t *) (pData));
-	} else if(type == SHADOW_JSON_UINT16) {
-		snPrintfReturn = snprintf(pStringBuffer, maxSizoStringBuffer, "%hu,", *(uint16_t *) (pData));
-	} else if(type == SHADOW_JSON_UINT8) {
-		snPrintfReturn = snprintf(pStringBuffer, maxSizoStringBuffer, "%hhu,", *(uint8_t *) (pData));
-	} else if(type == SHADOW_JSON_DOUBLE) {
-		snPrintfReturn = snprintf(pStringBuffer, maxSizoStringBuffer, "%f,", *(double *) (pData));
-	} else if(type == SHADOW_JSON_FLOAT) {
-		snPrintfReturn = snprintf(pStringBuffer, maxSizoStringBuffer, "%f,", *(float *) (pData));
-	} else if(type == SHADOW_JSON_BOOL) {
-		snPrintfReturn = snprintf(pStringBuffer, maxSizoStringBuffer, "%s,", *(bool *) (pData) ? "true" : "false");
-	} else if(type == SHADOW_JSON_STRING) {
-		snPrintfReturn = snprintf(pStringBuffer, maxSizoStringBuffer, "\"%s\",", (char *) (pData));
-	} else if(type == SHADOW_JSON_OBJECT) {
-		snPrintfReturn = snprintf(pStringBuffer, maxSizoStringBuffer, "%s,", (char *) (pData));
-	}
-
-
-	ret_val = checkReturnValueOfSnPrintf(snPrintfReturn, maxSizoStringBuffer);
-
-	return ret_val;
+	return aws_iot_shadow_writer_finalize(&writer, 0);
 }
 
 static jsmn_parser shadowJsonParser;
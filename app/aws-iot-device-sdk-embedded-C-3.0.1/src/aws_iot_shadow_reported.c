@@ -0,0 +1,238 @@
+/*
+ * Copyright 2010-2015 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file aws_iot_shadow_reported.c
+ * @brief Publish only the reported fields that changed since the last accepted update
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "aws_iot_shadow_reported.h"
+
+#include <string.h>
+
+#include "aws_iot_config.h"
+#include "aws_iot_log.h"
+#include "aws_iot_shadow_json.h"
+#include "aws_iot_shadow_key.h"
+
+#define SHADOW_REJECTED_VERSION_CONFLICT 409
+
+static uint32_t fieldMaskOf(uint8_t count) {
+	return (count >= 32) ? 0xFFFFFFFFUL : ((1UL << count) - 1);
+}
+
+static size_t fieldValueSize(const jsonStruct_t *pField) {
+	switch(pField->type) {
+		case SHADOW_JSON_INT32:
+		case SHADOW_JSON_UINT32:
+			return sizeof(uint32_t);
+		case SHADOW_JSON_INT16:
+		case SHADOW_JSON_UINT16:
+			return sizeof(uint16_t);
+		case SHADOW_JSON_INT8:
+		case SHADOW_JSON_UINT8:
+			return sizeof(uint8_t);
+		case SHADOW_JSON_FLOAT:
+			return sizeof(float);
+		case SHADOW_JSON_DOUBLE:
+			return sizeof(double);
+		case SHADOW_JSON_BOOL:
+			return sizeof(bool);
+		default:
+			return strlen((const char *) pField->pData);
+	}
+}
+
+/* Values of up to 4 bytes are kept as is, so a change is always seen. Longer values are
+ * reduced to an FNV-1a hash; a collision only delays the change to the next full sync. */
+static uint32_t fieldFingerprint(const jsonStruct_t *pField) {
+	const uint8_t *pData = (const uint8_t *) pField->pData;
+	size_t size = fieldValueSize(pField);
+	uint32_t fingerprint = 0;
+	size_t i;
+
+	if(size <= sizeof(fingerprint)) {
+		memcpy(&fingerprint, pData, size);
+		return fingerprint;
+	}
+
+	fingerprint = 2166136261UL;
+	for(i = 0; i < size; i++) {
+		fingerprint ^= pData[i];
+		fingerprint *= 16777619UL;
+	}
+	return fingerprint;
+}
+
+static int32_t extractRejectedCode(const char *pJsonDocument) {
+	int32_t tokenCount;
+	int32_t code = 0;
+	uint32_t dataLength;
+	int32_t dataPosition;
+	jsonStruct_t codeStruct = {"code", &code, sizeof(code), SHADOW_JSON_INT32, NULL};
+
+	if(isJsonValidAndParse(pJsonDocument, strlen(pJsonDocument), NULL, &tokenCount)) {
+		isJsonKeyMatchingAndUpdateValue(pJsonDocument, NULL, tokenCount, &codeStruct, &dataLength, &dataPosition);
+	}
+	return code;
+}
+
+static void reportedAckCallback(const char *pThingName, ShadowActions_t action, Shadow_Ack_Status_t status,
+								const char *pReceivedJsonDocument, void *pContextData) {
+	ShadowReportedState_t *pState = (ShadowReportedState_t *) pContextData;
+	int32_t tokenCount;
+	uint32_t version;
+	int32_t code;
+	uint8_t i;
+
+	IOT_UNUSED(pThingName);
+	IOT_UNUSED(action);
+
+	if(status == SHADOW_ACK_ACCEPTED) {
+		for(i = 0; i < pState->count; i++) {
+			if(pState->pendingMask & (1UL << i)) {
+				pState->ackedFingerprint[i] = pState->pendingFingerprint[i];
+			}
+		}
+		pState->ackedMask |= pState->pendingMask;
+		if(isJsonValidAndParse(pReceivedJsonDocument, strlen(pReceivedJsonDocument), NULL, &tokenCount)
+		   && extractVersionNumber(pReceivedJsonDocument, NULL, tokenCount, &version)) {
+			pState->version = version;
+		}
+	} else if(status == SHADOW_ACK_REJECTED) {
+		code = extractRejectedCode(pReceivedJsonDocument);
+		IOT_WARN("Reported state update rejected, code %ld\n", (long) code);
+		if(code == SHADOW_REJECTED_VERSION_CONFLICT) {
+			// The Shadow moved on without us, the fields we think are reported may not be
+			aws_iot_shadow_reported_force_full_sync(pState);
+			pState->resyncs++;
+		}
+	} else {
+		// The update may or may not have been applied, so the version is no longer known
+		IOT_WARN("Reported state update timed out\n");
+		aws_iot_shadow_reported_force_full_sync(pState);
+		pState->resyncs++;
+	}
+
+	pState->pendingMask = 0;
+	pState->isUpdatePending = false;
+}
+
+IoT_Error_t aws_iot_shadow_reported_init(ShadowReportedState_t *pState, jsonStruct_t *const *ppFields, uint8_t count) {
+	uint8_t i;
+
+	if(NULL == pState || NULL == ppFields) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	if(count > SHADOW_REPORTED_MAX_FIELDS) {
+		FUNC_EXIT_RC(MAX_SIZE_ERROR);
+	}
+
+	for(i = 0; i < count; i++) {
+		if(NULL == ppFields[i] || NULL == ppFields[i]->pKey || NULL == ppFields[i]->pData) {
+			FUNC_EXIT_RC(NULL_VALUE_ERROR);
+		}
+	}
+
+	memset(pState, 0, sizeof(*pState));
+	pState->ppFields = ppFields;
+	pState->count = count;
+	init_timer(&pState->fullSyncTimer);
+
+	FUNC_EXIT_RC(SUCCESS);
+}
+
+void aws_iot_shadow_reported_force_full_sync(ShadowReportedState_t *pState) {
+	pState->ackedMask = 0;
+	pState->version = 0;
+}
+
+IoT_Error_t aws_iot_shadow_reported_update(AWS_IoT_Client *pClient, ShadowReportedState_t *pState,
+										   const char *pThingName, char *pJsonDocument,
+										   size_t maxSizeOfJsonDocument, uint8_t timeout_seconds) {
+	AwsIotJsonWriter writer;
+	IoT_Error_t rc;
+	uint32_t allFields;
+	uint32_t changedMask = 0;
+	bool isFullSync;
+	uint8_t i;
+
+	if(NULL == pClient || NULL == pState || NULL == pThingName || NULL == pJsonDocument) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	if(pState->isUpdatePending) {
+		FUNC_EXIT_RC(SHADOW_WAIT_FOR_PUBLISH);
+	}
+
+	allFields = fieldMaskOf(pState->count);
+	isFullSync = (pState->ackedMask != allFields);
+	if(SHADOW_REPORTED_FULL_SYNC_INTERVAL_SEC > 0 && has_timer_expired(&pState->fullSyncTimer)) {
+		isFullSync = true;
+	}
+
+	for(i = 0; i < pState->count; i++) {
+		pState->pendingFingerprint[i] = fieldFingerprint(pState->ppFields[i]);
+		if(isFullSync || pState->pendingFingerprint[i] != pState->ackedFingerprint[i]) {
+			changedMask |= (1UL << i);
+		}
+	}
+
+	if(changedMask == 0) {
+		FUNC_EXIT_RC(SUCCESS);
+	}
+
+	// A full sync replaces every field we own, so it goes out unconditionally and learns the version
+	rc = aws_iot_shadow_writer_init(&writer, pJsonDocument, maxSizeOfJsonDocument);
+	if(SUCCESS == rc) {
+		rc = aws_iot_shadow_writer_add_section(&writer, SHADOW_REPORTED_STRING, pState->ppFields, pState->count,
+											   changedMask);
+	}
+	if(SUCCESS == rc) {
+		rc = aws_iot_shadow_writer_finalize(&writer, isFullSync ? 0 : pState->version);
+	}
+	if(SUCCESS != rc) {
+		IOT_ERROR("Reported state does not fit in %u bytes\n", (unsigned) maxSizeOfJsonDocument);
+		FUNC_EXIT_RC(rc);
+	}
+
+	rc = aws_iot_shadow_update(pClient, pThingName, pJsonDocument, reportedAckCallback, pState, timeout_seconds,
+							   true);
+	if(SUCCESS != rc) {
+		FUNC_EXIT_RC(rc);
+	}
+
+	pState->pendingMask = changedMask;
+	pState->isUpdatePending = true;
+	if(isFullSync) {
+		pState->fullSyncs++;
+		countdown_sec(&pState->fullSyncTimer, SHADOW_REPORTED_FULL_SYNC_INTERVAL_SEC);
+	} else {
+		pState->deltaUpdates++;
+	}
+
+	IOT_DEBUG("Reported %s update, %lu bytes\n", isFullSync ? "full" : "delta", (unsigned long) writer.length);
+
+	FUNC_EXIT_RC(SUCCESS);
+}
+
+#ifdef __cplusplus
+}
+#endif
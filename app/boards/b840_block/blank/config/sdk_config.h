@@ -3703,6 +3703,12 @@
 #define NRF_CRYPTO_BACKEND_CC310_HASH_SHA256_ENABLED 1
 #endif
 
+// <q> NRF_CRYPTO_BACKEND_CC310_ECC_SECP256R1_ENABLED  - Enable the secp256r1 elliptic curve support using CC310.
+
+#ifndef NRF_CRYPTO_BACKEND_CC310_ECC_SECP256R1_ENABLED
+#define NRF_CRYPTO_BACKEND_CC310_ECC_SECP256R1_ENABLED 1
+#endif
+
 // <q> NRF_CRYPTO_BACKEND_CC310_INTERRUPTS_ENABLED  - Enable Interrupts while support using CC310.
 
 // <i> Select a library version compatible with the configuration. When interrupts are disable, a version named _noint must be used
@@ -3711,10 +3717,10 @@
 #define NRF_CRYPTO_BACKEND_CC310_INTERRUPTS_ENABLED 1
 #endif
 
-#if 0
+// <q> NRF_CRYPTO_RNG_ENABLED  - nrf_crypto_rng, required by CC310 ECDSA signing (ES256 JWT).
+
 #ifndef NRF_CRYPTO_RNG_ENABLED
-#define NRF_CRYPTO_RNG_ENABLED 0
-#endif
+#define NRF_CRYPTO_RNG_ENABLED 1
 #endif
 
 #ifndef NRF_CRYPTO_BACKEND_CC310_RNG_ENABLED
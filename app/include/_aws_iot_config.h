@@ -28,6 +28,65 @@
 #define AWS_IOT_MQTT_TX_BUF_LEN                 1024 ///< Any time a message is sent out through the MQTT layer. The message is copied into this buffer anytime a publish is done. This will also be used in the case of Thing Shadow
 #define AWS_IOT_MQTT_RX_BUF_LEN                 1024 ///< Any message that comes into the device should be less than this buffer size. If a received message is bigger than this buffer size the message will be dropped.
 #define AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS     5 ///< Maximum number of topic filters the MQTT client can handle at any given time. This should be increased appropriately when using Thing Shadow
+#define AWS_IOT_MQTT_MAX_TOPIC_LEVELS           8 ///< Topic filters up to this many levels are indexed for dispatch, deeper ones are matched one by one. Index takes this many nodes per subscribe handler.
+#define AWS_IOT_MQTT_MAX_INFLIGHT_PUBLISH       4 ///< In-flight window of aws_iot_mqtt_publish_async, QoS1 messages sent and waiting for PUBACK at the same time.
+#define AWS_IOT_MQTT_INFLIGHT_RETRY_MS          15000 ///< Unacknowledged async QoS1 message is resent with DUP flag after this time.
+#define AWS_IOT_MQTT_INFLIGHT_MAX_RETRIES       3 ///< Async QoS1 message is given up with MQTT_REQUEST_TIMEOUT_ERROR to completion handler after this many resends.
+#define IOT_MQTT_PERSISTENT_SESSION             true ///< Connect with clean session off, broker keeps subscriptions and QoS1 state over reconnects and resubscribe is skipped when it reports session present.
+#define IOT_MQTT5_ENABLED                       false ///< Cloud IoT Core accepts MQTT 3.1.1 only.
+#define AWS_IOT_MQTT_MAX_TOPIC_ALIASES          4 ///< MQTT 5 topic aliases kept per connection, publishes to these topics send 2 byte alias instead of topic name. At least 1.
+#define AWS_IOT_MQTT_TOPIC_ALIAS_MAX_LEN        48 ///< Longer topics are always sent in full, alias table keeps a copy of each topic.
+#define AWS_IOT_MQTT5_SESSION_EXPIRY_SEC        3600 ///< MQTT 5 session expiry sent with persistent session, broker drops session after this long offline.
+
+// Outbound publish queue
+#define PUBLISH_QUEUE_LENGTH                    8 ///< Messages held while connection is down or busy, see publish_queue.h.
+#define PUBLISH_QUEUE_PAYLOAD_MAX               128 ///< Payload bytes copied into each queue entry.
+
+// Telemetry batching
+#define TELEMETRY_BATCH_MAX_SAMPLES             16 ///< Samples per publish, see telemetry_batch.h. Batch must fit PUBLISH_QUEUE_PAYLOAD_MAX.
+#define TELEMETRY_BATCH_DELTA_ENCODING          true ///< Delta of delta timestamps and delta temperatures as zigzag varints, about 2 bytes per sample instead of 4.
+#define TELEMETRY_BATCH_MAX_AGE_SEC             900 ///< Batch is published when its oldest sample is this old, bounds delivery latency.
+
+// Temperature sampling and publish policy, see temp_sensor.h and publish_policy.h
+#define TEMPERATURE_SAMPLE_INTERVAL_MS          5000 ///< RTC starts a TEMP measurement through PPI this often, CPU only takes the result interrupt.
+#define TEMPERATURE_SAMPLE_RING_LENGTH          32 ///< Samples held until main loop reads them, power of 2. Must hold a window of samples.
+#define TEMPERATURE_WINDOW_SEC                  60 ///< Samples are summed up as min, max, mean and count over this window, publish policy sees window mean.
+#define TEMPERATURE_DEADBAND_C                  1 ///< Change of window mean from last published one that is published.
+#define TEMPERATURE_MIN_REPORT_SEC              60 ///< Changes closer than this to last published window wait for it.
+#define TEMPERATURE_HEARTBEAT_SEC               1800 ///< Temperature is published at least this often even when unchanged.
+
+// Offline telemetry log in flash, see telemetry_log.h
+#define TELEMETRY_LOG_FLASH_START               0xE0000 ///< First log page, MAX_FP_BASE_ADDRESS in bl_cmds.h and application FLASH region in ota_app.ld end here.
+#define TELEMETRY_LOG_PAGES                     16 ///< 4 kB flash pages between log start and bootloader. Page after the one in use is kept erased, when it is needed oldest page is erased with its unsent batches.
+#define TELEMETRY_LOG_REPLAY_INTERVAL_MS        2000 ///< Least time between replayed publishes after reconnect, leaves link to live telemetry.
+#define TELEMETRY_LOG_REPLAY_WINDOW             2 ///< Replayed batches waiting for PUBACK at the same time.
+
+// Main loop
+#define IOT_EVENT_DRIVEN_YIELD                  true ///< Sleep (WFE) until modem reports data or next keepalive, resend or sample is due, instead of polling modem with 1 second yields.
+#define IOT_EVENT_YIELD_MS                      200 ///< Yield time after each wake up, enough to read notified packets.
+
+// MQTT keepalive, see keepalive_tuner.h
+#define IOT_KEEPALIVE_MIN_SEC                   60 ///< Shortest idle time before a ping, also the starting point on a network not probed before.
+#define IOT_KEEPALIVE_MAX_SEC                   1200 ///< Keepalive sent in CONNECT, idle time before a ping never goes above it. AWS IoT allows up to 1200.
+#define IOT_KEEPALIVE_STEP_SEC                  60 ///< Idle time is raised by this much after each confirmed probe and lowered by it after repeated lost pings.
+#define IOT_KEEPALIVE_PROBE_CONFIRM             2 ///< Answered pings needed at one idle time before a longer one is tried.
+#define IOT_KEEPALIVE_LOSS_CONFIRM              3 ///< Pings lost one after another at a known good idle time before it is lowered. A single loss is as likely coverage or a modem stall.
+#define IOT_KEEPALIVE_REPROBE_PINGS             100 ///< Answered pings after settling before a longer idle time is tried again, so a setting lowered by outages recovers.
+
+// TLS (mbedTLS transport only)
+#define IOT_TLS_MAX_FRAGMENT_LEN                1024 ///< Requested TLS max_fragment_length (RFC 6066): 512, 1024, 2048, 4096 or 0 to not negotiate. Records sent are at most this long, so each fits one GPRS_TCP_SEND_CHUNK_SIZE. Records received are limited too only when server echoes the extension, which is logged after handshake; MBEDTLS_SSL_IN_CONTENT_LEN stays at 16K for servers that ignore it.
+#define IOT_TLS_PINNED_SPKI_SHA256              "" ///< Hex SHA-256 of SubjectPublicKeyInfo of a server certificate, "" disables pinning. With root CA the key must be on the validated path. Without root CA a pinned leaf key is trusted as is, a pinned intermediate must have signed the leaf, which must name the host. openssl x509 -in cert.pem -pubkey -noout | openssl pkey -pubin -outform der | openssl dgst -sha256
+#define IOT_TLS_VERIFIED_CHAIN_CACHE_SIZE       0 ///< Number of server certificate chains (keyed by SHA-256 of host name and chain) remembered after full validation, each until its first certificate expires by modem clock. 0 validates on every handshake. Non zero, like a pinned key, runs handshake with MBEDTLS_SSL_VERIFY_NONE and checks chain after it, before anything is sent.
+#define IOT_TLS_DEFAULT_TRANSPORT               IOT_TLS_TRANSPORT_MBEDTLS ///< Transport for new connections when both are linked (CLOUD_TARGET 4 and 5): IOT_TLS_TRANSPORT_MODEM or IOT_TLS_TRANSPORT_MBEDTLS. Change per connection with iot_tls_set_transport().
+#define IOT_TLS_BENCHMARK_ENABLED               false ///< When both transports are linked, measure handshake time, publish throughput and heap of each before starting application.
+
+// JWT
+#define GCP_IOT_JWT_LIFETIME_SECONDS            (24 * 60 * 60) ///< exp - iat of device JWT, GCP accepts at most 24 hours. Connection is closed by GCP when JWT expires.
+#define GCP_IOT_JWT_REFRESH_MARGIN_SECONDS      (60 * 60) ///< JWT is re-signed in idle time when less than this is left before expiry, so reconnects never wait for signing.
+#define GCP_IOT_JWT_BENCHMARK_ENABLED           false ///< Before connecting, time JWT signing with each key below. Signing algorithm follows key type: RSA key signs RS256 on mbedTLS, P-256 key signs ES256 on CC310.
+#define GCP_IOT_JWT_BENCHMARK_RSA_KEY_FILENAME  "" ///< ROFS path of RSA private key used only by JWT benchmark, "" skips it.
+#define GCP_IOT_JWT_BENCHMARK_EC_KEY_FILENAME   "" ///< ROFS path of P-256 private key used only by JWT benchmark, "" skips it.
+#define GCP_IOT_JWT_BENCHMARK_ITERATIONS        3
 
 // Thing Shadow specific configs
 #define SHADOW_MAX_SIZE_OF_RX_BUFFER                (AWS_IOT_MQTT_RX_BUF_LEN + 1) ///< Maximum size of the SHADOW buffer to store the received Shadow message, including terminating NULL byte.
@@ -40,6 +99,7 @@
 #define MAX_SHADOW_TOPIC_LENGTH_WITHOUT_THINGNAME   60 ///< All shadow actions have to be published or subscribed to a topic which is of the format $aws/things/{thingName}/shadow/update/accepted. This refers to the size of the topic without the Thing Name
 #define MAX_SIZE_OF_THING_NAME                      20 ///< The Thing Name should not be bigger than this value. Modify this if the Thing Name needs to be bigger
 #define MAX_SHADOW_TOPIC_LENGTH_BYTES               MAX_SHADOW_TOPIC_LENGTH_WITHOUT_THINGNAME + MAX_SIZE_OF_THING_NAME ///< This size includes the length of topic with Thing Name
+#define SHADOW_REPORTED_FULL_SYNC_INTERVAL_SEC      3600 ///< Report every field, without a version check, at least this often even if only some changed. 0 only full syncs on start and after a rejected or timed out update
 
 // Auto Reconnect specific config
 #define AWS_IOT_MQTT_MIN_RECONNECT_WAIT_INTERVAL    1000 ///< Minimum time before the First reconnect attempt is made as part of the exponential back-off algorithm
@@ -68,6 +128,57 @@
 #define AWS_IOT_MQTT_TX_BUF_LEN                 512 ///< Any time a message is sent out through the MQTT layer. The message is copied into this buffer anytime a publish is done. This will also be used in the case of Thing Shadow
 #define AWS_IOT_MQTT_RX_BUF_LEN                 512 ///< Any message that comes into the device should be less than this buffer size. If a received message is bigger than this buffer size the message will be dropped.
 #define AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS     5 ///< Maximum number of topic filters the MQTT client can handle at any given time. This should be increased appropriately when using Thing Shadow
+#define AWS_IOT_MQTT_MAX_TOPIC_LEVELS           8 ///< Topic filters up to this many levels are indexed for dispatch, deeper ones are matched one by one. Index takes this many nodes per subscribe handler.
+#define AWS_IOT_MQTT_MAX_INFLIGHT_PUBLISH       4 ///< In-flight window of aws_iot_mqtt_publish_async, QoS1 messages sent and waiting for PUBACK at the same time.
+#define AWS_IOT_MQTT_INFLIGHT_RETRY_MS          15000 ///< Unacknowledged async QoS1 message is resent with DUP flag after this time.
+#define AWS_IOT_MQTT_INFLIGHT_MAX_RETRIES       3 ///< Async QoS1 message is given up with MQTT_REQUEST_TIMEOUT_ERROR to completion handler after this many resends.
+#define IOT_MQTT_PERSISTENT_SESSION             true ///< Connect with clean session off, broker keeps subscriptions and QoS1 state over reconnects and resubscribe is skipped when it reports session present.
+#define IOT_MQTT5_ENABLED                       true ///< Connect with MQTT 5 for topic aliases, receive maximum flow control and reason codes, false for MQTT 3.1.1.
+#define AWS_IOT_MQTT_MAX_TOPIC_ALIASES          4 ///< MQTT 5 topic aliases kept per connection, publishes to these topics send 2 byte alias instead of topic name. At least 1.
+#define AWS_IOT_MQTT_TOPIC_ALIAS_MAX_LEN        48 ///< Longer topics are always sent in full, alias table keeps a copy of each topic.
+#define AWS_IOT_MQTT5_SESSION_EXPIRY_SEC        3600 ///< MQTT 5 session expiry sent with persistent session, broker drops session after this long offline.
+
+// Outbound publish queue
+#define PUBLISH_QUEUE_LENGTH                    8 ///< Messages held while connection is down or busy, see publish_queue.h.
+#define PUBLISH_QUEUE_PAYLOAD_MAX               128 ///< Payload bytes copied into each queue entry.
+
+// Telemetry batching
+#define TELEMETRY_BATCH_MAX_SAMPLES             16 ///< Samples per publish, see telemetry_batch.h. Batch must fit PUBLISH_QUEUE_PAYLOAD_MAX.
+#define TELEMETRY_BATCH_DELTA_ENCODING          true ///< Delta of delta timestamps and delta temperatures as zigzag varints, about 2 bytes per sample instead of 4.
+#define TELEMETRY_BATCH_MAX_AGE_SEC             900 ///< Batch is published when its oldest sample is this old, bounds delivery latency.
+
+// Temperature sampling and publish policy, see temp_sensor.h and publish_policy.h
+#define TEMPERATURE_SAMPLE_INTERVAL_MS          5000 ///< RTC starts a TEMP measurement through PPI this often, CPU only takes the result interrupt.
+#define TEMPERATURE_SAMPLE_RING_LENGTH          32 ///< Samples held until main loop reads them, power of 2. Must hold a window of samples.
+#define TEMPERATURE_WINDOW_SEC                  60 ///< Samples are summed up as min, max, mean and count over this window, publish policy sees window mean.
+#define TEMPERATURE_DEADBAND_C                  1 ///< Change of window mean from last published one that is published.
+#define TEMPERATURE_MIN_REPORT_SEC              60 ///< Changes closer than this to last published window wait for it.
+#define TEMPERATURE_HEARTBEAT_SEC               1800 ///< Temperature is published at least this often even when unchanged.
+
+// Offline telemetry log in flash, see telemetry_log.h
+#define TELEMETRY_LOG_FLASH_START               0xE0000 ///< First log page, MAX_FP_BASE_ADDRESS in bl_cmds.h and application FLASH region in ota_app.ld end here.
+#define TELEMETRY_LOG_PAGES                     16 ///< 4 kB flash pages between log start and bootloader. Page after the one in use is kept erased, when it is needed oldest page is erased with its unsent batches.
+#define TELEMETRY_LOG_REPLAY_INTERVAL_MS        2000 ///< Least time between replayed publishes after reconnect, leaves link to live telemetry.
+#define TELEMETRY_LOG_REPLAY_WINDOW             2 ///< Replayed batches waiting for PUBACK at the same time.
+
+// Main loop
+#define IOT_EVENT_DRIVEN_YIELD                  true ///< Sleep (WFE) until modem reports data or next keepalive, resend or sample is due, instead of polling modem with 1 second yields.
+#define IOT_EVENT_YIELD_MS                      200 ///< Yield time after each wake up, enough to read notified packets.
+
+// MQTT keepalive, see keepalive_tuner.h
+#define IOT_KEEPALIVE_MIN_SEC                   60 ///< Shortest idle time before a ping, also the starting point on a network not probed before.
+#define IOT_KEEPALIVE_MAX_SEC                   1200 ///< Keepalive sent in CONNECT, idle time before a ping never goes above it.
+#define IOT_KEEPALIVE_STEP_SEC                  60 ///< Idle time is raised by this much after each confirmed probe and lowered by it after repeated lost pings.
+#define IOT_KEEPALIVE_PROBE_CONFIRM             2 ///< Answered pings needed at one idle time before a longer one is tried.
+#define IOT_KEEPALIVE_LOSS_CONFIRM              3 ///< Pings lost one after another at a known good idle time before it is lowered. A single loss is as likely coverage or a modem stall.
+#define IOT_KEEPALIVE_REPROBE_PINGS             100 ///< Answered pings after settling before a longer idle time is tried again, so a setting lowered by outages recovers.
+
+// TLS (mbedTLS transport only)
+#define IOT_TLS_MAX_FRAGMENT_LEN                1024 ///< Requested TLS max_fragment_length (RFC 6066): 512, 1024, 2048, 4096 or 0 to not negotiate. Records sent are at most this long, so each fits one GPRS_TCP_SEND_CHUNK_SIZE. Records received are limited too only when server echoes the extension, which is logged after handshake; MBEDTLS_SSL_IN_CONTENT_LEN stays at 16K for servers that ignore it.
+#define IOT_TLS_PINNED_SPKI_SHA256              "" ///< Hex SHA-256 of SubjectPublicKeyInfo of a server certificate, "" disables pinning. With root CA the key must be on the validated path. Without root CA a pinned leaf key is trusted as is, a pinned intermediate must have signed the leaf, which must name the host. openssl x509 -in cert.pem -pubkey -noout | openssl pkey -pubin -outform der | openssl dgst -sha256
+#define IOT_TLS_VERIFIED_CHAIN_CACHE_SIZE       0 ///< Number of server certificate chains (keyed by SHA-256 of host name and chain) remembered after full validation, each until its first certificate expires by modem clock. 0 validates on every handshake. Non zero, like a pinned key, runs handshake with MBEDTLS_SSL_VERIFY_NONE and checks chain after it, before anything is sent.
+#define IOT_TLS_DEFAULT_TRANSPORT               IOT_TLS_TRANSPORT_MBEDTLS ///< Transport for new connections when both are linked (CLOUD_TARGET 4 and 5): IOT_TLS_TRANSPORT_MODEM or IOT_TLS_TRANSPORT_MBEDTLS. Change per connection with iot_tls_set_transport().
+#define IOT_TLS_BENCHMARK_ENABLED               false ///< When both transports are linked, measure handshake time, publish throughput and heap of each before starting application.
 
 // Thing Shadow specific configs
 #define SHADOW_MAX_SIZE_OF_RX_BUFFER                (AWS_IOT_MQTT_RX_BUF_LEN + 1) ///< Maximum size of the SHADOW buffer to store the received Shadow message, including terminating NULL byte.
@@ -80,6 +191,7 @@
 #define MAX_SHADOW_TOPIC_LENGTH_WITHOUT_THINGNAME   60 ///< All shadow actions have to be published or subscribed to a topic which is of the format $aws/things/{thingName}/shadow/update/accepted. This refers to the size of the topic without the Thing Name
 #define MAX_SIZE_OF_THING_NAME                      20 ///< The Thing Name should not be bigger than this value. Modify this if the Thing Name needs to be bigger
 #define MAX_SHADOW_TOPIC_LENGTH_BYTES               MAX_SHADOW_TOPIC_LENGTH_WITHOUT_THINGNAME + MAX_SIZE_OF_THING_NAME ///< This size includes the length of topic with Thing Name
+#define SHADOW_REPORTED_FULL_SYNC_INTERVAL_SEC      3600 ///< Report every field, without a version check, at least this often even if only some changed. 0 only full syncs on start and after a rejected or timed out update
 
 // Auto Reconnect specific config
 #define AWS_IOT_MQTT_MIN_RECONNECT_WAIT_INTERVAL    1000 ///< Minimum time before the First reconnect attempt is made as part of the exponential back-off algorithm
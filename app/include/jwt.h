@@ -26,8 +26,23 @@ limitations under the License.
 typedef char* string_t;
 typedef const char* cstring_t;
 
+typedef enum {
+    JWT_ALG_NONE,
+    JWT_ALG_RS256, //mbedTLS software RSA.
+    JWT_ALG_ES256, //CC310 ECDSA P-256.
+} jwt_alg_t;
+
+//Enough for RS256 with 2048 bit key or ES256 and claims of up to ~200 bytes.
+#define JWT_TOKEN_MAX_LEN 640
+
 int jwt_init(void);
+//Signing algorithm is selected from key type.
 int jwt_pk_init(const unsigned char* key, size_t keylen);
-int jwt_create_RS256_token(cstring_t payload, string_t* otoken, size_t* token_len);
+jwt_alg_t jwt_get_alg(void);
+//Signs with algorithm selected by jwt_pk_init into caller's token buffer,
+//null terminated. Returns 0 on success.
+int jwt_create_token(cstring_t payload, string_t token, size_t token_size, size_t* token_len);
+int jwt_create_RS256_token(cstring_t payload, string_t token, size_t token_size, size_t* token_len);
+int jwt_create_ES256_token(cstring_t payload, string_t token, size_t token_size, size_t* token_len);
 
 #endif /* JWT_H_ */
@@ -0,0 +1,37 @@
+/*
+
+Copyright 2019-2020 Ravikiran Bukkasagara <contact@ravikiranb.com>
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+    
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#ifndef JWT_MANAGER_H_
+#define JWT_MANAGER_H_
+
+#include "jwt.h"
+
+//Caches device JWT and re-signs it before expiry, so connect and reconnect
+//get a valid token without waiting for signing. jwt_pk_init must be done first.
+
+int jwt_manager_init(cstring_t audience, unsigned long lifetime_sec, unsigned long refresh_margin_sec);
+
+//Returns cached token, signs a new one only if none yet or it is close to expiry.
+//Token memory stays valid until second re-sign after it, enough to swap client to new token.
+int jwt_manager_get(cstring_t* token, size_t* token_len);
+
+//Call when idle. Cheap unless clock check interval has passed.
+//Returns 1 if a new token was signed, 0 if not due, negative on error.
+int jwt_manager_refresh(void);
+
+#endif /* JWT_MANAGER_H_ */
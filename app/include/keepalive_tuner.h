@@ -0,0 +1,47 @@
+/*
+
+Copyright 2019-2020 Ravikiran Bukkasagara <contact@ravikiranb.com>
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#ifndef KEEPALIVE_TUNER_H_
+#define KEEPALIVE_TUNER_H_
+
+#include <stdint.h>
+
+#include "aws_iot_mqtt_client_interface.h"
+
+//Finds longest idle time the carrier NAT keeps the connection open, between
+//IOT_KEEPALIVE_MIN_SEC and IOT_KEEPALIVE_MAX_SEC. Pings are sent only after that
+//much idle time, any other packet sent counts as liveness. Each answered ping is
+//a successful probe, after IOT_KEEPALIVE_PROBE_CONFIRM of them the idle time is
+//raised. A ping lost at a probed idle time settles on the last good one. A known
+//good idle time is lowered only after IOT_KEEPALIVE_LOSS_CONFIRM pings lost one
+//after another, and after IOT_KEEPALIVE_REPROBE_PINGS answered pings a settled
+//idle time is probed upwards again. Result is saved on modem file system per
+//operator (MCC and MNC).
+
+//Call after aws_iot_mqtt_init, modem must be registered to network.
+void keepalive_tuner_init(AWS_IoT_Client* client);
+
+//Call from main loop after yield.
+void keepalive_tuner_update(AWS_IoT_Client* client);
+
+//Call from disconnect handler.
+void keepalive_tuner_on_disconnect(AWS_IoT_Client* client);
+
+uint16_t keepalive_tuner_get_interval(void);
+
+#endif /* KEEPALIVE_TUNER_H_ */
@@ -0,0 +1,69 @@
+/*
+
+Copyright 2019-2020 Ravikiran Bukkasagara <contact@ravikiranb.com>
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#ifndef PUBLISH_POLICY_H_
+#define PUBLISH_POLICY_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+//Decides which samples of a signal are worth publishing. Sensor is read often,
+//a sample is published when it differs from last published value by at least
+//deadband and min_interval_sec has passed since last publish, or when nothing
+//was published for max_interval_sec (heartbeat, value unchanged). A change
+//held back by min_interval_sec goes out with first sample after it, if it is
+//still there.
+
+typedef enum {
+    PUBLISH_POLICY_SKIP,
+    PUBLISH_POLICY_CHANGE,
+    PUBLISH_POLICY_HEARTBEAT,
+} publish_policy_result_t;
+
+typedef struct {
+    int32_t deadband; //in signal units, 0 publishes every change.
+    uint32_t min_interval_sec;
+    uint32_t max_interval_sec;
+} publish_policy_config_t;
+
+typedef struct {
+    uint32_t samples;
+    uint32_t changes;
+    uint32_t heartbeats;
+} publish_policy_stats_t;
+
+//One per signal.
+typedef struct {
+    const publish_policy_config_t* config;
+    bool published;
+    int32_t last_value;
+    uint32_t last_time;
+    publish_policy_stats_t stats;
+} publish_policy_t;
+
+//config must be static.
+void publish_policy_init(publish_policy_t* policy, const publish_policy_config_t* config);
+
+//timestamp in seconds. Remembers sample as last published unless result is
+//PUBLISH_POLICY_SKIP.
+publish_policy_result_t publish_policy_check(publish_policy_t* policy, uint32_t timestamp, int32_t value);
+
+//Next sample is published whatever its value, e.g. after configuration change.
+void publish_policy_force(publish_policy_t* policy);
+
+#endif /* PUBLISH_POLICY_H_ */
@@ -0,0 +1,60 @@
+/*
+
+Copyright 2019-2020 Ravikiran Bukkasagara <contact@ravikiranb.com>
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#ifndef PUBLISH_QUEUE_H_
+#define PUBLISH_QUEUE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "aws_iot_mqtt_client_interface.h"
+
+//Bounded outbound queue in front of MQTT publish. Samples are queued while
+//connection is down or slow and sent from main loop with publish_queue_drain.
+//Higher priority goes first, FIFO within same priority. When full, oldest
+//entry of lowest priority is dropped if it is not above new entry priority.
+
+typedef enum {
+    PUBLISH_PRIORITY_LOW,
+    PUBLISH_PRIORITY_NORMAL,
+    PUBLISH_PRIORITY_HIGH,
+} publish_priority_t;
+
+typedef struct {
+    uint8_t depth; //queued, not yet sent.
+    uint8_t inflight; //QoS1 sent, waiting for PUBACK.
+    uint32_t sent;
+    uint32_t dropped;
+    uint32_t coalesced;
+    uint32_t failed; //QoS1 not acknowledged after retries, requeued.
+} publish_queue_stats_t;
+
+void publish_queue_init(void);
+
+//topic must be static, payload is copied. With latest_only a queued message
+//of same topic is overwritten instead of adding another (state topics).
+IoT_Error_t publish_queue_push(const char* topic, const void* payload, size_t payload_len,
+    QoS qos, publish_priority_t priority, bool latest_only);
+
+//Sends while client is connected and in-flight window has room. Call from
+//main loop before yield.
+IoT_Error_t publish_queue_drain(AWS_IoT_Client* client);
+
+void publish_queue_get_stats(publish_queue_stats_t* stats);
+
+#endif /* PUBLISH_QUEUE_H_ */
@@ -25,6 +25,7 @@ typedef struct {
     unsigned int length; //without null character if added.
     unsigned int null_added; //1 if added extra by generator.
     const char* mime_type;
+    const char* sha256; //hex digest of file content, without null character.
 } rofs_file_info_t;
 
 //Returns 0 on success, -1 on file not found.
@@ -0,0 +1,44 @@
+/*
+
+Copyright 2019-2020 Ravikiran Bukkasagara <contact@ravikiranb.com>
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#ifndef SENSOR_STATS_H_
+#define SENSOR_STATS_H_
+
+#include <stdint.h>
+
+//Running min, max, mean and count of a sensor signal over a window, kept in
+//sensor units so any sensor can use it.
+
+typedef struct {
+    int16_t min;
+    int16_t max;
+    int32_t sum;
+    uint16_t count; //stops at UINT16_MAX, further samples are not added.
+} sensor_stats_t;
+
+void sensor_stats_reset(sensor_stats_t* stats);
+
+void sensor_stats_add(sensor_stats_t* stats, int16_t value);
+
+//Adds samples of src to dst, e.g. windows that were not published.
+void sensor_stats_merge(sensor_stats_t* dst, const sensor_stats_t* src);
+
+//Rounded to nearest, 0 when there are no samples.
+int16_t sensor_stats_mean(const sensor_stats_t* stats);
+
+#endif /* SENSOR_STATS_H_ */
@@ -29,4 +29,9 @@ limitations under the License.
 #define AT_RESP_SHORT_TIMEOUT_MS 3000
 #define AT_RESP_LONG_TIMEOUT_MS 90000
 
+//Modem directory holding "<certname>.sha" files, the content hash of each downloaded certificate.
+#define CERT_HASH_DIR "E:/"
+//RAM bounce buffer used to stream certificates from flash to modem.
+#define CERT_STREAM_CHUNK_SIZE 256
+
 #endif /* SIM7600_CONFIG_H_ */
@@ -59,6 +59,7 @@ enum GPRS_ERROR_CODES {
     GPRS_ERROR_HTTP_DOWNLOAD_FAILED,
     GPRS_ERROR_HTTP_READFILE_FAILED,
     GPRS_ERROR_SSL_SERVICE_STOP_FAILED,
+    GPRS_ERROR_WOULD_BLOCK,
 
     //Error codes from SIMCOM SSL APIs
     GPRS_ERROR_SSL_BASE = -500,
@@ -133,15 +134,29 @@ typedef enum {
     NETWORK_MODE_HYBRID_CDMA_eHRPD,
 } gprs_network_mode_t;
 
+// One buffer of a gather send, buffers go out back to back as one stream.
+typedef struct {
+    const unsigned char* buf;
+    int len;
+} gprs_segment_t;
+
 //SIMCOM(SC) NON-SSL TCP GPRS APIs
 int gprs_init(int do_power_cycle, int disable_quicksend, int no_internet);
 int gprs_connect(const char* domain_name_or_ip, int port, int timeout_ms);
 int gprs_send(int conn_id, const unsigned char* buf, int buf_len, int timeout_ms);
+int gprs_sendv(int conn_id, const gprs_segment_t* segments, int n_segments, int timeout_ms);
 int gprs_recv(int conn_id, unsigned char* buf, int buf_len, int timeout_ms);
 int gprs_recv_poll(int conn_id, int timeout_ms);
+// Returns GPRS_ERROR_WOULD_BLOCK at once if modem has not reported any data for link.
+int gprs_recv_nonblock(int conn_id, unsigned char* buf, int buf_len);
+// Sleeps until modem reports data or close on any link or ssl session, or
+// timeout. Returns 1 on event, 0 on timeout. Call only between commands.
+int gprs_wait_event(int timeout_ms);
 int gprs_close(int conn_id);
 int gprs_get_my_ip(char* ipv4, int ipv4_buf_len, char* ipv6, int ipv6_buf_len);
 int gprs_get_network_mode(gprs_network_mode_t* mode);
+// Numeric MCC and MNC of registered operator, e.g. "40445". Empty if not registered.
+int gprs_get_operator(char* plmn, int plmn_buf_len);
 //int gprs_get_send_status(int conn_id, int *tx_len, int *ack_len, int *nack_len);
 int gsm_get_signal_quality(int* rssi, int* ber);
 
@@ -207,15 +222,18 @@ int gprs_ssl_config_context(int ssl_ctx_id, const gprs_ssl_context_t* ssl_ctx);
 //ssl_ctx_id is different than ssl_session_id.
 int gprs_ssl_connect(int ssl_ctx_id, const char* domain_name_or_ip, int port, int timeout_ms);
 int gprs_ssl_send(int ssl_session_id, const unsigned char* buf, int buf_len, int timeout_ms);
+int gprs_ssl_sendv(int ssl_session_id, const gprs_segment_t* segments, int n_segments, int timeout_ms);
 int gprs_ssl_recv_poll(int ssl_sessions[], int n_sessions, int timeout_ms);
 int gprs_ssl_recv(int ssl_session_id, unsigned char* buf, int buf_len, int timeout_ms);
 int gprs_ssl_close(int ssl_session_id);
 int gprs_ssl_stop(void);
 int gprs_ssl_cert_download(const char* ro_fs_path);
 int gprs_ssl_cert_is_present(const char* ro_fs_path);
+int gprs_ssl_cert_is_current(const char* ro_fs_path);
 int gprs_ssl_cert_delete(const char* ro_fs_path);
 
 //SIMCOM AT Commands that do not need SIM or Internet.
 int simcom_fs_readfile(const char* path, int offset, unsigned char* buf, int buf_len);
+int simcom_fs_writefile(const char* path, const unsigned char* buf, int buf_len);
 
 #endif /* SIM7600_GPRS_H_ */
@@ -40,6 +40,7 @@ typedef enum {
     AT_RESP_CIPCLOSE,
     AT_RESP_CIPRXGET,
     AT_RESP_CNSMOD,
+    AT_RESP_COPS,
     AT_RESP_CSQ,
     AT_RESP_CIPACK,
     AT_RESP_CCERTLIST,
@@ -0,0 +1,84 @@
+/*
+
+Copyright 2019-2020 Ravikiran Bukkasagara <contact@ravikiranb.com>
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#ifndef TELEMETRY_BATCH_H_
+#define TELEMETRY_BATCH_H_
+
+#include <stdint.h>
+
+#include "aws_iot_mqtt_client_interface.h"
+#include "publish_queue.h"
+#include "sensor_stats.h"
+
+//Collects sensor samples into one binary payload and hands it to publish queue
+//when TELEMETRY_BATCH_MAX_SAMPLES are collected, when oldest sample is
+//TELEMETRY_BATCH_MAX_AGE_SEC old, or at once for a high priority sample. One
+//publish, TLS record and AT send then carries many samples.
+//
+//Payload, multi byte fields big endian:
+//  u8  format, TELEMETRY_FORMAT_FIXED, TELEMETRY_FORMAT_DELTA or TELEMETRY_FORMAT_STATS
+//  u8  sample count
+//  u32 timestamp of first sample, unix seconds
+//TELEMETRY_FORMAT_FIXED, per sample:
+//  u16 seconds since first sample, i16 temperature in degrees C
+//TELEMETRY_FORMAT_DELTA, per sample, zigzag encoded LEB128 varints:
+//  delta of delta of timestamp, first delta counts from 0
+//  delta of temperature from previous sample, first from 0
+//Samples taken at steady interval and slowly changing temperature then take
+//2 bytes each.
+//TELEMETRY_FORMAT_STATS, per window summary, varints as above, values in
+//0.25 C units, timestamp is end of window:
+//  delta of delta of timestamp, first delta counts from 0
+//  delta of mean from previous mean, first from 0
+//  mean - min, max - mean, sample count, not zigzag encoded
+//A batch holds one kind of sample, adding other kind queues it first.
+//scripts/telemetry/main.py decodes all formats.
+//
+//While client is disconnected, or queue does not take a batch, it is
+//appended to telemetry log in flash and replayed later, see telemetry_log.h.
+
+#define TELEMETRY_FORMAT_FIXED 1
+#define TELEMETRY_FORMAT_DELTA 2
+#define TELEMETRY_FORMAT_STATS 3
+
+typedef struct {
+    uint32_t samples;
+    uint32_t batches;
+    uint32_t payload_bytes; //of all batches queued or logged.
+    uint32_t logged; //batches appended to flash log.
+    uint32_t dropped; //samples lost because neither publish queue nor log took them.
+} telemetry_batch_stats_t;
+
+//topic must be static.
+void telemetry_batch_init(AWS_IoT_Client* client, const char* topic, QoS qos);
+
+IoT_Error_t telemetry_batch_add(uint32_t timestamp, int16_t temperature, publish_priority_t priority);
+
+//Summary of a window of samples, timestamp is end of window. Empty summary is
+//not added.
+IoT_Error_t telemetry_batch_add_stats(uint32_t timestamp, const sensor_stats_t* sample, publish_priority_t priority);
+
+//Queues or logs collected samples now, e.g. before disconnect.
+IoT_Error_t telemetry_batch_flush(void);
+
+//Call from main loop, flushes batch that got too old.
+void telemetry_batch_poll(void);
+
+void telemetry_batch_get_stats(telemetry_batch_stats_t* stats);
+
+#endif /* TELEMETRY_BATCH_H_ */
@@ -0,0 +1,80 @@
+/*
+
+Copyright 2019-2020 Ravikiran Bukkasagara <contact@ravikiranb.com>
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#ifndef TELEMETRY_LOG_H_
+#define TELEMETRY_LOG_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "aws_iot_mqtt_client_interface.h"
+
+//Append only log of unsent telemetry batches in flash pages from
+//TELEMETRY_LOG_FLASH_START up to bootloader, kept over reset and power loss.
+//Batches that cannot be queued while connection is down are appended here and
+//replayed as QoS1 publishes once connected, one every
+//TELEMETRY_LOG_REPLAY_INTERVAL_MS with at most TELEMETRY_LOG_REPLAY_WINDOW
+//waiting for PUBACK.
+//
+//Pages are written in turn as a ring, each is erased only when writing comes
+//back around to it, which spreads erases evenly. The page after the one being
+//written is kept erased ahead of time by telemetry_log_prepare, so a full log
+//drops the unsent batches of its oldest page one page early.
+//
+//A page erase halts the CPU for about 85 ms. Modem UARTE receives into 1 byte
+//EasyDMA blocks advanced from its interrupt and has no flow control, so every
+//byte arriving meanwhile lands on the same slot and the AT/TLS stream is
+//corrupted. Appends therefore never erase, only telemetry_log_prepare does.
+//
+//Page: u32 sequence number, u32 magic, then records. Record, 32 bit words:
+//  length, low half bytes of payload, high half its complement
+//  payload, padded to words
+//  CRC32 of payload, still erased if cut short. Payload with all ones CRC is taken as torn
+//  sent mark, left erased when written, programmed to 0 on PUBACK
+//Writes go word by word from first to last so a record cut short by power loss
+//fails CRC check, it is skipped and appending continues after it. Flash bits
+//only go from 1 to 0, so a length word cut short never passes complement check.
+
+typedef struct {
+    uint32_t appended;
+    uint32_t replayed; //acknowledged by broker.
+    uint32_t dropped; //unsent batches erased with oldest page, or refused by broker.
+    uint32_t torn; //records found incomplete after power loss.
+    uint32_t pending; //in log, not yet acknowledged.
+} telemetry_log_stats_t;
+
+//Finds write position and oldest unsent record. topic must be static.
+void telemetry_log_init(const char* topic);
+
+//Erases next page if not done yet. Halts CPU, call only while modem is quiescent:
+//no AT command in progress and no connection open.
+void telemetry_log_prepare(void);
+
+//LIMIT_EXCEEDED_ERROR when current page is full and next one not erased yet.
+IoT_Error_t telemetry_log_append(const void* payload, size_t payload_len);
+
+//Sends unsent records while client is connected, rate limit and window allow.
+//Call from main loop.
+IoT_Error_t telemetry_log_replay(AWS_IoT_Client* client);
+
+//Time to next replay publish if waiting only on rate limit, else max_ms.
+uint32_t telemetry_log_get_next_deadline_ms(uint32_t max_ms);
+
+void telemetry_log_get_stats(telemetry_log_stats_t* stats);
+
+#endif /* TELEMETRY_LOG_H_ */
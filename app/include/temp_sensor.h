@@ -19,7 +19,24 @@ limitations under the License.
 #ifndef TEMPERATURE_SENSOR_H_
 #define TEMPERATURE_SENSOR_H_
 
+#include <stdbool.h>
+#include <stdint.h>
+
 void temps_init(void);
+
+//One measurement in C, waits for conversion. Not to be used while sampling.
 int temps_read(void);
 
+//Periodic sampling: RTC1 compare 1 starts TEMP through PPI every interval_ms
+//and DATARDY interrupt puts result in a ring of TEMPERATURE_SAMPLE_RING_LENGTH,
+//CPU neither starts nor waits for conversions. First measurement starts now.
+void temps_start_sampling(uint32_t interval_ms);
+void temps_stop_sampling(void);
+
+//Oldest sample not read yet in 0.25 C units, false when ring is empty.
+bool temps_get_sample(int16_t* quarter_celsius);
+
+//Samples lost because ring was full.
+uint32_t temps_get_overruns(void);
+
 #endif //TEMPERATURE_SENSOR_H_
@@ -0,0 +1,34 @@
+/*
+
+Copyright 2019-2020 Ravikiran Bukkasagara <contact@ravikiranb.com>
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+    
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#ifndef TLS_BENCHMARK_H_
+#define TLS_BENCHMARK_H_
+
+#include "aws_iot_mqtt_client_interface.h"
+
+#define TLS_BENCHMARK_ROUNDS 3
+#define TLS_BENCHMARK_MESSAGES 10
+#define TLS_BENCHMARK_PAYLOAD_LEN 256
+
+// For each linked TLS transport: time TLS handshake, time QoS1 publishes
+// to topic and report heap held while connected. Results are printed.
+// Only available when both transports are linked (IOT_TLS_MULTI_TRANSPORT).
+int tls_benchmark_run(IoT_Client_Init_Params* init_params, IoT_Client_Connect_Params* connect_params,
+    const char* topic);
+
+#endif //TLS_BENCHMARK_H_
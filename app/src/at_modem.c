@@ -25,12 +25,15 @@ limitations under the License.
 #define UART_RX_BUFFER_SIZE 1800
 #define UART_RX_DMA_BLOCK_SIZE 1 // 1 = this will generate two interrupts per byte.
 #define LINE_DELIMIT "\r\n"
+// EasyDMA reads only RAM, data in flash is sent through this buffer.
+#define UART_TX_BOUNCE_BUFFER_SIZE 64
 
 static unsigned char rx_buffer[UART_RX_BUFFER_SIZE];
 static int unread_length = 0;
 static int wr_index = 0;
 static int rd_index = 0;
 static int err_count = 0;
+static unsigned char tx_bounce_buffer[UART_TX_BOUNCE_BUFFER_SIZE];
 
 static nrfx_uarte_t uarte_modem = NRFX_UARTE_INSTANCE(0);
 static inline void atomic_rmw(int* addr, int m);
@@ -108,7 +111,23 @@ int at_get_raw_data(unsigned char* buf, int buf_len)
 
 int at_send_data(const unsigned char* buf, int buf_len)
 {
-    uarte_tx(uarte_modem.p_reg, buf, buf_len);
+    int sent;
+    int chunk;
+
+    if (nrfx_is_in_ram(buf)) {
+        uarte_tx(uarte_modem.p_reg, buf, buf_len);
+        return buf_len;
+    }
+
+    for (sent = 0; sent < buf_len; sent += chunk) {
+        chunk = buf_len - sent;
+        if (chunk > UART_TX_BOUNCE_BUFFER_SIZE)
+            chunk = UART_TX_BOUNCE_BUFFER_SIZE;
+
+        memcpy(tx_bounce_buffer, &buf[sent], chunk);
+        uarte_tx(uarte_modem.p_reg, tx_bounce_buffer, chunk);
+    }
+
     return buf_len;
 }
 
@@ -30,19 +30,33 @@ limitations under the License.
 #include "aws_iot_log.h"
 #include "aws_iot_mqtt_client_interface.h"
 #include "aws_iot_version.h"
+#include "keepalive_tuner.h"
 #include "temp_sensor.h"
 
 #include "sim7600_gprs.h"
 
 #include "ota_update.h"
+#include "publish_policy.h"
+#include "publish_queue.h"
+#include "sensor_stats.h"
+#include "telemetry_batch.h"
+#include "telemetry_log.h"
 #include "version.h"
 
+#ifdef IOT_TLS_MULTI_TRANSPORT
+#include "tls_benchmark.h"
+#endif
+
 #define MQTT_TOPIC_EVENTS "test/events"
 #define MQTT_TOPIC_OTA_UPDATE "test/ota_update"
 
-#define TEMPERATURE_PUBLISH_INTERVAL_SECONDS (2 * 60)
+// Window means are in 0.25 C units.
+static const publish_policy_config_t temperature_policy_config = {
+    .deadband = TEMPERATURE_DEADBAND_C * 4,
+    .min_interval_sec = TEMPERATURE_MIN_REPORT_SEC,
+    .max_interval_sec = TEMPERATURE_HEARTBEAT_SEC,
+};
 
-static char msg_payload[100];
 
 static int fw_update_pending = 0;
 
@@ -78,6 +92,8 @@ void disconnectCallbackHandler(AWS_IoT_Client* pClient, void* data)
 
     IOT_UNUSED(data);
 
+    keepalive_tuner_on_disconnect(pClient);
+
     if (aws_iot_is_autoreconnect_enabled(pClient)) {
         IOT_INFO("Auto Reconnect is enabled, Reconnecting attempt will start now");
     } else {
@@ -99,9 +115,11 @@ int aws_iot_app(void)
     IoT_Client_Init_Params mqttInitParams = iotClientInitParamsDefault;
     IoT_Client_Connect_Params connectParams = iotClientConnectParamsDefault;
 
-    IoT_Publish_Message_Params paramsQOS;
-
     Timer temp_measure_timer;
+    publish_policy_t temperature_policy;
+    sensor_stats_t temperature_window;
+    sensor_stats_t temperature_unpublished;
+    int16_t sample;
 
     IOT_INFO("\r\nApplication Version: %lu\r\n", APP_VERSION);
     IOT_INFO("Amazon Web Services IoT Core with");
@@ -130,13 +148,26 @@ int aws_iot_app(void)
         return rc;
     }
 
-    connectParams.keepAliveIntervalInSec = 300;
-    connectParams.isCleanSession = true;
-    connectParams.MQTTVersion = MQTT_3_1_1;
+    keepalive_tuner_init(&client);
+
+    // Upper bound, pings are sent after idle time found by keepalive tuner.
+    connectParams.keepAliveIntervalInSec = IOT_KEEPALIVE_MAX_SEC;
+    connectParams.isCleanSession = !IOT_MQTT_PERSISTENT_SESSION;
+    connectParams.MQTTVersion = IOT_MQTT5_ENABLED ? MQTT_5 : MQTT_3_1_1;
     connectParams.pClientID = AWS_IOT_MQTT_CLIENT_ID;
     connectParams.clientIDLen = (uint16_t)strlen(AWS_IOT_MQTT_CLIENT_ID);
     connectParams.isWillMsgPresent = false;
 
+#ifdef IOT_TLS_MULTI_TRANSPORT
+    if (IOT_TLS_BENCHMARK_ENABLED) {
+        tls_benchmark_run(&mqttInitParams, &connectParams, MQTT_TOPIC_EVENTS);
+    }
+#endif
+
+    // Before connecting, no connection open yet so spare page erase loses no modem bytes.
+    telemetry_log_init(MQTT_TOPIC_EVENTS);
+    telemetry_log_prepare();
+
     IOT_INFO("Connecting...");
     rc = aws_iot_mqtt_connect(&client, &connectParams);
     if (SUCCESS != rc) {
@@ -165,27 +196,94 @@ int aws_iot_app(void)
         return rc;
     }
 
-    paramsQOS.qos = QOS0;
-    paramsQOS.payload = (void*)msg_payload;
-    paramsQOS.isRetained = 0;
+    publish_queue_init();
+    telemetry_batch_init(&client, MQTT_TOPIC_EVENTS, QOS0);
 
     IOT_INFO("Publishing...");
 
+    publish_policy_init(&temperature_policy, &temperature_policy_config);
+    sensor_stats_reset(&temperature_window);
+    sensor_stats_reset(&temperature_unpublished);
+    temps_start_sampling(TEMPERATURE_SAMPLE_INTERVAL_MS);
     init_timer(&temp_measure_timer);
+    countdown_sec(&temp_measure_timer, TEMPERATURE_WINDOW_SEC);
 
     do {
+        // Measurements are started by RTC through PPI, results wait in sample ring.
+        while (temps_get_sample(&sample))
+            sensor_stats_add(&temperature_window, sample);
+
         if (has_timer_expired(&temp_measure_timer)) {
             unsigned long timestamp;
+            int16_t mean;
+            publish_policy_result_t result;
+            publish_queue_stats_t queue_stats;
+            telemetry_batch_stats_t batch_stats;
+            telemetry_log_stats_t log_stats;
 
             gsm_get_time(&timestamp);
-            sprintf(msg_payload, "Temperature: %d C\r\nTimestamp: %lu", temps_read(), timestamp);
-            paramsQOS.payloadLen = strlen(msg_payload);
-            IOT_INFO("Publishing: %s", msg_payload);
-            rc = aws_iot_mqtt_publish(&client, MQTT_TOPIC_EVENTS, strlen(MQTT_TOPIC_EVENTS), &paramsQOS);
-            countdown_sec(&temp_measure_timer, TEMPERATURE_PUBLISH_INTERVAL_SECONDS);
+            countdown_sec(&temp_measure_timer, TEMPERATURE_WINDOW_SEC);
+
+            // Windows held back by publish policy are folded into next published summary.
+            mean = sensor_stats_mean(&temperature_window);
+            sensor_stats_merge(&temperature_unpublished, &temperature_window);
+            result = (temperature_window.count == 0)
+                ? PUBLISH_POLICY_SKIP
+                : publish_policy_check(&temperature_policy, (uint32_t)timestamp, mean);
+            IOT_DEBUG("Temperature window: mean %d, min %d, max %d (0.25 C), %u samples",
+                mean, temperature_window.min, temperature_window.max, temperature_window.count);
+            sensor_stats_reset(&temperature_window);
+
+            if (PUBLISH_POLICY_SKIP != result) {
+                IOT_INFO("Temperature: %d C over %u samples at %lu",
+                    sensor_stats_mean(&temperature_unpublished) / 4, temperature_unpublished.count, timestamp);
+                if (SUCCESS != telemetry_batch_add_stats((uint32_t)timestamp, &temperature_unpublished,
+                        (PUBLISH_POLICY_CHANGE == result) ? PUBLISH_PRIORITY_NORMAL : PUBLISH_PRIORITY_LOW)) {
+                    IOT_WARN("Telemetry batch dropped");
+                }
+                sensor_stats_reset(&temperature_unpublished);
+            }
+            IOT_DEBUG("Temperature windows: %lu, changes: %lu, heartbeats: %lu, sample overruns: %lu",
+                (unsigned long)temperature_policy.stats.samples, (unsigned long)temperature_policy.stats.changes,
+                (unsigned long)temperature_policy.stats.heartbeats, (unsigned long)temps_get_overruns());
+            publish_queue_get_stats(&queue_stats);
+            IOT_DEBUG("Publish queue depth: %u, inflight: %u, sent: %lu, dropped: %lu",
+                queue_stats.depth, queue_stats.inflight, (unsigned long)queue_stats.sent, (unsigned long)queue_stats.dropped);
+            telemetry_batch_get_stats(&batch_stats);
+            IOT_DEBUG("Telemetry samples: %lu, batches: %lu, payload bytes: %lu, logged: %lu, dropped: %lu",
+                (unsigned long)batch_stats.samples, (unsigned long)batch_stats.batches,
+                (unsigned long)batch_stats.payload_bytes, (unsigned long)batch_stats.logged,
+                (unsigned long)batch_stats.dropped);
+            telemetry_log_get_stats(&log_stats);
+            IOT_DEBUG("Telemetry log pending: %lu, replayed: %lu, dropped: %lu",
+                (unsigned long)log_stats.pending, (unsigned long)log_stats.replayed, (unsigned long)log_stats.dropped);
         } else {
+            // Erase halts CPU, only while connection is down and modem idle between attempts.
+            if (!aws_iot_mqtt_is_client_connected(&client))
+                telemetry_log_prepare();
+
+            telemetry_batch_poll();
+
+            // Send what is queued, failures are retried on next pass.
+            if (SUCCESS != publish_queue_drain(&client)) {
+                IOT_DEBUG("Publish queue drain stopped");
+            }
+
+            // Batches logged while offline, paced behind live traffic.
+            if (SUCCESS != telemetry_log_replay(&client)) {
+                IOT_DEBUG("Telemetry log replay stopped");
+            }
+
+#if IOT_EVENT_DRIVEN_YIELD
+            // Sleep until modem has data, or keepalive, resend, replay or next sample is due.
+            gprs_wait_event(aws_iot_mqtt_get_next_deadline_ms(&client,
+                telemetry_log_get_next_deadline_ms(left_ms(&temp_measure_timer))));
+            rc = aws_iot_mqtt_yield(&client, IOT_EVENT_YIELD_MS);
+#else
             // Wait for all the messages to be received
             rc = aws_iot_mqtt_yield(&client, 1000);
+#endif
+            keepalive_tuner_update(&client);
         }
 
         if (fw_update_pending) {
@@ -194,6 +292,8 @@ int aws_iot_app(void)
 
     } while ((NETWORK_ATTEMPTING_RECONNECT == rc || NETWORK_RECONNECTED == rc || SUCCESS == rc));
 
+    temps_stop_sampling();
+
     IOT_ERROR("Closing connection. Last error= %d\r\n", rc);
 
     aws_iot_mqtt_disconnect(&client);
@@ -32,13 +32,24 @@ limitations under the License.
 #include "aws_iot_version.h"
 
 #include "jwt.h"
+#include "jwt_manager.h"
+#include "keepalive_tuner.h"
 #include "ota_update.h"
+#include "publish_policy.h"
+#include "publish_queue.h"
+#include "sensor_stats.h"
 #include "rofs.h"
 #include "sim7600_gprs.h"
+#include "telemetry_batch.h"
+#include "telemetry_log.h"
 #include "temp_sensor.h"
 #include "timer_interface.h"
 #include "version.h"
 
+#ifdef IOT_TLS_MULTI_TRANSPORT
+#include "tls_benchmark.h"
+#endif
+
 #define MQTT_EVENT_TOPIC_NAME "/devices/my-device/events"
 #define MQTT_STATE_TOPIC_NAME "/devices/my-device/state"
 #define MQTT_CONFIG_TOPIC_NAME "/devices/my-device/config"
@@ -46,9 +57,19 @@ limitations under the License.
 
 #define GCP_IOT_MQTT_CLIENT_ID "projects/" GCP_PROJECT_ID "/locations/" GCP_IOT_LOCATION "/registries/" GCP_IOT_REGISTRY_NAME "/devices/" GCP_IOT_DEVICE_ID
 
-#define TEMPERATURE_PUBLISH_INTERVAL_SECONDS (2 * 60)
+// Window means are in 0.25 C units.
+static const publish_policy_config_t temperature_policy_config = {
+    .deadband = TEMPERATURE_DEADBAND_C * 4,
+    .min_interval_sec = TEMPERATURE_MIN_REPORT_SEC,
+    .max_interval_sec = TEMPERATURE_HEARTBEAT_SEC,
+};
+
+// Longest measurable JWT signing time.
+#define JWT_TIMER_MS (60 * 60 * 1000)
+
+// Signing time does not depend on claim values.
+#define JWT_BENCHMARK_CLAIMS "{ \"aud\": \"" GCP_PROJECT_ID "\", \"iat\": 1600000000, \"exp\": 1600086400 }"
 
-static char msg_payload[100];
 
 static int fw_update_pending = 0;
 
@@ -83,6 +104,28 @@ void iot_subscribe_config_callback_handler(AWS_IoT_Client* pClient, char* topicN
     }
 }
 
+// Points MQTT client at current token, reconnects use client copy of connect params.
+static IoT_Error_t jwt_update_connect_params(AWS_IoT_Client* pClient, IoT_Client_Connect_Params* connectParams)
+{
+    int ret;
+    cstring_t jwt;
+    size_t jwt_len;
+
+    ret = jwt_manager_get(&jwt, &jwt_len);
+    if (ret < 0) {
+        IOT_ERROR("jwt_manager_get returned error : %d", ret);
+        return FAILURE;
+    }
+
+    connectParams->pPassword = (char*)jwt;
+    connectParams->passwordLen = (uint16_t)jwt_len;
+
+    if (pClient == NULL)
+        return SUCCESS;
+
+    return aws_iot_mqtt_set_connect_params(pClient, connectParams);
+}
+
 void disconnectCallbackHandler(AWS_IoT_Client* pClient, void* data)
 {
     IOT_WARN("MQTT Disconnect");
@@ -92,7 +135,13 @@ void disconnectCallbackHandler(AWS_IoT_Client* pClient, void* data)
         return;
     }
 
-    IOT_UNUSED(data);
+    // Token may have expired, GCP drops connection at JWT expiry.
+    rc = jwt_update_connect_params(pClient, (IoT_Client_Connect_Params*)data);
+    if (SUCCESS != rc) {
+        IOT_WARN("Reconnecting with old JWT - %d", rc);
+    }
+
+    keepalive_tuner_on_disconnect(pClient);
 
     if (aws_iot_is_autoreconnect_enabled(pClient)) {
         IOT_INFO("Auto Reconnect is enabled, Reconnecting attempt will start now");
@@ -107,21 +156,71 @@ void disconnectCallbackHandler(AWS_IoT_Client* pClient, void* data)
     }
 }
 
-static const char* prepare_jwt_claims(void)
+static const char* jwt_alg_name(jwt_alg_t alg)
+{
+    return (alg == JWT_ALG_ES256) ? "ES256" : "RS256";
+}
+
+static int jwt_sign_timed(cstring_t claims, string_t jwt, size_t jwt_size, size_t* jwt_len, uint32_t* sign_ms)
 {
-    static char claims[128];
     int ret;
-    unsigned long now_seconds;
-    ret = gsm_get_time(&now_seconds);
+    Timer timer;
+
+    init_timer(&timer);
+    countdown_ms(&timer, JWT_TIMER_MS);
+
+    ret = jwt_create_token(claims, jwt, jwt_size, jwt_len);
+
+    *sign_ms = JWT_TIMER_MS - left_ms(&timer);
+    return ret;
+}
+
+static void jwt_benchmark_key(const char* key_path, cstring_t claims)
+{
+    int ret;
+    int i;
+    const unsigned char* key;
+    const rofs_file_info_t* keyinfo;
+    static char jwt[JWT_TOKEN_MAX_LEN];
+    size_t jwt_len;
+    uint32_t sign_ms;
+    uint32_t total_ms = 0;
+
+    if (key_path[0] == 0)
+        return;
+
+    ret = rofs_readfile(key_path, &key, &keyinfo);
     if (ret < 0) {
-        IOT_ERROR("gsm_get_time returned error : %d ", ret);
-        return NULL;
+        IOT_ERROR("JWT benchmark: %s not found", key_path);
+        return;
+    }
+
+    ret = jwt_pk_init(key, keyinfo->length + keyinfo->null_added);
+    if (ret) {
+        IOT_ERROR("JWT benchmark: jwt_pk_init(%s) returned error : %d", key_path, ret);
+        return;
     }
 
-    sprintf(claims, "{ \"aud\": \"%s\", \"iat\": %lu, \"exp\": %lu }",
-        GCP_PROJECT_ID, now_seconds, now_seconds + 86400);
+    for (i = 0; i < GCP_IOT_JWT_BENCHMARK_ITERATIONS; i++) {
+        ret = jwt_sign_timed(claims, jwt, sizeof(jwt), &jwt_len, &sign_ms);
+        if (ret) {
+            IOT_ERROR("JWT benchmark: %s signing returned error : %d", jwt_alg_name(jwt_get_alg()), ret);
+            return;
+        }
+        total_ms += sign_ms;
+    }
 
-    return &claims[0];
+    IOT_INFO("JWT benchmark: %s %lu ms/token (%d tokens, %u bytes)", jwt_alg_name(jwt_get_alg()),
+        (unsigned long)(total_ms / GCP_IOT_JWT_BENCHMARK_ITERATIONS), GCP_IOT_JWT_BENCHMARK_ITERATIONS, (unsigned int)jwt_len);
+}
+
+//Compares RS256 (software) and ES256 (CC310) signing. Device key must be initialised again afterwards.
+static void jwt_benchmark_run(void)
+{
+    cstring_t claims = JWT_BENCHMARK_CLAIMS;
+
+    jwt_benchmark_key(GCP_IOT_JWT_BENCHMARK_RSA_KEY_FILENAME, claims);
+    jwt_benchmark_key(GCP_IOT_JWT_BENCHMARK_EC_KEY_FILENAME, claims);
 }
 
 int gcp_iot_app(void)
@@ -130,18 +229,21 @@ int gcp_iot_app(void)
 
     AWS_IoT_Client client;
     IoT_Client_Init_Params mqttInitParams = iotClientInitParamsDefault;
-    IoT_Client_Connect_Params connectParams = iotClientConnectParamsDefault;
-    IoT_Publish_Message_Params paramsQOS;
+    // static, reconnects read it from disconnect handler.
+    static IoT_Client_Connect_Params connectParams;
 
     Timer temp_measure_timer;
+    publish_policy_t temperature_policy;
+    sensor_stats_t temperature_window;
+    sensor_stats_t temperature_unpublished;
+    int16_t sample;
 
     const unsigned char* device_key;
     const rofs_file_info_t* device_keyinfo;
-    string_t jwt;
-    size_t jwt_len;
-    cstring_t jwt_claims;
-    unsigned long jwt_calc_duration_start;
-    unsigned long jwt_calc_duration_end;
+    Timer jwt_timer;
+    uint32_t jwt_sign_ms;
+
+    connectParams = iotClientConnectParamsDefault;
 
     IOT_INFO("\r\nApplication Version: %lu\r\n", APP_VERSION);
     IOT_INFO("Google Cloud IoT Core with");
@@ -153,10 +255,12 @@ int gcp_iot_app(void)
     mqttInitParams.pHostURL = GCP_IOT_MQTT_HOST;
     mqttInitParams.port = GCP_IOT_MQTT_PORT;
 
-    //Setting RootCA to NULL will skip server verification.
+    //Setting RootCA to NULL will skip chain validation.
     //For ECC keys + Google mqtt LTS server, both mbedTLS and SIM7600 SSL APIs
     //fail in handshake stage when server verification is enabled. - TODO
-    //To try out GCP set RootCA to NULL.
+    //To try out GCP set RootCA to NULL. With mbedTLS, server is still
+    //authenticated when IOT_TLS_PINNED_SPKI_SHA256 in aws_iot_config.h is
+    //the key of its leaf certificate or of the intermediate that signed it.
     mqttInitParams.pRootCALocation = NULL; //GCP_IOT_ROOT_CA_FILENAME;
     mqttInitParams.pDeviceCertLocation = NULL;
     mqttInitParams.pDevicePrivateKeyLocation = NULL;
@@ -165,7 +269,7 @@ int gcp_iot_app(void)
     mqttInitParams.mqttPacketTimeout_ms = 30000;
     mqttInitParams.isSSLHostnameVerify = true;
     mqttInitParams.disconnectHandler = disconnectCallbackHandler;
-    mqttInitParams.disconnectHandlerData = NULL;
+    mqttInitParams.disconnectHandlerData = &connectParams;
 
     rc = aws_iot_mqtt_init(&client, &mqttInitParams);
     if (SUCCESS != rc) {
@@ -173,6 +277,8 @@ int gcp_iot_app(void)
         return rc;
     }
 
+    keepalive_tuner_init(&client);
+
     //Init JWT
     rc = jwt_init();
     if (SUCCESS != rc) {
@@ -180,6 +286,10 @@ int gcp_iot_app(void)
         return rc;
     }
 
+    if (GCP_IOT_JWT_BENCHMARK_ENABLED) {
+        jwt_benchmark_run();
+    }
+
     rc = rofs_readfile(GCP_IOT_DEVICE_PRIVATE_KEY_FILENAME, &device_key, &device_keyinfo);
     if (rc < 0) {
         IOT_ERROR("rofs_readfile returned error : %d\r\n", rc);
@@ -192,37 +302,46 @@ int gcp_iot_app(void)
         return rc;
     }
 
-    gsm_get_time(&jwt_calc_duration_start);
-
-    jwt_claims = prepare_jwt_claims();
-    if (jwt_claims == NULL) {
-        IOT_ERROR("prepare_jwt_claims failed\r\n");
-        return -1;
+    rc = jwt_manager_init(GCP_PROJECT_ID, GCP_IOT_JWT_LIFETIME_SECONDS, GCP_IOT_JWT_REFRESH_MARGIN_SECONDS);
+    if (SUCCESS != rc) {
+        IOT_ERROR("jwt_manager_init returned error : %d\r\n", rc);
+        return rc;
     }
 
-    IOT_INFO("Generating JWT for claims: %s\r\n", jwt_claims);
+    IOT_INFO("Generating %s JWT\r\n", jwt_alg_name(jwt_get_alg()));
 
-    rc = jwt_create_RS256_token(jwt_claims, &jwt, &jwt_len);
+    init_timer(&jwt_timer);
+    countdown_ms(&jwt_timer, JWT_TIMER_MS);
+
+    rc = jwt_update_connect_params(NULL, &connectParams);
     if (SUCCESS != rc) {
-        IOT_ERROR("jwt_create_RS256_token returned error : %d\r\n", rc);
         return rc;
     }
 
-    gsm_get_time(&jwt_calc_duration_end);
+    jwt_sign_ms = JWT_TIMER_MS - left_ms(&jwt_timer);
 
-    IOT_DEBUG("JWT Generated: %lu\n%s\n", jwt_len, jwt);
-    IOT_INFO("JWT computation time : %lu seconds\r\n", jwt_calc_duration_end - jwt_calc_duration_start);
+    IOT_DEBUG("JWT Generated: %u\n%.*s\n", connectParams.passwordLen, connectParams.passwordLen, connectParams.pPassword);
+    IOT_INFO("JWT computation time : %lu ms\r\n", (unsigned long)jwt_sign_ms);
 
-    connectParams.keepAliveIntervalInSec = 300;
-    connectParams.isCleanSession = true;
-    connectParams.MQTTVersion = MQTT_3_1_1;
+    // Upper bound, pings are sent after idle time found by keepalive tuner.
+    connectParams.keepAliveIntervalInSec = IOT_KEEPALIVE_MAX_SEC;
+    connectParams.isCleanSession = !IOT_MQTT_PERSISTENT_SESSION;
+    connectParams.MQTTVersion = IOT_MQTT5_ENABLED ? MQTT_5 : MQTT_3_1_1;
     connectParams.pClientID = GCP_IOT_MQTT_CLIENT_ID;
     connectParams.clientIDLen = (uint16_t)strlen(GCP_IOT_MQTT_CLIENT_ID);
     connectParams.isWillMsgPresent = false;
     connectParams.pUsername = "ignore";
     connectParams.usernameLen = strlen(connectParams.pUsername);
-    connectParams.pPassword = jwt;
-    connectParams.passwordLen = jwt_len;
+
+#ifdef IOT_TLS_MULTI_TRANSPORT
+    if (IOT_TLS_BENCHMARK_ENABLED) {
+        tls_benchmark_run(&mqttInitParams, &connectParams, MQTT_EVENT_TOPIC_NAME);
+    }
+#endif
+
+    // Before connecting, no connection open yet so spare page erase loses no modem bytes.
+    telemetry_log_init(MQTT_STATE_TOPIC_NAME);
+    telemetry_log_prepare();
 
     IOT_INFO("Connecting...");
     rc = aws_iot_mqtt_connect(&client, &connectParams);
@@ -235,50 +354,121 @@ int gcp_iot_app(void)
 	 *  #AWS_IOT_MQTT_MIN_RECONNECT_WAIT_INTERVAL
 	 *  #AWS_IOT_MQTT_MAX_RECONNECT_WAIT_INTERVAL
 	 */
-    // JWT needs to be re-generated when reconnecting.
+    // JWT is refreshed in idle time below and checked again in disconnect handler.
     rc = aws_iot_mqtt_autoreconnect_set_status(&client, true);
     if (SUCCESS != rc) {
         IOT_ERROR("Unable to set Auto Reconnect to true - %d", rc);
         return rc;
     }
 
-    IOT_INFO("Subscribing to topic: %s\n", MQTT_CONFIG_TOPIC_NAME);
-    rc = aws_iot_mqtt_subscribe(&client, MQTT_CONFIG_TOPIC_NAME, strlen(MQTT_CONFIG_TOPIC_NAME), QOS1, iot_subscribe_config_callback_handler, NULL);
-    if (SUCCESS != rc) {
-        IOT_ERROR("Error subscribing : %d ", rc);
-        return rc;
-    }
+    IoT_Subscribe_Params subscriptions[] = {
+        {MQTT_CONFIG_TOPIC_NAME, strlen(MQTT_CONFIG_TOPIC_NAME), QOS1, iot_subscribe_config_callback_handler, NULL, NULL},
+        {MQTT_COMMANDS_TOPIC_NAME, strlen(MQTT_COMMANDS_TOPIC_NAME), QOS1, iot_subscribe_cmd_callback_handler, NULL, NULL},
+    };
 
-    IOT_INFO("Subscribing to topic: %s\n", MQTT_COMMANDS_TOPIC_NAME);
-    rc = aws_iot_mqtt_subscribe(&client, MQTT_COMMANDS_TOPIC_NAME, strlen(MQTT_COMMANDS_TOPIC_NAME), QOS1, iot_subscribe_cmd_callback_handler, NULL);
+    // One SUBSCRIBE and SUBACK for both topics
+    IOT_INFO("Subscribing to topics: %s, %s\n", MQTT_CONFIG_TOPIC_NAME, MQTT_COMMANDS_TOPIC_NAME);
+    rc = aws_iot_mqtt_subscribe_batch(&client, subscriptions, sizeof(subscriptions) / sizeof(subscriptions[0]));
     if (SUCCESS != rc) {
         IOT_ERROR("Error subscribing : %d ", rc);
         return rc;
     }
 
-    paramsQOS.qos = QOS0;
-    paramsQOS.payload = (void*)msg_payload;
-    paramsQOS.isRetained = 0;
+    publish_queue_init();
+    telemetry_batch_init(&client, MQTT_STATE_TOPIC_NAME, QOS0);
 
     //NOTE device state can be updated at the rate of only 1 per second. Exceeding
     //this will cause connection to be dropped. Publish to events topic instead.
     IOT_INFO("Publishing  to topic: %s", MQTT_STATE_TOPIC_NAME);
 
+    publish_policy_init(&temperature_policy, &temperature_policy_config);
+    sensor_stats_reset(&temperature_window);
+    sensor_stats_reset(&temperature_unpublished);
+    temps_start_sampling(TEMPERATURE_SAMPLE_INTERVAL_MS);
     init_timer(&temp_measure_timer);
+    countdown_sec(&temp_measure_timer, TEMPERATURE_WINDOW_SEC);
 
     do {
+        // Measurements are started by RTC through PPI, results wait in sample ring.
+        while (temps_get_sample(&sample))
+            sensor_stats_add(&temperature_window, sample);
+
         if (has_timer_expired(&temp_measure_timer)) {
             unsigned long timestamp;
+            int16_t mean;
+            publish_policy_result_t result;
+            publish_queue_stats_t queue_stats;
+            telemetry_batch_stats_t batch_stats;
+            telemetry_log_stats_t log_stats;
 
             gsm_get_time(&timestamp);
-            sprintf(msg_payload, "Temperature: %d C\r\nTimestamp: %lu", temps_read(), timestamp);
-            paramsQOS.payloadLen = strlen(msg_payload);
-            IOT_INFO("Publishing: %s", msg_payload);
-            rc = aws_iot_mqtt_publish(&client, MQTT_STATE_TOPIC_NAME, strlen(MQTT_STATE_TOPIC_NAME), &paramsQOS);
-            countdown_sec(&temp_measure_timer, TEMPERATURE_PUBLISH_INTERVAL_SECONDS);
+            countdown_sec(&temp_measure_timer, TEMPERATURE_WINDOW_SEC);
+
+            // Windows held back by publish policy are folded into next published summary.
+            mean = sensor_stats_mean(&temperature_window);
+            sensor_stats_merge(&temperature_unpublished, &temperature_window);
+            result = (temperature_window.count == 0)
+                ? PUBLISH_POLICY_SKIP
+                : publish_policy_check(&temperature_policy, (uint32_t)timestamp, mean);
+            IOT_DEBUG("Temperature window: mean %d, min %d, max %d (0.25 C), %u samples",
+                mean, temperature_window.min, temperature_window.max, temperature_window.count);
+            sensor_stats_reset(&temperature_window);
+
+            if (PUBLISH_POLICY_SKIP != result) {
+                IOT_INFO("Temperature: %d C over %u samples at %lu",
+                    sensor_stats_mean(&temperature_unpublished) / 4, temperature_unpublished.count, timestamp);
+                if (SUCCESS != telemetry_batch_add_stats((uint32_t)timestamp, &temperature_unpublished,
+                        (PUBLISH_POLICY_CHANGE == result) ? PUBLISH_PRIORITY_NORMAL : PUBLISH_PRIORITY_LOW)) {
+                    IOT_WARN("Telemetry batch dropped");
+                }
+                sensor_stats_reset(&temperature_unpublished);
+            }
+            IOT_DEBUG("Temperature windows: %lu, changes: %lu, heartbeats: %lu, sample overruns: %lu",
+                (unsigned long)temperature_policy.stats.samples, (unsigned long)temperature_policy.stats.changes,
+                (unsigned long)temperature_policy.stats.heartbeats, (unsigned long)temps_get_overruns());
+            publish_queue_get_stats(&queue_stats);
+            IOT_DEBUG("Publish queue depth: %u, inflight: %u, sent: %lu, dropped: %lu",
+                queue_stats.depth, queue_stats.inflight, (unsigned long)queue_stats.sent, (unsigned long)queue_stats.dropped);
+            telemetry_batch_get_stats(&batch_stats);
+            IOT_DEBUG("Telemetry samples: %lu, batches: %lu, payload bytes: %lu, logged: %lu, dropped: %lu",
+                (unsigned long)batch_stats.samples, (unsigned long)batch_stats.batches,
+                (unsigned long)batch_stats.payload_bytes, (unsigned long)batch_stats.logged,
+                (unsigned long)batch_stats.dropped);
+            telemetry_log_get_stats(&log_stats);
+            IOT_DEBUG("Telemetry log pending: %lu, replayed: %lu, dropped: %lu",
+                (unsigned long)log_stats.pending, (unsigned long)log_stats.replayed, (unsigned long)log_stats.dropped);
         } else {
+            // Re-sign JWT well before expiry while nothing else is pending.
+            if (jwt_manager_refresh() > 0) {
+                jwt_update_connect_params(&client, &connectParams);
+            }
+
+            // Erase halts CPU, only while connection is down and modem idle between attempts.
+            if (!aws_iot_mqtt_is_client_connected(&client))
+                telemetry_log_prepare();
+
+            telemetry_batch_poll();
+
+            // Send what is queued, failures are retried on next pass.
+            if (SUCCESS != publish_queue_drain(&client)) {
+                IOT_DEBUG("Publish queue drain stopped");
+            }
+
+            // Batches logged while offline, paced behind live traffic.
+            if (SUCCESS != telemetry_log_replay(&client)) {
+                IOT_DEBUG("Telemetry log replay stopped");
+            }
+
+#if IOT_EVENT_DRIVEN_YIELD
+            // Sleep until modem has data, or keepalive, resend, replay or next sample is due.
+            gprs_wait_event(aws_iot_mqtt_get_next_deadline_ms(&client,
+                telemetry_log_get_next_deadline_ms(left_ms(&temp_measure_timer))));
+            rc = aws_iot_mqtt_yield(&client, IOT_EVENT_YIELD_MS);
+#else
             // Wait for all the messages to be received
             rc = aws_iot_mqtt_yield(&client, 1000);
+#endif
+            keepalive_tuner_update(&client);
         }
 
         if (fw_update_pending) {
@@ -287,6 +477,8 @@ int gcp_iot_app(void)
 
     } while ((NETWORK_ATTEMPTING_RECONNECT == rc || NETWORK_RECONNECTED == rc || SUCCESS == rc));
 
+    temps_stop_sampling();
+
     IOT_ERROR("Closing connection. Last error = %d\r\n", rc);
 
     aws_iot_mqtt_disconnect(&client);
@@ -18,13 +18,16 @@ limitations under the License.
 
 #include "jwt.h"
 
-#include "mbedtls/base64.h"
 #include "mbedtls/ctr_drbg.h"
 #include "mbedtls/entropy.h"
 #include "mbedtls/md.h"
 #include "mbedtls/pk.h"
+#include "mbedtls/platform_util.h"
 #include "mbedtls/rsa.h"
 
+#include "nrf_crypto_ecc.h"
+#include "nrf_crypto_ecdsa.h"
+#include "nrf_crypto_hash.h"
 #include "nrf_drv_rng.h"
 
 #include "uart_print.h"
@@ -32,26 +35,99 @@ limitations under the License.
 static mbedtls_pk_context pk;
 static mbedtls_entropy_context entropy;
 static mbedtls_ctr_drbg_context ctr_drbg;
-static const string_t rs256_header = "{ \"alg\": \"RS256\", \"typ\": \"JWT\" }";
+
+// base64url of constant JOSE headers, without padding.
+// { "alg": "RS256", "typ": "JWT" }
+static const char rs256_header_segment[] = "eyAiYWxnIjogIlJTMjU2IiwgInR5cCI6ICJKV1QiIH0";
+// { "alg": "ES256", "typ": "JWT" }
+static const char es256_header_segment[] = "eyAiYWxnIjogIkVTMjU2IiwgInR5cCI6ICJKV1QiIH0";
+
+static const char base64url_alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+// Largest RSA key supported for RS256, signature is as long as modulus.
+#define JWT_RSA_MAX_SIGNATURE_LEN 512
+static unsigned char sign_buf[JWT_RSA_MAX_SIGNATURE_LEN];
+
+// ES256 signs on CC310, key is moved out of mbedtls pk context once parsed.
+static jwt_alg_t jwt_alg = JWT_ALG_NONE;
+static nrf_crypto_ecc_private_key_t ec_key;
+static nrf_crypto_hash_context_t hash_ctx;
+static nrf_crypto_ecdsa_secp256r1_sign_context_t sign_ctx;
 
 static int entropy_simple_src(void* data, unsigned char* output, size_t len, size_t* olen);
-static int base64_to_url(string_t base64);
 
-static int base64_to_url(string_t base64)
+// Unpadded base64url, written at out[0..]. Returns encoded length or -1 if out_size is short.
+static int base64url_encode(const unsigned char* in, size_t in_len, char* out, size_t out_size)
 {
-    int i;
-    for (i = 0; base64[i] != 0; i++) {
-        if (base64[i] == '+')
-            base64[i] = '-';
-        if (base64[i] == '/')
-            base64[i] = '_';
-        if (base64[i] == '=') {
-            base64[i] = 0;
-            break;
-        }
+    size_t i;
+    size_t o = 0;
+    unsigned long v;
+
+    if (out_size < (in_len * 4 + 2) / 3)
+        return -1;
+
+    for (i = 0; i + 2 < in_len; i += 3) {
+        v = ((unsigned long)in[i] << 16) | ((unsigned long)in[i + 1] << 8) | in[i + 2];
+        out[o++] = base64url_alphabet[(v >> 18) & 0x3f];
+        out[o++] = base64url_alphabet[(v >> 12) & 0x3f];
+        out[o++] = base64url_alphabet[(v >> 6) & 0x3f];
+        out[o++] = base64url_alphabet[v & 0x3f];
     }
 
-    return i;
+    if (i < in_len) {
+        v = (unsigned long)in[i] << 16;
+        if (i + 1 < in_len)
+            v |= (unsigned long)in[i + 1] << 8;
+
+        out[o++] = base64url_alphabet[(v >> 18) & 0x3f];
+        out[o++] = base64url_alphabet[(v >> 12) & 0x3f];
+        if (i + 1 < in_len)
+            out[o++] = base64url_alphabet[(v >> 6) & 0x3f];
+    }
+
+    return (int)o;
+}
+
+// Writes "<header>.<payload>" into token. Returns length or -1.
+static int jwt_encode_signing_input(const char* header_segment, size_t header_len,
+    cstring_t payload, string_t token, size_t token_size)
+{
+    int len;
+
+    if (header_len + 1 > token_size)
+        return -1;
+
+    memcpy(token, header_segment, header_len);
+    token[header_len] = '.';
+
+    len = base64url_encode((const unsigned char*)payload, strlen(payload),
+        &token[header_len + 1], token_size - header_len - 1);
+    if (len < 0)
+        return -1;
+
+    return (int)header_len + 1 + len;
+}
+
+// Appends ".<signature>" and null character. Returns total token length or -1.
+static int jwt_append_signature(string_t token, size_t token_size, size_t rlen,
+    const unsigned char* sig, size_t sig_len)
+{
+    int len;
+
+    // '.' and null character.
+    if (rlen + 2 > token_size)
+        return -1;
+
+    token[rlen++] = '.';
+
+    len = base64url_encode(sig, sig_len, &token[rlen], token_size - rlen - 1);
+    if (len < 0)
+        return -1;
+
+    rlen += len;
+    token[rlen] = 0;
+
+    return (int)rlen;
 }
 
 static int entropy_rng_src(void* data, unsigned char* output, size_t len, size_t* olen)
@@ -88,9 +164,17 @@ int jwt_init(void)
     return ret;
 }
 
+//Selects ES256 for P-256 EC keys and RS256 for RSA keys.
 int jwt_pk_init(const unsigned char* key, size_t keylen)
 {
     int ret;
+    mbedtls_ecp_keypair* ec;
+    unsigned char raw[NRF_CRYPTO_ECC_SECP256R1_RAW_PRIVATE_KEY_SIZE];
+
+    if (jwt_alg == JWT_ALG_ES256)
+        nrf_crypto_ecc_private_key_free(&ec_key);
+    mbedtls_pk_free(&pk);
+    jwt_alg = JWT_ALG_NONE;
 
     mbedtls_pk_init(&pk);
 
@@ -100,59 +184,90 @@ int jwt_pk_init(const unsigned char* key, size_t keylen)
         NULL,
         0);
 
-    return ret;
-}
+    if (ret)
+        return ret;
 
-int jwt_create_RS256_token(cstring_t payload, string_t* otoken, size_t* token_len)
-{
-    int ret;
+    switch (mbedtls_pk_get_type(&pk)) {
+    case MBEDTLS_PK_RSA:
+        jwt_alg = JWT_ALG_RS256;
+        return 0;
 
-    size_t tlen = 512; //token max length
-    string_t token = (string_t)malloc(tlen);
-    size_t rlen = 0; // running length
-    size_t len; // current length
-    const mbedtls_md_info_t* md_info;
-    unsigned char hash[32];
-    unsigned char* sign_buf;
+    case MBEDTLS_PK_ECKEY:
+        ec = mbedtls_pk_ec(pk);
+        if (ec->grp.id != MBEDTLS_ECP_DP_SECP256R1) {
+            dbg_printf(DEBUG_LEVEL_ERROR, "ES256 needs P-256 key, curve: %d\r\n", ec->grp.id);
+            ret = -1;
+            break;
+        }
+
+        ret = mbedtls_mpi_write_binary(&ec->d, raw, sizeof(raw));
+        if (ret)
+            break;
+
+        ret = nrf_crypto_ecc_private_key_from_raw(&g_nrf_crypto_ecc_secp256r1_curve_info,
+            &ec_key,
+            raw,
+            sizeof(raw));
+        mbedtls_platform_zeroize(raw, sizeof(raw));
+
+        if (ret) {
+            dbg_printf(DEBUG_LEVEL_ERROR, "nrf_crypto_ecc_private_key_from_raw: %d\r\n", ret);
+            break;
+        }
 
-    if (payload == NULL) {
+        jwt_alg = JWT_ALG_ES256;
+        break;
+
+    default:
         ret = -1;
-        goto err0;
+        break;
     }
 
-    ret = mbedtls_base64_encode((unsigned char*)token,
-        tlen,
-        &len,
-        (const unsigned char*)rs256_header,
-        strlen((string_t)rs256_header));
+    // private key now lives in CC310 format only, or parse failed.
+    mbedtls_pk_free(&pk);
+    return ret;
+}
 
-    if (ret) {
-        dbg_printf(DEBUG_LEVEL_ERROR, "mbedtls_base64_encode: %d\r\n", ret);
-        goto err0;
-    }
+jwt_alg_t jwt_get_alg(void)
+{
+    return jwt_alg;
+}
 
-    token[rlen + len] = 0;
-    // This may change length.
-    len = base64_to_url(token);
-    rlen += len;
+int jwt_create_token(cstring_t payload, string_t token, size_t token_size, size_t* token_len)
+{
+    switch (jwt_alg) {
+    case JWT_ALG_RS256:
+        return jwt_create_RS256_token(payload, token, token_size, token_len);
+    case JWT_ALG_ES256:
+        return jwt_create_ES256_token(payload, token, token_size, token_len);
+    default:
+        return -1;
+    }
+}
 
-    token[rlen] = '.';
-    rlen++;
+int jwt_create_RS256_token(cstring_t payload, string_t token, size_t token_size, size_t* token_len)
+{
+    int ret;
+    int rlen; // running length
+    size_t len;
+    const mbedtls_md_info_t* md_info;
+    unsigned char hash[32];
 
-    ret = mbedtls_base64_encode((unsigned char*)&token[rlen],
-        tlen - rlen,
-        &len,
-        (const unsigned char*)payload,
-        strlen((string_t)payload));
+    if ((payload == NULL) || (token == NULL) || (jwt_alg != JWT_ALG_RS256))
+        return -1;
 
-    if (ret) {
-        dbg_printf(DEBUG_LEVEL_ERROR, "mbedtls_base64_encode: %d\r\n", ret);
-        goto err0;
+    // mbedtls_pk_sign does not take output size.
+    if (mbedtls_pk_get_len(&pk) > sizeof(sign_buf)) {
+        dbg_printf(DEBUG_LEVEL_ERROR, "RSA key too long: %u\r\n", (unsigned int)mbedtls_pk_get_len(&pk));
+        return -1;
     }
 
-    token[rlen + len] = 0;
-    len = base64_to_url(&token[rlen]);
-    rlen += len;
+    rlen = jwt_encode_signing_input(rs256_header_segment, sizeof(rs256_header_segment) - 1,
+        payload, token, token_size);
+    if (rlen < 0) {
+        dbg_printf(DEBUG_LEVEL_ERROR, "JWT buffer too short: %u\r\n", (unsigned int)token_size);
+        return -1;
+    }
 
     md_info = mbedtls_md_info_from_type(MBEDTLS_MD_SHA256);
 
@@ -163,48 +278,79 @@ int jwt_create_RS256_token(cstring_t payload, string_t* otoken, size_t* token_le
 
     if (ret) {
         dbg_printf(DEBUG_LEVEL_ERROR, "mbedtls_md: %d\r\n", ret);
-        goto err0;
+        return ret;
     }
 
-    sign_buf = malloc(MBEDTLS_MPI_MAX_SIZE);
-
     ret = mbedtls_pk_sign(&pk, MBEDTLS_MD_SHA256,
         hash, 0, sign_buf, &len,
         mbedtls_ctr_drbg_random, &ctr_drbg);
 
     if (ret) {
         dbg_printf(DEBUG_LEVEL_ERROR, "mbedtls_pk_sign: %d\r\n", ret);
-        goto err1;
+        return ret;
     }
 
-    token[rlen] = '.';
-    rlen++;
+    rlen = jwt_append_signature(token, token_size, rlen, sign_buf, len);
+    if (rlen < 0) {
+        dbg_printf(DEBUG_LEVEL_ERROR, "JWT buffer too short: %u\r\n", (unsigned int)token_size);
+        return -1;
+    }
 
-    ret = mbedtls_base64_encode((unsigned char*)&token[rlen],
-        tlen - rlen,
-        &len,
-        (const unsigned char*)sign_buf,
-        len);
+    *token_len = rlen;
+    return 0;
+}
+
+int jwt_create_ES256_token(cstring_t payload, string_t token, size_t token_size, size_t* token_len)
+{
+    int ret;
+    int rlen; // running length
+    nrf_crypto_hash_sha256_digest_t hash;
+    size_t hash_len = sizeof(hash);
+    nrf_crypto_ecdsa_secp256r1_signature_t signature;
+    size_t sign_len = sizeof(signature);
+
+    if ((payload == NULL) || (token == NULL) || (jwt_alg != JWT_ALG_ES256))
+        return -1;
+
+    rlen = jwt_encode_signing_input(es256_header_segment, sizeof(es256_header_segment) - 1,
+        payload, token, token_size);
+    if (rlen < 0) {
+        dbg_printf(DEBUG_LEVEL_ERROR, "JWT buffer too short: %u\r\n", (unsigned int)token_size);
+        return -1;
+    }
+
+    // token is in RAM, CC310 cannot read flash.
+    ret = nrf_crypto_hash_calculate(&hash_ctx,
+        &g_nrf_crypto_hash_sha256_info,
+        (const uint8_t*)token,
+        rlen,
+        hash,
+        &hash_len);
 
     if (ret) {
-        dbg_printf(DEBUG_LEVEL_ERROR, "mbedtls_base64_encode: %d\r\n", ret);
-        goto err1;
+        dbg_printf(DEBUG_LEVEL_ERROR, "nrf_crypto_hash_calculate: %d\r\n", ret);
+        return ret;
     }
 
-    token[rlen + len] = 0;
-    len = base64_to_url(&token[rlen]);
-    rlen += len;
+    // JWS ES256 signature is raw R || S, which is what CC310 backend returns.
+    ret = nrf_crypto_ecdsa_sign(&sign_ctx,
+        &ec_key,
+        hash,
+        hash_len,
+        signature,
+        &sign_len);
 
-    free(sign_buf);
-    // callers frees token
-    *otoken = token;
-    *token_len = rlen;
-    return ret;
+    if (ret) {
+        dbg_printf(DEBUG_LEVEL_ERROR, "nrf_crypto_ecdsa_sign: %d\r\n", ret);
+        return ret;
+    }
 
-err1:
-    free(sign_buf);
+    rlen = jwt_append_signature(token, token_size, rlen, signature, sign_len);
+    if (rlen < 0) {
+        dbg_printf(DEBUG_LEVEL_ERROR, "JWT buffer too short: %u\r\n", (unsigned int)token_size);
+        return -1;
+    }
 
-err0:
-    free(token);
-    return ret;
+    *token_len = rlen;
+    return 0;
 }
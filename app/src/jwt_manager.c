@@ -0,0 +1,130 @@
+/*
+
+Copyright 2019-2020 Ravikiran Bukkasagara <contact@ravikiranb.com>
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include "jwt_manager.h"
+
+#include "sim7600_gprs.h"
+#include "timer_interface.h"
+#include "uart_print.h"
+
+// RTC timers wrap in few hours, expiry is tracked in modem wall clock time
+// which is read at most once per interval. Must be less than refresh margin.
+#define JWT_CLOCK_CHECK_INTERVAL_SEC 60
+
+static cstring_t jwt_audience;
+static unsigned long jwt_lifetime_sec;
+static unsigned long jwt_refresh_margin_sec;
+
+// New token is signed into the slot not handed out, client may still point at current one.
+static char jwt_slots[2][JWT_TOKEN_MAX_LEN];
+static int jwt_slot;
+static string_t jwt_token;
+static size_t jwt_token_len;
+static unsigned long jwt_exp;
+static Timer clock_check_timer;
+
+static char claims[128];
+
+int jwt_manager_init(cstring_t audience, unsigned long lifetime_sec, unsigned long refresh_margin_sec)
+{
+    if ((audience == NULL) || (refresh_margin_sec <= JWT_CLOCK_CHECK_INTERVAL_SEC) || (refresh_margin_sec >= lifetime_sec))
+        return -1;
+
+    jwt_audience = audience;
+    jwt_lifetime_sec = lifetime_sec;
+    jwt_refresh_margin_sec = refresh_margin_sec;
+
+    jwt_token = NULL;
+    jwt_token_len = 0;
+    jwt_exp = 0;
+
+    init_timer(&clock_check_timer);
+
+    return 0;
+}
+
+static int jwt_sign(unsigned long now_seconds)
+{
+    int ret;
+    int slot = jwt_slot ^ 1;
+    size_t token_len;
+
+    ret = snprintf(claims, sizeof(claims), "{ \"aud\": \"%s\", \"iat\": %lu, \"exp\": %lu }",
+        jwt_audience, now_seconds, now_seconds + jwt_lifetime_sec);
+    if ((ret < 0) || (ret >= (int)sizeof(claims)))
+        return -1;
+
+    ret = jwt_create_token(claims, jwt_slots[slot], sizeof(jwt_slots[slot]), &token_len);
+    if (ret) {
+        dbg_printf(DEBUG_LEVEL_ERROR, "jwt_create_token: %d\r\n", ret);
+        return ret;
+    }
+
+    jwt_slot = slot;
+    jwt_token = jwt_slots[slot];
+    jwt_token_len = token_len;
+    jwt_exp = now_seconds + jwt_lifetime_sec;
+
+    dbg_printf(DEBUG_LEVEL_INFO, "JWT signed, expires at %lu\r\n", jwt_exp);
+
+    return 1;
+}
+
+// Reads wall clock and re-signs if token is missing or within refresh margin.
+static int jwt_check_and_sign(void)
+{
+    int ret;
+    unsigned long now_seconds;
+
+    ret = gsm_get_time(&now_seconds);
+    if (ret < 0)
+        return ret;
+
+    countdown_sec(&clock_check_timer, JWT_CLOCK_CHECK_INTERVAL_SEC);
+
+    if ((jwt_token != NULL) && (now_seconds + jwt_refresh_margin_sec < jwt_exp))
+        return 0;
+
+    return jwt_sign(now_seconds);
+}
+
+int jwt_manager_get(cstring_t* token, size_t* token_len)
+{
+    int ret;
+
+    // Token had more than refresh margin left at last clock check, less than
+    // check interval ago, so it is still valid without asking modem.
+    if ((jwt_token == NULL) || has_timer_expired(&clock_check_timer)) {
+        ret = jwt_check_and_sign();
+        if (ret < 0)
+            return ret;
+    }
+
+    *token = jwt_token;
+    *token_len = jwt_token_len;
+
+    return 0;
+}
+
+int jwt_manager_refresh(void)
+{
+    if ((jwt_token != NULL) && !has_timer_expired(&clock_check_timer))
+        return 0;
+
+    return jwt_check_and_sign();
+}
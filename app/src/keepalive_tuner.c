@@ -0,0 +1,202 @@
+/*
+
+Copyright 2019-2020 Ravikiran Bukkasagara <contact@ravikiranb.com>
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include "keepalive_tuner.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "aws_iot_config.h"
+#include "aws_iot_log.h"
+#include "sim7600_gprs.h"
+
+#define KEEPALIVE_FILE_MAGIC 0x4B415431 // "KAT1"
+#define PLMN_BUF_SIZE 8
+#define FILEPATH_BUF_SIZE 24
+
+typedef struct {
+    uint32_t magic;
+    uint16_t interval;
+    uint8_t settled;
+    uint8_t reserved;
+} keepalive_file_t;
+
+static char filepath[FILEPATH_BUF_SIZE];
+static uint16_t interval;
+static uint16_t good_interval; //0 until a ping was answered.
+static bool settled; //probing stopped.
+static uint8_t confirmed; //answered pings at current interval.
+static uint8_t losses; //pings lost one after another at current interval.
+static uint16_t settled_pings; //answered pings since probing stopped.
+static uint32_t last_response_count;
+
+static void save(void)
+{
+    keepalive_file_t file;
+    int ret;
+
+    if (filepath[0] == '\0')
+        return;
+
+    file.magic = KEEPALIVE_FILE_MAGIC;
+    file.interval = interval;
+    file.settled = settled;
+    file.reserved = 0;
+
+    ret = simcom_fs_writefile(filepath, (const unsigned char*)&file, sizeof(file));
+    if (ret < 0) {
+        IOT_WARN("Keepalive save failed: %d", ret);
+    }
+}
+
+static void load(void)
+{
+    keepalive_file_t file;
+    int ret;
+
+    if (filepath[0] == '\0')
+        return;
+
+    ret = simcom_fs_readfile(filepath, 0, (unsigned char*)&file, sizeof(file));
+    if ((ret != sizeof(file)) || (file.magic != KEEPALIVE_FILE_MAGIC))
+        return;
+
+    if ((file.interval < IOT_KEEPALIVE_MIN_SEC) || (file.interval > IOT_KEEPALIVE_MAX_SEC))
+        return;
+
+    interval = file.interval;
+    good_interval = file.interval;
+    settled = (file.settled != 0);
+}
+
+static void apply(AWS_IoT_Client* client)
+{
+    confirmed = 0;
+    losses = 0;
+    aws_iot_mqtt_set_ping_interval(client, interval);
+}
+
+static void settle(void)
+{
+    settled = true;
+    settled_pings = 0;
+    save();
+}
+
+static void probe_longer(AWS_IoT_Client* client)
+{
+    interval += IOT_KEEPALIVE_STEP_SEC;
+    if (interval > IOT_KEEPALIVE_MAX_SEC)
+        interval = IOT_KEEPALIVE_MAX_SEC;
+
+    IOT_INFO("Keepalive probing %u s", interval);
+    apply(client);
+}
+
+void keepalive_tuner_init(AWS_IoT_Client* client)
+{
+    char plmn[PLMN_BUF_SIZE];
+
+    interval = IOT_KEEPALIVE_MIN_SEC;
+    good_interval = 0;
+    settled = false;
+    settled_pings = 0;
+    filepath[0] = '\0';
+
+    if ((gprs_get_operator(plmn, sizeof(plmn)) == GPRS_OK) && (plmn[0] != '\0')) {
+        snprintf(filepath, sizeof(filepath), "E:/ka_%s.bin", plmn);
+        load();
+    }
+
+    last_response_count = aws_iot_mqtt_get_ping_response_count(client);
+    apply(client);
+
+    IOT_INFO("Keepalive idle time %u s%s, network %s", interval, settled ? "" : " (probing)",
+        filepath[0] ? filepath : "unknown");
+}
+
+void keepalive_tuner_update(AWS_IoT_Client* client)
+{
+    uint32_t count = aws_iot_mqtt_get_ping_response_count(client);
+
+    if (count == last_response_count)
+        return;
+
+    // Ping goes out only after interval without traffic, so an answer means
+    // NAT kept connection through that much idle time.
+    last_response_count = count;
+    losses = 0;
+    if (good_interval != interval) {
+        good_interval = interval;
+        save();
+    }
+
+    if (interval >= IOT_KEEPALIVE_MAX_SEC) {
+        if (!settled)
+            settle();
+        return;
+    }
+
+    // Outages can settle below NAT timeout too, a longer idle time is tried
+    // again once in a while.
+    if (settled) {
+        if (++settled_pings < IOT_KEEPALIVE_REPROBE_PINGS)
+            return;
+        settled = false;
+        save();
+    } else if (++confirmed < IOT_KEEPALIVE_PROBE_CONFIRM) {
+        return;
+    }
+
+    probe_longer(client);
+}
+
+void keepalive_tuner_on_disconnect(AWS_IoT_Client* client)
+{
+    // Other disconnect reasons say nothing about NAT timeout.
+    if (!client->clientStatus.isPingOutstanding)
+        return;
+
+    if (!settled && (good_interval != 0) && (good_interval < interval)) {
+        // Probe was too long, stay at last one that worked.
+        interval = good_interval;
+    } else if (interval > IOT_KEEPALIVE_MIN_SEC) {
+        // Coverage loss or modem stall with a ping in flight looks the same,
+        // only repeated losses mean NAT timeout got shorter.
+        if (++losses < IOT_KEEPALIVE_LOSS_CONFIRM) {
+            IOT_WARN("Ping lost at %u s idle time, %u of %u", interval, losses, IOT_KEEPALIVE_LOSS_CONFIRM);
+            return;
+        }
+        interval -= IOT_KEEPALIVE_STEP_SEC;
+        if (interval < IOT_KEEPALIVE_MIN_SEC)
+            interval = IOT_KEEPALIVE_MIN_SEC;
+        good_interval = 0;
+    } else {
+        return;
+    }
+
+    IOT_WARN("Ping lost, keepalive idle time now %u s", interval);
+    settle();
+    apply(client);
+}
+
+uint16_t keepalive_tuner_get_interval(void)
+{
+    return interval;
+}
@@ -0,0 +1,67 @@
+/*
+
+Copyright 2019-2020 Ravikiran Bukkasagara <contact@ravikiranb.com>
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include "publish_policy.h"
+
+#include <string.h>
+
+void publish_policy_init(publish_policy_t* policy, const publish_policy_config_t* config)
+{
+    memset(policy, 0, sizeof(*policy));
+    policy->config = config;
+}
+
+void publish_policy_force(publish_policy_t* policy)
+{
+    policy->published = false;
+}
+
+publish_policy_result_t publish_policy_check(publish_policy_t* policy, uint32_t timestamp, int32_t value)
+{
+    const publish_policy_config_t* config = policy->config;
+    publish_policy_result_t result = PUBLISH_POLICY_SKIP;
+    uint32_t elapsed = timestamp - policy->last_time;
+    int32_t change = value - policy->last_value;
+
+    policy->stats.samples++;
+
+    if (change < 0)
+        change = -change;
+
+    if (!policy->published)
+        result = PUBLISH_POLICY_CHANGE;
+    else if ((change >= config->deadband) && (change > 0) && (elapsed >= config->min_interval_sec))
+        result = PUBLISH_POLICY_CHANGE;
+    // Clock set backwards counts as heartbeat due.
+    else if ((timestamp < policy->last_time) || (elapsed >= config->max_interval_sec))
+        result = PUBLISH_POLICY_HEARTBEAT;
+
+    if (result == PUBLISH_POLICY_SKIP)
+        return result;
+
+    if (result == PUBLISH_POLICY_CHANGE)
+        policy->stats.changes++;
+    else
+        policy->stats.heartbeats++;
+
+    policy->published = true;
+    policy->last_value = value;
+    policy->last_time = timestamp;
+
+    return result;
+}
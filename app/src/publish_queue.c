@@ -0,0 +1,240 @@
+/*
+
+Copyright 2019-2020 Ravikiran Bukkasagara <contact@ravikiranb.com>
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include "publish_queue.h"
+
+#include <string.h>
+
+#include "aws_iot_config.h"
+#include "aws_iot_log.h"
+
+typedef enum {
+    ENTRY_FREE,
+    ENTRY_QUEUED,
+    ENTRY_INFLIGHT,
+} entry_state_t;
+
+typedef struct {
+    entry_state_t state;
+    uint32_t seq;
+    const char* topic;
+    QoS qos;
+    publish_priority_t priority;
+    bool latest_only;
+    size_t payload_len;
+    unsigned char payload[PUBLISH_QUEUE_PAYLOAD_MAX];
+} queue_entry_t;
+
+static queue_entry_t entries[PUBLISH_QUEUE_LENGTH];
+static uint32_t next_seq;
+static publish_queue_stats_t stats;
+
+void publish_queue_init(void)
+{
+    memset(entries, 0, sizeof(entries));
+    memset(&stats, 0, sizeof(stats));
+    next_seq = 0;
+}
+
+static queue_entry_t* find_queued_topic(const char* topic)
+{
+    int i;
+
+    for (i = 0; i < PUBLISH_QUEUE_LENGTH; i++) {
+        if ((entries[i].state == ENTRY_QUEUED) && (strcmp(entries[i].topic, topic) == 0))
+            return &entries[i];
+    }
+
+    return NULL;
+}
+
+// Next to send: highest priority, then oldest.
+static queue_entry_t* find_next(void)
+{
+    int i;
+    queue_entry_t* e = NULL;
+
+    for (i = 0; i < PUBLISH_QUEUE_LENGTH; i++) {
+        if (entries[i].state != ENTRY_QUEUED)
+            continue;
+        if ((e == NULL) || (entries[i].priority > e->priority)
+            || ((entries[i].priority == e->priority) && ((int32_t)(entries[i].seq - e->seq) < 0)))
+            e = &entries[i];
+    }
+
+    return e;
+}
+
+// Eviction candidate: lowest priority, then oldest.
+static queue_entry_t* find_victim(void)
+{
+    int i;
+    queue_entry_t* e = NULL;
+
+    for (i = 0; i < PUBLISH_QUEUE_LENGTH; i++) {
+        if (entries[i].state != ENTRY_QUEUED)
+            continue;
+        if ((e == NULL) || (entries[i].priority < e->priority)
+            || ((entries[i].priority == e->priority) && ((int32_t)(entries[i].seq - e->seq) < 0)))
+            e = &entries[i];
+    }
+
+    return e;
+}
+
+static queue_entry_t* alloc_entry(publish_priority_t priority)
+{
+    int i;
+    queue_entry_t* e;
+
+    for (i = 0; i < PUBLISH_QUEUE_LENGTH; i++) {
+        if (entries[i].state == ENTRY_FREE)
+            return &entries[i];
+    }
+
+    e = find_victim();
+    if ((e == NULL) || (e->priority > priority))
+        return NULL;
+
+    IOT_DEBUG("Publish queue full, dropping message for %s", e->topic);
+    e->state = ENTRY_FREE;
+    stats.depth--;
+    stats.dropped++;
+
+    return e;
+}
+
+IoT_Error_t publish_queue_push(const char* topic, const void* payload, size_t payload_len,
+    QoS qos, publish_priority_t priority, bool latest_only)
+{
+    queue_entry_t* e = NULL;
+
+    if ((topic == NULL) || (payload == NULL))
+        return NULL_VALUE_ERROR;
+
+    if (payload_len > PUBLISH_QUEUE_PAYLOAD_MAX)
+        return MAX_SIZE_ERROR;
+
+    if (latest_only) {
+        e = find_queued_topic(topic);
+        if (e != NULL)
+            stats.coalesced++;
+    }
+
+    if (e == NULL) {
+        e = alloc_entry(priority);
+        if (e == NULL) {
+            stats.dropped++;
+            return LIMIT_EXCEEDED_ERROR;
+        }
+        e->state = ENTRY_QUEUED;
+        e->seq = next_seq++;
+        stats.depth++;
+    }
+
+    e->topic = topic;
+    e->qos = qos;
+    e->priority = priority;
+    e->latest_only = latest_only;
+    e->payload_len = payload_len;
+    memcpy(e->payload, payload, payload_len);
+
+    return SUCCESS;
+}
+
+static void publish_complete(AWS_IoT_Client* pClient, uint16_t packetId, IoT_Error_t rc, void* pData)
+{
+    queue_entry_t* e = (queue_entry_t*)pData;
+
+    IOT_UNUSED(pClient);
+    IOT_UNUSED(packetId);
+
+    stats.inflight--;
+
+    if (SUCCESS == rc) {
+        e->state = ENTRY_FREE;
+        stats.sent++;
+        return;
+    }
+
+    stats.failed++;
+
+    // Broker refused it with a reason code, resending gets the same answer.
+    if (MQTT_REQUEST_REJECTED_ERROR == rc) {
+        e->state = ENTRY_FREE;
+        stats.dropped++;
+        return;
+    }
+
+    // Newer value already waiting, old one is not worth resending.
+    if (e->latest_only && (find_queued_topic(e->topic) != NULL)) {
+        e->state = ENTRY_FREE;
+        stats.dropped++;
+        return;
+    }
+
+    // Back in queue with its original order.
+    e->state = ENTRY_QUEUED;
+    stats.depth++;
+}
+
+IoT_Error_t publish_queue_drain(AWS_IoT_Client* client)
+{
+    IoT_Error_t rc;
+    IoT_Publish_Message_Params params;
+    queue_entry_t* e;
+
+    while ((e = find_next()) != NULL) {
+        if (!aws_iot_mqtt_is_client_connected(client))
+            return SUCCESS;
+
+        params.qos = e->qos;
+        params.isRetained = 0;
+        params.payload = e->payload;
+        params.payloadLen = e->payload_len;
+
+        if (QOS1 == e->qos) {
+            if (aws_iot_mqtt_get_inflight_count(client) >= aws_iot_mqtt_get_inflight_window(client))
+                return SUCCESS;
+
+            rc = aws_iot_mqtt_publish_async(client, e->topic, (uint16_t)strlen(e->topic), &params,
+                publish_complete, e);
+            if (SUCCESS != rc)
+                return rc;
+
+            e->state = ENTRY_INFLIGHT;
+            stats.depth--;
+            stats.inflight++;
+        } else {
+            rc = aws_iot_mqtt_publish(client, e->topic, (uint16_t)strlen(e->topic), &params);
+            if (SUCCESS != rc)
+                return rc;
+
+            e->state = ENTRY_FREE;
+            stats.depth--;
+            stats.sent++;
+        }
+    }
+
+    return SUCCESS;
+}
+
+void publish_queue_get_stats(publish_queue_stats_t* out)
+{
+    *out = stats;
+}
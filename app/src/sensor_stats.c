@@ -0,0 +1,65 @@
+/*
+
+Copyright 2019-2020 Ravikiran Bukkasagara <contact@ravikiranb.com>
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include "sensor_stats.h"
+
+void sensor_stats_reset(sensor_stats_t* stats)
+{
+    stats->min = INT16_MAX;
+    stats->max = INT16_MIN;
+    stats->sum = 0;
+    stats->count = 0;
+}
+
+void sensor_stats_add(sensor_stats_t* stats, int16_t value)
+{
+    if (stats->count == UINT16_MAX)
+        return;
+
+    if (value < stats->min)
+        stats->min = value;
+    if (value > stats->max)
+        stats->max = value;
+    stats->sum += value;
+    stats->count++;
+}
+
+void sensor_stats_merge(sensor_stats_t* dst, const sensor_stats_t* src)
+{
+    if ((src->count == 0) || ((uint32_t)dst->count + src->count > UINT16_MAX))
+        return;
+
+    if (src->min < dst->min)
+        dst->min = src->min;
+    if (src->max > dst->max)
+        dst->max = src->max;
+    dst->sum += src->sum;
+    dst->count += src->count;
+}
+
+int16_t sensor_stats_mean(const sensor_stats_t* stats)
+{
+    int32_t half;
+
+    if (stats->count == 0)
+        return 0;
+
+    half = stats->count / 2;
+
+    return (int16_t)((stats->sum >= 0) ? (stats->sum + half) / stats->count : (stats->sum - half) / stats->count);
+}
@@ -41,6 +41,7 @@ static int cmd_simple(const char* cmd, int timeout_ms);
 static int cmd_variadic(int timeout_ms, const char* cmd, ...);
 static int get_links_state(unsigned int* state);
 static int get_filename(const char* path, const char** name);
+static int parse_line(const char* alternate_token);
 
 extern int caltime_to_unix_ts(char* cal_time, unsigned long* time);
 
@@ -68,6 +69,27 @@ extern int caltime_to_unix_ts(char* cal_time, unsigned long* time);
 static char scratch_pad_buf[SCRATCH_PAD_BUF];
 static int ssl_session_ids[MAX_SSL_SESSIONS];
 
+// sha256 hex digest as stored in modem file system next to each certificate.
+#define CERT_HASH_HEX_LEN 64
+#define CERT_HASH_PATH_LEN 64
+#if CERT_STREAM_CHUNK_SIZE < CERT_HASH_HEX_LEN
+#error "CERT_STREAM_CHUNK_SIZE must hold a certificate hash."
+#endif
+static unsigned char stream_bounce_buf[CERT_STREAM_CHUNK_SIZE];
+
+// Rx state of ip links, tracked from URCs and CIPRXGET responses seen while
+// parsing any command. Lets receive path skip modem queries when idle.
+#define LINK_RX_UNKNOWN -1
+#define URC_DRAIN_MAX_LINES 4
+static int link_rx_pending[MAX_IP_LINKS];
+static unsigned int link_closed_mask;
+// Same for ssl sessions, from CCHRECV length query and data responses.
+static int ssl_rx_pending[MAX_SSL_SESSIONS];
+// Set on any rx or close notification, consumed by gprs_wait_event.
+static int link_event_pending;
+// Enough to get through a burst of URCs and blank lines between them.
+#define WAIT_EVENT_DRAIN_MAX_LINES 16
+
 int gprs_init(int do_power_cycle, int disable_quicksend, int no_internet)
 {
     int ret;
@@ -134,7 +156,7 @@ int gprs_recv_poll(int conn_id, int timeout_ms)
         flags = 0;
 
         do {
-            ret = sim7600_parse_line(NULL);
+            ret = parse_line(NULL);
             if (ret >= 0) {
                 switch (at_response_fields[0].ival) {
                 case AT_RESP_CIPRXGET:
@@ -213,9 +235,12 @@ int gprs_recv(int conn_id, unsigned char* buf, int buf_len, int timeout_ms)
 
     dbg_printf(DEBUG_LEVEL_DEBUG, "Requested bytes to receive: %d\r\n", buf_len);
 
-    ret = gprs_recv_poll(conn_id, timeout_ms);
-    if (ret < 0)
-        return ret;
+    ret = link_rx_pending[conn_id];
+    if (ret <= 0) {
+        ret = gprs_recv_poll(conn_id, timeout_ms);
+        if (ret < 0)
+            return ret;
+    }
 
     dbg_printf(DEBUG_LEVEL_DEBUG, "Available bytes to read: %d\r\n", ret);
 
@@ -245,7 +270,7 @@ int gprs_recv(int conn_id, unsigned char* buf, int buf_len, int timeout_ms)
             return GPRS_ERROR_TIMEOUT;
         }
 
-        ret = sim7600_parse_line(NULL);
+        ret = parse_line(NULL);
         if (ret >= 0) {
             switch (at_response_fields[0].ival) {
             case AT_RESP_CIPRXGET:
@@ -309,7 +334,114 @@ int gprs_recv(int conn_id, unsigned char* buf, int buf_len, int timeout_ms)
     } while (1);
 }
 
+int gprs_recv_nonblock(int conn_id, unsigned char* buf, int buf_len)
+{
+    int i;
+
+    if ((conn_id < 0) || (conn_id >= MAX_IP_LINKS))
+        return GPRS_ERROR_INVALID_PARAMETERS;
+
+    // Pick up URCs received since last command, this never waits.
+    for (i = 0; i < URC_DRAIN_MAX_LINES; i++)
+        parse_line(NULL);
+
+    if (link_closed_mask & (1 << conn_id))
+        return GPRS_ERROR_CONNECTION_CLOSED;
+
+    if (link_rx_pending[conn_id] == 0)
+        return GPRS_ERROR_WOULD_BLOCK;
+
+    return gprs_recv(conn_id, buf, buf_len, AT_RESP_SHORT_TIMEOUT_MS);
+}
+
+static int rx_data_pending(void)
+{
+    int i;
+
+    for (i = 0; i < MAX_IP_LINKS; i++) {
+        if (link_rx_pending[i] > 0)
+            return 1;
+    }
+
+    for (i = 0; i < MAX_SSL_SESSIONS; i++) {
+        if (ssl_rx_pending[i] > 0)
+            return 1;
+    }
+
+    return 0;
+}
+
+int gprs_wait_event(int timeout_ms)
+{
+    Timer timer;
+    int i;
+
+    init_timer(&timer);
+    countdown_ms(&timer, timeout_ms);
+
+    do {
+        // Only URCs can be in buffer here, no command is outstanding.
+        for (i = 0; i < WAIT_EVENT_DRAIN_MAX_LINES; i++)
+            parse_line(NULL);
+
+        if (link_event_pending || rx_data_pending()) {
+            link_event_pending = 0;
+            return 1;
+        }
+
+        if (has_timer_expired(&timer))
+            return 0;
+
+        // Every received uart byte interrupts, so any modem output wakes.
+        timer_wait_event(&timer);
+    } while (1);
+}
+
+// Sends len bytes of segments starting at offset, right after modem prompt.
+static int send_segments_range(const gprs_segment_t* segments, int n_segments, int offset, int len)
+{
+    int i;
+    int n;
+
+    for (i = 0; (i < n_segments) && (len > 0); i++) {
+        if (offset >= segments[i].len) {
+            offset -= segments[i].len;
+            continue;
+        }
+
+        n = segments[i].len - offset;
+        if (n > len)
+            n = len;
+
+        if (at_send_data(&segments[i].buf[offset], n) < 0)
+            return GPRS_ERROR_MODEM_COMM_FAILED;
+
+        len -= n;
+        offset = 0;
+    }
+
+    return GPRS_OK;
+}
+
+static int segments_length(const gprs_segment_t* segments, int n_segments)
+{
+    int i;
+    int len = 0;
+
+    for (i = 0; i < n_segments; i++)
+        len += segments[i].len;
+
+    return len;
+}
+
 int gprs_send(int conn_id, const unsigned char* buf, int buf_len, int timeout_ms)
+{
+    gprs_segment_t segment = { .buf = buf, .len = buf_len };
+
+    return gprs_sendv(conn_id, &segment, 1, timeout_ms);
+}
+
+int gprs_sendv(int conn_id, const gprs_segment_t* segments, int n_segments, int timeout_ms)
 {
 
     int ret;
@@ -320,10 +452,13 @@ int gprs_send(int conn_id, const unsigned char* buf, int buf_len, int timeout_ms
     int pending_bytes = 0;
     const char* prompt = ">";
     int actual_bytes_accepted = 0;
+    int buf_len;
 
     if ((conn_id < 0) || (conn_id >= MAX_IP_LINKS))
         return GPRS_ERROR_INVALID_PARAMETERS;
 
+    buf_len = segments_length(segments, n_segments);
+
     dbg_printf(DEBUG_LEVEL_DEBUG, "Requested bytes to send: %d\r\n", buf_len);
 
     init_timer(&timer);
@@ -352,14 +487,14 @@ int gprs_send(int conn_id, const unsigned char* buf, int buf_len, int timeout_ms
             if (has_timer_expired(&timer))
                 return GPRS_ERROR_TIMEOUT;
 
-            ret = sim7600_parse_line(prompt);
+            ret = parse_line(prompt);
             if (ret >= 0) {
                 switch (at_response_fields[0].ival) {
                 case AT_RESP_LINE_VALUE:
                     if (at_response_fields[1].sval[0] == '>') {
-                        ret = at_send_data(&buf[sent_bytes], chunk_size);
+                        ret = send_segments_range(segments, n_segments, sent_bytes, chunk_size);
                         if (ret < 0)
-                            return GPRS_ERROR_MODEM_COMM_FAILED;
+                            return ret;
                     }
                     break;
                 case AT_RESP_CIPSEND:
@@ -417,7 +552,7 @@ static int get_links_state(unsigned int* state)
         if (has_timer_expired(&timer))
             return GPRS_ERROR_TIMEOUT;
 
-        ret = sim7600_parse_line(NULL);
+        ret = parse_line(NULL);
         if (ret >= 0) {
             switch (at_response_fields[0].ival) {
             case AT_RESP_CIPCLOSE:
@@ -459,6 +594,9 @@ int gprs_close(int conn_id)
 
     init_timer(&timer);
 
+    link_closed_mask |= (1 << conn_id);
+    link_rx_pending[conn_id] = 0;
+
     snprintf(scratch_pad_buf, SCRATCH_PAD_BUF - 1, "AT+CIPCLOSE=%d\r",
         conn_id);
     ret = at_send_cmd(scratch_pad_buf);
@@ -471,7 +609,7 @@ int gprs_close(int conn_id)
         if (has_timer_expired(&timer))
             return GPRS_ERROR_TIMEOUT;
 
-        ret = sim7600_parse_line(NULL);
+        ret = parse_line(NULL);
         if (ret >= 0) {
             switch (at_response_fields[0].ival) {
             case AT_RESP_CIPCLOSE:
@@ -542,7 +680,7 @@ int gprs_http_download(const char* url, const char* filename, int expected_len,
             return GPRS_ERROR_TIMEOUT;
         }
 
-        ret = sim7600_parse_line(NULL);
+        ret = parse_line(NULL);
         if (ret >= 0) {
             switch (at_response_fields[0].ival) {
             case AT_RESP_HTTPACTION:
@@ -612,7 +750,7 @@ int gprs_http_readfile(const char* filename, int timeout_ms)
             return GPRS_ERROR_TIMEOUT;
         }
 
-        ret = sim7600_parse_line(NULL);
+        ret = parse_line(NULL);
         if (ret >= 0) {
             switch (at_response_fields[0].ival) {
             case AT_RESP_HTTPREADFILE:
@@ -666,6 +804,10 @@ int gprs_connect(const char* domain_name_or_ip, int port, int timeout_ms)
         domain_name_or_ip,
         port);
 
+    // Modem reports data arrival with URC once link is open.
+    link_rx_pending[conn_id] = 0;
+    link_closed_mask &= ~(1 << conn_id);
+
     init_timer(&timer);
 
     dbg_printf(DEBUG_LEVEL_DEBUG, "Connecting to: %d) %s\r\n", conn_id, scratch_pad_buf);
@@ -681,7 +823,7 @@ int gprs_connect(const char* domain_name_or_ip, int port, int timeout_ms)
             dbg_printf(DEBUG_LEVEL_DEBUG, "gprs_connect flags: %d\r\n", flags);
             return GPRS_ERROR_TIMEOUT;
         }
-        ret = sim7600_parse_line(NULL);
+        ret = parse_line(NULL);
         if (ret >= 0) {
             switch (at_response_fields[0].ival) {
             case AT_RESP_CIPOPEN:
@@ -739,7 +881,7 @@ int gprs_get_network_mode(gprs_network_mode_t* mode)
         if (has_timer_expired(&timer))
             return GPRS_ERROR_TIMEOUT;
 
-        ret = sim7600_parse_line(NULL);
+        ret = parse_line(NULL);
         if (ret >= 0) {
             switch (at_response_fields[0].ival) {
             case AT_RESP_CNSMOD:
@@ -760,6 +902,66 @@ int gprs_get_network_mode(gprs_network_mode_t* mode)
     } while (1);
 }
 
+int gprs_get_operator(char* plmn, int plmn_buf_len)
+{
+    Timer timer;
+    int ret;
+    int flags = 0;
+    int i, n;
+    const char* s;
+
+    if ((plmn == NULL) || (plmn_buf_len < 1))
+        return GPRS_ERROR_INVALID_PARAMETERS;
+
+    plmn[0] = '\0';
+
+    // Numeric operator format.
+    ret = cmd_simple("AT+COPS=3,2\r", AT_RESP_SHORT_TIMEOUT_MS);
+    if (ret < 0)
+        return ret;
+
+    init_timer(&timer);
+
+    snprintf(scratch_pad_buf, SCRATCH_PAD_BUF, "AT+COPS?\r");
+    ret = at_send_cmd(scratch_pad_buf);
+    if (ret < 0)
+        return GPRS_ERROR_MODEM_COMM_FAILED;
+
+    countdown_ms(&timer, AT_RESP_SHORT_TIMEOUT_MS);
+
+    do {
+        if (has_timer_expired(&timer))
+            return GPRS_ERROR_TIMEOUT;
+
+        ret = parse_line(NULL);
+        if (ret >= 0) {
+            switch (at_response_fields[0].ival) {
+            case AT_RESP_COPS:
+                // Only mode is reported when not registered.
+                if (ret > 2) {
+                    s = at_response_fields[3].sval;
+                    for (i = 0, n = 0; (s[i] != '\0') && (n < plmn_buf_len - 1); i++) {
+                        if ((s[i] >= '0') && (s[i] <= '9'))
+                            plmn[n++] = s[i];
+                    }
+                    plmn[n] = '\0';
+                }
+                flags |= FLAGS_GOT_DATA;
+                break;
+            case AT_RESP_OK:
+                flags |= FLAGS_GOT_OK;
+                break;
+            case AT_RESP_ERR:
+                return GPRS_ERROR_CMD_ERROR;
+            }
+        }
+
+        if (IS_CMD_COMPLETE(flags))
+            return GPRS_OK;
+
+    } while (1);
+}
+
 //CGPADDR returns multiple context addresses but only the first one is stored
 //and total count is returned.
 int gprs_get_my_ip(char* ipv4, int ipv4_buf_len, char* ipv6, int ipv6_buf_len)
@@ -781,7 +983,7 @@ int gprs_get_my_ip(char* ipv4, int ipv4_buf_len, char* ipv6, int ipv6_buf_len)
         if (has_timer_expired(&timer))
             return GPRS_ERROR_TIMEOUT;
 
-        ret = sim7600_parse_line(NULL);
+        ret = parse_line(NULL);
         if (ret >= 0) {
             switch (at_response_fields[0].ival) {
             case AT_RESP_CGPADDR:
@@ -881,7 +1083,7 @@ static int check_cpin(void)
         if (has_timer_expired(&timer))
             return GPRS_ERROR_TIMEOUT;
 
-        ret = sim7600_parse_line(NULL);
+        ret = parse_line(NULL);
         if (ret >= 0) {
             switch (at_response_fields[0].ival) {
             case AT_RESP_CPIN:
@@ -925,7 +1127,7 @@ static int netopen(void)
         if (has_timer_expired(&timer))
             return GPRS_ERROR_TIMEOUT;
 
-        ret = sim7600_parse_line(NULL);
+        ret = parse_line(NULL);
         if (ret >= 0) {
             switch (at_response_fields[0].ival) {
             case AT_RESP_NETOPEN:
@@ -985,7 +1187,7 @@ static int check_creg(int do_gprs_reg)
             if (has_timer_expired(&timer))
                 return GPRS_ERROR_TIMEOUT;
 
-            ret = sim7600_parse_line(NULL);
+            ret = parse_line(NULL);
             if (ret >= 0) {
                 switch (at_response_fields[0].ival) {
                 case AT_RESP_CREG:
@@ -1022,6 +1224,61 @@ static int check_creg(int do_gprs_reg)
     } while (1);
 }
 
+// Every response line goes through here so that link rx state is never missed,
+// whichever command happens to be waiting when URC arrives.
+static int parse_line(const char* alternate_token)
+{
+    int ret;
+    int id;
+
+    ret = sim7600_parse_line(alternate_token);
+    if (ret < 0)
+        return ret;
+
+    switch (at_response_fields[0].ival) {
+    case AT_RESP_CIPRXGET:
+        id = at_response_fields[2].ival;
+        if ((ret < 2) || (id < 0) || (id >= MAX_IP_LINKS))
+            break;
+
+        if ((ret == 2) && (at_response_fields[1].ival == 1)) { // rx event
+            link_rx_pending[id] = LINK_RX_UNKNOWN;
+            link_event_pending = 1;
+        } else if ((ret == 3) && (at_response_fields[1].ival == 4)) { // pending length
+            link_rx_pending[id] = at_response_fields[3].ival;
+        } else if ((ret == 4) && (at_response_fields[1].ival == 2)) { // read, rest length
+            link_rx_pending[id] = at_response_fields[4].ival;
+        }
+        break;
+    case AT_RESP_IPCLOSE:
+        id = at_response_fields[1].ival;
+        if ((ret >= 1) && (id >= 0) && (id < MAX_IP_LINKS))
+            link_closed_mask |= (1 << id);
+        link_event_pending = 1;
+        break;
+    case AT_RESP_CCHRECV:
+        if ((ret == 3) && (strcmp(at_response_fields[1].sval, "LEN") == 0)) {
+            for (id = 0; id < MAX_SSL_SESSIONS; id++)
+                ssl_rx_pending[id] = at_response_fields[2 + id].ival;
+        } else if ((ret == 3) && (strcmp(at_response_fields[1].sval, "DATA") == 0)) {
+            id = at_response_fields[2].ival;
+            if ((id >= 0) && (id < MAX_SSL_SESSIONS) && (ssl_rx_pending[id] > 0)) {
+                ssl_rx_pending[id] -= at_response_fields[3].ival;
+                if (ssl_rx_pending[id] < 0)
+                    ssl_rx_pending[id] = 0;
+            }
+        }
+        break;
+    case AT_RESP_CCHEVENT:
+    case AT_RESP_CCHRECV_CLOSED:
+    case AT_RESP_CCH_PEER_CLOSED:
+        link_event_pending = 1;
+        break;
+    }
+
+    return ret;
+}
+
 static int cmd_simple(const char* cmd, int timeout_ms)
 {
     Timer timer;
@@ -1040,7 +1297,7 @@ static int cmd_simple(const char* cmd, int timeout_ms)
         if (has_timer_expired(&timer))
             return GPRS_ERROR_TIMEOUT;
 
-        ret = sim7600_parse_line(NULL);
+        ret = parse_line(NULL);
         if (ret >= 0) {
             switch (at_response_fields[0].ival) {
             case AT_RESP_OK:
@@ -1076,7 +1333,7 @@ static int cmd_variadic(int timeout_ms, const char* cmd, ...)
         if (has_timer_expired(&timer))
             return GPRS_ERROR_TIMEOUT;
 
-        ret = sim7600_parse_line(NULL);
+        ret = parse_line(NULL);
         if (ret >= 0) {
             switch (at_response_fields[0].ival) {
             case AT_RESP_OK:
@@ -1197,7 +1454,7 @@ int gsm_get_signal_quality(int* rssi, int* ber)
         if (has_timer_expired(&timer))
             return GPRS_ERROR_TIMEOUT;
 
-        ret = sim7600_parse_line(NULL);
+        ret = parse_line(NULL);
         if (ret >= 0) {
             switch (at_response_fields[0].ival) {
             case AT_RESP_CSQ:
@@ -1240,7 +1497,7 @@ static int sslstart(void)
         if (has_timer_expired(&timer))
             return GPRS_ERROR_TIMEOUT;
 
-        ret = sim7600_parse_line(NULL);
+        ret = parse_line(NULL);
         if (ret >= 0) {
             switch (at_response_fields[0].ival) {
             case AT_RESP_CCHSTART:
@@ -1323,7 +1580,7 @@ int gprs_ssl_config_context(int ssl_ctx_id, const gprs_ssl_context_t* ssl_ctx)
     if (ssl_ctx->cacert) {
         const char* name;
 
-        ret = gprs_ssl_cert_is_present(ssl_ctx->cacert);
+        ret = gprs_ssl_cert_is_current(ssl_ctx->cacert);
         if (ret < 0)
             return ret;
 
@@ -1347,7 +1604,7 @@ int gprs_ssl_config_context(int ssl_ctx_id, const gprs_ssl_context_t* ssl_ctx)
     if (ssl_ctx->clientcert) {
         const char* name;
 
-        ret = gprs_ssl_cert_is_present(ssl_ctx->clientcert);
+        ret = gprs_ssl_cert_is_current(ssl_ctx->clientcert);
         if (ret < 0)
             return ret;
 
@@ -1371,7 +1628,7 @@ int gprs_ssl_config_context(int ssl_ctx_id, const gprs_ssl_context_t* ssl_ctx)
     if (ssl_ctx->clientkey) {
         const char* name;
 
-        ret = gprs_ssl_cert_is_present(ssl_ctx->clientkey);
+        ret = gprs_ssl_cert_is_current(ssl_ctx->clientkey);
         if (ret < 0)
             return ret;
 
@@ -1436,7 +1693,7 @@ int gprs_ssl_connect(int ssl_ctx_id, const char* domain_name_or_ip, int port, in
             dbg_printf(DEBUG_LEVEL_DEBUG, "gprs_ssl_connect flags: %d\r\n", flags);
             return GPRS_ERROR_TIMEOUT;
         }
-        ret = sim7600_parse_line(NULL);
+        ret = parse_line(NULL);
         if (ret >= 0) {
             switch (at_response_fields[0].ival) {
             case AT_RESP_CCHOPEN:
@@ -1475,6 +1732,7 @@ int gprs_ssl_connect(int ssl_ctx_id, const char* domain_name_or_ip, int port, in
     } while (1);
 
     ssl_session_ids[session_id] = 1;
+    ssl_rx_pending[session_id] = 0;
     return session_id;
 }
 
@@ -1499,7 +1757,7 @@ int gprs_ssl_stop(void)
         if (has_timer_expired(&timer)) {
             return GPRS_ERROR_TIMEOUT;
         }
-        ret = sim7600_parse_line(NULL);
+        ret = parse_line(NULL);
         if (ret >= 0) {
             switch (at_response_fields[0].ival) {
             case AT_RESP_CCHSTOP:
@@ -1552,13 +1810,14 @@ int gprs_ssl_close(int session_id)
     flags = 0;
 
     ssl_session_ids[session_id] = 0;
+    ssl_rx_pending[session_id] = 0;
 
     do {
         if (has_timer_expired(&timer)) {
             dbg_printf(DEBUG_LEVEL_DEBUG, "gprs_ssl_close flags: %d\r\n", flags);
             return GPRS_ERROR_TIMEOUT;
         }
-        ret = sim7600_parse_line(NULL);
+        ret = parse_line(NULL);
         if (ret >= 0) {
             switch (at_response_fields[0].ival) {
             case AT_RESP_CCHCLOSE:
@@ -1600,6 +1859,13 @@ int gprs_ssl_close(int session_id)
 }
 
 int gprs_ssl_send(int session_id, const unsigned char* buf, int buf_len, int timeout_ms)
+{
+    gprs_segment_t segment = { .buf = buf, .len = buf_len };
+
+    return gprs_ssl_sendv(session_id, &segment, 1, timeout_ms);
+}
+
+int gprs_ssl_sendv(int session_id, const gprs_segment_t* segments, int n_segments, int timeout_ms)
 {
     int ret;
     Timer timer;
@@ -1608,10 +1874,13 @@ int gprs_ssl_send(int session_id, const unsigned char* buf, int buf_len, int tim
     int chunk_size = 0;
     int pending_bytes = 0;
     const char* prompt = ">";
+    int buf_len;
 
     if ((session_id < 0) || (session_id >= MAX_SSL_SESSIONS))
         return GPRS_ERROR_INVALID_PARAMETERS;
 
+    buf_len = segments_length(segments, n_segments);
+
     dbg_printf(DEBUG_LEVEL_DEBUG, "Requested bytes to send: %d\r\n", buf_len);
 
     init_timer(&timer);
@@ -1641,14 +1910,14 @@ int gprs_ssl_send(int session_id, const unsigned char* buf, int buf_len, int tim
             if (has_timer_expired(&timer))
                 return GPRS_ERROR_TIMEOUT;
 
-            ret = sim7600_parse_line(prompt);
+            ret = parse_line(prompt);
             if (ret >= 0) {
                 switch (at_response_fields[0].ival) {
                 case AT_RESP_LINE_VALUE:
                     if (at_response_fields[1].sval[0] == '>') {
-                        ret = at_send_data(&buf[sent_bytes], chunk_size);
+                        ret = send_segments_range(segments, n_segments, sent_bytes, chunk_size);
                         if (ret < 0)
-                            return GPRS_ERROR_MODEM_COMM_FAILED;
+                            return ret;
                         flags |= FLAGS_GOT_DATA;
                     }
                     break;
@@ -1700,7 +1969,7 @@ int gprs_ssl_recv_poll(int ssl_sessions[], int n_sessions, int timeout_ms)
         flags = 0;
 
         do {
-            ret = sim7600_parse_line(NULL);
+            ret = parse_line(NULL);
             if (ret >= 0) {
                 switch (at_response_fields[0].ival) {
                 case AT_RESP_CCHRECV:
@@ -1808,7 +2077,7 @@ int gprs_ssl_recv(int session_id, unsigned char* buf, int buf_len, int timeout_m
             return GPRS_ERROR_TIMEOUT;
         }
 
-        ret = sim7600_parse_line(NULL);
+        ret = parse_line(NULL);
         if (ret >= 0) {
             switch (at_response_fields[0].ival) {
             case AT_RESP_CCHRECV:
@@ -1879,18 +2148,80 @@ static int get_filename(const char* path, const char** name)
     return GPRS_OK;
 }
 
-//the only function which uses malloc because of the limitation of uarte easy dma cannot
-//use flash memory even for TX transmission and certificate length is not known to use static memory.
-int gprs_ssl_cert_download(const char* ro_fs_path)
+//Sends command already formatted in scratch_pad_buf, waits for '>' prompt and streams
+//data from flash through a RAM bounce buffer, since uarte easy dma cannot read flash.
+static int send_prompted_data(const unsigned char* data, unsigned int len, int err_code)
 {
     int ret;
-    const char* certname;
     Timer timer;
     int flags = 0;
     const char* prompt = ">";
+    unsigned int sent;
+    unsigned int chunk;
+
+    init_timer(&timer);
+    countdown_ms(&timer, AT_RESP_SHORT_TIMEOUT_MS);
+
+    ret = at_send_cmd(scratch_pad_buf);
+    if (ret < 0)
+        return GPRS_ERROR_MODEM_COMM_FAILED;
+
+    do {
+        if (has_timer_expired(&timer))
+            return GPRS_ERROR_TIMEOUT;
+
+        ret = parse_line(prompt);
+        if (ret >= 0) {
+            switch (at_response_fields[0].ival) {
+            case AT_RESP_LINE_VALUE:
+                if (at_response_fields[1].sval[0] == '>') {
+                    for (sent = 0; sent < len; sent += chunk) {
+                        chunk = len - sent;
+                        if (chunk > sizeof(stream_bounce_buf))
+                            chunk = sizeof(stream_bounce_buf);
+
+                        memcpy(stream_bounce_buf, &data[sent], chunk);
+                        ret = at_send_data(stream_bounce_buf, chunk);
+                        if (ret < 0)
+                            return GPRS_ERROR_MODEM_COMM_FAILED;
+                    }
+                    flags |= FLAGS_GOT_DATA;
+                }
+                break;
+            case AT_RESP_OK:
+                flags |= FLAGS_GOT_OK;
+                break;
+            case AT_RESP_ERR:
+                return err_code;
+            }
+        }
+
+        if (IS_CMD_COMPLETE(flags))
+            return GPRS_OK;
+
+    } while (1);
+}
+
+static int cert_hash_path(const char* certname, char* path, int path_len)
+{
+    int ret;
+
+    ret = snprintf(path, path_len, CERT_HASH_DIR "%s.sha", certname);
+    if ((ret < 0) || (ret >= path_len))
+        return GPRS_ERROR_COMMAND_TOO_LONG;
+
+    return GPRS_OK;
+}
+
+//Streams certificate from ROFS to modem and stores its content hash alongside,
+//so next boot can skip the download if ROFS content did not change.
+int gprs_ssl_cert_download(const char* ro_fs_path)
+{
+    int ret;
+    const char* certname;
     const unsigned char* filedata;
     const rofs_file_info_t* fileinfo;
-    unsigned char* ram;
+    char hash_path[CERT_HASH_PATH_LEN];
 
 #if 0 //Let user specifically delete certificates.
 	//delete if already exists.
@@ -1910,64 +2241,68 @@ int gprs_ssl_cert_download(const char* ro_fs_path)
     if (ret < 0)
         return GPRS_ERROR_CERT_READ_FAILED;
 
-    //DO not use return statement from this point.
-    ram = malloc(fileinfo->length);
-
-    memcpy(ram, filedata, fileinfo->length);
-
-    init_timer(&timer);
-    countdown_ms(&timer, AT_RESP_SHORT_TIMEOUT_MS);
-
     dbg_printf(DEBUG_LEVEL_DEBUG, "Downloading certificate \"%s\", %u\r\n", certname, fileinfo->length);
 
     snprintf(scratch_pad_buf, SCRATCH_PAD_BUF - 1, "AT+CCERTDOWN=\"%s\",%u\r",
         certname,
         fileinfo->length);
-    ret = at_send_cmd(scratch_pad_buf);
+    ret = send_prompted_data(filedata, fileinfo->length, GPRS_ERROR_CERT_DOWNLOAD_FAILED);
     if (ret < 0)
-        goto err0;
+        return ret;
 
-    flags = 0;
+    //ROFS image generated without digests, nothing to record. Such certificates are always reprovisioned.
+    if (fileinfo->sha256 == NULL)
+        return ret;
 
-    do {
-        if (has_timer_expired(&timer)) {
-            ret = GPRS_ERROR_TIMEOUT;
-            goto err0;
-        }
+    //Hash is written only after certificate, an interrupted download is retried next time.
+    ret = cert_hash_path(certname, hash_path, sizeof(hash_path));
+    if (ret < 0)
+        return ret;
 
-        ret = sim7600_parse_line(prompt);
-        if (ret >= 0) {
-            switch (at_response_fields[0].ival) {
-            case AT_RESP_LINE_VALUE:
-                if (at_response_fields[1].sval[0] == '>') {
-                    ret = at_send_data(ram, fileinfo->length);
-                    if (ret < 0) {
-                        ret = GPRS_ERROR_MODEM_COMM_FAILED;
-                        goto err0;
-                    }
-                    flags |= FLAGS_GOT_DATA;
-                }
-                break;
-            case AT_RESP_OK:
-                flags |= FLAGS_GOT_OK;
-                break;
-            case AT_RESP_ERR:
-                ret = GPRS_ERROR_CERT_DOWNLOAD_FAILED;
-                goto err0;
-                break;
-            }
-        }
+    return simcom_fs_writefile(hash_path, (const unsigned char*)fileinfo->sha256, CERT_HASH_HEX_LEN);
+}
 
-        if (IS_CMD_COMPLETE(flags)) {
-            ret = GPRS_OK;
-            break;
-        }
+//Returns 1 if certificate on modem matches ROFS content hash, 0 if missing or stale.
+//Certificates not found in ROFS (provisioned manually) are checked for presence only.
+int gprs_ssl_cert_is_current(const char* ro_fs_path)
+{
+    int ret;
+    const char* certname;
+    const unsigned char* filedata;
+    const rofs_file_info_t* fileinfo;
+    char hash_path[CERT_HASH_PATH_LEN];
 
-    } while (1);
+    ret = gprs_ssl_cert_is_present(ro_fs_path);
+    if (ret <= 0)
+        return ret;
 
-err0:
-    free(ram);
-    return ret;
+    if (rofs_readfile(ro_fs_path, &filedata, &fileinfo) < 0)
+        return ret;
+
+    //Stale generated ROFS without digests, treat certificate as outdated.
+    if (fileinfo->sha256 == NULL)
+        return 0;
+
+    ret = get_filename(ro_fs_path, &certname);
+    if (ret < 0)
+        return ret;
+
+    ret = cert_hash_path(certname, hash_path, sizeof(hash_path));
+    if (ret < 0)
+        return ret;
+
+    ret = simcom_fs_readfile(hash_path, 0, stream_bounce_buf, CERT_HASH_HEX_LEN);
+    if (ret == GPRS_ERROR_CFTRAN_FAILED) // no hash stored, downloaded by older firmware.
+        return 0;
+    if (ret < 0)
+        return ret;
+
+    if ((ret != CERT_HASH_HEX_LEN) || memcmp(stream_bounce_buf, fileinfo->sha256, CERT_HASH_HEX_LEN)) {
+        dbg_printf(DEBUG_LEVEL_DEBUG, "Certificate \"%s\" changed.\r\n", certname);
+        return 0;
+    }
+
+    return 1;
 }
 
 int gprs_ssl_cert_is_present(const char* ro_fs_path)
@@ -1998,7 +2333,7 @@ int gprs_ssl_cert_is_present(const char* ro_fs_path)
         if (has_timer_expired(&timer))
             return GPRS_ERROR_TIMEOUT;
 
-        ret = sim7600_parse_line(NULL);
+        ret = parse_line(NULL);
         if (ret >= 0) {
             switch (at_response_fields[0].ival) {
             case AT_RESP_CCERTLIST:
@@ -2075,7 +2410,7 @@ int gprs_ntp_sync(const char* server, int tz_code)
             return GPRS_ERROR_TIMEOUT;
         }
 
-        ret = sim7600_parse_line(NULL);
+        ret = parse_line(NULL);
         if (ret >= 0) {
             switch (at_response_fields[0].ival) {
             case AT_RESP_CNTP:
@@ -2125,7 +2460,7 @@ int gsm_get_time(unsigned long* utc_time)
             return GPRS_ERROR_TIMEOUT;
         }
 
-        ret = sim7600_parse_line(NULL);
+        ret = parse_line(NULL);
         if (ret >= 0) {
             switch (at_response_fields[0].ival) {
             case AT_RESP_CCLK: {
@@ -2176,7 +2511,7 @@ int simcom_fs_readfile(const char* path, int offset, unsigned char* buf, int buf
             return GPRS_ERROR_TIMEOUT;
         }
 
-        ret = sim7600_parse_line(NULL);
+        ret = parse_line(NULL);
         if (ret >= 0) {
             switch (at_response_fields[0].ival) {
             case AT_RESP_CFTRANTX:
@@ -2212,3 +2547,20 @@ int simcom_fs_readfile(const char* path, int offset, unsigned char* buf, int buf
 
     } while (1);
 }
+
+int simcom_fs_writefile(const char* path, const unsigned char* buf, int buf_len)
+{
+    int ret;
+
+    ret = snprintf(scratch_pad_buf, SCRATCH_PAD_BUF - 1, "AT+CFTRANRX=\"%s\",%d\r",
+        path,
+        buf_len);
+    if ((ret < 0) || (ret >= SCRATCH_PAD_BUF - 1))
+        return GPRS_ERROR_COMMAND_TOO_LONG;
+
+    ret = send_prompted_data(buf, buf_len, GPRS_ERROR_CFTRAN_FAILED);
+    if (ret < 0)
+        return ret;
+
+    return buf_len;
+}
@@ -155,6 +155,13 @@ static int parse_type(const char* type, char* fields)
             2);
     }
 
+    if (strcmp("+COPS:", type) == 0) {
+        at_response_fields[0].ival = AT_RESP_COPS;
+        return parse_fields(fields,
+            INTEGER_FIELD_BIT(0) | INTEGER_FIELD_BIT(1) | STRING_FIELD_BIT(2) | INTEGER_FIELD_BIT(3),
+            4);
+    }
+
     if (strcmp("+CCERTLIST:", type) == 0) {
         at_response_fields[0].ival = AT_RESP_CCERTLIST;
         return parse_fields(fields,
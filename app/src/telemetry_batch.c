@@ -0,0 +1,248 @@
+/*
+
+Copyright 2019-2020 Ravikiran Bukkasagara <contact@ravikiranb.com>
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include "telemetry_batch.h"
+
+#include <string.h>
+
+#include "aws_iot_config.h"
+#include "aws_iot_log.h"
+#include "telemetry_log.h"
+#include "timer_interface.h"
+
+#define BATCH_HEADER_LEN 6
+#define BATCH_BUF_LEN PUBLISH_QUEUE_PAYLOAD_MAX
+
+#if TELEMETRY_BATCH_DELTA_ENCODING
+#define BATCH_FORMAT TELEMETRY_FORMAT_DELTA
+//Largest sample: 33 bit timestamp delta of delta and 17 bit temperature delta.
+#define BATCH_SAMPLE_MAX_LEN (5 + 3)
+#else
+#define BATCH_FORMAT TELEMETRY_FORMAT_FIXED
+#define BATCH_SAMPLE_MAX_LEN 4
+#endif
+
+//Largest statistics record: timestamp delta of delta, 17 bit mean delta, two
+//16 bit spreads and 16 bit count.
+#define STATS_SAMPLE_MAX_LEN (5 + 3 + 3 + 3 + 3)
+
+#if (BATCH_HEADER_LEN + STATS_SAMPLE_MAX_LEN > BATCH_BUF_LEN)
+#error "Telemetry batch does not fit PUBLISH_QUEUE_PAYLOAD_MAX"
+#endif
+
+static AWS_IoT_Client* batch_client;
+static const char* batch_topic;
+static QoS batch_qos;
+static unsigned char batch_buf[BATCH_BUF_LEN];
+static size_t batch_len;
+static uint8_t batch_count;
+static uint32_t batch_base;
+//Encoder state of previous sample.
+static uint32_t prev_timestamp;
+static int64_t prev_delta;
+static int16_t prev_temperature;
+static publish_priority_t batch_priority;
+static Timer age_timer;
+static telemetry_batch_stats_t stats;
+
+static void put_u16(unsigned char* p, uint16_t v)
+{
+    p[0] = (unsigned char)(v >> 8);
+    p[1] = (unsigned char)v;
+}
+
+static void put_u32(unsigned char* p, uint32_t v)
+{
+    put_u16(p, (uint16_t)(v >> 16));
+    put_u16(p + 2, (uint16_t)v);
+}
+
+static size_t put_varint(unsigned char* p, uint64_t v)
+{
+    size_t len = 0;
+
+    while (v >= 0x80) {
+        p[len++] = (unsigned char)(v | 0x80);
+        v >>= 7;
+    }
+    p[len++] = (unsigned char)v;
+
+    return len;
+}
+
+//Maps small negative and positive numbers to small unsigned ones: 0, -1, 1, -2...
+static uint64_t zigzag(int64_t v)
+{
+    return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static void encode_sample(uint32_t timestamp, int16_t temperature)
+{
+#if TELEMETRY_BATCH_DELTA_ENCODING
+    int64_t delta = (int64_t)timestamp - (int64_t)prev_timestamp;
+
+    batch_len += put_varint(&batch_buf[batch_len], zigzag(delta - prev_delta));
+    batch_len += put_varint(&batch_buf[batch_len], zigzag((int64_t)temperature - prev_temperature));
+    prev_delta = delta;
+#else
+    put_u16(&batch_buf[batch_len], (uint16_t)(timestamp - batch_base));
+    put_u16(&batch_buf[batch_len + 2], (uint16_t)temperature);
+    batch_len += BATCH_SAMPLE_MAX_LEN;
+#endif
+    prev_timestamp = timestamp;
+    prev_temperature = temperature;
+}
+
+static void encode_stats(uint32_t timestamp, const sensor_stats_t* sample)
+{
+    int16_t mean = sensor_stats_mean(sample);
+    int64_t delta = (int64_t)timestamp - (int64_t)prev_timestamp;
+
+    batch_len += put_varint(&batch_buf[batch_len], zigzag(delta - prev_delta));
+    batch_len += put_varint(&batch_buf[batch_len], zigzag((int64_t)mean - prev_temperature));
+    batch_len += put_varint(&batch_buf[batch_len], (uint64_t)((int32_t)mean - sample->min));
+    batch_len += put_varint(&batch_buf[batch_len], (uint64_t)((int32_t)sample->max - mean));
+    batch_len += put_varint(&batch_buf[batch_len], sample->count);
+    prev_delta = delta;
+    prev_timestamp = timestamp;
+    prev_temperature = mean;
+}
+
+void telemetry_batch_init(AWS_IoT_Client* client, const char* topic, QoS qos)
+{
+    batch_client = client;
+    batch_topic = topic;
+    batch_qos = qos;
+    batch_len = 0;
+    batch_count = 0;
+    memset(&stats, 0, sizeof(stats));
+    init_timer(&age_timer);
+}
+
+IoT_Error_t telemetry_batch_flush(void)
+{
+    IoT_Error_t rc;
+
+    if (batch_count == 0)
+        return SUCCESS;
+
+    batch_buf[1] = batch_count;
+
+    // Offline batches go to flash, queue would drop them once full and loses them on reset.
+    if (aws_iot_mqtt_is_client_connected(batch_client))
+        rc = publish_queue_push(batch_topic, batch_buf, batch_len, batch_qos, batch_priority, false);
+    else
+        rc = NETWORK_DISCONNECTED_ERROR;
+
+    if (SUCCESS != rc) {
+        rc = telemetry_log_append(batch_buf, batch_len);
+        if (SUCCESS == rc)
+            stats.logged++;
+    }
+
+    if (SUCCESS == rc) {
+        stats.batches++;
+        stats.payload_bytes += batch_len;
+    } else {
+        stats.dropped += batch_count;
+    }
+
+    batch_len = 0;
+    batch_count = 0;
+
+    return rc;
+}
+
+// Starts a new batch if needed, returns result of flushing previous one.
+static IoT_Error_t begin_sample(uint8_t format, uint32_t timestamp)
+{
+    IoT_Error_t rc = SUCCESS;
+
+    // Other kind of sample or clock set backwards starts a new batch, so does
+    // a gap too long for fixed format offset.
+    if ((batch_count > 0)
+        && ((batch_buf[0] != format) || (timestamp < prev_timestamp)
+            || ((format == TELEMETRY_FORMAT_FIXED) && (timestamp - batch_base > UINT16_MAX))))
+        rc = telemetry_batch_flush();
+
+    if (batch_count == 0) {
+        batch_base = timestamp;
+        batch_priority = PUBLISH_PRIORITY_LOW;
+        batch_buf[0] = format;
+        put_u32(&batch_buf[2], batch_base);
+        batch_len = BATCH_HEADER_LEN;
+        prev_timestamp = timestamp;
+        prev_delta = 0;
+        prev_temperature = 0;
+        countdown_sec(&age_timer, TELEMETRY_BATCH_MAX_AGE_SEC);
+    }
+
+    return rc;
+}
+
+static IoT_Error_t end_sample(publish_priority_t priority, size_t sample_max_len, IoT_Error_t rc)
+{
+    batch_count++;
+    stats.samples++;
+
+    if (priority > batch_priority)
+        batch_priority = priority;
+
+    // Flushed while there is still room for a worst case sample.
+    if ((batch_count == TELEMETRY_BATCH_MAX_SAMPLES) || (batch_len + sample_max_len > BATCH_BUF_LEN)
+        || (priority == PUBLISH_PRIORITY_HIGH))
+        return telemetry_batch_flush();
+
+    return rc;
+}
+
+IoT_Error_t telemetry_batch_add(uint32_t timestamp, int16_t temperature, publish_priority_t priority)
+{
+    IoT_Error_t rc = begin_sample(BATCH_FORMAT, timestamp);
+
+    encode_sample(timestamp, temperature);
+
+    return end_sample(priority, BATCH_SAMPLE_MAX_LEN, rc);
+}
+
+IoT_Error_t telemetry_batch_add_stats(uint32_t timestamp, const sensor_stats_t* sample, publish_priority_t priority)
+{
+    IoT_Error_t rc;
+
+    if (sample->count == 0)
+        return SUCCESS;
+
+    rc = begin_sample(TELEMETRY_FORMAT_STATS, timestamp);
+
+    encode_stats(timestamp, sample);
+
+    return end_sample(priority, STATS_SAMPLE_MAX_LEN, rc);
+}
+
+void telemetry_batch_poll(void)
+{
+    if ((batch_count > 0) && has_timer_expired(&age_timer)) {
+        if (SUCCESS != telemetry_batch_flush())
+            IOT_WARN("Publish queue full, telemetry batch dropped");
+    }
+}
+
+void telemetry_batch_get_stats(telemetry_batch_stats_t* out)
+{
+    *out = stats;
+}
@@ -0,0 +1,482 @@
+/*
+
+Copyright 2019-2020 Ravikiran Bukkasagara <contact@ravikiranb.com>
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include "telemetry_log.h"
+
+#include <string.h>
+
+#include "aws_iot_config.h"
+#include "aws_iot_log.h"
+#include "bl_cmds.h"
+#include "nrf_nvmc.h"
+#include "timer_interface.h"
+
+#define LOG_PAGE_SIZE 4096
+#define LOG_PAGE_MAGIC 0x474F4C54UL //"TLOG"
+#define LOG_PAGE_HEADER_LEN 8
+#define LOG_ERASED 0xFFFFFFFFUL
+
+#define PAYLOAD_WORDS(len) (((len) + 3) / 4)
+//Length word, payload, CRC and sent mark.
+#define RECORD_LEN(len) ((3 + PAYLOAD_WORDS(len)) * 4)
+#define PAGE_ADDR(page) (TELEMETRY_LOG_FLASH_START + (uint32_t)(page)*LOG_PAGE_SIZE)
+#define PAGE_OF(addr) ((uint16_t)((((addr)-TELEMETRY_LOG_FLASH_START) / LOG_PAGE_SIZE) % TELEMETRY_LOG_PAGES))
+#define LOG_END PAGE_ADDR(TELEMETRY_LOG_PAGES)
+
+//Application and OTA images end below log, bootloader starts above it.
+#if (TELEMETRY_LOG_FLASH_START < MAX_FP_BASE_ADDRESS) || (TELEMETRY_LOG_FLASH_START % LOG_PAGE_SIZE)
+#error "TELEMETRY_LOG_FLASH_START overlaps application flash"
+#endif
+
+#if (TELEMETRY_LOG_FLASH_START + TELEMETRY_LOG_PAGES * LOG_PAGE_SIZE) > BL_BASE_ADDRESS
+#error "Telemetry log overlaps bootloader flash"
+#endif
+
+typedef enum {
+    RECORD_VALID,
+    RECORD_TORN, //cut short by power loss, next record can still be found.
+    RECORD_FREE,
+    RECORD_BAD, //length word damaged, rest of page is not usable.
+} record_state_t;
+
+typedef struct {
+    bool busy;
+    uint32_t addr;
+    uint32_t page_seq; //to detect page erased while waiting for PUBACK.
+    size_t payload_len;
+    unsigned char payload[PUBLISH_QUEUE_PAYLOAD_MAX];
+} replay_slot_t;
+
+static const char* log_topic;
+static uint16_t head_page;
+static uint32_t head_seq;
+//Next append, end of head page when it is closed.
+static uint32_t write_addr;
+//Page after head is erased and ready to be opened without erasing.
+static bool spare_ready;
+//Where to look for next record to replay, 0 to start from oldest page.
+static uint32_t read_addr;
+static replay_slot_t slots[TELEMETRY_LOG_REPLAY_WINDOW];
+static Timer replay_timer;
+static bool replay_paced;
+static telemetry_log_stats_t stats;
+
+static uint32_t read_word(uint32_t addr)
+{
+    return *(const volatile uint32_t*)(uintptr_t)addr;
+}
+
+static uint32_t log_crc32(const void* data, size_t len)
+{
+    uint32_t crc = 0xFFFFFFFFUL;
+    const unsigned char* p = (const unsigned char*)data;
+    int bit;
+
+    while (len--) {
+        crc ^= *p++;
+        for (bit = 0; bit < 8; bit++)
+            crc = (crc >> 1) ^ (0xEDB88320UL & (0 - (crc & 1)));
+    }
+
+    return ~crc;
+}
+
+static bool page_valid(uint16_t page)
+{
+    return read_word(PAGE_ADDR(page) + 4) == LOG_PAGE_MAGIC;
+}
+
+static uint32_t page_seq(uint16_t page)
+{
+    return read_word(PAGE_ADDR(page));
+}
+
+static bool page_blank(uint16_t page)
+{
+    uint32_t addr;
+
+    for (addr = PAGE_ADDR(page); addr < PAGE_ADDR(page) + LOG_PAGE_SIZE; addr += 4) {
+        if (read_word(addr) != LOG_ERASED)
+            return false;
+    }
+
+    return true;
+}
+
+static bool header_valid(uint32_t header, uint32_t addr, uint32_t page_end)
+{
+    size_t len = header & 0xFFFF;
+
+    return ((header >> 16) == (~header & 0xFFFF)) && (len > 0) && (len <= PUBLISH_QUEUE_PAYLOAD_MAX)
+        && (addr + RECORD_LEN(len) <= page_end);
+}
+
+//Sets *next to following record on RECORD_VALID and RECORD_TORN.
+static record_state_t read_record(uint32_t addr, size_t* len, uint32_t* next)
+{
+    uint32_t header;
+    uint32_t crc;
+    uint32_t page_end = PAGE_ADDR(PAGE_OF(addr)) + LOG_PAGE_SIZE;
+
+    if (addr + RECORD_LEN(1) > page_end)
+        return RECORD_FREE;
+
+    header = read_word(addr);
+    if (header == LOG_ERASED)
+        return RECORD_FREE;
+
+    // Length word cut short, appending went on after it.
+    if (!header_valid(header, addr, page_end)) {
+        if ((read_word(addr + 4) != LOG_ERASED) && !header_valid(read_word(addr + 4), addr + 4, page_end))
+            return RECORD_BAD;
+        *len = 0;
+        *next = addr + 4;
+        return RECORD_TORN;
+    }
+
+    *len = header & 0xFFFF;
+    *next = addr + RECORD_LEN(*len);
+    crc = read_word(addr + 4 + PAYLOAD_WORDS(*len) * 4);
+
+    // CRC of erased payload can be all ones too, 4 bytes of 0xFF is.
+    if ((crc == LOG_ERASED) || (log_crc32((const void*)(uintptr_t)(addr + 4), *len) != crc))
+        return RECORD_TORN;
+
+    return RECORD_VALID;
+}
+
+static bool record_sent(uint32_t addr, size_t len)
+{
+    //Partly programmed mark is from power loss after PUBACK.
+    return read_word(addr + RECORD_LEN(len) - 4) != LOG_ERASED;
+}
+
+static bool record_in_flight(uint32_t addr)
+{
+    int i;
+
+    for (i = 0; i < TELEMETRY_LOG_REPLAY_WINDOW; i++) {
+        if (slots[i].busy && (slots[i].addr == addr))
+            return true;
+    }
+
+    return false;
+}
+
+//Counts records of page, returns where next one can be appended or page end.
+static uint32_t scan_page(uint16_t page, uint32_t* unsent, uint32_t* torn)
+{
+    uint32_t addr = PAGE_ADDR(page) + LOG_PAGE_HEADER_LEN;
+    uint32_t next;
+    size_t len;
+
+    *unsent = 0;
+    *torn = 0;
+
+    for (;;) {
+        switch (read_record(addr, &len, &next)) {
+        case RECORD_VALID:
+            if (!record_sent(addr, len))
+                (*unsent)++;
+            break;
+        case RECORD_TORN:
+            (*torn)++;
+            break;
+        case RECORD_FREE:
+            return addr;
+        default:
+            return PAGE_ADDR(page) + LOG_PAGE_SIZE;
+        }
+        addr = next;
+    }
+}
+
+//Oldest unsent record not waiting for PUBACK at or after from, 0 if none.
+static uint32_t find_unsent(uint32_t from, size_t* len)
+{
+    uint16_t i;
+    uint16_t page;
+    uint32_t addr;
+    uint32_t next;
+
+    if (from == LOG_END)
+        from = TELEMETRY_LOG_FLASH_START;
+
+    //Pages from oldest to head.
+    for (i = 1; i <= TELEMETRY_LOG_PAGES; i++) {
+        page = (head_page + i) % TELEMETRY_LOG_PAGES;
+        addr = PAGE_ADDR(page) + LOG_PAGE_HEADER_LEN;
+
+        if (from != 0) {
+            if (PAGE_OF(from) != page)
+                continue;
+            if (from > addr)
+                addr = from;
+            from = 0;
+        }
+
+        if (!page_valid(page))
+            continue;
+
+        for (;;) {
+            record_state_t state = read_record(addr, len, &next);
+
+            if ((state == RECORD_FREE) || (state == RECORD_BAD))
+                break;
+            if ((state == RECORD_VALID) && !record_sent(addr, *len) && !record_in_flight(addr))
+                return addr;
+            addr = next;
+        }
+    }
+
+    return 0;
+}
+
+static void open_next_page(void)
+{
+    uint16_t page = (head_page + 1) % TELEMETRY_LOG_PAGES;
+    uint32_t header[2];
+
+    // Magic goes last, page with sequence number cut short stays invalid.
+    header[0] = head_seq + 1;
+    header[1] = LOG_PAGE_MAGIC;
+    nrf_nvmc_write_words(PAGE_ADDR(page), header, 2);
+
+    head_page = page;
+    head_seq++;
+    write_addr = PAGE_ADDR(page) + LOG_PAGE_HEADER_LEN;
+    spare_ready = false;
+}
+
+void telemetry_log_prepare(void)
+{
+    uint16_t page = (head_page + 1) % TELEMETRY_LOG_PAGES;
+    uint32_t unsent;
+    uint32_t torn;
+
+    if (spare_ready)
+        return;
+
+    if (page_valid(page)) {
+        scan_page(page, &unsent, &torn);
+        if (unsent > 0) {
+            IOT_WARN("Telemetry log full, dropping %lu oldest batches", (unsigned long)unsent);
+            stats.dropped += unsent;
+            stats.pending -= unsent;
+        }
+        // Invalidated first, page left half erased by power loss must not be taken for log data.
+        nrf_nvmc_write_word(PAGE_ADDR(page) + 4, 0);
+    }
+
+    if ((read_addr != 0) && (PAGE_OF(read_addr) == page))
+        read_addr = 0;
+
+    if (!page_blank(page))
+        nrf_nvmc_page_erase(PAGE_ADDR(page));
+
+    spare_ready = true;
+}
+
+void telemetry_log_init(const char* topic)
+{
+    uint16_t page;
+    uint32_t unsent;
+    uint32_t torn;
+    uint32_t end;
+    bool found = false;
+
+    log_topic = topic;
+    read_addr = 0;
+    replay_paced = false;
+    memset(slots, 0, sizeof(slots));
+    memset(&stats, 0, sizeof(stats));
+    init_timer(&replay_timer);
+
+    // Head is the page written last.
+    head_page = TELEMETRY_LOG_PAGES - 1;
+    head_seq = 0;
+    for (page = 0; page < TELEMETRY_LOG_PAGES; page++) {
+        if (page_valid(page) && (!found || (page_seq(page) > head_seq))) {
+            head_page = page;
+            head_seq = page_seq(page);
+            found = true;
+        }
+    }
+
+    // Empty log, first append opens page 0.
+    write_addr = PAGE_ADDR(head_page) + LOG_PAGE_SIZE;
+
+    for (page = 0; page < TELEMETRY_LOG_PAGES; page++) {
+        if (!page_valid(page))
+            continue;
+        end = scan_page(page, &unsent, &torn);
+        stats.pending += unsent;
+        stats.torn += torn;
+        if (page == head_page)
+            write_addr = end;
+    }
+
+    spare_ready = page_blank((head_page + 1) % TELEMETRY_LOG_PAGES);
+
+    IOT_INFO("Telemetry log: %lu unsent batches, %lu incomplete records",
+        (unsigned long)stats.pending, (unsigned long)stats.torn);
+}
+
+IoT_Error_t telemetry_log_append(const void* payload, size_t payload_len)
+{
+    uint32_t record[RECORD_LEN(PUBLISH_QUEUE_PAYLOAD_MAX) / 4];
+    uint32_t words = RECORD_LEN(payload_len) / 4;
+
+    if (payload == NULL)
+        return NULL_VALUE_ERROR;
+
+    if ((payload_len == 0) || (payload_len > PUBLISH_QUEUE_PAYLOAD_MAX))
+        return MAX_SIZE_ERROR;
+
+    if (write_addr + RECORD_LEN(payload_len) > PAGE_ADDR(head_page) + LOG_PAGE_SIZE) {
+        if (!spare_ready)
+            return LIMIT_EXCEEDED_ERROR;
+        open_next_page();
+    }
+
+    memset(record, 0xFF, sizeof(record));
+    record[0] = (uint32_t)payload_len | ((~(uint32_t)payload_len & 0xFFFF) << 16);
+    memcpy(&record[1], payload, payload_len);
+    record[words - 2] = log_crc32(&record[1], payload_len);
+
+    // Sent mark stays erased. CRC goes last, power loss before it leaves a torn record.
+    nrf_nvmc_write_words(write_addr, record, words - 1);
+    write_addr += RECORD_LEN(payload_len);
+
+    stats.appended++;
+    stats.pending++;
+
+    return SUCCESS;
+}
+
+static void replay_complete(AWS_IoT_Client* pClient, uint16_t packetId, IoT_Error_t rc, void* pData)
+{
+    replay_slot_t* slot = (replay_slot_t*)pData;
+    uint16_t page = PAGE_OF(slot->addr);
+
+    IOT_UNUSED(pClient);
+    IOT_UNUSED(packetId);
+
+    slot->busy = false;
+
+    // Sent again in log order with next replay.
+    if ((SUCCESS != rc) && (MQTT_REQUEST_REJECTED_ERROR != rc)) {
+        read_addr = 0;
+        return;
+    }
+
+    // Page was erased for new records meanwhile, already counted as dropped.
+    if (!page_valid(page) || (page_seq(page) != slot->page_seq))
+        return;
+
+    nrf_nvmc_write_word(slot->addr + RECORD_LEN(slot->payload_len) - 4, 0);
+    stats.pending--;
+
+    // Broker refused it with a reason code, resending gets the same answer.
+    if (SUCCESS == rc)
+        stats.replayed++;
+    else
+        stats.dropped++;
+}
+
+static replay_slot_t* find_free_slot(void)
+{
+    int i;
+
+    for (i = 0; i < TELEMETRY_LOG_REPLAY_WINDOW; i++) {
+        if (!slots[i].busy)
+            return &slots[i];
+    }
+
+    return NULL;
+}
+
+IoT_Error_t telemetry_log_replay(AWS_IoT_Client* client)
+{
+    IoT_Error_t rc;
+    IoT_Publish_Message_Params params;
+    replay_slot_t* slot;
+    uint32_t addr;
+    size_t len;
+
+    replay_paced = false;
+
+    while (stats.pending > 0) {
+        if (!aws_iot_mqtt_is_client_connected(client))
+            return SUCCESS;
+
+        if (!has_timer_expired(&replay_timer)) {
+            replay_paced = true;
+            return SUCCESS;
+        }
+
+        slot = find_free_slot();
+        if ((slot == NULL) || (aws_iot_mqtt_get_inflight_count(client) >= aws_iot_mqtt_get_inflight_window(client)))
+            return SUCCESS;
+
+        addr = find_unsent(read_addr, &len);
+        if (addr == 0) {
+            read_addr = write_addr;
+            return SUCCESS;
+        }
+
+        // Copied, page may be erased before PUBACK.
+        memcpy(slot->payload, (const void*)(uintptr_t)(addr + 4), len);
+
+        params.qos = QOS1;
+        params.isRetained = 0;
+        params.payload = slot->payload;
+        params.payloadLen = len;
+
+        rc = aws_iot_mqtt_publish_async(client, log_topic, (uint16_t)strlen(log_topic), &params,
+            replay_complete, slot);
+        if (SUCCESS != rc)
+            return rc;
+
+        slot->busy = true;
+        slot->addr = addr;
+        slot->page_seq = page_seq(PAGE_OF(addr));
+        slot->payload_len = len;
+        read_addr = addr + RECORD_LEN(len);
+        countdown_ms(&replay_timer, TELEMETRY_LOG_REPLAY_INTERVAL_MS);
+    }
+
+    return SUCCESS;
+}
+
+uint32_t telemetry_log_get_next_deadline_ms(uint32_t max_ms)
+{
+    uint32_t ms;
+
+    if (!replay_paced)
+        return max_ms;
+
+    ms = left_ms(&replay_timer);
+
+    return (ms < max_ms) ? ms : max_ms;
+}
+
+void telemetry_log_get_stats(telemetry_log_stats_t* out)
+{
+    *out = stats;
+}
@@ -17,8 +17,36 @@ limitations under the License.
 */
 
 #include "temp_sensor.h"
+#include "app_util_platform.h"
+#include "aws_iot_config.h"
+#include "nrf_ppi.h"
+#include "nrf_rtc.h"
 #include "nrf_temp.h"
 
+// RTC1 counts milliseconds for platform timers, which use only compare 0.
+#define SAMPLING_RTC NRF_RTC1
+#define SAMPLING_RTC_CC 1
+#define SAMPLING_PPI_CHANNEL NRF_PPI_CHANNEL0
+#define RTC_COUNTER_MASK 0xFFFFFFUL
+// RTC compare closer than this to counter may not generate event.
+#define MIN_COMPARE_TICKS 2
+
+#if (TEMPERATURE_SAMPLE_RING_LENGTH & (TEMPERATURE_SAMPLE_RING_LENGTH - 1)) != 0
+#error "TEMPERATURE_SAMPLE_RING_LENGTH must be power of 2"
+#endif
+
+// Main loop may sleep until window ends before reading samples.
+#if (TEMPERATURE_WINDOW_SEC * 1000 / TEMPERATURE_SAMPLE_INTERVAL_MS) >= TEMPERATURE_SAMPLE_RING_LENGTH
+#error "TEMPERATURE_SAMPLE_RING_LENGTH does not hold a window of samples"
+#endif
+
+static volatile int16_t ring[TEMPERATURE_SAMPLE_RING_LENGTH];
+// Head moved only by interrupt, tail only by main loop.
+static volatile uint32_t ring_head;
+static volatile uint32_t ring_tail;
+static volatile uint32_t overruns;
+static uint32_t interval_ticks;
+
 void temps_init(void)
 {
     nrf_temp_init();
@@ -45,3 +73,98 @@ int temps_read(void)
 
     return t;
 }
+
+static void schedule_next(void)
+{
+    uint32_t now = nrf_rtc_counter_get(SAMPLING_RTC);
+    uint32_t next = (nrf_rtc_cc_get(SAMPLING_RTC, SAMPLING_RTC_CC) + interval_ticks) & RTC_COUNTER_MASK;
+    uint32_t ahead = (next - now) & RTC_COUNTER_MASK;
+
+    // Stepped from last compare so interval does not drift, unless that one
+    // is already past or too close.
+    if ((ahead > interval_ticks) || (ahead < MIN_COMPARE_TICKS))
+        next = (now + interval_ticks) & RTC_COUNTER_MASK;
+
+    nrf_rtc_cc_set(SAMPLING_RTC, SAMPLING_RTC_CC, next);
+}
+
+void TEMP_IRQHandler(void)
+{
+    uint32_t head = ring_head;
+    int16_t t;
+
+    NRF_TEMP->EVENTS_DATARDY = 0;
+
+    //PAN_028 rev2.0A anomaly 29 - TEMP: Stop task clears the TEMP register.
+    t = (int16_t)nrf_temp_read();
+
+    //PAN_028 rev2.0A anomaly 30 - TEMP: Temp module analog front end does not power down when DATARDY event occurs.
+    NRF_TEMP->TASKS_STOP = 1;
+
+    if (head - ring_tail < TEMPERATURE_SAMPLE_RING_LENGTH) {
+        ring[head % TEMPERATURE_SAMPLE_RING_LENGTH] = t;
+        ring_head = head + 1;
+    } else {
+        overruns++;
+    }
+
+    nrf_rtc_event_clear(SAMPLING_RTC, NRF_RTC_EVENT_COMPARE_1);
+    schedule_next();
+}
+
+void temps_start_sampling(uint32_t interval_ms)
+{
+    temps_stop_sampling();
+
+    interval_ticks = interval_ms;
+    ring_head = 0;
+    ring_tail = 0;
+    overruns = 0;
+
+    NRF_TEMP->EVENTS_DATARDY = 0;
+    NRF_TEMP->INTENSET = TEMP_INTENSET_DATARDY_Msk;
+    NVIC_ClearPendingIRQ(TEMP_IRQn);
+    NVIC_SetPriority(TEMP_IRQn, APP_IRQ_PRIORITY_LOW);
+    NVIC_EnableIRQ(TEMP_IRQn);
+
+    nrf_ppi_channel_endpoint_setup(SAMPLING_PPI_CHANNEL,
+        nrf_rtc_event_address_get(SAMPLING_RTC, NRF_RTC_EVENT_COMPARE_1),
+        (uint32_t)&NRF_TEMP->TASKS_START);
+    nrf_ppi_channel_enable(SAMPLING_PPI_CHANNEL);
+
+    // Compare event is routed to PPI only, it does not interrupt.
+    nrf_rtc_event_clear(SAMPLING_RTC, NRF_RTC_EVENT_COMPARE_1);
+    nrf_rtc_cc_set(SAMPLING_RTC, SAMPLING_RTC_CC, (nrf_rtc_counter_get(SAMPLING_RTC) + interval_ticks) & RTC_COUNTER_MASK);
+    nrf_rtc_event_enable(SAMPLING_RTC, NRF_RTC_INT_COMPARE1_MASK);
+
+    NRF_TEMP->TASKS_START = 1;
+}
+
+void temps_stop_sampling(void)
+{
+    nrf_rtc_event_disable(SAMPLING_RTC, NRF_RTC_INT_COMPARE1_MASK);
+    nrf_ppi_channel_disable(SAMPLING_PPI_CHANNEL);
+
+    NVIC_DisableIRQ(TEMP_IRQn);
+    NRF_TEMP->INTENCLR = TEMP_INTENCLR_DATARDY_Msk;
+    NRF_TEMP->TASKS_STOP = 1;
+    NRF_TEMP->EVENTS_DATARDY = 0;
+}
+
+bool temps_get_sample(int16_t* quarter_celsius)
+{
+    uint32_t tail = ring_tail;
+
+    if (tail == ring_head)
+        return false;
+
+    *quarter_celsius = ring[tail % TEMPERATURE_SAMPLE_RING_LENGTH];
+    ring_tail = tail + 1;
+
+    return true;
+}
+
+uint32_t temps_get_overruns(void)
+{
+    return overruns;
+}
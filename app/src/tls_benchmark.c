@@ -0,0 +1,212 @@
+/*
+
+Copyright 2019-2020 Ravikiran Bukkasagara <contact@ravikiranb.com>
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+    
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include <malloc.h>
+#include <string.h>
+
+#include "aws_iot_config.h"
+#include "aws_iot_log.h"
+#include "aws_iot_mqtt_client_interface.h"
+#include "network_transport.h"
+#include "timer_interface.h"
+
+#include "tls_benchmark.h"
+
+// Longest measurable interval, RTC1 counter is 24 bits of ms.
+#define BENCH_TIMER_MS 0xffffffU
+
+typedef struct {
+    uint32_t handshake_ms;
+    uint32_t publish_ms;
+    uint32_t bytes;
+    int heap_connected;
+    int heap_peak;
+    int failures;
+} bench_result_t;
+
+static AWS_IoT_Client bench_client;
+static unsigned char bench_payload[TLS_BENCHMARK_PAYLOAD_LEN];
+
+static uint32_t elapsed_ms(Timer* timer)
+{
+    return BENCH_TIMER_MS - left_ms(timer);
+}
+
+static IoT_Error_t bench_handshake(iot_tls_transport_t transport, IoT_Client_Init_Params* init_params,
+    bench_result_t* result)
+{
+    Network* network = &(bench_client.networkStack);
+    struct mallinfo before;
+    struct mallinfo after;
+    Timer timer;
+    IoT_Error_t rc;
+
+    rc = aws_iot_mqtt_init(&bench_client, init_params);
+    if (SUCCESS != rc) {
+        return rc;
+    }
+
+    rc = iot_tls_set_transport(network, transport);
+    if (SUCCESS != rc) {
+        return rc;
+    }
+
+    before = mallinfo();
+
+    countdown_ms(&timer, BENCH_TIMER_MS);
+    rc = network->connect(network, NULL);
+    result->handshake_ms += elapsed_ms(&timer);
+
+    after = mallinfo();
+
+    if (SUCCESS == rc) {
+        result->heap_connected += after.uordblks - before.uordblks;
+        // arena only grows, growth during connect is the new high water mark.
+        if ((int)after.arena > result->heap_peak) {
+            result->heap_peak = after.arena;
+        }
+        network->disconnect(network);
+    }
+    network->destroy(network);
+
+    return rc;
+}
+
+static void bench_publish_complete(AWS_IoT_Client* pClient, uint16_t packetId, IoT_Error_t rc, void* pData)
+{
+    bench_result_t* result = (bench_result_t*)pData;
+
+    IOT_UNUSED(pClient);
+    IOT_UNUSED(packetId);
+
+    if (SUCCESS == rc) {
+        result->bytes += sizeof(bench_payload);
+    }
+}
+
+static IoT_Error_t bench_publish(iot_tls_transport_t transport, IoT_Client_Init_Params* init_params,
+    IoT_Client_Connect_Params* connect_params, const char* topic, bench_result_t* result)
+{
+    IoT_Publish_Message_Params params;
+    Timer timer;
+    IoT_Error_t rc;
+    int i;
+
+    rc = aws_iot_mqtt_init(&bench_client, init_params);
+    if (SUCCESS != rc) {
+        return rc;
+    }
+
+    rc = iot_tls_set_transport(&(bench_client.networkStack), transport);
+    if (SUCCESS != rc) {
+        return rc;
+    }
+
+    rc = aws_iot_mqtt_connect(&bench_client, connect_params);
+    if (SUCCESS != rc) {
+        return rc;
+    }
+
+    params.qos = QOS1;
+    params.isRetained = 0;
+    params.payload = bench_payload;
+    params.payloadLen = sizeof(bench_payload);
+
+    // Messages are pipelined in the in-flight window, bytes count when acknowledged.
+    countdown_ms(&timer, BENCH_TIMER_MS);
+    for (i = 0; (i < TLS_BENCHMARK_MESSAGES) || aws_iot_mqtt_get_inflight_count(&bench_client);) {
+        if ((i < TLS_BENCHMARK_MESSAGES) && (aws_iot_mqtt_get_inflight_count(&bench_client) < AWS_IOT_MQTT_MAX_INFLIGHT_PUBLISH)) {
+            rc = aws_iot_mqtt_publish_async(&bench_client, topic, (uint16_t)strlen(topic), &params,
+                bench_publish_complete, result);
+            i++;
+        } else {
+            rc = aws_iot_mqtt_yield(&bench_client, 10);
+        }
+        if (SUCCESS != rc) {
+            break;
+        }
+    }
+    result->publish_ms += elapsed_ms(&timer);
+
+    aws_iot_mqtt_disconnect(&bench_client);
+    bench_client.networkStack.destroy(&(bench_client.networkStack));
+
+    return rc;
+}
+
+int tls_benchmark_run(IoT_Client_Init_Params* init_params, IoT_Client_Connect_Params* connect_params,
+    const char* topic)
+{
+    bench_result_t results[IOT_TLS_TRANSPORT_COUNT];
+    IoT_Client_Init_Params bench_params;
+    bench_result_t* r;
+    IoT_Error_t rc;
+    int transport;
+    int round;
+
+    memset(results, 0, sizeof(results));
+    memset(bench_payload, 'x', sizeof(bench_payload));
+
+    // Auto reconnect would hide failures. Work on a copy so the application keeps its setting.
+    bench_params = *init_params;
+    bench_params.enableAutoReconnect = false;
+
+    for (round = 0; round < TLS_BENCHMARK_ROUNDS; round++) {
+        for (transport = 0; transport < IOT_TLS_TRANSPORT_COUNT; transport++) {
+            r = &results[transport];
+
+            rc = bench_handshake((iot_tls_transport_t)transport, &bench_params, r);
+            if (SUCCESS != rc) {
+                IOT_ERROR("bench %s handshake failed: %d\r\n", iot_tls_transport_name(transport), rc);
+                r->failures++;
+                continue;
+            }
+
+            rc = bench_publish((iot_tls_transport_t)transport, &bench_params, connect_params, topic, r);
+            if (SUCCESS != rc) {
+                IOT_ERROR("bench %s publish failed: %d\r\n", iot_tls_transport_name(transport), rc);
+                r->failures++;
+            }
+        }
+    }
+
+    IOT_INFO("TLS benchmark, %d rounds, %d x %d byte QoS1 publishes\r\n",
+        TLS_BENCHMARK_ROUNDS, TLS_BENCHMARK_MESSAGES, TLS_BENCHMARK_PAYLOAD_LEN);
+    IOT_INFO("static TLS state: %u bytes\r\n", (unsigned int)sizeof(TLSDataParams));
+
+    for (transport = 0; transport < IOT_TLS_TRANSPORT_COUNT; transport++) {
+        int ok;
+
+        r = &results[transport];
+        ok = TLS_BENCHMARK_ROUNDS - r->failures;
+        if (ok <= 0) {
+            IOT_INFO("%s: all rounds failed\r\n", iot_tls_transport_name(transport));
+            continue;
+        }
+
+        IOT_INFO("%s: handshake %lu ms, publish %lu B/s, heap connected %d B, heap peak %d B, failures %d\r\n",
+            iot_tls_transport_name(transport),
+            (unsigned long)(r->handshake_ms / ok),
+            (unsigned long)(r->publish_ms ? (r->bytes * 1000UL) / r->publish_ms : 0),
+            r->heap_connected / ok,
+            r->heap_peak,
+            r->failures);
+    }
+
+    return 0;
+}
@@ -0,0 +1,300 @@
+/*
+
+Copyright 2019-2020 Ravikiran Bukkasagara <contact@ravikiranb.com>
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+//Shadow update document of 6000 fields built with the variadic API of SDK
+//3.0.1, with the variadic API of this tree and with aws_iot_shadow_writer_*.
+//Documents must be the same apart from whitespace and escaping, which 3.0.1
+//did not do. Also checks sections limited by field mask and truncation.
+
+#include <string.h>
+#include <time.h>
+
+#include "aws_iot_config.h"
+#include "aws_iot_shadow_json.h"
+#include "aws_iot_shadow_key.h"
+#include "legacy/aws_iot_shadow_json_3_0_1.h"
+#include "test_check.h"
+
+#define FIELDS 6000
+//Fields per variadic call, the section is repeated for each call.
+#define FIELDS_PER_SECTION 100
+#define DOC_SIZE (256 * 1024)
+#define STRING_VALUE_SIZE 16
+
+char mqttClientID[MAX_SIZE_OF_UNIQUE_CLIENT_ID_BYTES] = "bench";
+
+static char keys[FIELDS][8];
+static int32_t int_values[FIELDS];
+static float float_values[FIELDS];
+static bool bool_values[FIELDS];
+static char string_values[FIELDS][STRING_VALUE_SIZE];
+static jsonStruct_t fields[FIELDS];
+static jsonStruct_t* field_ptrs[FIELDS];
+
+static char legacy_doc[DOC_SIZE];
+static char variadic_doc[DOC_SIZE];
+static char writer_doc[DOC_SIZE];
+static char normalized_a[DOC_SIZE];
+static char normalized_b[DOC_SIZE];
+
+//Mix of types, strings with characters 3.0.1 wrote unescaped.
+static void make_fields(void)
+{
+    int i;
+
+    for (i = 0; i < FIELDS; i++) {
+        snprintf(keys[i], sizeof(keys[i]), "k%d", i);
+        fields[i].pKey = keys[i];
+        fields[i].cb = NULL;
+
+        switch (i % 5) {
+        case 0:
+            int_values[i] = i * -1000;
+            fields[i].pData = &int_values[i];
+            fields[i].dataLength = sizeof(int32_t);
+            fields[i].type = SHADOW_JSON_INT32;
+            break;
+        case 1:
+            float_values[i] = i * 0.25f;
+            fields[i].pData = &float_values[i];
+            fields[i].dataLength = sizeof(float);
+            fields[i].type = SHADOW_JSON_FLOAT;
+            break;
+        case 2:
+            bool_values[i] = (i % 3) == 0;
+            fields[i].pData = &bool_values[i];
+            fields[i].dataLength = sizeof(bool);
+            fields[i].type = SHADOW_JSON_BOOL;
+            break;
+        case 3:
+            snprintf(string_values[i], STRING_VALUE_SIZE, (i % 4) ? "s%d" : "q\"%d\\\x01", i);
+            fields[i].pData = string_values[i];
+            fields[i].dataLength = STRING_VALUE_SIZE;
+            fields[i].type = SHADOW_JSON_STRING;
+            break;
+        default:
+            int_values[i] = i;
+            fields[i].pData = &int_values[i];
+            fields[i].dataLength = sizeof(uint32_t);
+            fields[i].type = SHADOW_JSON_UINT32;
+            break;
+        }
+
+        field_ptrs[i] = &fields[i];
+    }
+}
+
+#define F(n) &fields[i + (n)]
+#define F10(n) F(n), F(n + 1), F(n + 2), F(n + 3), F(n + 4), F(n + 5), F(n + 6), F(n + 7), F(n + 8), F(n + 9)
+#define F100 F10(0), F10(10), F10(20), F10(30), F10(40), F10(50), F10(60), F10(70), F10(80), F10(90)
+
+#if FIELDS_PER_SECTION != 100 || FIELDS % FIELDS_PER_SECTION
+#error "F100 passes 100 fields per call"
+#endif
+
+static IoT_Error_t build_legacy(char* doc, size_t size)
+{
+    IoT_Error_t rc;
+    int i;
+
+    legacy_reset_client_token_sequence_num();
+    rc = legacy_shadow_init_json_document(doc, size);
+    for (i = 0; (i < FIELDS) && (SUCCESS == rc); i += FIELDS_PER_SECTION)
+        rc = legacy_shadow_add_reported(doc, size, FIELDS_PER_SECTION, F100);
+    if (SUCCESS == rc)
+        rc = legacy_finalize_json_document(doc, size);
+
+    return rc;
+}
+
+static IoT_Error_t build_variadic(char* doc, size_t size)
+{
+    IoT_Error_t rc;
+    int i;
+
+    resetClientTokenSequenceNum();
+    rc = aws_iot_shadow_init_json_document(doc, size);
+    for (i = 0; (i < FIELDS) && (SUCCESS == rc); i += FIELDS_PER_SECTION)
+        rc = aws_iot_shadow_add_reported(doc, size, FIELDS_PER_SECTION, F100);
+    if (SUCCESS == rc)
+        rc = aws_iot_finalize_json_document(doc, size);
+
+    return rc;
+}
+
+//Writer keeps going after truncation, length then tells the size needed.
+static IoT_Error_t build_writer(char* doc, size_t size, size_t* length)
+{
+    AwsIotJsonWriter writer;
+    int i;
+
+    resetClientTokenSequenceNum();
+    aws_iot_shadow_writer_init(&writer, doc, size);
+    for (i = 0; i < FIELDS; i += FIELDS_PER_SECTION)
+        aws_iot_shadow_writer_add_section(&writer, SHADOW_REPORTED_STRING, &field_ptrs[i], FIELDS_PER_SECTION,
+            0xFFFFFFFFUL);
+    aws_iot_shadow_writer_finalize(&writer, 0);
+
+    if (length != NULL)
+        *length = writer.length;
+
+    return writer.rc;
+}
+
+//Drops whitespace, undoes escaping if asked. Strings must not contain whitespace.
+static void normalize(const char* in, char* out, bool unescape)
+{
+    unsigned int c;
+
+    while (*in != '\0') {
+        if ((*in == ' ') || (*in == '\n') || (*in == '\t')) {
+            in++;
+        } else if (unescape && (in[0] == '\\') && (in[1] == 'u') && (sscanf(in + 2, "%4x", &c) == 1)) {
+            *out++ = (char)c;
+            in += 6;
+        } else if (unescape && (in[0] == '\\')) {
+            *out++ = in[1];
+            in += 2;
+        } else {
+            *out++ = *in++;
+        }
+    }
+    *out = '\0';
+}
+
+static double now_ms(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static void bench_full_document(void)
+{
+    const int legacy_runs = 5;
+    const int runs = 100;
+    double start;
+    double legacy_ms;
+    double variadic_ms;
+    double writer_ms;
+    size_t length = 0;
+    int i;
+
+    start = now_ms();
+    for (i = 0; i < legacy_runs; i++)
+        CHECK(SUCCESS == build_legacy(legacy_doc, sizeof(legacy_doc)));
+    legacy_ms = (now_ms() - start) / legacy_runs;
+
+    start = now_ms();
+    for (i = 0; i < runs; i++)
+        CHECK(SUCCESS == build_variadic(variadic_doc, sizeof(variadic_doc)));
+    variadic_ms = (now_ms() - start) / runs;
+
+    start = now_ms();
+    for (i = 0; i < runs; i++)
+        CHECK(SUCCESS == build_writer(writer_doc, sizeof(writer_doc), &length));
+    writer_ms = (now_ms() - start) / runs;
+
+    printf("%d fields, %lu bytes\n", FIELDS, (unsigned long)strlen(writer_doc));
+    printf("  variadic API, SDK 3.0.1: %8.3f ms\n", legacy_ms);
+    printf("  variadic API:            %8.3f ms\n", variadic_ms);
+    printf("  aws_iot_shadow_writer_*: %8.3f ms\n", writer_ms);
+
+    CHECK(length == strlen(writer_doc));
+    CHECK(strcmp(variadic_doc, writer_doc) == 0);
+
+    normalize(legacy_doc, normalized_a, false);
+    normalize(writer_doc, normalized_b, true);
+    CHECK(strcmp(normalized_a, normalized_b) == 0);
+
+    // Escaping is the only other difference.
+    CHECK(strstr(legacy_doc, "\"q\"8\\\x01\"") != NULL);
+    CHECK(strstr(writer_doc, "\"q\\\"8\\\\\\u0001\"") != NULL);
+}
+
+static void test_field_mask(void)
+{
+    char doc[256];
+    char legacy[256];
+    jsonStruct_t* section[4] = { &fields[0], &fields[1], &fields[2], &fields[3] };
+    AwsIotJsonWriter writer;
+
+    // Fields 0 and 2, desired left out as none is selected.
+    resetClientTokenSequenceNum();
+    CHECK(SUCCESS == aws_iot_shadow_writer_init(&writer, doc, sizeof(doc)));
+    CHECK(SUCCESS == aws_iot_shadow_writer_add_section(&writer, SHADOW_REPORTED_STRING, section, 4, 0x5));
+    CHECK(SUCCESS == aws_iot_shadow_writer_add_section(&writer, SHADOW_DESIRED_STRING, section, 4, 0x30));
+    CHECK(SUCCESS == aws_iot_shadow_writer_finalize(&writer, 0));
+    CHECK(strstr(doc, SHADOW_DESIRED_STRING) == NULL);
+
+    legacy_reset_client_token_sequence_num();
+    CHECK(SUCCESS == legacy_shadow_init_json_document(legacy, sizeof(legacy)));
+    CHECK(SUCCESS == legacy_shadow_add_reported(legacy, sizeof(legacy), 2, &fields[0], &fields[2]));
+    CHECK(SUCCESS == legacy_finalize_json_document(legacy, sizeof(legacy)));
+
+    normalize(legacy, normalized_a, false);
+    normalize(doc, normalized_b, true);
+    CHECK(strcmp(normalized_a, normalized_b) == 0);
+
+    // Version goes after state when known.
+    resetClientTokenSequenceNum();
+    CHECK(SUCCESS == aws_iot_shadow_writer_init(&writer, doc, sizeof(doc)));
+    CHECK(SUCCESS == aws_iot_shadow_writer_add_section(&writer, SHADOW_REPORTED_STRING, section, 4, 0x8));
+    CHECK(SUCCESS == aws_iot_shadow_writer_finalize(&writer, 42));
+    CHECK(strcmp(doc, "{\"state\":{\"reported\":{\"k3\":\"s3\"}},\"version\":42,\"clientToken\":\"bench-0\"}") == 0);
+
+    printf("field mask: %s\n", doc);
+}
+
+static void test_truncated(void)
+{
+    static char small[DOC_SIZE];
+    size_t full = strlen(writer_doc);
+    size_t sizes[] = { full, full / 2, 8, 1 };
+    size_t length;
+    size_t i;
+
+    for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        memset(small, 'x', sizeof(small));
+        CHECK(SHADOW_JSON_BUFFER_TRUNCATED == build_writer(small, sizes[i], &length));
+        // Size needed is still known, buffer keeps a terminated prefix.
+        CHECK(length == full);
+        CHECK(strlen(small) < sizes[i]);
+        CHECK(strncmp(small, writer_doc, strlen(small)) == 0);
+        CHECK(small[sizes[i]] == 'x');
+
+        memset(small, 'x', sizeof(small));
+        CHECK(SUCCESS != build_variadic(small, sizes[i]));
+        CHECK(small[sizes[i]] == 'x');
+    }
+
+    printf("truncated: needs %lu bytes\n", (unsigned long)full);
+}
+
+int main(void)
+{
+    make_fields();
+
+    bench_full_document();
+    test_field_mask();
+    test_truncated();
+
+    return test_result("bench_shadow_json");
+}
@@ -0,0 +1,331 @@
+/*
+
+Copyright 2019-2020 Ravikiran Bukkasagara <contact@ravikiranb.com>
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+//Incoming topic dispatch over AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS subscribed
+//filters: character matching of SDK 3.0.1 against every handler, and a walk of
+//the topic filter index built at subscribe time. Both must agree except where
+//3.0.1 did not follow MQTT 3.1.1 section 4.7.1, which each such topic states.
+//Index must also agree with the level at a time matcher used for filters too
+//deep to be indexed. Built once per handler count.
+
+#include <signal.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+//Matchers are static, built here with the rest of the file.
+#include "aws_iot_mqtt_client_common_internal.c"
+
+#include "test_check.h"
+
+#define RUNS (20000000 / AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS)
+#define FILTER_MAX_LEN 64
+
+typedef struct {
+    const char* name;
+    //Filters 3.0.1 got wrong for this name, bit per filter.
+    uint32_t legacy_wrong;
+} topic_t;
+
+//First handlers, 3.0.1 differs from MQTT on some of them.
+static const char* const filters[] = {
+    "$aws/things/+/shadow/update/delta",
+    "$aws/things/dev1/jobs/+/get/#",
+    "devices/+/config",
+    "sensors/#",
+    //Deeper than AWS_IOT_MQTT_MAX_TOPIC_LEVELS, not indexed.
+    "a/+/c/+/e/+/g/+/i",
+    "a/b/c/d/e/f/g/h/i/#",
+};
+
+//Rest of the handlers, one device each.
+static const char* const device_filters[] = {
+    "$aws/things/dev%u/shadow/update/delta",
+    "$aws/things/dev%u/jobs/+/get/#",
+    "devices/dev%u/+/config",
+    "sensors/dev%u/#",
+    "fleet/+/dev%u/status",
+};
+
+static const topic_t topics[] = {
+    { "$aws/things/dev1/shadow/update/delta", 0 },
+    { "$aws/things/dev1/shadow/update/accepted", 0 },
+    { "$aws/things/dev1/jobs/42/get/accepted", 0 },
+    { "$aws/things/dev1/jobs/42/get", 0x2 }, // # also matches parent level.
+    { "$aws/things/dev2/jobs/42/get/accepted", 0 },
+    { "devices/dev1/config", 0 },
+    { "devices/dev1/config/extra", 0 },
+    { "devices//config", 0x4 }, // + matches empty level.
+    { "devices/dev1/commands", 0 },
+    { "sensors/temperature/window", 0 },
+    { "sensors", 0x8 }, // # also matches parent level.
+    { "sensorsX/temperature", 0 },
+    { "a/b/c/d/e/f/g/h/i", 0x20 }, // # also matches parent level.
+    { "a/b/c/d/e/f/g/h/i/j/k", 0 },
+    { "a//c/d/e/f/g/h/i", 0x10 }, // + matches empty level.
+    { "a/b/c/d/e/f/g/h/j", 0 },
+    { "sensors/1/2/3/4/5/6/7/8/9", 0 },
+    { "a/b/c", 0 },
+    { "devices/dev1/config/", 0 },
+    { "$aws/things/dev10/shadow/update/delta", 0 },
+    { "$aws/things/dev11/jobs/7/get/accepted", 0 },
+    { "devices/dev12/eu/config", 0 },
+    { "sensors/dev13/temperature", 0 },
+    { "fleet/eu/dev14/status", 0 },
+    { "$aws/things/dev200/shadow/update/delta", 0 },
+    { "fleet/us/dev249/status", 0 },
+    { "fleet/us/dev250/status", 0 },
+};
+
+#define FILTER_COUNT (sizeof(filters) / sizeof(filters[0]))
+#define DEVICE_FILTER_COUNT (sizeof(device_filters) / sizeof(device_filters[0]))
+#define TOPIC_COUNT (sizeof(topics) / sizeof(topics[0]))
+
+static AWS_IoT_Client client;
+static char filter_text[AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS][FILTER_MAX_LEN];
+
+// Only matching is run, rest of the file is not reached.
+ClientState aws_iot_mqtt_get_client_state(AWS_IoT_Client* pClient)
+{
+    return CLIENT_STATE_INVALID;
+}
+
+IoT_Error_t aws_iot_mqtt_set_client_state(AWS_IoT_Client* pClient, ClientState expectedCurrentState,
+    ClientState newState)
+{
+    return FAILURE;
+}
+
+IoT_Error_t aws_iot_mqtt_internal_serialize_ack(unsigned char* pTxBuf, size_t txBufLen, MessageTypes msgType,
+    uint8_t dup, uint16_t packetId, uint32_t* pSerializedLen)
+{
+    return FAILURE;
+}
+
+IoT_Error_t aws_iot_mqtt_internal_deserialize_ack(unsigned char* pPacketType, unsigned char* dup,
+    uint16_t* pPacketId, unsigned char* pReasonCode, unsigned char* pRxBuf, size_t rxBuflen)
+{
+    return FAILURE;
+}
+
+IoT_Error_t aws_iot_mqtt_internal_deserialize_publish(uint8_t* dup, QoS* qos, uint8_t* retained,
+    uint16_t* pPacketId, char** pTopicName, uint16_t* topicNameLen, unsigned char** payload, size_t* payloadLen,
+    bool isMqtt5, unsigned char* pRxBuf, size_t rxBufLen)
+{
+    return FAILURE;
+}
+
+bool aws_iot_mqtt_internal_inflight_ack(AWS_IoT_Client* pClient, uint16_t packetId, IoT_Error_t rc)
+{
+    return false;
+}
+
+//Matcher of SDK 3.0.1, unchanged.
+// assume topic filter and name is in correct format
+// # can only be at end
+// + and # can only be next to separator
+static bool legacy_is_topic_matched(char* pTopicFilter, char* pTopicName, uint16_t topicNameLen)
+{
+    char *curf, *curn, *curn_end;
+
+    if (NULL == pTopicFilter || NULL == pTopicName) {
+        return false;
+    }
+
+    curf = pTopicFilter;
+    curn = pTopicName;
+    curn_end = curn + topicNameLen;
+
+    while (*curf && (curn < curn_end)) {
+        if (*curn == '/' && *curf != '/') {
+            break;
+        }
+        if (*curf != '+' && *curf != '#' && *curf != *curn) {
+            break;
+        }
+        if (*curf == '+') {
+            /* skip until we meet the next separator, or end of string */
+            char* nextpos = curn + 1;
+            while (nextpos < curn_end && *nextpos != '/')
+                nextpos = ++curn + 1;
+        } else if (*curf == '#') {
+            /* skip until end of string */
+            curn = curn_end - 1;
+        }
+
+        curf++;
+        curn++;
+    };
+
+    return (curn == curn_end) && (*curf == '\0');
+}
+
+//Same handler fields aws_iot_mqtt_subscribe sets up, then the index.
+static void register_filters(void)
+{
+    size_t i;
+
+    for (i = 0; i < AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS; i++) {
+        MessageHandlers* handler = &client.clientData.messageHandlers[i];
+
+        if (i < FILTER_COUNT)
+            snprintf(filter_text[i], FILTER_MAX_LEN, "%s", filters[i]);
+        else
+            snprintf(filter_text[i], FILTER_MAX_LEN, device_filters[i % DEVICE_FILTER_COUNT], (unsigned)i);
+
+        handler->topicName = filter_text[i];
+        handler->topicNameLen = (uint16_t)strlen(handler->topicName);
+    }
+
+    aws_iot_mqtt_internal_index_topic_filters(&client);
+}
+
+//Loop of 3.0.1 dispatch, number of handlers matched.
+static uint32_t dispatch_legacy(const char* name, uint16_t len)
+{
+    uint32_t count = 0;
+    size_t i;
+
+    for (i = 0; i < AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS; i++) {
+        if (legacy_is_topic_matched((char*)client.clientData.messageHandlers[i].topicName, (char*)name, len))
+            count++;
+    }
+
+    return count;
+}
+
+//Index walk and handler loop of _aws_iot_mqtt_internal_deliver_message.
+static uint32_t dispatch_index(const char* name, uint16_t len)
+{
+    uint32_t matched[HANDLER_MATCH_WORDS];
+    uint32_t count = 0;
+    uint32_t i;
+
+    _aws_iot_mqtt_internal_match_handlers(&client.clientData, name, len, matched);
+    for (i = 0; i < AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS; i++) {
+        if (0 == matched[i / 32]) {
+            i |= 31;
+            continue;
+        }
+        if (HANDLER_MATCHED(matched, i))
+            count++;
+    }
+
+    return count;
+}
+
+//Index result against both matchers for every handler.
+static void check_topic(const char* name, uint16_t len, uint32_t legacy_wrong)
+{
+    const MessageHandlers* handlers = client.clientData.messageHandlers;
+    uint32_t matched[HANDLER_MATCH_WORDS];
+    size_t i;
+
+    _aws_iot_mqtt_internal_match_handlers(&client.clientData, name, len, matched);
+
+    for (i = 0; i < AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS; i++) {
+        bool index = HANDLER_MATCHED(matched, i);
+        bool levels = _aws_iot_mqtt_internal_is_topic_matched(handlers[i].topicName, handlers[i].topicNameLen,
+            name, len);
+        bool legacy = legacy_is_topic_matched((char*)handlers[i].topicName, (char*)name, len);
+        bool wrong = (i < FILTER_COUNT) && (legacy_wrong & (1UL << i));
+
+        if ((index != levels) || (index != (legacy != wrong)))
+            printf("%.*s on %s: index %d, level at a time %d, 3.0.1 %d\n", len > 64 ? 64 : len, name,
+                handlers[i].topicName, index, levels, legacy);
+        CHECK(index == levels);
+        CHECK(index == (legacy != wrong));
+    }
+}
+
+static double now_ms(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static void bench_match(void)
+{
+    uint16_t lens[TOPIC_COUNT];
+    volatile uint32_t sink = 0;
+    double start;
+    double legacy_ns;
+    double index_ns;
+    size_t t;
+    int run;
+
+    for (t = 0; t < TOPIC_COUNT; t++) {
+        lens[t] = (uint16_t)strlen(topics[t].name);
+        check_topic(topics[t].name, lens[t], topics[t].legacy_wrong);
+    }
+
+    start = now_ms();
+    for (run = 0; run < RUNS; run++) {
+        for (t = 0; t < TOPIC_COUNT; t++)
+            sink += dispatch_legacy(topics[t].name, lens[t]);
+    }
+    legacy_ns = (now_ms() - start) * 1e6 / ((double)RUNS * TOPIC_COUNT);
+
+    start = now_ms();
+    for (run = 0; run < RUNS; run++) {
+        for (t = 0; t < TOPIC_COUNT; t++)
+            sink += dispatch_index(topics[t].name, lens[t]);
+    }
+    index_ns = (now_ms() - start) * 1e6 / ((double)RUNS * TOPIC_COUNT);
+
+    printf("%d handlers, %u index nodes, %lu topics, ns per incoming topic\n", AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS,
+        client.clientData.topicNodeCount, (unsigned long)TOPIC_COUNT);
+    printf("  character matching, SDK 3.0.1: %8.1f\n", legacy_ns);
+    printf("  topic filter index:            %8.1f\n", index_ns);
+}
+
+//Topic length field is 16 bits, longest topic must still end the level walks.
+static void test_longest_topic(void)
+{
+    static char name[65535];
+    size_t i;
+
+    memset(name, 'a', sizeof(name));
+    check_topic(name, sizeof(name), 0);
+
+    for (i = 1000; i < sizeof(name); i += 1000)
+        name[i] = '/';
+    check_topic(name, sizeof(name), 0);
+
+    memcpy(name, "sensors/", 8);
+    check_topic(name, sizeof(name), 0);
+
+    printf("longest topic: matched\n");
+}
+
+int main(void)
+{
+    // A level walk that never ends fails the run instead of hanging it.
+    alarm(60);
+
+    register_filters();
+    CHECK(client.clientData.firstUnindexedHandler == 5);
+    CHECK(client.clientData.messageHandlers[5].nextHandler == 4);
+    test_longest_topic();
+    bench_match();
+
+    return test_result("bench_topic_match");
+}
@@ -0,0 +1,237 @@
+/*
+ * Copyright 2010-2015 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file aws_iot_shadow_json_3_0_1.c
+ * @brief Shadow document builder as released in SDK 3.0.1, kept for benchmarks
+ *
+ * Unchanged apart from the legacy_ prefix. Every field rescans the whole document
+ * with strlen, which bench_shadow_json measures against aws_iot_shadow_writer_*.
+ */
+
+#include "aws_iot_shadow_json_3_0_1.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "aws_iot_config.h"
+#include "aws_iot_shadow_key.h"
+
+extern char mqttClientID[MAX_SIZE_OF_UNIQUE_CLIENT_ID_BYTES];
+static uint32_t clientTokenNum = 0;
+
+static IoT_Error_t convertDataToString(char *pStringBuffer, size_t maxSizoStringBuffer, JsonPrimitiveType type,
+									   void *pData);
+
+void legacy_reset_client_token_sequence_num(void) {
+	clientTokenNum = 0;
+}
+
+static inline IoT_Error_t checkReturnValueOfSnPrintf(int32_t snPrintfReturn, size_t maxSizeOfJsonDocument) {
+	if(snPrintfReturn < 0) {
+		return SHADOW_JSON_ERROR;
+	} else if((size_t) snPrintfReturn >= maxSizeOfJsonDocument) {
+		return SHADOW_JSON_BUFFER_TRUNCATED;
+	}
+	return SUCCESS;
+}
+
+IoT_Error_t legacy_shadow_init_json_document(char *pJsonDocument, size_t maxSizeOfJsonDocument) {
+
+	IoT_Error_t ret_val = SUCCESS;
+	int32_t snPrintfReturn = 0;
+
+	if(pJsonDocument == NULL) {
+		return NULL_VALUE_ERROR;
+	}
+	snPrintfReturn = snprintf(pJsonDocument, maxSizeOfJsonDocument, "{\"state\":{");
+
+	ret_val = checkReturnValueOfSnPrintf(snPrintfReturn, maxSizeOfJsonDocument);
+
+	return ret_val;
+
+}
+
+IoT_Error_t legacy_shadow_add_reported(char *pJsonDocument, size_t maxSizeOfJsonDocument, uint8_t count, ...) {
+	IoT_Error_t ret_val = SUCCESS;
+
+	int8_t i;
+	size_t remSizeOfJsonBuffer = maxSizeOfJsonDocument;
+	int32_t snPrintfReturn = 0;
+	size_t tempSize = 0;
+	jsonStruct_t *pTemporary;
+	va_list pArgs;
+	va_start(pArgs, count);
+
+	if(pJsonDocument == NULL) {
+		va_end(pArgs);
+		return NULL_VALUE_ERROR;
+	}
+
+
+	tempSize = maxSizeOfJsonDocument - strlen(pJsonDocument);
+	if(tempSize <= 1) {
+		va_end(pArgs);
+		return SHADOW_JSON_ERROR;
+	}
+	remSizeOfJsonBuffer = tempSize;
+
+	snPrintfReturn = snprintf(pJsonDocument + strlen(pJsonDocument), remSizeOfJsonBuffer, "\"reported\":{");
+	ret_val = checkReturnValueOfSnPrintf(snPrintfReturn, remSizeOfJsonBuffer);
+
+	if(ret_val != SUCCESS) {
+		va_end(pArgs);
+		return ret_val;
+	}
+
+	for(i = 0; i < count; i++) {
+		tempSize = maxSizeOfJsonDocument - strlen(pJsonDocument);
+		if(tempSize <= 1) {
+			va_end(pArgs);
+			return SHADOW_JSON_ERROR;
+		}
+		remSizeOfJsonBuffer = tempSize;
+
+		pTemporary = va_arg (pArgs, jsonStruct_t *);
+		if(pTemporary != NULL) {
+			snPrintfReturn = snprintf(pJsonDocument + strlen(pJsonDocument), remSizeOfJsonBuffer, "\"%s\":",
+									  pTemporary->pKey);
+			ret_val = checkReturnValueOfSnPrintf(snPrintfReturn, remSizeOfJsonBuffer);
+			if(ret_val != SUCCESS) {
+				va_end(pArgs);
+				return ret_val;
+			}
+			if(pTemporary->pKey != NULL && pTemporary->pData != NULL) {
+				ret_val = convertDataToString(pJsonDocument + strlen(pJsonDocument), remSizeOfJsonBuffer,
+											  pTemporary->type, pTemporary->pData);
+			} else {
+				va_end(pArgs);
+				return NULL_VALUE_ERROR;
+			}
+			if(ret_val != SUCCESS) {
+				va_end(pArgs);
+				return ret_val;
+			}
+		} else {
+			va_end(pArgs);
+			return NULL_VALUE_ERROR;
+		}
+	}
+
+	va_end(pArgs);
+	snPrintfReturn = snprintf(pJsonDocument + strlen(pJsonDocument) - 1, remSizeOfJsonBuffer, "},");
+	ret_val = checkReturnValueOfSnPrintf(snPrintfReturn, remSizeOfJsonBuffer);
+	return ret_val;
+}
+
+static int32_t legacyFillWithClientTokenSize(char *pBufferToBeUpdatedWithClientToken, size_t maxSizeOfJsonDocument) {
+	int32_t snPrintfReturn;
+	snPrintfReturn = snprintf(pBufferToBeUpdatedWithClientToken, maxSizeOfJsonDocument, "%s-%d", mqttClientID,
+				  (int) clientTokenNum++);
+
+	return snPrintfReturn;
+}
+
+IoT_Error_t legacy_finalize_json_document(char *pJsonDocument, size_t maxSizeOfJsonDocument) {
+	size_t remSizeOfJsonBuffer = maxSizeOfJsonDocument;
+	int32_t snPrintfReturn = 0;
+	size_t tempSize = 0;
+	IoT_Error_t ret_val = SUCCESS;
+
+	if(pJsonDocument == NULL) {
+		return NULL_VALUE_ERROR;
+	}
+
+	tempSize = maxSizeOfJsonDocument - strlen(pJsonDocument);
+	if(tempSize <= 1) {
+		return SHADOW_JSON_ERROR;
+	}
+	remSizeOfJsonBuffer = tempSize;
+
+	// strlen(ShadowTxBuffer) - 1 is to ensure we remove the last ,(comma) that was added
+	snPrintfReturn = snprintf(pJsonDocument + strlen(pJsonDocument) - 1, remSizeOfJsonBuffer, "}, \"%s\":\"",
+							  SHADOW_CLIENT_TOKEN_STRING);
+	ret_val = checkReturnValueOfSnPrintf(snPrintfReturn, remSizeOfJsonBuffer);
+
+	if(ret_val != SUCCESS) {
+		return ret_val;
+	}
+	// refactor this XXX repeated code
+	tempSize = maxSizeOfJsonDocument - strlen(pJsonDocument);
+	if(tempSize <= 1) {
+		return SHADOW_JSON_ERROR;
+	}
+	remSizeOfJsonBuffer = tempSize;
+
+
+	snPrintfReturn = legacyFillWithClientTokenSize(pJsonDocument + strlen(pJsonDocument), remSizeOfJsonBuffer);
+	ret_val = checkReturnValueOfSnPrintf(snPrintfReturn, remSizeOfJsonBuffer);
+
+	if(ret_val != SUCCESS) {
+		return ret_val;
+	}
+	tempSize = maxSizeOfJsonDocument - strlen(pJsonDocument);
+	if(tempSize <= 1) {
+		return SHADOW_JSON_ERROR;
+	}
+	remSizeOfJsonBuffer = tempSize;
+
+
+	snPrintfReturn = snprintf(pJsonDocument + strlen(pJsonDocument), remSizeOfJsonBuffer, "\"}");
+	ret_val = checkReturnValueOfSnPrintf(snPrintfReturn, remSizeOfJsonBuffer);
+
+	return ret_val;
+}
+
+static IoT_Error_t convertDataToString(char *pStringBuffer, size_t maxSizoStringBuffer, JsonPrimitiveType type,
+									   void *pData) {
+	int32_t snPrintfReturn = 0;
+	IoT_Error_t ret_val = SUCCESS;
+
+	if(maxSizoStringBuffer == 0) {
+		return SHADOW_JSON_ERROR;
+	}
+
+	if(type == SHADOW_JSON_INT32) {
+		snPrintfReturn = snprintf(pStringBuffer, maxSizoStringBuffer, "%i,", *(int32_t *) (pData));
+	} else if(type == SHADOW_JSON_INT16) {
+		snPrintfReturn = snprintf(pStringBuffer, maxSizoStringBuffer, "%hi,", *(int16_t *) (pData));
+	} else if(type == SHADOW_JSON_INT8) {
+		snPrintfReturn = snprintf(pStringBuffer, maxSizoStringBuffer, "%hhi,", *(int8_t *) (pData));
+	} else if(type == SHADOW_JSON_UINT32) {
+		snPrintfReturn = snprintf(pStringBuffer, maxSizoStringBuffer, "%u,", *(uint32_t *) (pData));
+	} else if(type == SHADOW_JSON_UINT16) {
+		snPrintfReturn = snprintf(pStringBuffer, maxSizoStringBuffer, "%hu,", *(uint16_t *) (pData));
+	} else if(type == SHADOW_JSON_UINT8) {
+		snPrintfReturn = snprintf(pStringBuffer, maxSizoStringBuffer, "%hhu,", *(uint8_t *) (pData));
+	} else if(type == SHADOW_JSON_DOUBLE) {
+		snPrintfReturn = snprintf(pStringBuffer, maxSizoStringBuffer, "%f,", *(double *) (pData));
+	} else if(type == SHADOW_JSON_FLOAT) {
+		snPrintfReturn = snprintf(pStringBuffer, maxSizoStringBuffer, "%f,", *(float *) (pData));
+	} else if(type == SHADOW_JSON_BOOL) {
+		snPrintfReturn = snprintf(pStringBuffer, maxSizoStringBuffer, "%s,", *(bool *) (pData) ? "true" : "false");
+	} else if(type == SHADOW_JSON_STRING) {
+		snPrintfReturn = snprintf(pStringBuffer, maxSizoStringBuffer, "\"%s\",", (char *) (pData));
+	} else if(type == SHADOW_JSON_OBJECT) {
+		snPrintfReturn = snprintf(pStringBuffer, maxSizoStringBuffer, "%s,", (char *) (pData));
+	}
+
+
+	ret_val = checkReturnValueOfSnPrintf(snPrintfReturn, maxSizoStringBuffer);
+
+	return ret_val;
+}
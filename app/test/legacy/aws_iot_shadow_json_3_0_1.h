@@ -0,0 +1,37 @@
+/*
+ * Copyright 2010-2015 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file aws_iot_shadow_json_3_0_1.h
+ * @brief Shadow document builder as released in SDK 3.0.1, kept for benchmarks
+ */
+
+#ifndef AWS_IOT_SHADOW_JSON_3_0_1_H_
+#define AWS_IOT_SHADOW_JSON_3_0_1_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "aws_iot_shadow_json_data.h"
+
+void legacy_reset_client_token_sequence_num(void);
+
+IoT_Error_t legacy_shadow_init_json_document(char *pJsonDocument, size_t maxSizeOfJsonDocument);
+
+IoT_Error_t legacy_shadow_add_reported(char *pJsonDocument, size_t maxSizeOfJsonDocument, uint8_t count, ...);
+
+IoT_Error_t legacy_finalize_json_document(char *pJsonDocument, size_t maxSizeOfJsonDocument);
+
+#endif /* AWS_IOT_SHADOW_JSON_3_0_1_H_ */
@@ -0,0 +1,68 @@
+/*
+
+Copyright 2019-2020 Ravikiran Bukkasagara <contact@ravikiranb.com>
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include "host_timer.h"
+
+#include <stdbool.h>
+
+static uint32_t now;
+
+uint32_t host_timer_now_ms(void)
+{
+    return now;
+}
+
+void host_timer_advance_ms(uint32_t ms)
+{
+    now += ms;
+}
+
+bool has_timer_expired(Timer* timer)
+{
+    return left_ms(timer) == 0;
+}
+
+void countdown_ms(Timer* timer, uint32_t expire_ms)
+{
+    timer->diff = expire_ms;
+    timer->that_time = now;
+}
+
+void countdown_sec(Timer* timer, uint32_t expire_sec)
+{
+    countdown_ms(timer, expire_sec * 1000U);
+}
+
+uint32_t left_ms(Timer* timer)
+{
+    uint32_t elapsed = now - timer->that_time;
+
+    return (elapsed < timer->diff) ? timer->diff - elapsed : 0;
+}
+
+void init_timer(Timer* timer)
+{
+    timer->diff = 0;
+    timer->that_time = now;
+}
+
+//Sleeping until expiry is just moving the clock there.
+void timer_wait_event(Timer* timer)
+{
+    now += left_ms(timer);
+}
@@ -0,0 +1,33 @@
+/*
+
+Copyright 2019-2020 Ravikiran Bukkasagara <contact@ravikiranb.com>
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#ifndef HOST_TIMER_H_
+#define HOST_TIMER_H_
+
+#include <stdint.h>
+
+#include "timer_interface.h"
+
+//Host build of timer_interface.h over a millisecond clock moved by the test
+//instead of RTC1, so timeouts are reproducible and take no real time.
+
+uint32_t host_timer_now_ms(void);
+
+void host_timer_advance_ms(uint32_t ms);
+
+#endif /* HOST_TIMER_H_ */
@@ -0,0 +1,32 @@
+/*
+
+Copyright 2019-2020 Ravikiran Bukkasagara <contact@ravikiranb.com>
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#ifndef NRF_NVMC_H__
+#define NRF_NVMC_H__
+
+#include <stdint.h>
+
+//Host build, implemented by the test over RAM mapped at the flash address.
+
+void nrf_nvmc_page_erase(uint32_t address);
+
+void nrf_nvmc_write_word(uint32_t address, uint32_t value);
+
+void nrf_nvmc_write_words(uint32_t address, const uint32_t* src, uint32_t num_words);
+
+#endif /* NRF_NVMC_H__ */
@@ -0,0 +1,43 @@
+/*
+
+Copyright 2019-2020 Ravikiran Bukkasagara <contact@ravikiranb.com>
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#ifndef TEST_CHECK_H_
+#define TEST_CHECK_H_
+
+#include <stdio.h>
+
+//Host tests keep going after a failed check and exit non zero at the end.
+
+static int test_failures;
+
+#define CHECK(cond)                                                              \
+    do {                                                                         \
+        if (!(cond)) {                                                           \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);      \
+            test_failures++;                                                     \
+        }                                                                        \
+    } while (0)
+
+static inline int test_result(const char* name)
+{
+    printf("%s: %s\n", name, test_failures ? "FAIL" : "PASS");
+
+    return test_failures ? 1 : 0;
+}
+
+#endif /* TEST_CHECK_H_ */
@@ -0,0 +1,166 @@
+/*
+
+Copyright 2019-2020 Ravikiran Bukkasagara <contact@ravikiranb.com>
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+//Keepalive tuner against a carrier NAT that drops connections idle for its
+//timeout or longer. Each ping is answered when idle time is below the timeout,
+//otherwise it is lost and client disconnects with the ping outstanding. On top
+//of that some pings are lost to outages whatever the idle time. Tuner must
+//settle just below the timeout and stay near it through outages.
+
+#include <string.h>
+
+#include "aws_iot_config.h"
+#include "keepalive_tuner.h"
+#include "sim7600_gprs.h"
+#include "test_check.h"
+
+#define PINGS 20000
+#define SAVED_FILE_SIZE 8
+
+static AWS_IoT_Client client;
+static uint16_t ping_interval;
+static uint32_t ping_responses;
+static unsigned char saved_file[SAVED_FILE_SIZE];
+static int saved_len;
+static uint32_t random_state = 12345;
+
+static uint32_t random_next(void)
+{
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 17;
+    random_state ^= random_state << 5;
+
+    return random_state;
+}
+
+int gprs_get_operator(char* plmn, int plmn_buf_len)
+{
+    snprintf(plmn, plmn_buf_len, "26201");
+
+    return GPRS_OK;
+}
+
+int simcom_fs_readfile(const char* path, int offset, unsigned char* buf, int buf_len)
+{
+    CHECK(strcmp(path, "E:/ka_26201.bin") == 0);
+    if ((saved_len == 0) || (buf_len > saved_len))
+        return -1;
+
+    memcpy(buf, saved_file, buf_len);
+
+    return buf_len;
+}
+
+int simcom_fs_writefile(const char* path, const unsigned char* buf, int buf_len)
+{
+    CHECK(buf_len <= SAVED_FILE_SIZE);
+    if (buf_len > SAVED_FILE_SIZE)
+        return -1;
+
+    memcpy(saved_file, buf, buf_len);
+    saved_len = buf_len;
+
+    return buf_len;
+}
+
+IoT_Error_t aws_iot_mqtt_set_ping_interval(AWS_IoT_Client* pClient, uint16_t pingIntervalSec)
+{
+    ping_interval = pingIntervalSec;
+
+    return SUCCESS;
+}
+
+uint32_t aws_iot_mqtt_get_ping_response_count(AWS_IoT_Client* pClient)
+{
+    return ping_responses;
+}
+
+//One ping after ping_interval of idle time, lost_per_1000 of them to outages.
+static void ping(uint16_t nat_timeout, uint32_t lost_per_1000)
+{
+    if ((ping_interval < nat_timeout) && (random_next() % 1000 >= lost_per_1000)) {
+        ping_responses++;
+        keepalive_tuner_update(&client);
+    } else {
+        client.clientStatus.isPingOutstanding = true;
+        keepalive_tuner_on_disconnect(&client);
+        client.clientStatus.isPingOutstanding = false;
+    }
+}
+
+//Mean idle time over second half of run, and longest one answered.
+static void run(const char* name, uint16_t nat_timeout, uint32_t lost_per_1000, uint16_t* mean)
+{
+    uint64_t sum = 0;
+    uint32_t i;
+
+    for (i = 0; i < PINGS; i++) {
+        ping(nat_timeout, lost_per_1000);
+        if (i >= PINGS / 2)
+            sum += ping_interval;
+    }
+
+    *mean = (uint16_t)(sum / (PINGS - PINGS / 2));
+    printf("%s: NAT timeout %u s, %u.%u%% pings lost to outages, idle time %u s now, %u s on average\n", name,
+        nat_timeout, lost_per_1000 / 10, lost_per_1000 % 10, ping_interval, *mean);
+}
+
+static void test_nat_timeout(void)
+{
+    const uint16_t best = 600 - IOT_KEEPALIVE_STEP_SEC;
+    uint16_t mean;
+
+    saved_len = 0;
+    keepalive_tuner_init(&client);
+    CHECK(ping_interval == IOT_KEEPALIVE_MIN_SEC);
+
+    // Settles just below timeout, longer one is only tried again now and then.
+    run("reliable link", 600, 0, &mean);
+    CHECK(ping_interval == best);
+    CHECK(mean > best - IOT_KEEPALIVE_STEP_SEC / 10);
+
+    // Restarted device starts from saved setting.
+    keepalive_tuner_init(&client);
+    CHECK(ping_interval == best);
+
+    // Outages alone do not wear the setting down.
+    run("outages", 600, 20, &mean);
+    CHECK(ping_interval >= best - IOT_KEEPALIVE_STEP_SEC);
+    CHECK(mean >= best - IOT_KEEPALIVE_STEP_SEC);
+
+    run("heavy outages", 600, 100, &mean);
+    CHECK(mean >= best - 2 * IOT_KEEPALIVE_STEP_SEC);
+
+    // Shorter timeout is followed down, and up again when it gets longer.
+    run("shorter NAT timeout", 300, 20, &mean);
+    CHECK((ping_interval < 300) && (ping_interval >= 300 - 2 * IOT_KEEPALIVE_STEP_SEC));
+
+    run("longer NAT timeout", 900, 20, &mean);
+    CHECK((ping_interval < 900) && (ping_interval >= 900 - 2 * IOT_KEEPALIVE_STEP_SEC));
+
+    // Maximum is kept when NAT allows it.
+    run("no NAT timeout", 0xFFFF, 20, &mean);
+    CHECK(ping_interval == IOT_KEEPALIVE_MAX_SEC);
+}
+
+int main(void)
+{
+    test_nat_timeout();
+
+    return test_result("test_keepalive_tuner");
+}
@@ -0,0 +1,236 @@
+/*
+
+Copyright 2019-2020 Ravikiran Bukkasagara <contact@ravikiranb.com>
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+//Samples of fixtures/temperature.csv through telemetry batch encoder, with the
+//clock moved to each sample time and main loop poll in between. Every payload
+//published is decoded with scripts/telemetry/main.py and must give back the
+//samples. Payload bytes and publishes must be what "main.py ratio" prints for
+//the format built. Run from app/test, python3 required.
+
+#include <string.h>
+
+#include "aws_iot_config.h"
+#include "host_timer.h"
+#include "telemetry_batch.h"
+#include "test_check.h"
+
+#define FIXTURE "fixtures/temperature.csv"
+#define SCRIPT "python3 ../../scripts/telemetry/main.py"
+#define MAX_SAMPLES 1024
+#define MAX_PAYLOADS 256
+
+#if TELEMETRY_BATCH_DELTA_ENCODING
+#define FORMAT_NAME "delta"
+#else
+#define FORMAT_NAME "fixed"
+#endif
+
+typedef struct {
+    uint32_t timestamp;
+    int16_t temperature;
+} sample_t;
+
+typedef struct {
+    unsigned char data[PUBLISH_QUEUE_PAYLOAD_MAX];
+    size_t len;
+} payload_t;
+
+static sample_t samples[MAX_SAMPLES];
+static size_t sample_count;
+static payload_t payloads[MAX_PAYLOADS];
+static size_t payload_count;
+
+bool aws_iot_mqtt_is_client_connected(AWS_IoT_Client* pClient)
+{
+    return true;
+}
+
+IoT_Error_t publish_queue_push(const char* topic, const void* payload, size_t payload_len,
+    QoS qos, publish_priority_t priority, bool latest_only)
+{
+    CHECK(payload_len <= PUBLISH_QUEUE_PAYLOAD_MAX);
+    CHECK(payload_count < MAX_PAYLOADS);
+    if ((payload_len > PUBLISH_QUEUE_PAYLOAD_MAX) || (payload_count == MAX_PAYLOADS))
+        return FAILURE;
+
+    memcpy(payloads[payload_count].data, payload, payload_len);
+    payloads[payload_count].len = payload_len;
+    payload_count++;
+
+    return SUCCESS;
+}
+
+// Queue always takes a batch while connected, nothing goes to flash.
+IoT_Error_t telemetry_log_append(const void* payload, size_t len)
+{
+    CHECK(false);
+
+    return FAILURE;
+}
+
+static void load_fixture(void)
+{
+    FILE* f = fopen(FIXTURE, "r");
+    char line[128];
+    unsigned long timestamp;
+    int temperature;
+
+    CHECK(f != NULL);
+    if (f == NULL)
+        return;
+
+    while (fgets(line, sizeof(line), f) != NULL) {
+        if ((line[0] == '#') || (sscanf(line, "%lu,%d", &timestamp, &temperature) != 2))
+            continue;
+        CHECK(sample_count < MAX_SAMPLES);
+        if (sample_count == MAX_SAMPLES)
+            break;
+        samples[sample_count].timestamp = (uint32_t)timestamp;
+        samples[sample_count].temperature = (int16_t)temperature;
+        sample_count++;
+    }
+
+    fclose(f);
+}
+
+static void encode(void)
+{
+    telemetry_batch_stats_t stats;
+    size_t bytes = 0;
+    size_t i;
+
+    telemetry_batch_init(NULL, "test/telemetry", QOS1);
+
+    for (i = 0; i < sample_count; i++) {
+        // Clock set backwards does not move the timer clock.
+        if ((i > 0) && (samples[i].timestamp > samples[i - 1].timestamp))
+            host_timer_advance_ms((samples[i].timestamp - samples[i - 1].timestamp) * 1000U);
+        telemetry_batch_poll();
+        CHECK(SUCCESS == telemetry_batch_add(samples[i].timestamp, samples[i].temperature, PUBLISH_PRIORITY_LOW));
+    }
+    CHECK(SUCCESS == telemetry_batch_flush());
+
+    for (i = 0; i < payload_count; i++)
+        bytes += payloads[i].len;
+
+    telemetry_batch_get_stats(&stats);
+    CHECK(stats.samples == sample_count);
+    CHECK(stats.batches == payload_count);
+    CHECK(stats.payload_bytes == bytes);
+    CHECK((stats.logged == 0) && (stats.dropped == 0));
+}
+
+//Decoded rows of each payload must continue the fixture where the previous one ended.
+static void check_decoded(void)
+{
+    char command[sizeof(SCRIPT) + 16 + 2 * PUBLISH_QUEUE_PAYLOAD_MAX];
+    char line[128];
+    size_t decoded = 0;
+    size_t i;
+    size_t j;
+
+    for (i = 0; i < payload_count; i++) {
+        FILE* p;
+        size_t n = snprintf(command, sizeof(command), "%s decode ", SCRIPT);
+        unsigned long timestamp;
+        int temperature;
+
+        for (j = 0; j < payloads[i].len; j++)
+            n += snprintf(command + n, sizeof(command) - n, "%02x", payloads[i].data[j]);
+
+        p = popen(command, "r");
+        CHECK(p != NULL);
+        if (p == NULL)
+            return;
+
+        // Header row first, then timestamp,utc,temperature.
+        CHECK(fgets(line, sizeof(line), p) != NULL);
+        CHECK(strcmp(line, "timestamp,utc,temperature\n") == 0);
+        while (fgets(line, sizeof(line), p) != NULL) {
+            CHECK(sscanf(line, "%lu,%*[^,],%d", &timestamp, &temperature) == 2);
+            CHECK(decoded < sample_count);
+            if (decoded == sample_count)
+                break;
+            CHECK(timestamp == samples[decoded].timestamp);
+            CHECK(temperature == samples[decoded].temperature);
+            decoded++;
+        }
+
+        CHECK(pclose(p) == 0);
+    }
+
+    CHECK(decoded == sample_count);
+}
+
+static void check_ratio(void)
+{
+    const char* prefix = FORMAT_NAME ":";
+    char line[256];
+    char expected[32];
+    size_t bytes = 0;
+    unsigned long ratio_bytes = 0;
+    unsigned long ratio_publishes = 0;
+    double ratio_per_sample = 0;
+    double per_sample;
+    bool found = false;
+    FILE* p;
+    size_t i;
+
+    for (i = 0; i < payload_count; i++)
+        bytes += payloads[i].len;
+    per_sample = (double)bytes / sample_count;
+
+    p = popen(SCRIPT " ratio " FIXTURE, "r");
+    CHECK(p != NULL);
+    if (p == NULL)
+        return;
+
+    while (fgets(line, sizeof(line), p) != NULL) {
+        if (strncmp(line, prefix, strlen(prefix)) != 0)
+            continue;
+        found = sscanf(line + strlen(prefix), "%lu bytes, %lf per sample, %lu publishes", &ratio_bytes,
+                    &ratio_per_sample, &ratio_publishes)
+            == 3;
+    }
+    CHECK(pclose(p) == 0);
+    CHECK(found);
+
+    printf(FORMAT_NAME ": %lu samples, %lu bytes, %.2f per sample, %lu publishes\n", (unsigned long)sample_count,
+        (unsigned long)bytes, per_sample, (unsigned long)payload_count);
+    printf("main.py ratio: %lu bytes, %.2f per sample, %lu publishes\n", ratio_bytes, ratio_per_sample,
+        ratio_publishes);
+
+    CHECK(ratio_bytes == bytes);
+    CHECK(ratio_publishes == payload_count);
+    // Both printed to two decimals from the same division.
+    snprintf(line, sizeof(line), "%.2f", per_sample);
+    snprintf(expected, sizeof(expected), "%.2f", ratio_per_sample);
+    CHECK(strcmp(line, expected) == 0);
+}
+
+int main(void)
+{
+    load_fixture();
+    CHECK(sample_count > 0);
+
+    encode();
+    check_decoded();
+    check_ratio();
+
+    return test_result("test_telemetry_batch (" FORMAT_NAME ")");
+}
@@ -0,0 +1,471 @@
+/*
+
+Copyright 2019-2020 Ravikiran Bukkasagara <contact@ravikiranb.com>
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+//Telemetry log over RAM standing in for flash, with power cut after a number
+//of word writes, in the middle of a word write or in the middle of a page erase.
+//After every cut the log is initialized again like on reset, and at the end
+//every append that returned SUCCESS must have been published or be counted
+//as dropped.
+
+#include <setjmp.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "aws_iot_config.h"
+#include "host_timer.h"
+#include "nrf_nvmc.h"
+#include "telemetry_log.h"
+#include "test_check.h"
+
+#ifndef MAP_FIXED_NOREPLACE
+#define MAP_FIXED_NOREPLACE MAP_FIXED
+#endif
+
+#define LOG_PAGE_SIZE 4096
+#define LOG_SIZE (TELEMETRY_LOG_PAGES * LOG_PAGE_SIZE)
+#define LOG_TOPIC "test/events"
+#define MAX_IDS 65536
+#define MAX_INFLIGHT 8
+
+typedef enum {
+    CUT_NONE,
+    CUT_AFTER_WORDS, //between two word writes.
+    CUT_IN_WORD, //word left with only some of its bits programmed.
+    CUT_IN_ERASE, //page left with only some of its bits erased.
+} cut_mode_t;
+
+typedef struct {
+    pPublishCompleteHandler_t handler;
+    void* data;
+    uint32_t id;
+} inflight_t;
+
+static jmp_buf power_loss;
+static cut_mode_t cut_mode;
+//Flash operations of kind selected by cut_mode left before power is cut.
+static uint32_t cut_countdown;
+static uint32_t cuts;
+static bool erase_allowed;
+static uint32_t erases;
+static uint32_t random_state = 1;
+
+static bool connected;
+static inflight_t inflight[MAX_INFLIGHT];
+static uint8_t inflight_count;
+
+static uint32_t next_id;
+static bool accepted[MAX_IDS];
+static bool delivered[MAX_IDS];
+static uint32_t refused;
+static uint32_t dropped;
+static uint32_t bad_payloads;
+
+//xorshift32, same sequence on every host.
+static uint32_t random_next(void)
+{
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 17;
+    random_state ^= random_state << 5;
+
+    return random_state;
+}
+
+static volatile uint32_t* flash_word(uint32_t address)
+{
+    return (volatile uint32_t*)(uintptr_t)address;
+}
+
+static bool cut_now(cut_mode_t first, cut_mode_t last)
+{
+    if ((cut_mode < first) || (cut_mode > last))
+        return false;
+
+    return cut_countdown-- == 0;
+}
+
+static void power_cut(void)
+{
+    cuts++;
+    cut_mode = CUT_NONE;
+    erase_allowed = false;
+    longjmp(power_loss, 1);
+}
+
+static void program_word(uint32_t address, uint32_t value)
+{
+    CHECK((address >= TELEMETRY_LOG_FLASH_START) && (address < TELEMETRY_LOG_FLASH_START + LOG_SIZE));
+    CHECK((address % 4) == 0);
+
+    if (cut_now(CUT_AFTER_WORDS, CUT_IN_WORD)) {
+        if (cut_mode == CUT_IN_WORD)
+            *flash_word(address) &= value | random_next();
+        power_cut();
+    }
+
+    // Programming only clears bits.
+    *flash_word(address) &= value;
+}
+
+void nrf_nvmc_page_erase(uint32_t address)
+{
+    uint32_t i;
+
+    CHECK((address >= TELEMETRY_LOG_FLASH_START) && (address < TELEMETRY_LOG_FLASH_START + LOG_SIZE));
+    CHECK((address % LOG_PAGE_SIZE) == 0);
+    // Erase halts CPU and loses modem bytes, only telemetry_log_prepare may do it.
+    CHECK(erase_allowed);
+    erases++;
+
+    if (cut_now(CUT_IN_ERASE, CUT_IN_ERASE)) {
+        for (i = 0; i < LOG_PAGE_SIZE; i += 4)
+            *flash_word(address + i) |= random_next();
+        power_cut();
+    }
+
+    memset((void*)(uintptr_t)address, 0xFF, LOG_PAGE_SIZE);
+}
+
+void nrf_nvmc_write_word(uint32_t address, uint32_t value)
+{
+    program_word(address, value);
+}
+
+void nrf_nvmc_write_words(uint32_t address, const uint32_t* src, uint32_t num_words)
+{
+    uint32_t i;
+
+    for (i = 0; i < num_words; i++)
+        program_word(address + i * 4, src[i]);
+}
+
+bool aws_iot_mqtt_is_client_connected(AWS_IoT_Client* pClient)
+{
+    IOT_UNUSED(pClient);
+
+    return connected;
+}
+
+uint8_t aws_iot_mqtt_get_inflight_count(AWS_IoT_Client* pClient)
+{
+    IOT_UNUSED(pClient);
+
+    return inflight_count;
+}
+
+uint8_t aws_iot_mqtt_get_inflight_window(AWS_IoT_Client* pClient)
+{
+    IOT_UNUSED(pClient);
+
+    return MAX_INFLIGHT;
+}
+
+static size_t payload_len(uint32_t id)
+{
+    return 4 + id % (PUBLISH_QUEUE_PAYLOAD_MAX - 3);
+}
+
+static void make_payload(uint32_t id, unsigned char* payload)
+{
+    size_t i;
+
+    memcpy(payload, &id, 4);
+    for (i = 4; i < payload_len(id); i++)
+        payload[i] = (unsigned char)(id * 31 + i);
+}
+
+IoT_Error_t aws_iot_mqtt_publish_async(AWS_IoT_Client* pClient, const char* pTopicName, uint16_t topicNameLen,
+    IoT_Publish_Message_Params* pParams, pPublishCompleteHandler_t completeHandler, void* pCompleteHandlerData)
+{
+    unsigned char expected[PUBLISH_QUEUE_PAYLOAD_MAX];
+    uint32_t id = MAX_IDS;
+
+    IOT_UNUSED(pClient);
+
+    CHECK((topicNameLen == strlen(LOG_TOPIC)) && (memcmp(pTopicName, LOG_TOPIC, topicNameLen) == 0));
+    CHECK(pParams->qos == QOS1);
+    CHECK(inflight_count < MAX_INFLIGHT);
+
+    if (pParams->payloadLen >= 4)
+        memcpy(&id, pParams->payload, 4);
+    if ((id < next_id) && (pParams->payloadLen == payload_len(id))) {
+        make_payload(id, expected);
+        if (memcmp(expected, pParams->payload, pParams->payloadLen) != 0)
+            id = MAX_IDS;
+    } else {
+        id = MAX_IDS;
+    }
+    if (id == MAX_IDS)
+        bad_payloads++;
+
+    inflight[inflight_count].handler = completeHandler;
+    inflight[inflight_count].data = pCompleteHandlerData;
+    inflight[inflight_count].id = id;
+    inflight_count++;
+
+    return SUCCESS;
+}
+
+//PUBACK or timeout for every publish waiting, callback may cut power.
+static void complete_inflight(IoT_Error_t rc)
+{
+    inflight_t done[MAX_INFLIGHT];
+    uint8_t count = inflight_count;
+    uint8_t i;
+
+    memcpy(done, inflight, sizeof(done));
+    inflight_count = 0;
+
+    for (i = 0; i < count; i++) {
+        if ((SUCCESS == rc) && (done[i].id < MAX_IDS))
+            delivered[done[i].id] = true;
+        done[i].handler(NULL, 0, rc, done[i].data);
+    }
+}
+
+static void append_next(void)
+{
+    unsigned char payload[PUBLISH_QUEUE_PAYLOAD_MAX];
+    uint32_t id = next_id++;
+    IoT_Error_t rc;
+
+    if (id >= MAX_IDS)
+        return;
+
+    make_payload(id, payload);
+    rc = telemetry_log_append(payload, payload_len(id));
+    if (SUCCESS == rc) {
+        accepted[id] = true;
+    } else {
+        CHECK(LIMIT_EXCEEDED_ERROR == rc);
+        refused++;
+    }
+}
+
+static void prepare(void)
+{
+    erase_allowed = true;
+    telemetry_log_prepare();
+    erase_allowed = false;
+}
+
+//Reset, RAM state of log is gone. Application initializes log and erases
+//spare page before connecting.
+static void boot(void)
+{
+    telemetry_log_stats_t stats;
+
+    telemetry_log_get_stats(&stats);
+    dropped += stats.dropped;
+
+    connected = false;
+    inflight_count = 0;
+    telemetry_log_init(LOG_TOPIC);
+    prepare();
+}
+
+static void replay(uint32_t passes, bool acked)
+{
+    uint32_t i;
+
+    connected = true;
+    for (i = 0; i < passes; i++) {
+        CHECK(SUCCESS == telemetry_log_replay(NULL));
+        host_timer_advance_ms(TELEMETRY_LOG_REPLAY_INTERVAL_MS);
+        if (inflight_count > 0)
+            complete_inflight(acked ? SUCCESS : MQTT_REQUEST_TIMEOUT_ERROR);
+    }
+    connected = false;
+}
+
+static bool link_unreliable;
+
+//Connected period, on an unreliable link short and mostly without PUBACK.
+static void connected_period(void)
+{
+    if (link_unreliable)
+        replay(random_next() % 30, random_next() % 8 == 0);
+    else
+        replay(200, true);
+}
+
+//Backlog from before reset is replayed, then offline appends erasing spare page
+//every loop iteration like the application, then connected again.
+static void session(void)
+{
+    uint32_t appends = 1 + random_next() % 40;
+    uint32_t i;
+
+    connected_period();
+
+    for (i = 0; i < appends; i++) {
+        prepare();
+        append_next();
+    }
+
+    // Publish queue overflowing while connected, no erase allowed.
+    if (random_next() % 4 == 0)
+        append_next();
+
+    connected_period();
+}
+
+static bool session_until_power_cut(void)
+{
+    if (setjmp(power_loss) != 0)
+        return false;
+
+    session();
+
+    return true;
+}
+
+static void reset_log(void)
+{
+    memset((void*)(uintptr_t)TELEMETRY_LOG_FLASH_START, 0xFF, LOG_SIZE);
+    memset(accepted, 0, sizeof(accepted));
+    memset(delivered, 0, sizeof(delivered));
+    memset(&inflight, 0, sizeof(inflight));
+    next_id = 0;
+    refused = 0;
+    dropped = 0;
+    cuts = 0;
+    erases = 0;
+    bad_payloads = 0;
+    cut_mode = CUT_NONE;
+    telemetry_log_init(LOG_TOPIC);
+}
+
+static void test_power_loss(const char* name, cut_mode_t mode, uint32_t max_countdown, bool unreliable)
+{
+    telemetry_log_stats_t stats;
+    uint32_t accepted_count = 0;
+    uint32_t missing = 0;
+    uint32_t round;
+    uint32_t id;
+
+    reset_log();
+    link_unreliable = unreliable;
+    boot();
+
+    for (round = 0; round < 400; round++) {
+        cut_mode = mode;
+        cut_countdown = random_next() % max_countdown;
+        session_until_power_cut();
+        cut_mode = CUT_NONE;
+        boot();
+    }
+
+    // Link finally stays up long enough to send everything.
+    for (round = 0; round < 1000; round++) {
+        telemetry_log_get_stats(&stats);
+        if (stats.pending == 0)
+            break;
+        replay(100, true);
+    }
+    telemetry_log_get_stats(&stats);
+    dropped += stats.dropped;
+    CHECK(stats.pending == 0);
+
+    for (id = 0; id < next_id; id++) {
+        if (!accepted[id])
+            continue;
+        accepted_count++;
+        if (!delivered[id])
+            missing++;
+    }
+
+    printf("%s: %lu power cuts, %lu appended, %lu refused, %lu erases, %lu dropped, %lu lost\n", name,
+        (unsigned long)cuts, (unsigned long)accepted_count, (unsigned long)refused, (unsigned long)erases,
+        (unsigned long)dropped, (unsigned long)missing);
+
+    CHECK(cuts > 0);
+    CHECK(bad_payloads == 0);
+    // Dropping may count batches that were also sent before, never fewer than lost.
+    CHECK(missing <= dropped);
+    if (!unreliable)
+        CHECK(dropped == 0);
+    else
+        CHECK(dropped > 0);
+}
+
+//Appends need an erased page, only telemetry_log_prepare provides one.
+static void test_spare_page(void)
+{
+    unsigned char payload[PUBLISH_QUEUE_PAYLOAD_MAX];
+    uint32_t per_page = (LOG_PAGE_SIZE - 8) / (PUBLISH_QUEUE_PAYLOAD_MAX + 12);
+    telemetry_log_stats_t stats;
+    uint32_t i;
+    uint32_t page;
+
+    reset_log();
+    memset(payload, 0x5A, sizeof(payload));
+
+    // Blank flash, first page needs no erase.
+    for (i = 0; i < per_page; i++)
+        CHECK(SUCCESS == telemetry_log_append(payload, sizeof(payload)));
+    CHECK(LIMIT_EXCEEDED_ERROR == telemetry_log_append(payload, sizeof(payload)));
+    CHECK(erases == 0);
+
+    prepare();
+    CHECK(SUCCESS == telemetry_log_append(payload, sizeof(payload)));
+    CHECK(erases == 0);
+
+    // Fill every page, oldest is dropped once its page is needed as spare.
+    for (page = 0; page < TELEMETRY_LOG_PAGES; page++) {
+        for (i = 0; i < per_page; i++) {
+            prepare();
+            CHECK(SUCCESS == telemetry_log_append(payload, sizeof(payload)));
+        }
+    }
+    telemetry_log_get_stats(&stats);
+    CHECK(erases == 2);
+    CHECK(stats.dropped == 2 * per_page);
+    CHECK(stats.pending + stats.dropped == stats.appended);
+
+    // Same state is found again after reset.
+    telemetry_log_init(LOG_TOPIC);
+    telemetry_log_get_stats(&stats);
+    CHECK(stats.pending == (TELEMETRY_LOG_PAGES - 1) * per_page + 1);
+    CHECK(stats.torn == 0);
+    prepare();
+    telemetry_log_get_stats(&stats);
+    CHECK(erases == 3);
+    CHECK(stats.dropped == per_page);
+
+    printf("spare page: %lu records per page, %lu erases\n", (unsigned long)per_page, (unsigned long)erases);
+}
+
+int main(void)
+{
+    void* flash = mmap((void*)(uintptr_t)TELEMETRY_LOG_FLASH_START, LOG_SIZE, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+
+    if (flash != (void*)(uintptr_t)TELEMETRY_LOG_FLASH_START) {
+        perror("mmap telemetry log flash");
+        return 1;
+    }
+
+    test_spare_page();
+    test_power_loss("cut after words", CUT_AFTER_WORDS, 400, false);
+    test_power_loss("cut in word", CUT_IN_WORD, 400, false);
+    test_power_loss("cut in erase", CUT_IN_ERASE, 3, true);
+    test_power_loss("cut after words, log full", CUT_AFTER_WORDS, 400, true);
+    test_power_loss("cut in word, log full", CUT_IN_WORD, 400, true);
+
+    return test_result("test_telemetry_log");
+}
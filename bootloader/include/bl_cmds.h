@@ -22,7 +22,8 @@
 
 #define MAX_FW_STORAGE_PATH 31
 #define MIN_FP_BASE_ADDRESS 0x1000
-#define MAX_FP_BASE_ADDRESS 0x000F0000
+#define MAX_FP_BASE_ADDRESS 0x000E0000 //Application end, pages above up to bootloader hold application telemetry log.
+#define BL_BASE_ADDRESS 0x000F0000
 #define MAX_EBIN_SIZE 0x100000 //1MB
 
 #define MAX_PROGRAMMING_ATTEMPTS 10
@@ -27,6 +27,7 @@ import os
 import sys
 from datetime import datetime
 import mimetypes
+import hashlib
 
 mimetypes.init()
 
@@ -67,7 +68,11 @@ for p in root_dir.glob('**/*'):
         if p.suffix in null_termination_required:
             add_null = 1
             
-        info_struct += '\t{{"{0}", {1}, {2}, {3}, "{4}"}},\n'.format(target_path, index, target_length, add_null, mime_type_name)
+        # content hash lets the device skip re-provisioning unchanged files (e.g. modem certificates).
+        with open(str(p), "rb") as f:
+            digest = hashlib.sha256(f.read()).hexdigest()
+
+        info_struct += '\t{{"{0}", {1}, {2}, {3}, "{4}", "{5}"}},\n'.format(target_path, index, target_length, add_null, mime_type_name, digest)
         code = "\t/* filepath = {0}, index = {1}, length = {2}, null_added = {3} */\n\t".format(target_path, index, target_length, add_null)
         src_f.write(code)
         with open(str(p), "rb") as f:
@@ -0,0 +1,230 @@
+#
+# Copyright 2019-2020 Ravikiran Bukkasagara <contact@ravikiranb.com>
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#    http://www.apache.org/licenses/LICENSE-2.0
+#    
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+
+"""
+Description:
+Decodes telemetry batch payloads published by the device, see
+app/include/telemetry_batch.h for the format.
+
+Usage:
+    python main.py decode <hex payload | payload file>
+        Prints timestamp and temperature of each sample as CSV, or
+        timestamp, count, min, mean and max of each window summary.
+    python main.py ratio <samples.csv>
+        Encodes recorded "timestamp,temperature" rows the way the device
+        does and prints payload bytes per sample of text, fixed and delta
+        formats.
+"""
+
+import struct
+import sys
+from datetime import datetime, timezone
+from pathlib import Path
+
+FORMAT_FIXED = 1
+FORMAT_DELTA = 2
+FORMAT_STATS = 3
+HEADER_LEN = 6
+# same as TELEMETRY_BATCH_MAX_SAMPLES, TELEMETRY_BATCH_MAX_AGE_SEC and PUBLISH_QUEUE_PAYLOAD_MAX
+MAX_SAMPLES = 16
+MAX_AGE_SEC = 900
+PAYLOAD_MAX = 128
+DELTA_SAMPLE_MAX_LEN = 8
+
+
+def read_varint(data, pos):
+    value = 0
+    shift = 0
+    while True:
+        if pos >= len(data):
+            raise ValueError("truncated varint")
+        byte = data[pos]
+        pos += 1
+        value |= (byte & 0x7F) << shift
+        shift += 7
+        if not byte & 0x80:
+            return value, pos
+
+
+def unzigzag(value):
+    return (value >> 1) ^ -(value & 1)
+
+
+def zigzag(value):
+    return (value << 1) if value >= 0 else ((-value << 1) - 1)
+
+
+def write_varint(value):
+    out = bytearray()
+    while value >= 0x80:
+        out.append((value & 0x7F) | 0x80)
+        value >>= 7
+    out.append(value)
+    return bytes(out)
+
+
+def decode(payload):
+    """Returns list of (timestamp, temperature) tuples, or for summaries
+    (timestamp, count, min, mean, max) tuples in 0.25 C units."""
+    if len(payload) < HEADER_LEN:
+        raise ValueError("payload shorter than header")
+    fmt, count, base = struct.unpack(">BBI", payload[:HEADER_LEN])
+    samples = []
+    pos = HEADER_LEN
+
+    if fmt == FORMAT_FIXED:
+        for _ in range(count):
+            offset, temperature = struct.unpack(">Hh", payload[pos:pos + 4])
+            pos += 4
+            samples.append((base + offset, temperature))
+    elif fmt == FORMAT_DELTA:
+        timestamp = base
+        delta = 0
+        temperature = 0
+        for _ in range(count):
+            dod, pos = read_varint(payload, pos)
+            delta += unzigzag(dod)
+            timestamp += delta
+            diff, pos = read_varint(payload, pos)
+            temperature += unzigzag(diff)
+            samples.append((timestamp, temperature))
+    elif fmt == FORMAT_STATS:
+        timestamp = base
+        delta = 0
+        mean = 0
+        for _ in range(count):
+            dod, pos = read_varint(payload, pos)
+            delta += unzigzag(dod)
+            timestamp += delta
+            diff, pos = read_varint(payload, pos)
+            mean += unzigzag(diff)
+            below, pos = read_varint(payload, pos)
+            above, pos = read_varint(payload, pos)
+            n, pos = read_varint(payload, pos)
+            samples.append((timestamp, n, mean - below, mean, mean + above))
+    else:
+        raise ValueError("unknown format {0}".format(fmt))
+
+    if pos != len(payload):
+        raise ValueError("{0} bytes left after {1} samples".format(len(payload) - pos, count))
+    return samples
+
+
+def encode_batches(samples, fmt):
+    """Splits samples into batches the way telemetry_batch.c does, returns payloads."""
+    batches = []
+    body = bytearray()
+    count = 0
+    base = prev_timestamp = prev_delta = prev_temperature = 0
+
+    def flush():
+        batches.append(struct.pack(">BBI", fmt, count, base) + bytes(body))
+
+    for timestamp, temperature in samples:
+        if count > 0 and (timestamp < prev_timestamp or timestamp - base >= MAX_AGE_SEC or
+                          (fmt == FORMAT_FIXED and timestamp - base > 0xFFFF)):
+            flush()
+            count = 0
+        if count == 0:
+            body = bytearray()
+            base = prev_timestamp = timestamp
+            prev_delta = prev_temperature = 0
+
+        if fmt == FORMAT_FIXED:
+            body += struct.pack(">Hh", timestamp - base, temperature)
+            sample_max_len = 4
+        else:
+            delta = timestamp - prev_timestamp
+            body += write_varint(zigzag(delta - prev_delta))
+            body += write_varint(zigzag(temperature - prev_temperature))
+            prev_delta = delta
+            sample_max_len = DELTA_SAMPLE_MAX_LEN
+        prev_timestamp = timestamp
+        prev_temperature = temperature
+        count += 1
+
+        if count == MAX_SAMPLES or HEADER_LEN + len(body) + sample_max_len > PAYLOAD_MAX:
+            flush()
+            count = 0
+
+    if count > 0:
+        flush()
+    return batches
+
+
+def load_payload(arg):
+    path = Path(arg)
+    if path.is_file():
+        return path.read_bytes()
+    return bytes.fromhex(arg)
+
+
+def load_samples(path):
+    samples = []
+    with open(path) as f:
+        for line in f:
+            line = line.strip()
+            if not line or line[0] == "#":
+                continue
+            timestamp, temperature = line.split(",")[:2]
+            samples.append((int(timestamp), int(temperature)))
+    return samples
+
+
+def main(argv):
+    if len(argv) != 3 or argv[1] not in ("decode", "ratio"):
+        print(__doc__)
+        return 1
+
+    if argv[1] == "decode":
+        payload = load_payload(argv[2])
+        samples = decode(payload)
+        if payload[0] == FORMAT_STATS:
+            print("timestamp,utc,count,min,mean,max")
+        else:
+            print("timestamp,utc,temperature")
+        for sample in samples:
+            utc = datetime.fromtimestamp(sample[0], timezone.utc).strftime("%Y-%m-%d %H:%M:%S")
+            if payload[0] == FORMAT_STATS:
+                print("{0},{1},{2},{3:.2f},{4:.2f},{5:.2f}".format(sample[0], utc, sample[1],
+                                                               sample[2] / 4, sample[3] / 4, sample[4] / 4))
+            else:
+                print("{0},{1},{2}".format(sample[0], utc, sample[1]))
+        return 0
+
+    samples = load_samples(argv[2])
+    if not samples:
+        print("No samples in {0}".format(argv[2]))
+        return 1
+
+    text = sum(len("Temperature: {0} C\r\nTimestamp: {1}".format(t, ts)) for ts, t in samples)
+    print("{0} samples".format(len(samples)))
+    print("text:  {0:6d} bytes, {1:5.2f} per sample, 1 publish per sample".format(text, text / len(samples)))
+    for name, fmt in (("fixed", FORMAT_FIXED), ("delta", FORMAT_DELTA)):
+        batches = encode_batches(samples, fmt)
+        size = sum(len(b) for b in batches)
+        # Round trip, decoder must return what was encoded
+        decoded = [s for b in batches for s in decode(b)]
+        if decoded != samples:
+            print("{0}: decoded samples differ".format(name))
+            return 1
+        print("{0}: {1:6d} bytes, {2:5.2f} per sample, {3} publishes, ratio {4:.1f}x to text".format(
+            name, size, size / len(samples), len(batches), text / size))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))